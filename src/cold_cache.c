@@ -0,0 +1,316 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cold_cache.h"
+#include "shared_memory.h"
+#include "utils.h"
+
+#define DROP_CACHES_PATH "/proc/sys/vm/drop_caches"
+/* Page cache, dentries and inodes. */
+#define DROP_CACHES_VALUE "3"
+
+/* Counters updated by whichever worker evicts caches, in shared memory
+   for workers which are processes to be accounted in the report of the
+   runner. */
+typedef struct
+{
+    /* Error of the last attempt to drop caches, once set dropping caches is
+       not attempted anymore. */
+    int drop_caches_error;
+    uint64_t evictions;
+    uint64_t drop_caches_done;
+    uint64_t files_evicted;
+    uint64_t files_failed;
+} mt_fs_tests_cold_cache_counters;
+
+typedef struct
+{
+    char ** paths;
+    size_t paths_count;
+    mt_fs_tests_cold_cache_counters * counters;
+    bool enabled;
+} mt_fs_tests_cold_cache_state;
+
+static mt_fs_tests_cold_cache_state state;
+
+int mt_fs_tests_cold_cache_enable(void)
+{
+    int result = 0;
+
+    if (state.counters == NULL)
+    {
+        state.counters = mt_fs_tests_shared_calloc(1,
+                                                   sizeof *(state.counters));
+    }
+
+    if (state.counters != NULL)
+    {
+        state.enabled = true;
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+bool mt_fs_tests_cold_cache_enabled(void)
+{
+    return state.enabled;
+}
+
+static int mt_fs_tests_cold_cache_drop_caches(void)
+{
+    int result = 0;
+    int fd = -1;
+
+    /* drop_caches only drops clean pages. */
+    sync();
+
+    fd = open(DROP_CACHES_PATH,
+              O_WRONLY | O_CLOEXEC);
+
+    if (fd != -1)
+    {
+        ssize_t const written = write(fd,
+                                      DROP_CACHES_VALUE,
+                                      sizeof DROP_CACHES_VALUE - 1);
+
+        if (written == -1)
+        {
+            result = errno;
+        }
+        else if ((size_t) written != sizeof DROP_CACHES_VALUE - 1)
+        {
+            result = EIO;
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static int mt_fs_tests_cold_cache_evict_file(char const * const path)
+{
+    int result = 0;
+    int fd = open(path,
+                  O_RDONLY | O_CLOEXEC);
+
+    if (fd != -1)
+    {
+        /* Dirty pages are not evicted, write them back first. */
+        if (fsync(fd) == 0)
+        {
+            result = posix_fadvise(fd,
+                                   0,
+                                   0,
+                                   POSIX_FADV_DONTNEED);
+        }
+        else
+        {
+            result = errno;
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    if (result == 0)
+    {
+        __atomic_add_fetch(&(state.counters->files_evicted), 1, __ATOMIC_RELAXED);
+    }
+    else
+    {
+        __atomic_add_fetch(&(state.counters->files_failed), 1, __ATOMIC_RELAXED);
+        LOG_DEBUG("Unable to evict %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+int mt_fs_tests_cold_cache_evict_path(char const * const path)
+{
+    int result = 0;
+    assert(path != NULL);
+
+    if (state.enabled == true)
+    {
+        result = mt_fs_tests_cold_cache_evict_file(path);
+    }
+
+    return result;
+}
+
+void mt_fs_tests_cold_cache_evict_phase(mt_fs_tests_barrier_t * const barrier)
+{
+    assert(barrier != NULL);
+
+    if (state.enabled == true &&
+        mt_fs_tests_barrier_wait(barrier) == MT_FS_TESTS_BARRIER_SERIAL_THREAD)
+    {
+        mt_fs_tests_cold_cache_evict();
+    }
+}
+
+void mt_fs_tests_cold_cache_evict(void)
+{
+    if (state.enabled == true)
+    {
+        mt_fs_tests_cold_cache_counters * const counters = state.counters;
+        int drop_caches_error = __atomic_load_n(&(counters->drop_caches_error), __ATOMIC_RELAXED);
+
+        __atomic_add_fetch(&(counters->evictions), 1, __ATOMIC_RELAXED);
+
+        if (drop_caches_error == 0)
+        {
+            drop_caches_error = mt_fs_tests_cold_cache_drop_caches();
+
+            if (drop_caches_error == 0)
+            {
+                __atomic_add_fetch(&(counters->drop_caches_done), 1, __ATOMIC_RELAXED);
+            }
+            else
+            {
+                __atomic_store_n(&(counters->drop_caches_error), drop_caches_error, __ATOMIC_RELAXED);
+                LOG_DEBUG("Unable to drop caches through %s: %d, falling back to per-file eviction",
+                          DROP_CACHES_PATH,
+                          drop_caches_error);
+            }
+        }
+
+        if (drop_caches_error != 0)
+        {
+            for (size_t idx = 0;
+                 idx < state.paths_count;
+                 idx++)
+            {
+                mt_fs_tests_cold_cache_evict_file(state.paths[idx]);
+            }
+        }
+    }
+}
+
+void mt_fs_tests_cold_cache_report(char const * const suite_name)
+{
+    assert(suite_name != NULL);
+
+    if (state.enabled == true)
+    {
+        mt_fs_tests_cold_cache_counters * const counters = state.counters;
+
+        if (counters->evictions > 0)
+        {
+            if (counters->drop_caches_done == counters->evictions)
+            {
+                LOG_OK("%s: cold cache, page, dentry and inode caches dropped %llu times",
+                       suite_name,
+                       (unsigned long long) counters->drop_caches_done);
+            }
+            else
+            {
+                LOG_OK("%s: cold cache, caches dropped %llu of %llu times (%s: %d), %llu files evicted from the page cache (%llu failures), dentry and inode caches stay warm",
+                       suite_name,
+                       (unsigned long long) counters->drop_caches_done,
+                       (unsigned long long) counters->evictions,
+                       DROP_CACHES_PATH,
+                       counters->drop_caches_error,
+                       (unsigned long long) counters->files_evicted,
+                       (unsigned long long) counters->files_failed);
+            }
+        }
+
+        counters->evictions = 0;
+        counters->drop_caches_done = 0;
+        counters->files_evicted = 0;
+        counters->files_failed = 0;
+    }
+}
+
+int mt_fs_tests_cold_cache_track(char const * const path)
+{
+    int result = 0;
+    assert(path != NULL);
+
+    if (state.enabled == true)
+    {
+        char ** const new_paths = realloc(state.paths,
+                                          sizeof *new_paths * (state.paths_count + 1));
+
+        if (new_paths != NULL)
+        {
+            state.paths = new_paths;
+            state.paths[state.paths_count] = strdup(path);
+
+            if (state.paths[state.paths_count] != NULL)
+            {
+                state.paths_count++;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+void mt_fs_tests_cold_cache_untrack(char const * const path)
+{
+    assert(path != NULL);
+
+    for (size_t idx = 0;
+         idx < state.paths_count;
+         idx++)
+    {
+        if (strcmp(state.paths[idx], path) == 0)
+        {
+            free(state.paths[idx]);
+            state.paths[idx] = state.paths[state.paths_count - 1];
+            state.paths[state.paths_count - 1] = NULL;
+            state.paths_count--;
+            break;
+        }
+    }
+}
+
+void mt_fs_tests_cold_cache_free(void)
+{
+    for (size_t idx = 0;
+         idx < state.paths_count;
+         idx++)
+    {
+        free(state.paths[idx]), state.paths[idx] = NULL;
+    }
+
+    free(state.paths), state.paths = NULL;
+    state.paths_count = 0;
+
+    if (state.counters != NULL)
+    {
+        mt_fs_tests_shared_free(state.counters), state.counters = NULL;
+    }
+
+    state.enabled = false;
+}
@@ -0,0 +1,901 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <limits.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "coordinator.h"
+#include "prng.h"
+#include "races.h"
+#include "utils.h"
+
+/* "MTFSCRD2", changed whenever the layout of the segment changes, so that a
+   client does not attach to a coordinator built from another version. */
+#define COORDINATOR_MAGIC (UINT64_C(0x4d54465343524432))
+#define COORDINATOR_NAME_PREFIX "/mt-fs-tests-"
+#define COORDINATOR_NAME_SIZE (256)
+#define COORDINATOR_DIRECTORY_SIZE (256)
+/* Waits between steps are not timed, polling is good enough. */
+#define COORDINATOR_POLL_NS (1000000)
+/* Clients may be started before the coordinator, and the other way around. */
+#define COORDINATOR_ATTACH_TIMEOUT_SEC (60)
+#define COORDINATOR_CACHE_LINE_SIZE (64)
+
+typedef struct
+{
+    mt_fs_tests_ops_summary summary;
+    char directory[COORDINATOR_DIRECTORY_SIZE];
+    /* Last step for which the client is ready, and whether it is. */
+    uint64_t ready_step;
+    int ready_status;
+    /* Last step for which the client published its results. */
+    uint64_t done_step;
+    int done_status;
+    /* Expectations of the race on targets shared by the clients, if any. */
+    mt_fs_tests_expectation expectations[MT_FS_TESTS_RACES_MAX_EXPECTATIONS];
+    size_t nb_expectations;
+    /* Set once the client is attached. */
+    pid_t pid;
+    uint32_t claimed;
+} __attribute__((aligned(COORDINATOR_CACHE_LINE_SIZE))) coordinator_client;
+
+typedef struct
+{
+    /* Set last by the coordinator, once the segment is initialized. */
+    uint64_t magic;
+    mt_fs_tests_coordinator_config config;
+    mt_fs_tests_barrier_t barrier;
+    size_t nb_clients;
+    pid_t coordinator_pid;
+    /* Last step clients are allowed to run, or to skip. */
+    uint64_t go_step;
+    uint32_t go_skipped;
+    /* Set when the coordinator stops, before the last step or not. */
+    uint32_t finished;
+    coordinator_client clients[MT_FS_TESTS_COORDINATOR_MAX_CLIENTS];
+} coordinator_segment;
+
+struct mt_fs_tests_coordinator
+{
+    coordinator_segment * segment;
+    char name[COORDINATOR_NAME_SIZE];
+    size_t client_id;
+    uint64_t step;
+    bool is_coordinator;
+    bool unlinked;
+};
+
+static int coordinator_make_name(char * const out,
+                                 char const * const name)
+{
+    int result = 0;
+    int const res = snprintf(out,
+                             COORDINATOR_NAME_SIZE,
+                             "%s%s",
+                             COORDINATOR_NAME_PREFIX,
+                             name);
+
+    if (name[0] == '\0' ||
+        strchr(name, '/') != NULL)
+    {
+        result = EINVAL;
+    }
+    else if (res < 0 ||
+             (size_t) res >= COORDINATOR_NAME_SIZE)
+    {
+        result = ENAMETOOLONG;
+    }
+
+    return result;
+}
+
+static void coordinator_sleep(void)
+{
+    struct timespec const delay =
+        {
+            .tv_sec = 0,
+            .tv_nsec = COORDINATOR_POLL_NS
+        };
+
+    nanosleep(&delay, NULL);
+}
+
+static bool coordinator_process_alive(pid_t const pid)
+{
+    /* EPERM still means that the process exists. */
+    return kill(pid, 0) == 0 || errno != ESRCH;
+}
+
+int mt_fs_tests_coordinator_create(mt_fs_tests_coordinator ** const coordinator,
+                                   char const * const name,
+                                   size_t const nb_clients,
+                                   mt_fs_tests_coordinator_config const * const config)
+{
+    int result = 0;
+    mt_fs_tests_coordinator * result_coordinator = NULL;
+    assert(coordinator != NULL);
+    assert(name != NULL);
+    assert(config != NULL);
+
+    if (nb_clients == 0 ||
+        nb_clients > MT_FS_TESTS_COORDINATOR_MAX_CLIENTS)
+    {
+        result = EINVAL;
+        LOG_ERROR("The number of clients has to be between 1 and %d",
+                  MT_FS_TESTS_COORDINATOR_MAX_CLIENTS);
+    }
+    else
+    {
+        result_coordinator = calloc(1, sizeof *result_coordinator);
+
+        if (result_coordinator != NULL)
+        {
+            result_coordinator->is_coordinator = true;
+            /* Until the segment is created. */
+            result_coordinator->unlinked = true;
+            result = coordinator_make_name(result_coordinator->name,
+                                           name);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Invalid coordination name %s: %d",
+                          name,
+                          result);
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if (result == 0)
+    {
+        int const fd = shm_open(result_coordinator->name,
+                                O_RDWR | O_CREAT | O_EXCL,
+                                S_IRUSR | S_IWUSR);
+
+        if (fd >= 0)
+        {
+            result_coordinator->unlinked = false;
+
+            /* The new object is zero-filled. */
+            if (ftruncate(fd, (off_t) sizeof *(result_coordinator->segment)) == 0)
+            {
+                result_coordinator->segment = mmap(NULL,
+                                                   sizeof *(result_coordinator->segment),
+                                                   PROT_READ | PROT_WRITE,
+                                                   MAP_SHARED,
+                                                   fd,
+                                                   0);
+
+                if (result_coordinator->segment == MAP_FAILED)
+                {
+                    result = errno;
+                    result_coordinator->segment = NULL;
+                }
+            }
+            else
+            {
+                result = errno;
+            }
+
+            close(fd);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error creating shared memory segment %s: %d",
+                          result_coordinator->name,
+                          result);
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating shared memory segment %s: %d%s",
+                      result_coordinator->name,
+                      result,
+                      result == EEXIST ? ", left by a previous coordinator? It lives in /dev/shm" : "");
+        }
+    }
+
+    if (result == 0)
+    {
+        coordinator_segment * const segment = result_coordinator->segment;
+        uint64_t const deadline = mt_fs_tests_now_ns() + COORDINATOR_ATTACH_TIMEOUT_SEC * MT_FS_TESTS_NS_PER_SEC;
+
+        segment->config = *config;
+        segment->nb_clients = nb_clients;
+        segment->coordinator_pid = getpid();
+
+        __atomic_store_n(&(segment->magic),
+                         COORDINATOR_MAGIC,
+                         __ATOMIC_RELEASE);
+
+        LOG_OK("Waiting for %zu clients to attach to %s",
+               nb_clients,
+               result_coordinator->name);
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < nb_clients;
+             idx++)
+        {
+            coordinator_client const * const client = &(segment->clients[idx]);
+            pid_t pid = 0;
+
+            while ((pid = __atomic_load_n(&(client->pid), __ATOMIC_ACQUIRE)) == 0 &&
+                   mt_fs_tests_now_ns() < deadline)
+            {
+                coordinator_sleep();
+            }
+
+            if (pid != 0)
+            {
+                LOG_OK("Client %zu attached, process %d, directory %s",
+                       idx,
+                       (int) pid,
+                       client->directory);
+            }
+            else
+            {
+                result = ETIMEDOUT;
+                LOG_ERROR("Client %zu did not attach to %s within %d s",
+                          idx,
+                          result_coordinator->name,
+                          COORDINATOR_ATTACH_TIMEOUT_SEC);
+            }
+        }
+    }
+
+    if (result == 0)
+    {
+        /* Attached processes keep their mapping, the name is not needed
+           anymore and would be left behind if the coordinator were killed. */
+        shm_unlink(result_coordinator->name);
+        result_coordinator->unlinked = true;
+
+        *coordinator = result_coordinator;
+    }
+    else if (result_coordinator != NULL)
+    {
+        /* Also tells clients already attached that no step will come. */
+        mt_fs_tests_coordinator_free(result_coordinator), result_coordinator = NULL;
+    }
+
+    return result;
+}
+
+/* Returns EAGAIN if the segment does not exist yet, or is not initialized. */
+static int coordinator_map(mt_fs_tests_coordinator * const coordinator)
+{
+    int result = 0;
+    int const fd = shm_open(coordinator->name,
+                            O_RDWR,
+                            0);
+
+    if (fd >= 0)
+    {
+        struct stat st;
+
+        if (fstat(fd, &st) == 0)
+        {
+            if ((size_t) st.st_size == sizeof *(coordinator->segment))
+            {
+                coordinator->segment = mmap(NULL,
+                                            sizeof *(coordinator->segment),
+                                            PROT_READ | PROT_WRITE,
+                                            MAP_SHARED,
+                                            fd,
+                                            0);
+
+                if (coordinator->segment == MAP_FAILED)
+                {
+                    result = errno;
+                    coordinator->segment = NULL;
+                }
+                else if (__atomic_load_n(&(coordinator->segment->magic), __ATOMIC_ACQUIRE) != COORDINATOR_MAGIC)
+                {
+                    munmap(coordinator->segment,
+                           sizeof *(coordinator->segment));
+                    coordinator->segment = NULL;
+                    result = EAGAIN;
+                }
+            }
+            else if (st.st_size == 0)
+            {
+                /* Not sized by the coordinator yet. */
+                result = EAGAIN;
+            }
+            else
+            {
+                result = EPROTO;
+            }
+        }
+        else
+        {
+            result = errno;
+        }
+
+        close(fd);
+    }
+    else
+    {
+        result = errno == ENOENT ? EAGAIN : errno;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_coordinator_attach(mt_fs_tests_coordinator ** const coordinator,
+                                   char const * const name,
+                                   size_t const client_id,
+                                   char const * const directory)
+{
+    int result = 0;
+    mt_fs_tests_coordinator * result_coordinator = NULL;
+    assert(coordinator != NULL);
+    assert(name != NULL);
+    assert(directory != NULL);
+
+    result_coordinator = calloc(1, sizeof *result_coordinator);
+
+    if (result_coordinator != NULL)
+    {
+        /* Unlinking is up to the coordinator. */
+        result_coordinator->unlinked = true;
+        result_coordinator->client_id = client_id;
+        result = coordinator_make_name(result_coordinator->name,
+                                       name);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Invalid coordination name %s: %d",
+                      name,
+                      result);
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    if (result == 0)
+    {
+        uint64_t const deadline = mt_fs_tests_now_ns() + COORDINATOR_ATTACH_TIMEOUT_SEC * MT_FS_TESTS_NS_PER_SEC;
+
+        while ((result = coordinator_map(result_coordinator)) == EAGAIN &&
+               mt_fs_tests_now_ns() < deadline)
+        {
+            coordinator_sleep();
+        }
+
+        if (result == EAGAIN)
+        {
+            result = ETIMEDOUT;
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error attaching to coordinator %s: %d",
+                      result_coordinator->name,
+                      result);
+        }
+    }
+
+    if (result == 0)
+    {
+        coordinator_segment * const segment = result_coordinator->segment;
+
+        if (client_id < segment->nb_clients)
+        {
+            coordinator_client * const client = &(segment->clients[client_id]);
+            uint32_t expected = 0;
+
+            if (__atomic_compare_exchange_n(&(client->claimed),
+                                            &expected,
+                                            1,
+                                            false,
+                                            __ATOMIC_ACQ_REL,
+                                            __ATOMIC_ACQUIRE))
+            {
+                snprintf(client->directory,
+                         sizeof client->directory,
+                         "%s",
+                         directory);
+
+                __atomic_store_n(&(client->pid),
+                                 getpid(),
+                                 __ATOMIC_RELEASE);
+
+                LOG_OK("Attached to %s as client %zu of %zu",
+                       result_coordinator->name,
+                       client_id,
+                       segment->nb_clients);
+            }
+            else
+            {
+                result = EBUSY;
+                LOG_ERROR("Client %zu is already attached to %s",
+                          client_id,
+                          result_coordinator->name);
+            }
+        }
+        else
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid client id %zu, coordinator %s expects %zu clients",
+                      client_id,
+                      result_coordinator->name,
+                      segment->nb_clients);
+        }
+    }
+
+    if (result == 0)
+    {
+        *coordinator = result_coordinator;
+    }
+    else if (result_coordinator != NULL)
+    {
+        mt_fs_tests_coordinator_free(result_coordinator), result_coordinator = NULL;
+    }
+
+    return result;
+}
+
+mt_fs_tests_coordinator_config const * mt_fs_tests_coordinator_get_config(mt_fs_tests_coordinator const * const coordinator)
+{
+    assert(coordinator != NULL);
+    assert(coordinator->segment != NULL);
+
+    return &(coordinator->segment->config);
+}
+
+size_t mt_fs_tests_coordinator_get_client_id(mt_fs_tests_coordinator const * const coordinator)
+{
+    assert(coordinator != NULL);
+    assert(coordinator->is_coordinator == false);
+
+    return coordinator->client_id;
+}
+
+uint64_t mt_fs_tests_coordinator_get_step_key(mt_fs_tests_coordinator const * const coordinator)
+{
+    uint64_t x = 0;
+    assert(coordinator != NULL);
+    assert(coordinator->segment != NULL);
+
+    /* Mixed like the streams of prng.c, so that the keys of different
+       coordinations, seeds and steps are unrelated. */
+    for (char const * ptr = coordinator->name;
+         *ptr != '\0';
+         ptr++)
+    {
+        x = mt_fs_tests_prng_splitmix64(&x) ^ (uint64_t) (unsigned char) *ptr;
+    }
+
+    x = mt_fs_tests_prng_splitmix64(&x) ^ coordinator->segment->config.seed;
+    /* The step of a client is only incremented once the suite is
+       initialized. */
+    x = mt_fs_tests_prng_splitmix64(&x) ^ (coordinator->step + 1);
+
+    return mt_fs_tests_prng_splitmix64(&x);
+}
+
+mt_fs_tests_barrier_t * mt_fs_tests_coordinator_get_barrier(mt_fs_tests_coordinator * const coordinator)
+{
+    assert(coordinator != NULL);
+    assert(coordinator->segment != NULL);
+
+    return &(coordinator->segment->barrier);
+}
+
+/* Waits for all clients to be ready for, or done with, the current step.
+   All pending clients are checked, the workers of a live one may be waiting
+   forever on the barrier for those of a dead one. */
+static int coordinator_wait_clients(mt_fs_tests_coordinator const * const coordinator,
+                                    bool const done)
+{
+    int result = 0;
+    coordinator_segment * const segment = coordinator->segment;
+    bool pending = true;
+
+    while (result == 0 &&
+           pending == true)
+    {
+        pending = false;
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < segment->nb_clients;
+             idx++)
+        {
+            coordinator_client * const client = &(segment->clients[idx]);
+            uint64_t * const step = done == true ? &(client->done_step) : &(client->ready_step);
+
+            if (__atomic_load_n(step, __ATOMIC_ACQUIRE) < coordinator->step)
+            {
+                if (coordinator_process_alive(client->pid) == true)
+                {
+                    pending = true;
+                }
+                else
+                {
+                    result = ESRCH;
+                    LOG_ERROR("Client %zu (process %d) exited before the end of the run",
+                              idx,
+                              (int) client->pid);
+                }
+            }
+        }
+
+        if (result == 0 &&
+            pending == true)
+        {
+            coordinator_sleep();
+        }
+    }
+
+    if (result != 0)
+    {
+        /* Their workers may be stuck on the barrier, which cannot be
+           released anymore. */
+        for (size_t idx = 0;
+             idx < segment->nb_clients;
+             idx++)
+        {
+            coordinator_client const * const client = &(segment->clients[idx]);
+
+            if (__atomic_load_n(&(client->done_step), __ATOMIC_ACQUIRE) < coordinator->step &&
+                coordinator_process_alive(client->pid) == true)
+            {
+                LOG_ERROR("Terminating client %zu (process %d)",
+                          idx,
+                          (int) client->pid);
+                kill(client->pid, SIGTERM);
+            }
+        }
+    }
+
+    return result;
+}
+
+static void coordinator_report(mt_fs_tests_coordinator const * const coordinator,
+                               char const * const suite_name)
+{
+    coordinator_segment const * const segment = coordinator->segment;
+    mt_fs_tests_ops_summary combined;
+    uint64_t last_start_ns = 0;
+    size_t nb_active = 0;
+
+    mt_fs_tests_histogram_reset(&(combined.latency));
+    mt_fs_tests_outcomes_reset(&(combined.outcomes));
+    combined.ops_count = 0;
+    combined.errors_count = 0;
+    combined.start_ns = UINT64_MAX;
+    combined.end_ns = 0;
+
+    for (size_t idx = 0;
+         idx < segment->nb_clients;
+         idx++)
+    {
+        coordinator_client const * const client = &(segment->clients[idx]);
+        mt_fs_tests_ops_summary const * const summary = &(client->summary);
+
+        if (summary->ops_count > 0)
+        {
+            double const duration = (double) (summary->end_ns - summary->start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+            uint64_t const p50 = mt_fs_tests_histogram_percentile(&(summary->latency), 50.0);
+            uint64_t const p99 = mt_fs_tests_histogram_percentile(&(summary->latency), 99.0);
+
+            LOG_OK("%s: client %zu (%s): %" PRIu64 " ops (%" PRIu64 " failed) in %.3f s, %.1f ops/s, latency (us) p50 %.1f p99 %.1f",
+                   suite_name,
+                   idx,
+                   client->directory,
+                   summary->ops_count,
+                   summary->errors_count,
+                   duration,
+                   duration > 0.0 ? (double) summary->ops_count / duration : 0.0,
+                   (double) p50 / 1000.0,
+                   (double) p99 / 1000.0);
+
+            mt_fs_tests_ops_summary_merge(&combined,
+                                          summary);
+
+            if (summary->start_ns > last_start_ns)
+            {
+                last_start_ns = summary->start_ns;
+            }
+
+            nb_active++;
+        }
+    }
+
+    if (combined.ops_count > 0)
+    {
+        double const duration = (double) (combined.end_ns - combined.start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+        uint64_t const p50 = mt_fs_tests_histogram_percentile(&(combined.latency), 50.0);
+        uint64_t const p90 = mt_fs_tests_histogram_percentile(&(combined.latency), 90.0);
+        uint64_t const p99 = mt_fs_tests_histogram_percentile(&(combined.latency), 99.0);
+        uint64_t const p999 = mt_fs_tests_histogram_percentile(&(combined.latency), 99.9);
+
+        /* The spread of the first operations of the clients tells how
+           closely the race actually started. */
+        LOG_OK("%s: %zu clients, %" PRIu64 " ops (%" PRIu64 " failed) in %.3f s, %.1f ops/s, first operations of the clients within %.1f us",
+               suite_name,
+               nb_active,
+               combined.ops_count,
+               combined.errors_count,
+               duration,
+               duration > 0.0 ? (double) combined.ops_count / duration : 0.0,
+               (double) (last_start_ns - combined.start_ns) / 1000.0);
+
+        LOG_OK("%s: latency (us) min %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f",
+               suite_name,
+               (double) combined.latency.min / 1000.0,
+               (double) p50 / 1000.0,
+               (double) p90 / 1000.0,
+               (double) p99 / 1000.0,
+               (double) p999 / 1000.0,
+               (double) combined.latency.max / 1000.0);
+
+        mt_fs_tests_ops_report_outcomes(&(combined.outcomes),
+                                        suite_name);
+
+        /* Each client only saw its share of a race on shared targets, all
+           clients running the same suite have the same expectations. */
+        if (segment->clients[0].nb_expectations > 0)
+        {
+            mt_fs_tests_outcomes_check(&(combined.outcomes),
+                                       segment->clients[0].expectations,
+                                       segment->clients[0].nb_expectations);
+        }
+    }
+}
+
+int mt_fs_tests_coordinator_run_step(mt_fs_tests_coordinator * const coordinator,
+                                     char const * const suite_name,
+                                     size_t const nb_workers)
+{
+    int result = 0;
+    coordinator_segment * segment = NULL;
+    bool skipped = false;
+    assert(coordinator != NULL);
+    assert(coordinator->is_coordinator == true);
+    assert(suite_name != NULL);
+    assert(nb_workers > 0);
+
+    segment = coordinator->segment;
+    coordinator->step++;
+
+    result = coordinator_wait_clients(coordinator,
+                                      false);
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < segment->nb_clients;
+         idx++)
+    {
+        if (segment->clients[idx].ready_status != 0)
+        {
+            skipped = true;
+            LOG_ERROR("%s: client %zu failed to initialize the suite: %d",
+                      suite_name,
+                      idx,
+                      segment->clients[idx].ready_status);
+        }
+    }
+
+    if (result == 0 &&
+        skipped == false)
+    {
+        assert(segment->nb_clients * nb_workers <= UINT_MAX);
+
+        result = mt_fs_tests_barrier_init_shared(&(segment->barrier),
+                                                 (unsigned int) (segment->nb_clients * nb_workers));
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error creating barrier for suite %s: %d",
+                      suite_name,
+                      result);
+            skipped = true;
+        }
+    }
+
+    if (result == 0)
+    {
+        segment->go_skipped = skipped == true ? 1 : 0;
+
+        __atomic_store_n(&(segment->go_step),
+                         coordinator->step,
+                         __ATOMIC_RELEASE);
+
+        result = coordinator_wait_clients(coordinator,
+                                          true);
+
+        if (skipped == false)
+        {
+            /* Workers of clients that have not published yet may still be
+               waiting on it. */
+            if (result == 0)
+            {
+                mt_fs_tests_barrier_destroy(&(segment->barrier));
+            }
+        }
+        else
+        {
+            result = ECANCELED;
+        }
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < segment->nb_clients;
+         idx++)
+    {
+        if (segment->clients[idx].done_status != 0)
+        {
+            result = segment->clients[idx].done_status;
+            LOG_ERROR("%s: client %zu failed to run the suite: %d",
+                      suite_name,
+                      idx,
+                      result);
+        }
+    }
+
+    if (result == 0)
+    {
+        coordinator_report(coordinator,
+                           suite_name);
+    }
+
+    return result;
+}
+
+int mt_fs_tests_coordinator_client_ready(mt_fs_tests_coordinator * const coordinator,
+                                         int const status)
+{
+    int result = 0;
+    coordinator_segment * segment = NULL;
+    coordinator_client * client = NULL;
+    assert(coordinator != NULL);
+    assert(coordinator->is_coordinator == false);
+
+    segment = coordinator->segment;
+    client = &(segment->clients[coordinator->client_id]);
+    coordinator->step++;
+
+    client->ready_status = status;
+    __atomic_store_n(&(client->ready_step),
+                     coordinator->step,
+                     __ATOMIC_RELEASE);
+
+    while (result == 0 &&
+           __atomic_load_n(&(segment->go_step), __ATOMIC_ACQUIRE) < coordinator->step)
+    {
+        if (__atomic_load_n(&(segment->finished), __ATOMIC_ACQUIRE) != 0 ||
+            coordinator_process_alive(segment->coordinator_pid) == false)
+        {
+            result = ECANCELED;
+            LOG_ERROR("The coordinator stopped before the end of the run");
+        }
+        else
+        {
+            coordinator_sleep();
+        }
+    }
+
+    if (result == 0 &&
+        segment->go_skipped != 0)
+    {
+        result = ECANCELED;
+        LOG_ERROR("Suite skipped, another client is not ready");
+    }
+
+    return result;
+}
+
+void mt_fs_tests_coordinator_client_publish(mt_fs_tests_coordinator * const coordinator,
+                                            mt_fs_tests_ops_run const * const run,
+                                            mt_fs_tests_expectation const * const expectations,
+                                            size_t const nb_expectations,
+                                            int const status)
+{
+    coordinator_segment * segment = NULL;
+    coordinator_client * client = NULL;
+    bool pending = true;
+    assert(coordinator != NULL);
+    assert(coordinator->is_coordinator == false);
+    assert(expectations != NULL || nb_expectations == 0);
+    assert(nb_expectations <= MT_FS_TESTS_RACES_MAX_EXPECTATIONS);
+
+    segment = coordinator->segment;
+    client = &(segment->clients[coordinator->client_id]);
+
+    if (nb_expectations > 0)
+    {
+        memcpy(client->expectations,
+               expectations,
+               sizeof *expectations * nb_expectations);
+    }
+
+    client->nb_expectations = nb_expectations;
+
+    if (run != NULL)
+    {
+        mt_fs_tests_ops_run_summarize(run,
+                                      &(client->summary));
+    }
+    else
+    {
+        memset(&(client->summary), 0, sizeof client->summary);
+    }
+
+    client->done_status = status;
+    __atomic_store_n(&(client->done_step),
+                     coordinator->step,
+                     __ATOMIC_RELEASE);
+
+    /* The suite is then deinitialized, which would remove shared targets
+       from under the workers of slower clients. A client that died is
+       reported by the coordinator, which then stops. */
+    while (pending == true &&
+           __atomic_load_n(&(segment->finished), __ATOMIC_ACQUIRE) == 0 &&
+           coordinator_process_alive(segment->coordinator_pid) == true)
+    {
+        pending = false;
+
+        for (size_t idx = 0;
+             pending == false &&
+                 idx < segment->nb_clients;
+             idx++)
+        {
+            pending = __atomic_load_n(&(segment->clients[idx].done_step), __ATOMIC_ACQUIRE) < coordinator->step;
+        }
+
+        if (pending == true)
+        {
+            coordinator_sleep();
+        }
+    }
+}
+
+void mt_fs_tests_coordinator_free(mt_fs_tests_coordinator * const coordinator)
+{
+    if (coordinator != NULL)
+    {
+        if (coordinator->segment != NULL)
+        {
+            if (coordinator->is_coordinator == true)
+            {
+                /* Releases clients waiting for a step that will not come. */
+                __atomic_store_n(&(coordinator->segment->finished),
+                                 1,
+                                 __ATOMIC_RELEASE);
+            }
+
+            munmap(coordinator->segment,
+                   sizeof *(coordinator->segment));
+            coordinator->segment = NULL;
+        }
+
+        if (coordinator->unlinked == false)
+        {
+            shm_unlink(coordinator->name);
+        }
+
+        free(coordinator);
+    }
+}
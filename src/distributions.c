@@ -0,0 +1,213 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <strings.h>
+
+#include "distributions.h"
+#include "options.h"
+#include "utils.h"
+
+#define OPTION_NAME_MAX (128)
+#define DEFAULT_ZIPF_THETA (0.99)
+#define DEFAULT_HOT_OPS (0.9)
+#define DEFAULT_HOT_SIZE (0.1)
+#define DEFAULT_STRIDE (1)
+
+static char const * const mt_fs_tests_distribution_names[] =
+{
+    "uniform",
+    "zipf",
+    "hotspot",
+    "stride",
+};
+
+static double mt_fs_tests_distribution_zeta(uint64_t const count,
+                                            double const theta)
+{
+    double result = 0.0;
+
+    for (uint64_t idx = 1;
+         idx <= count;
+         idx++)
+    {
+        result += 1.0 / pow((double) idx, theta);
+    }
+
+    return result;
+}
+
+static int mt_fs_tests_distribution_get_double(char const * const prefix,
+                                               char const * const key,
+                                               double const default_value,
+                                               double * const out)
+{
+    char name[OPTION_NAME_MAX];
+
+    snprintf(name,
+             sizeof name,
+             "%s.%s",
+             prefix,
+             key);
+
+    return mt_fs_tests_option_get_double(name,
+                                         default_value,
+                                         out);
+}
+
+static int mt_fs_tests_distribution_zipf_init(mt_fs_tests_distribution * const distribution)
+{
+    int result = 0;
+    double const theta = distribution->zipf_theta;
+
+    if (theta > 0.0 &&
+        theta < 1.0)
+    {
+        double const n = (double) distribution->nb_items;
+        double const zeta2 = mt_fs_tests_distribution_zeta(2, theta);
+
+        distribution->zipf_zetan = mt_fs_tests_distribution_zeta(distribution->nb_items,
+                                                                 theta);
+        distribution->zipf_alpha = 1.0 / (1.0 - theta);
+        distribution->zipf_eta = (1.0 - pow(2.0 / n, 1.0 - theta)) /
+            (1.0 - zeta2 / distribution->zipf_zetan);
+        distribution->zipf_threshold = 1.0 + pow(0.5, theta);
+    }
+    else
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid Zipfian theta %f, expected a value in (0, 1)",
+                  theta);
+    }
+
+    return result;
+}
+
+int mt_fs_tests_distribution_from_options(char const * const prefix,
+                                          uint64_t const nb_items,
+                                          mt_fs_tests_distribution * const distribution)
+{
+    int result = 0;
+    char name[OPTION_NAME_MAX];
+    char const * type = NULL;
+    uint64_t stride = DEFAULT_STRIDE;
+    assert(prefix != NULL);
+    assert(nb_items > 0);
+    assert(distribution != NULL);
+
+    *distribution = (mt_fs_tests_distribution) { .nb_items = nb_items };
+
+    snprintf(name, sizeof name, "%s.distribution", prefix);
+    type = mt_fs_tests_option_get_string(name,
+                                         mt_fs_tests_distribution_names[mt_fs_tests_distribution_uniform]);
+
+    result = ENOENT;
+
+    for (size_t idx = 0;
+         result == ENOENT &&
+             idx < mt_fs_tests_distribution_count;
+         idx++)
+    {
+        if (strcasecmp(type, mt_fs_tests_distribution_names[idx]) == 0)
+        {
+            distribution->type = (mt_fs_tests_distribution_type) idx;
+            result = 0;
+        }
+    }
+
+    if (result != 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid distribution %s",
+                  type);
+    }
+
+    if (result == 0 &&
+        distribution->type == mt_fs_tests_distribution_zipf)
+    {
+        result = mt_fs_tests_distribution_get_double(prefix,
+                                                     "zipf_theta",
+                                                     DEFAULT_ZIPF_THETA,
+                                                     &(distribution->zipf_theta));
+
+        if (result == 0)
+        {
+            result = mt_fs_tests_distribution_zipf_init(distribution);
+        }
+    }
+    else if (result == 0 &&
+             distribution->type == mt_fs_tests_distribution_hotspot)
+    {
+        result = mt_fs_tests_distribution_get_double(prefix,
+                                                     "hot_ops",
+                                                     DEFAULT_HOT_OPS,
+                                                     &(distribution->hot_ops));
+
+        if (result == 0)
+        {
+            result = mt_fs_tests_distribution_get_double(prefix,
+                                                         "hot_size",
+                                                         DEFAULT_HOT_SIZE,
+                                                         &(distribution->hot_size));
+        }
+
+        if (result == 0 &&
+            (distribution->hot_ops < 0.0 || distribution->hot_ops > 1.0 ||
+             distribution->hot_size <= 0.0 || distribution->hot_size > 1.0))
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid hotspot, expected fractions in [0, 1] and (0, 1]");
+        }
+
+        if (result == 0)
+        {
+            double const hot_items = ceil(distribution->hot_size * (double) nb_items);
+            distribution->hot_items = (uint64_t) hot_items;
+        }
+    }
+    else if (result == 0 &&
+             distribution->type == mt_fs_tests_distribution_stride)
+    {
+        snprintf(name, sizeof name, "%s.stride", prefix);
+        result = mt_fs_tests_option_get_uint64(name,
+                                               DEFAULT_STRIDE,
+                                               &stride);
+
+        if (result == 0 &&
+            stride == 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid stride, expected a value greater than 0");
+        }
+
+        distribution->stride = stride;
+    }
+
+    return result;
+}
+
+char const * mt_fs_tests_distribution_name(mt_fs_tests_distribution const * const distribution)
+{
+    assert(distribution != NULL);
+    assert(distribution->type < mt_fs_tests_distribution_count);
+
+    return mt_fs_tests_distribution_names[distribution->type];
+}
+
+void mt_fs_tests_sampler_init(mt_fs_tests_sampler * const sampler,
+                              mt_fs_tests_distribution const * const distribution,
+                              size_t const id,
+                              size_t const nb_threads)
+{
+    assert(sampler != NULL);
+    assert(distribution != NULL);
+    assert(nb_threads > 0);
+
+    sampler->distribution = distribution;
+    mt_fs_tests_prng_thread_init(&(sampler->prng),
+                                 id);
+    /* Threads start evenly spread over the items. */
+    sampler->next = (uint64_t) ((double) distribution->nb_items * (double) id / (double) nb_threads) %
+        distribution->nb_items;
+}
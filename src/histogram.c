@@ -0,0 +1,171 @@
+
+#include <assert.h>
+#include <string.h>
+
+#include "histogram.h"
+
+static size_t mt_fs_tests_histogram_index(uint64_t const value)
+{
+    size_t result = 0;
+
+    if (value < MT_FS_TESTS_HISTOGRAM_SUB_COUNT)
+    {
+        result = (size_t) value;
+    }
+    else
+    {
+        unsigned int const msb = 63 - (unsigned int) __builtin_clzll(value);
+
+        if (msb < MT_FS_TESTS_HISTOGRAM_MAX_BITS)
+        {
+            unsigned int const shift = msb - MT_FS_TESTS_HISTOGRAM_SUB_BITS;
+
+            result = (shift + 1) * MT_FS_TESTS_HISTOGRAM_SUB_COUNT +
+                (size_t) ((value >> shift) - MT_FS_TESTS_HISTOGRAM_SUB_COUNT);
+        }
+        else
+        {
+            result = MT_FS_TESTS_HISTOGRAM_BUCKETS - 1;
+        }
+    }
+
+    assert(result < MT_FS_TESTS_HISTOGRAM_BUCKETS);
+
+    return result;
+}
+
+static uint64_t mt_fs_tests_histogram_bucket_upper_bound(size_t const idx)
+{
+    uint64_t result = 0;
+
+    if (idx < MT_FS_TESTS_HISTOGRAM_SUB_COUNT)
+    {
+        result = idx;
+    }
+    else
+    {
+        size_t const shift = idx / MT_FS_TESTS_HISTOGRAM_SUB_COUNT - 1;
+        size_t const sub = idx % MT_FS_TESTS_HISTOGRAM_SUB_COUNT;
+
+        result = (((uint64_t) MT_FS_TESTS_HISTOGRAM_SUB_COUNT + sub + 1) << shift) - 1;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_histogram_reset(mt_fs_tests_histogram * const histogram)
+{
+    assert(histogram != NULL);
+
+    memset(histogram, 0, sizeof *histogram);
+    histogram->min = UINT64_MAX;
+}
+
+void mt_fs_tests_histogram_record(mt_fs_tests_histogram * const histogram,
+                                  uint64_t const value)
+{
+    assert(histogram != NULL);
+
+    histogram->buckets[mt_fs_tests_histogram_index(value)]++;
+    histogram->count++;
+
+    if (value < histogram->min)
+    {
+        histogram->min = value;
+    }
+
+    if (value > histogram->max)
+    {
+        histogram->max = value;
+    }
+}
+
+void mt_fs_tests_histogram_merge(mt_fs_tests_histogram * const destination,
+                                 mt_fs_tests_histogram const * const source)
+{
+    assert(destination != NULL);
+    assert(source != NULL);
+
+    for (size_t idx = 0;
+         idx < MT_FS_TESTS_HISTOGRAM_BUCKETS;
+         idx++)
+    {
+        destination->buckets[idx] += source->buckets[idx];
+    }
+
+    destination->count += source->count;
+
+    if (source->min < destination->min)
+    {
+        destination->min = source->min;
+    }
+
+    if (source->max > destination->max)
+    {
+        destination->max = source->max;
+    }
+}
+
+void mt_fs_tests_histogram_subtract(mt_fs_tests_histogram * const destination,
+                                    mt_fs_tests_histogram const * const source)
+{
+    assert(destination != NULL);
+    assert(source != NULL);
+    assert(source->count <= destination->count);
+
+    for (size_t idx = 0;
+         idx < MT_FS_TESTS_HISTOGRAM_BUCKETS;
+         idx++)
+    {
+        assert(source->buckets[idx] <= destination->buckets[idx]);
+        destination->buckets[idx] -= source->buckets[idx];
+    }
+
+    destination->count -= source->count;
+}
+
+uint64_t mt_fs_tests_histogram_percentile(mt_fs_tests_histogram const * const histogram,
+                                          double const percentile)
+{
+    uint64_t result = 0;
+    assert(histogram != NULL);
+    assert(percentile >= 0.0 && percentile <= 100.0);
+
+    if (histogram->count > 0)
+    {
+        uint64_t target = (uint64_t) ((double) histogram->count * percentile / 100.0 + 0.5);
+        uint64_t seen = 0;
+
+        if (target == 0)
+        {
+            target = 1;
+        }
+
+        result = histogram->max;
+
+        for (size_t idx = 0;
+             idx < MT_FS_TESTS_HISTOGRAM_BUCKETS;
+             idx++)
+        {
+            seen += histogram->buckets[idx];
+
+            if (seen >= target)
+            {
+                result = mt_fs_tests_histogram_bucket_upper_bound(idx);
+                break;
+            }
+        }
+
+        if (result > histogram->max)
+        {
+            result = histogram->max;
+        }
+
+        if (result < histogram->min)
+        {
+            result = histogram->min;
+        }
+    }
+
+    return result;
+}
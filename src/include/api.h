@@ -0,0 +1,8 @@
+#ifndef MT_FS_TESTS_API_H_
+#define MT_FS_TESTS_API_H_
+
+/* Everything is built with -fvisibility=hidden, functions that suites loaded
+   as plugins may call have to be explicitly exported. */
+#define MT_FS_TESTS_API __attribute__ ((__visibility__("default")))
+
+#endif /* MT_FS_TESTS_API_H_ */
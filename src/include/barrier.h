@@ -8,21 +8,53 @@
 #ifdef _POSIX_BARRIERS
 
 #define mt_fs_tests_barrier_t pthread_barrier_t
+/* Returned by mt_fs_tests_barrier_wait() to a single thread of each generation. */
+#define MT_FS_TESTS_BARRIER_SERIAL_THREAD PTHREAD_BARRIER_SERIAL_THREAD
 #define mt_fs_tests_barrier_init(barrier, count) pthread_barrier_init(barrier, \
                                                                       NULL, \
                                                                       count)
 #define mt_fs_tests_barrier_wait(barrier) pthread_barrier_wait(barrier)
 #define mt_fs_tests_barrier_destroy(barrier) pthread_barrier_destroy(barrier)
 
+/* Barrier usable by several processes, provided it lives in shared memory. */
+static inline int mt_fs_tests_barrier_init_shared(mt_fs_tests_barrier_t * const barrier,
+                                                  unsigned int const count)
+{
+    pthread_barrierattr_t attr;
+    int result = pthread_barrierattr_init(&attr);
+
+    if (result == 0)
+    {
+        result = pthread_barrierattr_setpshared(&attr,
+                                                PTHREAD_PROCESS_SHARED);
+
+        if (result == 0)
+        {
+            result = pthread_barrier_init(barrier,
+                                          &attr,
+                                          count);
+        }
+
+        pthread_barrierattr_destroy(&attr);
+    }
+
+    return result;
+}
+
 #else /* _POSIX_BARRIERS */
 #warning "No barrier, using internal implementation"
 
+#define MT_FS_TESTS_BARRIER_SERIAL_THREAD (-1)
+
 typedef struct
 {
     pthread_mutex_t mutex;
     pthread_cond_t cond;
     unsigned int count;
-
+    unsigned int initial_count;
+    /* Incremented each time all threads reached the barrier, which can then
+       be waited on again. */
+    unsigned long generation;
 } mt_fs_tests_barrier_t;
 
 static inline int mt_fs_tests_barrier_init(mt_fs_tests_barrier_t * const barrier,
@@ -42,6 +74,8 @@ static inline int mt_fs_tests_barrier_init(mt_fs_tests_barrier_t * const barrier
             if (result == 0)
             {
                 barrier->count = count;
+                barrier->initial_count = count;
+                barrier->generation = 0;
             }
             else
             {
@@ -53,6 +87,65 @@ static inline int mt_fs_tests_barrier_init(mt_fs_tests_barrier_t * const barrier
     return result;
 }
 
+/* Barrier usable by several processes, provided it lives in shared memory. */
+static inline int mt_fs_tests_barrier_init_shared(mt_fs_tests_barrier_t * const barrier,
+                                                  unsigned int const count)
+{
+    pthread_mutexattr_t mutex_attr;
+    pthread_condattr_t cond_attr;
+    int result = 0;
+    assert(barrier != NULL);
+
+    if (count > 0)
+    {
+        result = pthread_mutexattr_init(&mutex_attr);
+
+        if (result == 0)
+        {
+            result = pthread_mutexattr_setpshared(&mutex_attr,
+                                                  PTHREAD_PROCESS_SHARED);
+
+            if (result == 0)
+            {
+                result = pthread_condattr_init(&cond_attr);
+
+                if (result == 0)
+                {
+                    result = pthread_condattr_setpshared(&cond_attr,
+                                                         PTHREAD_PROCESS_SHARED);
+
+                    if (result == 0)
+                    {
+                        result = pthread_mutex_init(&barrier->mutex, &mutex_attr);
+
+                        if (result == 0)
+                        {
+                            result = pthread_cond_init(&barrier->cond, &cond_attr);
+
+                            if (result == 0)
+                            {
+                                barrier->count = count;
+                                barrier->initial_count = count;
+                                barrier->generation = 0;
+                            }
+                            else
+                            {
+                                pthread_mutex_destroy(&barrier->mutex);
+                            }
+                        }
+                    }
+
+                    pthread_condattr_destroy(&cond_attr);
+                }
+            }
+
+            pthread_mutexattr_destroy(&mutex_attr);
+        }
+    }
+
+    return result;
+}
+
 static inline int mt_fs_tests_barrier_destroy(mt_fs_tests_barrier_t * barrier)
 {
     int result = 0;
@@ -72,17 +165,24 @@ static inline int mt_fs_tests_barrier_wait(mt_fs_tests_barrier_t * const barrier
 
     if (result == 0)
     {
+        unsigned long const generation = barrier->generation;
+
         barrier->count--;
 
         if(barrier->count == 0)
         {
+            barrier->count = barrier->initial_count;
+            barrier->generation++;
             pthread_cond_broadcast(&barrier->cond);
 
-            result = 1;
+            result = MT_FS_TESTS_BARRIER_SERIAL_THREAD;
         }
         else
         {
-            pthread_cond_wait(&barrier->cond, &(barrier->mutex));
+            while (generation == barrier->generation)
+            {
+                pthread_cond_wait(&barrier->cond, &(barrier->mutex));
+            }
         }
 
         pthread_mutex_unlock(&barrier->mutex);
@@ -0,0 +1,49 @@
+#ifndef MT_FS_TESTS_COLD_CACHE_H_
+#define MT_FS_TESTS_COLD_CACHE_H_
+
+#include <stdbool.h>
+
+#include "api.h"
+#include "barrier.h"
+
+/* Cold-cache mode. Caches are evicted after each suite initialization, so
+   that the run does not hit the dentry, inode and page caches warmed by the
+   initialization or by the previous run, and suites may evict them between
+   their own phases as well.
+
+   Writing to /proc/sys/vm/drop_caches is tried first, which requires
+   privileges. Otherwise, files tracked by suites are flushed and evicted from
+   the page cache through posix_fadvise(POSIX_FADV_DONTNEED); the dentry and
+   inode caches then remain warm. */
+
+int mt_fs_tests_cold_cache_enable(void);
+
+/* Logs which evictions succeeded since the previous report. */
+void mt_fs_tests_cold_cache_report(char const * suite_name);
+
+void mt_fs_tests_cold_cache_free(void);
+
+MT_FS_TESTS_API bool mt_fs_tests_cold_cache_enabled(void) __attribute__ ((__pure__));
+
+/* Does nothing when cold-cache mode is not enabled. */
+MT_FS_TESTS_API void mt_fs_tests_cold_cache_evict(void);
+
+/* Files a suite creates and keeps across its phases or until its deinit
+   function, to be evicted when dropping caches is not allowed. Tracking is
+   not thread-safe and is expected from suite init and deinit functions. */
+MT_FS_TESTS_API int mt_fs_tests_cold_cache_track(char const * path);
+
+MT_FS_TESTS_API void mt_fs_tests_cold_cache_untrack(char const * path);
+
+/* Flushes path and evicts it from the page cache, for files only known to
+   the suite thread which uses them. Accounted in the report, returns 0 or
+   an errno value. Does nothing when cold-cache mode is not enabled. */
+MT_FS_TESTS_API int mt_fs_tests_cold_cache_evict_path(char const * path);
+
+/* Between phases of a suite, once each thread evicted its own files:
+   threads wait for each other on barrier, and the last one to arrive
+   evicts the caches, dropping dentries and inodes as well when allowed.
+   Does nothing when cold-cache mode is not enabled, without waiting. */
+MT_FS_TESTS_API void mt_fs_tests_cold_cache_evict_phase(mt_fs_tests_barrier_t * barrier);
+
+#endif /* MT_FS_TESTS_COLD_CACHE_H_ */
@@ -0,0 +1,95 @@
+#ifndef MT_FS_TESTS_COORDINATOR_H_
+#define MT_FS_TESTS_COORDINATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "barrier.h"
+#include "ops.h"
+#include "outcomes.h"
+
+/* Several independent mt-fs-tests processes, the clients, racing on the same
+   filesystem, usually through different mount points, under the control of
+   a coordinator process. The coordinator creates a named shared memory
+   segment holding the configuration of the run, a process-shared barrier on
+   which the workers of all clients start each suite together, and one result
+   area per client. Clients attach to it, take their configuration from it,
+   and go through the same sequence of suites, one step per suite run:
+   - each client initializes the suite, then tells whether it is ready,
+     the targets of races being shared by all clients, see races.h;
+   - once all clients are ready, the coordinator sizes the barrier for all
+     their workers and lets them go, otherwise the step is skipped by all;
+   - each client publishes the results of its workers, which the
+     coordinator combines once all of them are done, checking the outcomes
+     of races against their expectations. */
+#define MT_FS_TESTS_COORDINATOR_MAX_CLIENTS (64)
+#define MT_FS_TESTS_COORDINATOR_MAX_THREADS_COUNTS (64)
+#define MT_FS_TESTS_COORDINATOR_SUITE_NAME_SIZE (64)
+
+typedef struct mt_fs_tests_coordinator mt_fs_tests_coordinator;
+
+/* Parameters of the run shared by all clients. */
+typedef struct
+{
+    size_t threads_counts[MT_FS_TESTS_COORDINATOR_MAX_THREADS_COUNTS];
+    size_t nb_threads_counts;
+    size_t nb_runs;
+    uint64_t seed;
+    /* Empty to run all suites. */
+    char suite_name[MT_FS_TESTS_COORDINATOR_SUITE_NAME_SIZE];
+} mt_fs_tests_coordinator_config;
+
+/* Creates the segment, then waits for nb_clients clients to attach to it,
+   for as long as clients wait for the coordinator. */
+int mt_fs_tests_coordinator_create(mt_fs_tests_coordinator ** coordinator,
+                                   char const * name,
+                                   size_t nb_clients,
+                                   mt_fs_tests_coordinator_config const * config);
+
+/* Attaches as client client_id, waiting for the coordinator to create the
+   segment if needed. directory is only used in reports. */
+int mt_fs_tests_coordinator_attach(mt_fs_tests_coordinator ** coordinator,
+                                   char const * name,
+                                   size_t client_id,
+                                   char const * directory);
+
+mt_fs_tests_coordinator_config const * mt_fs_tests_coordinator_get_config(mt_fs_tests_coordinator const * coordinator) __attribute__ ((__pure__));
+
+/* Coordinator side. Runs one step, nb_workers being the number of workers
+   of each client for this suite. Returns ECANCELED if a client was not
+   ready. */
+int mt_fs_tests_coordinator_run_step(mt_fs_tests_coordinator * coordinator,
+                                     char const * suite_name,
+                                     size_t nb_workers);
+
+/* Client side. status is 0 if the suite has been initialized, an errno
+   value otherwise. Returns 0 once all clients are ready, ECANCELED if one of
+   them is not. */
+int mt_fs_tests_coordinator_client_ready(mt_fs_tests_coordinator * coordinator,
+                                         int status);
+
+/* Barrier on which all workers of all clients wait before the run, valid
+   between mt_fs_tests_coordinator_client_ready() and
+   mt_fs_tests_coordinator_client_publish(). */
+/* Client side. */
+size_t mt_fs_tests_coordinator_get_client_id(mt_fs_tests_coordinator const * coordinator) __attribute__ ((__pure__));
+
+/* Client side. The same for all clients, derived from the name of the
+   coordination, the seed and the step about to be initialized, to name the
+   targets they share. */
+uint64_t mt_fs_tests_coordinator_get_step_key(mt_fs_tests_coordinator const * coordinator) __attribute__ ((__pure__));
+
+mt_fs_tests_barrier_t * mt_fs_tests_coordinator_get_barrier(mt_fs_tests_coordinator * coordinator) __attribute__ ((__pure__));
+
+/* run may be NULL if the step was skipped. expectations are those of a race
+   on shared targets, if any, to be met by the outcomes of all clients. Returns
+   once all clients have published theirs. */
+void mt_fs_tests_coordinator_client_publish(mt_fs_tests_coordinator * coordinator,
+                                            mt_fs_tests_ops_run const * run,
+                                            mt_fs_tests_expectation const * expectations,
+                                            size_t nb_expectations,
+                                            int status);
+
+void mt_fs_tests_coordinator_free(mt_fs_tests_coordinator * coordinator);
+
+#endif /* MT_FS_TESTS_COORDINATOR_H_ */
@@ -0,0 +1,129 @@
+#ifndef MT_FS_TESTS_DISTRIBUTIONS_H_
+#define MT_FS_TESTS_DISTRIBUTIONS_H_
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "api.h"
+#include "prng.h"
+
+/* Distributions of item indexes, like chunks of a file, in [0, nb_items).
+   Everything depending only on the distribution parameters is computed once
+   in mt_fs_tests_distribution_from_options(), so that drawing an item costs
+   a few arithmetic operations. Options, read with the given prefix:
+   - <prefix>.distribution: uniform (default), zipf, hotspot or stride;
+   - <prefix>.zipf_theta: skew of the Zipfian distribution, in (0, 1),
+     default 0.99, the first items being the most popular;
+   - <prefix>.hot_ops and <prefix>.hot_size: fraction of the operations
+     going to the first fraction of the items (default 0.9 and 0.1);
+   - <prefix>.stride: step, in items, of the sequential stride distribution,
+     each thread starting at a different offset (default 1). */
+
+typedef enum
+{
+    mt_fs_tests_distribution_uniform = 0,
+    mt_fs_tests_distribution_zipf,
+    mt_fs_tests_distribution_hotspot,
+    mt_fs_tests_distribution_stride,
+    mt_fs_tests_distribution_count
+} mt_fs_tests_distribution_type;
+
+typedef struct
+{
+    mt_fs_tests_distribution_type type;
+    uint64_t nb_items;
+    double zipf_theta;
+    double zipf_zetan;
+    double zipf_alpha;
+    double zipf_eta;
+    double zipf_threshold;
+    double hot_ops;
+    double hot_size;
+    uint64_t hot_items;
+    uint64_t stride;
+} mt_fs_tests_distribution;
+
+typedef struct
+{
+    mt_fs_tests_distribution const * distribution;
+    mt_fs_tests_prng prng;
+    uint64_t next;
+} mt_fs_tests_sampler;
+
+MT_FS_TESTS_API int mt_fs_tests_distribution_from_options(char const * prefix,
+                                                          uint64_t nb_items,
+                                                          mt_fs_tests_distribution * distribution);
+
+MT_FS_TESTS_API char const * mt_fs_tests_distribution_name(mt_fs_tests_distribution const * distribution) __attribute__ ((__pure__));
+
+/* Seeds the sampler of thread id, see prng.h. */
+MT_FS_TESTS_API void mt_fs_tests_sampler_init(mt_fs_tests_sampler * sampler,
+                                              mt_fs_tests_distribution const * distribution,
+                                              size_t id,
+                                              size_t nb_threads);
+
+static inline uint64_t mt_fs_tests_sampler_next(mt_fs_tests_sampler * const sampler)
+{
+    mt_fs_tests_distribution const * const distribution = sampler->distribution;
+    uint64_t result = 0;
+
+    switch(distribution->type)
+    {
+    case mt_fs_tests_distribution_zipf:
+    {
+        /* Gray et al., "Quickly generating billion-record synthetic
+           databases", SIGMOD 1994. */
+        double const u = mt_fs_tests_prng_double(&(sampler->prng));
+        double const uz = u * distribution->zipf_zetan;
+
+        if (uz < 1.0)
+        {
+            result = 0;
+        }
+        else if (uz < distribution->zipf_threshold)
+        {
+            result = 1;
+        }
+        else
+        {
+            result = (uint64_t) ((double) distribution->nb_items *
+                                 pow(distribution->zipf_eta * u - distribution->zipf_eta + 1.0,
+                                     distribution->zipf_alpha));
+        }
+
+        if (result >= distribution->nb_items)
+        {
+            result = distribution->nb_items - 1;
+        }
+        break;
+    }
+    case mt_fs_tests_distribution_hotspot:
+        if (distribution->hot_items >= distribution->nb_items ||
+            mt_fs_tests_prng_double(&(sampler->prng)) < distribution->hot_ops)
+        {
+            result = mt_fs_tests_prng_bounded(&(sampler->prng),
+                                              distribution->hot_items);
+        }
+        else
+        {
+            result = distribution->hot_items +
+                mt_fs_tests_prng_bounded(&(sampler->prng),
+                                         distribution->nb_items - distribution->hot_items);
+        }
+        break;
+    case mt_fs_tests_distribution_stride:
+        result = sampler->next;
+        sampler->next = (sampler->next + distribution->stride) % distribution->nb_items;
+        break;
+    case mt_fs_tests_distribution_uniform:
+    default:
+        result = mt_fs_tests_prng_bounded(&(sampler->prng),
+                                          distribution->nb_items);
+        break;
+    }
+
+    return result;
+}
+
+#endif /* MT_FS_TESTS_DISTRIBUTIONS_H_ */
@@ -0,0 +1,40 @@
+#ifndef MT_FS_TESTS_HISTOGRAM_H_
+#define MT_FS_TESTS_HISTOGRAM_H_
+
+#include <stdint.h>
+
+/* Log-linear histogram: values are grouped by power of two, each power
+   being split in MT_FS_TESTS_HISTOGRAM_SUB_COUNT linear sub-buckets,
+   giving a relative error below 12.5%. Values above 2^40 (about 18 minutes
+   when counting nanoseconds) are accounted in the last bucket. */
+#define MT_FS_TESTS_HISTOGRAM_SUB_BITS (3)
+#define MT_FS_TESTS_HISTOGRAM_SUB_COUNT (1 << MT_FS_TESTS_HISTOGRAM_SUB_BITS)
+#define MT_FS_TESTS_HISTOGRAM_MAX_BITS (40)
+#define MT_FS_TESTS_HISTOGRAM_BUCKETS ((MT_FS_TESTS_HISTOGRAM_MAX_BITS - MT_FS_TESTS_HISTOGRAM_SUB_BITS + 1) * MT_FS_TESTS_HISTOGRAM_SUB_COUNT)
+
+typedef struct
+{
+    uint64_t buckets[MT_FS_TESTS_HISTOGRAM_BUCKETS];
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+} mt_fs_tests_histogram;
+
+void mt_fs_tests_histogram_reset(mt_fs_tests_histogram * histogram);
+
+void mt_fs_tests_histogram_record(mt_fs_tests_histogram * histogram,
+                                  uint64_t value);
+
+void mt_fs_tests_histogram_merge(mt_fs_tests_histogram * destination,
+                                 mt_fs_tests_histogram const * source);
+
+/* Removes from destination the values of source, an earlier copy of it.
+   min and max cannot be recomputed and are left as is. */
+void mt_fs_tests_histogram_subtract(mt_fs_tests_histogram * destination,
+                                    mt_fs_tests_histogram const * source);
+
+/* percentile is expressed between 0 and 100. */
+uint64_t mt_fs_tests_histogram_percentile(mt_fs_tests_histogram const * histogram,
+                                          double percentile) __attribute__ ((__pure__));
+
+#endif /* MT_FS_TESTS_HISTOGRAM_H_ */
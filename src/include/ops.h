@@ -0,0 +1,154 @@
+#ifndef MT_FS_TESTS_OPS_H_
+#define MT_FS_TESTS_OPS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "api.h"
+#include "histogram.h"
+#include "outcomes.h"
+
+typedef enum
+{
+    mt_fs_tests_arrival_closed_loop = 0,
+    mt_fs_tests_arrival_constant,
+    mt_fs_tests_arrival_poisson,
+    mt_fs_tests_arrival_count
+} mt_fs_tests_arrival;
+
+typedef struct
+{
+    /* Requested rate in operations per second, for all threads of a run
+       combined. Only used for open-loop arrivals. */
+    double rate;
+    mt_fs_tests_arrival arrival;
+    /* Capacity of the per-thread trace buffer, in events. Tracing is
+       disabled when 0. */
+    size_t trace_events;
+} mt_fs_tests_ops_config;
+
+/* An operation, as seen by the framework, is the unit of work a suite
+   thread issues: a syscall or a short sequence of syscalls. In open-loop
+   mode, the latency is measured from the time the operation was scheduled
+   to start, not from the time it was actually issued, so that a stall also
+   accounts for the operations that should have been issued during it. */
+typedef struct
+{
+    char const * name;
+    uint64_t intended_ns;
+    uint64_t start_ns;
+} mt_fs_tests_op;
+
+typedef struct mt_fs_tests_ops_run mt_fs_tests_ops_run;
+
+/* Totals of a run, all threads combined. Start and end times are read from
+   the monotonic clock, comparable between processes of the same host. */
+typedef struct
+{
+    mt_fs_tests_histogram latency;
+    mt_fs_tests_outcomes outcomes;
+    uint64_t ops_count;
+    uint64_t errors_count;
+    uint64_t start_ns;
+    uint64_t end_ns;
+} mt_fs_tests_ops_summary;
+
+int mt_fs_tests_ops_config_parse_arrival(char const * str,
+                                         mt_fs_tests_arrival * arrival);
+
+char const * mt_fs_tests_ops_arrival_name(mt_fs_tests_arrival arrival) __attribute__ ((__const__));
+
+/* Cumulative counters of a run, all threads combined, sampled while it
+   goes on. */
+typedef struct
+{
+    mt_fs_tests_histogram latency;
+    uint64_t ops_count;
+    uint64_t errors_count;
+    uint64_t bytes;
+} mt_fs_tests_ops_sample;
+
+/* Runner side */
+int mt_fs_tests_ops_run_init(mt_fs_tests_ops_run ** run,
+                             mt_fs_tests_ops_config const * config,
+                             size_t nb_threads);
+
+void mt_fs_tests_ops_thread_attach(mt_fs_tests_ops_run * run,
+                                   size_t id);
+
+void mt_fs_tests_ops_thread_detach(void);
+
+void mt_fs_tests_ops_run_report(mt_fs_tests_ops_run const * run,
+                                char const * suite_name);
+
+void mt_fs_tests_ops_run_summarize(mt_fs_tests_ops_run const * run,
+                                   mt_fs_tests_ops_summary * summary);
+
+/* Logs the histogram of the results of operations, errno values included. */
+void mt_fs_tests_ops_report_outcomes(mt_fs_tests_outcomes const * outcomes,
+                                     char const * suite_name);
+
+/* Merges source into destination, as if their operations had been issued
+   by the same run. */
+void mt_fs_tests_ops_summary_merge(mt_fs_tests_ops_summary * destination,
+                                   mt_fs_tests_ops_summary const * source);
+
+/* Safe to call from any thread while the run goes on, values written by a
+   thread since its last operation may not be accounted yet. */
+void mt_fs_tests_ops_run_sample(mt_fs_tests_ops_run const * run,
+                                mt_fs_tests_ops_sample * sample);
+
+/* Average memory used per thread by the run bookkeeping, in bytes. */
+size_t mt_fs_tests_ops_run_thread_footprint(mt_fs_tests_ops_run const * run) __attribute__ ((__pure__));
+
+int mt_fs_tests_ops_run_write_trace(mt_fs_tests_ops_run const * run,
+                                    FILE * fp,
+                                    char const * suite_name,
+                                    size_t run_idx);
+
+void mt_fs_tests_ops_run_free(mt_fs_tests_ops_run * run);
+
+/* Suite side. Calling these from a thread not attached to a run, for example
+   from a suite init function, is allowed and does nothing. */
+/* Switches the calling thread to open-loop mode at the given rate, in
+   operations per second for this thread alone, keeping the Poisson arrivals
+   of the run if any. To be called before the first operation of the thread. */
+MT_FS_TESTS_API void mt_fs_tests_op_set_thread_rate(double rate);
+
+/* Accounts bytes read or written by the calling thread, for the throughput
+   reported by the progress reporter. */
+MT_FS_TESTS_API void mt_fs_tests_op_add_bytes(uint64_t bytes);
+
+/* One phase of a suite as seen by one thread: when the thread started and
+   finished it, and the work it did meanwhile. */
+typedef struct
+{
+    uint64_t start_ns;
+    uint64_t end_ns;
+    uint64_t count;
+    uint64_t bytes;
+} mt_fs_tests_phase;
+
+MT_FS_TESTS_API void mt_fs_tests_phase_begin(mt_fs_tests_phase * phase);
+
+MT_FS_TESTS_API void mt_fs_tests_phase_end(mt_fs_tests_phase * phase);
+
+/* Aggregates the phases of several threads in total, from the first start to
+   the last end, after a mt_fs_tests_phase_reset(). Threads which never began
+   the phase, for example because they failed earlier, are ignored. */
+MT_FS_TESTS_API void mt_fs_tests_phase_reset(mt_fs_tests_phase * total);
+
+MT_FS_TESTS_API void mt_fs_tests_phase_merge(mt_fs_tests_phase * total,
+                                             mt_fs_tests_phase const * thread);
+
+/* Elapsed seconds of an aggregated phase, 0 if no thread began it. */
+MT_FS_TESTS_API double mt_fs_tests_phase_elapsed(mt_fs_tests_phase const * phase) __attribute__ ((__pure__));
+
+MT_FS_TESTS_API void mt_fs_tests_op_begin(mt_fs_tests_op * op,
+                                          char const * name);
+
+MT_FS_TESTS_API void mt_fs_tests_op_end(mt_fs_tests_op * op,
+                                        int result);
+
+#endif /* MT_FS_TESTS_OPS_H_ */
@@ -0,0 +1,44 @@
+#ifndef MT_FS_TESTS_OPTIONS_H_
+#define MT_FS_TESTS_OPTIONS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "api.h"
+
+/* Suite options, given on the command line as -o <suite>.<name>=<value>.
+   Getters return the default value when the option has not been set, and
+   EINVAL, after logging it, when the value can not be parsed. */
+
+int mt_fs_tests_options_add(char const * option);
+
+void mt_fs_tests_options_log(void);
+
+void mt_fs_tests_options_free(void);
+
+MT_FS_TESTS_API char const * mt_fs_tests_option_get_string(char const * name,
+                                                           char const * default_value) __attribute__ ((__pure__));
+
+MT_FS_TESTS_API int mt_fs_tests_option_get_uint64(char const * name,
+                                                  uint64_t default_value,
+                                                  uint64_t * out);
+
+/* Parses a size in bytes, with an optional k, m or g suffix for KiB, MiB
+   and GiB. Returns EINVAL, without logging, when str is not one. */
+MT_FS_TESTS_API int mt_fs_tests_parse_size(char const * str,
+                                           uint64_t * out);
+
+/* Accepts the sizes of mt_fs_tests_parse_size(). */
+MT_FS_TESTS_API int mt_fs_tests_option_get_size(char const * name,
+                                                uint64_t default_value,
+                                                uint64_t * out);
+
+MT_FS_TESTS_API int mt_fs_tests_option_get_double(char const * name,
+                                                  double default_value,
+                                                  double * out);
+
+MT_FS_TESTS_API int mt_fs_tests_option_get_bool(char const * name,
+                                                bool default_value,
+                                                bool * out);
+
+#endif /* MT_FS_TESTS_OPTIONS_H_ */
@@ -0,0 +1,92 @@
+#ifndef MT_FS_TESTS_OUTCOMES_H_
+#define MT_FS_TESTS_OUTCOMES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "api.h"
+
+/* Histogram of the outcomes of operations: 0 for a success, the errno value
+   otherwise. Values above MT_FS_TESTS_OUTCOMES_MAX_ERRNO, the largest errno
+   value of Linux, and negative ones are counted together. Each thread counts
+   its own outcomes, histograms being merged once the run is over. */
+#define MT_FS_TESTS_OUTCOMES_MAX_ERRNO (133)
+#define MT_FS_TESTS_OUTCOMES_OTHER (MT_FS_TESTS_OUTCOMES_MAX_ERRNO + 1)
+
+typedef struct
+{
+    uint64_t counts[MT_FS_TESTS_OUTCOMES_OTHER + 1];
+} mt_fs_tests_outcomes;
+
+/* Expected number of operations having an outcome. Outcomes not listed in
+   the expectations of a suite are not expected at all. For instance,
+   exactly one success and EEXIST for all the other operations:
+   { { 0, mt_fs_tests_expect_exactly, 1 }, { EEXIST, mt_fs_tests_expect_any, 0 } } */
+typedef enum
+{
+    mt_fs_tests_expect_exactly = 0,
+    mt_fs_tests_expect_at_least,
+    mt_fs_tests_expect_any,
+} mt_fs_tests_expect_kind;
+
+typedef struct
+{
+    int outcome;
+    mt_fs_tests_expect_kind kind;
+    uint64_t count;
+} mt_fs_tests_expectation;
+
+/* Large enough for the outcomes of a few dozen different errno values. */
+#define MT_FS_TESTS_OUTCOMES_FORMAT_SIZE (1024)
+
+static inline size_t mt_fs_tests_outcomes_index(int const outcome)
+{
+    return outcome >= 0 && outcome <= MT_FS_TESTS_OUTCOMES_MAX_ERRNO ?
+        (size_t) outcome :
+        MT_FS_TESTS_OUTCOMES_OTHER;
+}
+
+static inline void mt_fs_tests_outcomes_add(mt_fs_tests_outcomes * const outcomes,
+                                            int const outcome)
+{
+    outcomes->counts[mt_fs_tests_outcomes_index(outcome)]++;
+}
+
+/* For histograms shared by threads, like the ones of race rounds. */
+static inline void mt_fs_tests_outcomes_add_atomic(mt_fs_tests_outcomes * const outcomes,
+                                                   int const outcome)
+{
+    __atomic_fetch_add(&(outcomes->counts[mt_fs_tests_outcomes_index(outcome)]),
+                       1,
+                       __ATOMIC_RELAXED);
+}
+
+MT_FS_TESTS_API void mt_fs_tests_outcomes_reset(mt_fs_tests_outcomes * outcomes);
+
+MT_FS_TESTS_API void mt_fs_tests_outcomes_merge(mt_fs_tests_outcomes * destination,
+                                               mt_fs_tests_outcomes const * source);
+
+MT_FS_TESTS_API uint64_t mt_fs_tests_outcomes_get(mt_fs_tests_outcomes const * outcomes,
+                                                  int outcome) __attribute__ ((__pure__));
+
+MT_FS_TESTS_API uint64_t mt_fs_tests_outcomes_total(mt_fs_tests_outcomes const * outcomes) __attribute__ ((__pure__));
+
+/* Whether outcomes meet all the expectations, and no unexpected outcome
+   occurred. */
+MT_FS_TESTS_API bool mt_fs_tests_outcomes_match(mt_fs_tests_outcomes const * outcomes,
+                                                mt_fs_tests_expectation const * expectations,
+                                                size_t nb_expectations) __attribute__ ((__pure__));
+
+/* Writes the outcomes that occurred, as "success 1, EEXIST 499". */
+MT_FS_TESTS_API void mt_fs_tests_outcomes_format(mt_fs_tests_outcomes const * outcomes,
+                                                 char * buffer,
+                                                 size_t size);
+
+/* Logs "Success!" if outcomes match the expectations, the expectations and
+   outcomes otherwise, and returns whether they matched. */
+MT_FS_TESTS_API bool mt_fs_tests_outcomes_check(mt_fs_tests_outcomes const * outcomes,
+                                                mt_fs_tests_expectation const * expectations,
+                                                size_t nb_expectations);
+
+#endif /* MT_FS_TESTS_OUTCOMES_H_ */
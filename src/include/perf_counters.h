@@ -0,0 +1,45 @@
+#ifndef MT_FS_TESTS_PERF_COUNTERS_H_
+#define MT_FS_TESTS_PERF_COUNTERS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/resource.h>
+
+typedef enum
+{
+    mt_fs_tests_perf_cycles = 0,
+    mt_fs_tests_perf_instructions,
+    mt_fs_tests_perf_context_switches,
+    mt_fs_tests_perf_cpu_migrations,
+    mt_fs_tests_perf_page_faults,
+    mt_fs_tests_perf_syscalls,
+    mt_fs_tests_perf_count
+} mt_fs_tests_perf_counter;
+
+/* Counters of a single thread, for the run phase of a suite. Counters which
+   could not be opened through perf_event_open() are not accounted, resource
+   usage as reported by getrusage(RUSAGE_THREAD) being always available. */
+typedef struct
+{
+    int fds[mt_fs_tests_perf_count];
+    uint64_t values[mt_fs_tests_perf_count];
+    struct rusage rusage_start;
+    struct rusage rusage_end;
+    unsigned int collected;
+} mt_fs_tests_perf_thread;
+
+/* Checks which counters are available, and raises the open files limit
+   since each thread needs one descriptor per counter. */
+void mt_fs_tests_perf_init(void);
+
+void mt_fs_tests_perf_thread_open(mt_fs_tests_perf_thread * perf);
+
+void mt_fs_tests_perf_thread_start(mt_fs_tests_perf_thread * perf);
+
+void mt_fs_tests_perf_thread_stop(mt_fs_tests_perf_thread * perf);
+
+void mt_fs_tests_perf_report(mt_fs_tests_perf_thread const * threads,
+                             size_t nb_threads,
+                             char const * suite_name);
+
+#endif /* MT_FS_TESTS_PERF_COUNTERS_H_ */
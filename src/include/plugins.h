@@ -0,0 +1,11 @@
+#ifndef MT_FS_TESTS_PLUGINS_H_
+#define MT_FS_TESTS_PLUGINS_H_
+
+/* Loads the suite exported by the shared object at path, or by every
+   shared object (*.so) found in path if it is a directory, and registers
+   it next to the built-in suites. */
+int mt_fs_tests_plugins_load(char const * path);
+
+void mt_fs_tests_plugins_unload(void);
+
+#endif /* MT_FS_TESTS_PLUGINS_H_ */
@@ -0,0 +1,98 @@
+#ifndef MT_FS_TESTS_PRNG_H_
+#define MT_FS_TESTS_PRNG_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "api.h"
+
+/* xoshiro256** pseudo-random generator. Each thread owns its state, so
+   generating numbers takes neither lock nor shared cache line, unlike
+   random(). Threads seed their generator with mt_fs_tests_prng_thread_init(),
+   deriving the state from the seed of the whole program, the run index and
+   the thread id, so that a run can be replayed with --seed. */
+typedef struct
+{
+    uint64_t state[4];
+} mt_fs_tests_prng;
+
+static inline uint64_t mt_fs_tests_prng_splitmix64(uint64_t * const x)
+{
+    uint64_t z = (*x += UINT64_C(0x9E3779B97F4A7C15));
+    z = (z ^ (z >> 30)) * UINT64_C(0xBF58476D1CE4E5B9);
+    z = (z ^ (z >> 27)) * UINT64_C(0x94D049BB133111EB);
+    return z ^ (z >> 31);
+}
+
+static inline void mt_fs_tests_prng_seed(mt_fs_tests_prng * const prng,
+                                         uint64_t seed)
+{
+    for (size_t idx = 0;
+         idx < sizeof prng->state / sizeof *(prng->state);
+         idx++)
+    {
+        prng->state[idx] = mt_fs_tests_prng_splitmix64(&seed);
+    }
+}
+
+static inline uint64_t mt_fs_tests_prng_rotl(uint64_t const value,
+                                             unsigned int const bits)
+{
+    return (value << bits) | (value >> (64 - bits));
+}
+
+static inline uint64_t mt_fs_tests_prng_next(mt_fs_tests_prng * const prng)
+{
+    uint64_t * const s = prng->state;
+    uint64_t const result = mt_fs_tests_prng_rotl(s[1] * 5, 7) * 9;
+    uint64_t const t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = mt_fs_tests_prng_rotl(s[3], 45);
+
+    return result;
+}
+
+/* Uniform in [0, bound), bound being greater than 0. */
+static inline uint64_t mt_fs_tests_prng_bounded(mt_fs_tests_prng * const prng,
+                                                uint64_t const bound)
+{
+#if defined(__SIZEOF_INT128__)
+    /* Multiply-shift, the bias is negligible for the bounds we use. */
+    return (uint64_t) (((unsigned __int128) mt_fs_tests_prng_next(prng) * bound) >> 64);
+#else
+    return mt_fs_tests_prng_next(prng) % bound;
+#endif
+}
+
+/* Uniform in [0, 1). */
+static inline double mt_fs_tests_prng_double(mt_fs_tests_prng * const prng)
+{
+    return (double) (mt_fs_tests_prng_next(prng) >> 11) * (1.0 / (double) (UINT64_C(1) << 53));
+}
+
+/* Runner side */
+void mt_fs_tests_prng_set_seed(uint64_t seed);
+
+uint64_t mt_fs_tests_prng_get_seed(void) __attribute__ ((__pure__));
+
+void mt_fs_tests_prng_set_run(size_t run_idx);
+
+/* Streams of a given thread are independent, the framework uses its own ones
+   so that suites are not affected by, for example, the arrival schedule. */
+#define MT_FS_TESTS_PRNG_STREAM_SUITE (0)
+#define MT_FS_TESTS_PRNG_STREAM_ARRIVALS (1)
+
+void mt_fs_tests_prng_stream_init(mt_fs_tests_prng * prng,
+                                  uint64_t stream,
+                                  size_t id);
+
+/* Suite side */
+MT_FS_TESTS_API void mt_fs_tests_prng_thread_init(mt_fs_tests_prng * prng,
+                                                  size_t id);
+
+#endif /* MT_FS_TESTS_PRNG_H_ */
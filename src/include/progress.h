@@ -0,0 +1,27 @@
+#ifndef MT_FS_TESTS_PROGRESS_H_
+#define MT_FS_TESTS_PROGRESS_H_
+
+#include <stdint.h>
+
+#include "ops.h"
+
+/* Reporter thread sampling the counters of a run at a fixed interval while
+   it goes on, printing the throughput and latency of each interval, so that
+   a slow run can be told from a stuck one. The series is kept and printed
+   again along with the other results, to be correlated with periodic events
+   of the filesystem such as journal commits or writeback. */
+typedef struct mt_fs_tests_progress mt_fs_tests_progress;
+
+int mt_fs_tests_progress_start(mt_fs_tests_progress ** progress,
+                               mt_fs_tests_ops_run const * run,
+                               char const * suite_name,
+                               uint64_t interval_ns);
+
+/* Stops the reporter, accounting the last, partial, interval. */
+void mt_fs_tests_progress_stop(mt_fs_tests_progress * progress);
+
+void mt_fs_tests_progress_report(mt_fs_tests_progress const * progress);
+
+void mt_fs_tests_progress_free(mt_fs_tests_progress * progress);
+
+#endif /* MT_FS_TESTS_PROGRESS_H_ */
@@ -0,0 +1,82 @@
+#ifndef MT_FS_TESTS_RACES_H_
+#define MT_FS_TESTS_RACES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "api.h"
+#include "outcomes.h"
+
+#define MT_FS_TESTS_RACES_MAX_EXPECTATIONS (8)
+
+/* Race rounds of the metadata race suites, in which all threads do the same
+   operation on the same target, the outcomes of a round having to meet the
+   expectations of the suite, like exactly one success and EEXIST for all
+   other threads.
+
+   Rather than a single race per run, threads race <prefix>.rounds times
+   (default 1), avoiding the initialization of the suite and the start of
+   the threads for each race. Each thread records the outcome of its
+   operation of the round in a histogram shared by all threads, then waits for
+   the others on a process-shared barrier. The last thread to reach it checks
+   the outcomes of the round and calls the reset function of the suite to
+   restore the target, while the others wait on the barrier again. */
+
+typedef struct mt_fs_tests_races mt_fs_tests_races;
+
+/* Runner side. Clients of a coordinator, see coordinator.h, race on the
+   same targets: before initializing the suite of each step, they all set the
+   same key, from which the names of the targets are derived, and only the
+   first client, the owner, creates those which have to exist. */
+void mt_fs_tests_races_set_shared(uint64_t key,
+                                  bool owner);
+
+/* Whether the suite of the step shares its targets, and if so the
+   expectations that the outcomes of all clients together have to meet. */
+bool mt_fs_tests_races_get_shared(mt_fs_tests_expectation * expectations,
+                                  size_t * nb_expectations);
+
+/* Suite side. Replaces the trailing XXXXXX of name, like mktemp(), by a
+   random suffix, or by one derived from the key of the step for clients of
+   a coordinator. create tells whether the caller is the one to create the
+   target if it has to exist, which is always the case outside of clients.
+   The outcomes of the operations of a client only being its share of those
+   of the race, the coordinator checks them all together against
+   expectations. */
+MT_FS_TESTS_API int mt_fs_tests_races_target(char * name,
+                                             mt_fs_tests_expectation const * expectations,
+                                             size_t nb_expectations,
+                                             bool * create);
+
+/* Whether the outcomes are checked by the coordinator, instead of by the
+   suite. */
+MT_FS_TESTS_API bool mt_fs_tests_races_shared(void) __attribute__ ((__pure__));
+
+/* Restores the target of the race, whatever the outcome of the round was. */
+typedef int (mt_fs_tests_races_reset)(void * suite_data);
+
+MT_FS_TESTS_API int mt_fs_tests_races_init(mt_fs_tests_races ** races,
+                                           char const * prefix,
+                                           size_t nb_threads,
+                                           mt_fs_tests_expectation const * expectations,
+                                           size_t nb_expectations,
+                                           mt_fs_tests_races_reset * reset,
+                                           void * suite_data);
+
+/* Whether the thread has another round to race, false after the last one
+   or when resetting the target failed. */
+MT_FS_TESTS_API bool mt_fs_tests_races_next(mt_fs_tests_races const * races) __attribute__ ((__pure__));
+
+/* Records the outcome of the operation of the thread, 0 or an errno value,
+   and returns once the round is over and the target reset. */
+MT_FS_TESTS_API void mt_fs_tests_races_end(mt_fs_tests_races * races,
+                                          int outcome);
+
+/* Logs whether all rounds met the expectations, and the outcomes of the
+   first one which did not. */
+MT_FS_TESTS_API void mt_fs_tests_races_report(mt_fs_tests_races const * races);
+
+MT_FS_TESTS_API void mt_fs_tests_races_free(mt_fs_tests_races * races);
+
+#endif /* MT_FS_TESTS_RACES_H_ */
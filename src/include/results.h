@@ -0,0 +1,47 @@
+#ifndef MT_FS_TESTS_RESULTS_H_
+#define MT_FS_TESTS_RESULTS_H_
+
+#include <stddef.h>
+
+#include "ops.h"
+
+/* Results of the runs of each suite and configuration, saved to a compact
+   JSON file and compared against such a file taken as baseline:
+
+   {"version": 1, "results": [
+    {"suite": "file_create_mt", "config": "threads=500 workers=thread ...",
+     "runs": [{"ops": 500, "failed": 0, "seconds": 0.004, "ops_per_sec": 125000.0, "p50_us": 2.1, "p99_us": 15.6},
+              ...]},
+    ...]}
+
+   Each run of a suite gives one sample of its throughput and p99 latency,
+   compared with those of the baseline with a Mann-Whitney U test. */
+#define MT_FS_TESTS_RESULTS_SIGNIFICANCE (0.05)
+
+typedef struct mt_fs_tests_results mt_fs_tests_results;
+
+int mt_fs_tests_results_init(mt_fs_tests_results ** results);
+
+int mt_fs_tests_results_add(mt_fs_tests_results * results,
+                            char const * suite_name,
+                            char const * config,
+                            mt_fs_tests_ops_summary const * summary);
+
+int mt_fs_tests_results_write(mt_fs_tests_results const * results,
+                              char const * path);
+
+int mt_fs_tests_results_load(mt_fs_tests_results ** results,
+                             char const * path);
+
+/* Logs the comparison of each suite and configuration found in both, and
+   sets nb_regressions to the number of them whose median throughput
+   dropped, or median p99 latency rose, by more than threshold percent,
+   significantly when there are enough runs to tell. */
+int mt_fs_tests_results_compare(mt_fs_tests_results const * results,
+                                mt_fs_tests_results const * baseline,
+                                double threshold,
+                                size_t * nb_regressions);
+
+void mt_fs_tests_results_free(mt_fs_tests_results * results);
+
+#endif /* MT_FS_TESTS_RESULTS_H_ */
@@ -0,0 +1,17 @@
+#ifndef MT_FS_TESTS_SHARED_MEMORY_H_
+#define MT_FS_TESTS_SHARED_MEMORY_H_
+
+#include <stddef.h>
+
+#include "api.h"
+
+/* Zeroed memory shared between the runner and its workers, whether they are
+   threads or forked processes. Anything a suite thread writes during the
+   run and that is read afterwards, in post_run for example, has to be
+   allocated here rather than with malloc(). */
+MT_FS_TESTS_API void * mt_fs_tests_shared_calloc(size_t nmemb,
+                                                 size_t size);
+
+MT_FS_TESTS_API void mt_fs_tests_shared_free(void * ptr);
+
+#endif /* MT_FS_TESTS_SHARED_MEMORY_H_ */
@@ -0,0 +1,39 @@
+#ifndef MT_FS_TESTS_STACKS_H_
+#define MT_FS_TESTS_STACKS_H_
+
+#include <pthread.h>
+#include <stddef.h>
+
+/* Stacks of thread workers, allocated by the framework rather than by the
+   pthread library so that their size can be lowered enough to run tens of
+   thousands of workers. Each stack sits above a guard page, a worker
+   overflowing its stack crashes instead of corrupting the stack of its
+   neighbour. Pages being only allocated when first touched, the deepest
+   resident page of a stack gives its high-water mark once its thread is
+   done, thread-local storage placed at the top of the stack included. */
+#define MT_FS_TESTS_STACKS_DEFAULT_SIZE (256 * 1024)
+
+typedef struct mt_fs_tests_stacks mt_fs_tests_stacks;
+
+/* Warns about system limits too low for this number of threads. */
+void mt_fs_tests_stacks_check_limits(size_t nb_threads);
+
+/* stack_size is rounded up to a multiple of the page size. */
+int mt_fs_tests_stacks_init(mt_fs_tests_stacks ** stacks,
+                            size_t nb_stacks,
+                            size_t stack_size);
+
+/* Initializes attr to create a thread on stack idx. */
+int mt_fs_tests_stacks_attr_init(mt_fs_tests_stacks const * stacks,
+                                 size_t idx,
+                                 pthread_attr_t * attr);
+
+/* To be called once all threads have been joined. framework_size is the
+   memory used per thread by the framework bookkeeping, in bytes. */
+void mt_fs_tests_stacks_report(mt_fs_tests_stacks const * stacks,
+                               char const * suite_name,
+                               size_t framework_size);
+
+void mt_fs_tests_stacks_free(mt_fs_tests_stacks * stacks);
+
+#endif /* MT_FS_TESTS_STACKS_H_ */
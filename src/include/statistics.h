@@ -0,0 +1,27 @@
+#ifndef MT_FS_TESTS_STATISTICS_H_
+#define MT_FS_TESTS_STATISTICS_H_
+
+#include <stddef.h>
+
+/* Median of values, which are sorted in place. */
+double mt_fs_tests_statistics_median(double * values,
+                                     size_t nb_values);
+
+/* One-sided Mann-Whitney U test: probability, were both samples drawn from
+   the same distribution, of values of a being at least as small compared to
+   those of b as observed. The exact distribution of U is used for samples
+   without ties of up to MT_FS_TESTS_STATISTICS_EXACT_MAX values each, its
+   normal approximation otherwise. */
+#define MT_FS_TESTS_STATISTICS_EXACT_MAX (50)
+
+int mt_fs_tests_statistics_mann_whitney(double const * a,
+                                        size_t nb_a,
+                                        double const * b,
+                                        size_t nb_b,
+                                        double * p_value);
+
+/* Smallest p-value the test can give for samples of these sizes. */
+double mt_fs_tests_statistics_mann_whitney_min_p(size_t nb_a,
+                                                 size_t nb_b) __attribute__ ((__const__));
+
+#endif /* MT_FS_TESTS_STATISTICS_H_ */
@@ -3,6 +3,19 @@
 
 #include <stdlib.h>
 
+#include "api.h"
+
+/* Bumped whenever the layout of the test_suite structure or the signature of
+   its functions or of the framework functions available to suites change,
+   so that a plugin built against another layout is rejected instead of being
+   called with mismatched arguments. A plugin using a framework function this
+   binary lacks is not covered: it already fails in dlopen() with an
+   unresolved symbol.
+   2: options, shared memory, cold cache, verification, prng and
+   distributions, races, outcomes, and the rate, bytes and phase functions
+   of ops.h. */
+#define MT_FS_TESTS_SUITE_API_VERSION (2)
+
 typedef enum
 {
     test_suite_type_none = 0,
@@ -31,4 +44,22 @@ typedef struct
     test_suite_type type;
 } test_suite;
 
+/* A suite built as a shared object, to be loaded with --plugin, exports a
+   test_suite_plugin descriptor named mt_fs_tests_plugin, usually through
+   the MT_FS_TESTS_PLUGIN() macro. */
+typedef struct
+{
+    unsigned int api_version;
+    test_suite const * suite;
+} test_suite_plugin;
+
+#define MT_FS_TESTS_PLUGIN_SYMBOL "mt_fs_tests_plugin"
+
+#define MT_FS_TESTS_PLUGIN(suite_name)                                  \
+    MT_FS_TESTS_API test_suite_plugin const mt_fs_tests_plugin =        \
+    {                                                                   \
+        MT_FS_TESTS_SUITE_API_VERSION,                                  \
+        &test_suite_ ## suite_name                                      \
+    }
+
 #endif /* TEST_SUITES_H_ */
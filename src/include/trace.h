@@ -0,0 +1,89 @@
+#ifndef MT_FS_TESTS_TRACE_H_
+#define MT_FS_TESTS_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/* Binary trace file layout, all values in host byte order:
+   - file header: MT_FS_TESTS_TRACE_MAGIC, then uint32_t version;
+   - one section per suite run:
+     - uint32_t name length, suite name (not NUL-terminated),
+     - uint32_t run index, uint32_t number of threads,
+     - uint32_t number of operation names, then for each one its uint32_t
+       length followed by the name,
+     - uint64_t number of events, then the events as
+       mt_fs_tests_trace_file_event. */
+#define MT_FS_TESTS_TRACE_MAGIC "MTFSTRC"
+#define MT_FS_TESTS_TRACE_VERSION (1)
+
+typedef enum
+{
+    mt_fs_tests_trace_phase_begin = 0,
+    mt_fs_tests_trace_phase_end,
+} mt_fs_tests_trace_phase;
+
+typedef struct
+{
+    uint64_t timestamp_ns;
+    uint32_t thread;
+    uint32_t name_idx;
+    int32_t result;
+    uint32_t phase;
+} mt_fs_tests_trace_file_event;
+
+typedef struct
+{
+    uint64_t timestamp_ns;
+    char const * name;
+    int32_t result;
+    uint32_t phase;
+} mt_fs_tests_trace_event;
+
+/* Events recorded by a single thread. The buffer is allocated and touched
+   before the run so that recording never allocates nor faults; events not
+   fitting in it are counted as dropped. */
+typedef struct
+{
+    mt_fs_tests_trace_event * events;
+    size_t capacity;
+    size_t count;
+    uint64_t dropped;
+} mt_fs_tests_trace_buffer;
+
+int mt_fs_tests_trace_buffer_init(mt_fs_tests_trace_buffer * buffer,
+                                  size_t capacity);
+
+void mt_fs_tests_trace_buffer_free(mt_fs_tests_trace_buffer * buffer);
+
+static inline void mt_fs_tests_trace_record(mt_fs_tests_trace_buffer * const buffer,
+                                            uint64_t const timestamp_ns,
+                                            char const * const name,
+                                            mt_fs_tests_trace_phase const phase,
+                                            int const result)
+{
+    if (buffer->count < buffer->capacity)
+    {
+        mt_fs_tests_trace_event * const event = &(buffer->events[buffer->count]);
+        event->timestamp_ns = timestamp_ns;
+        event->name = name;
+        event->result = result;
+        event->phase = phase;
+        buffer->count++;
+    }
+    else
+    {
+        buffer->dropped++;
+    }
+}
+
+int mt_fs_tests_trace_open(char const * path,
+                           FILE ** fp);
+
+int mt_fs_tests_trace_write_section(FILE * fp,
+                                    char const * suite_name,
+                                    size_t run_idx,
+                                    mt_fs_tests_trace_buffer const * const * buffers,
+                                    size_t nb_threads);
+
+#endif /* MT_FS_TESTS_TRACE_H_ */
@@ -1,13 +1,27 @@
 #ifndef MT_FS_TESTS_UTILS_H_
 #define MT_FS_TESTS_UTILS_H_
 
+#include <stdint.h>
 #include <stdio.h>
+#include <time.h>
 
-void log_real(char const * file,
-              int const line,
-              char const * const function,
-              char const * const format,
-              ...) __attribute__ ((__format__(printf, 4, 5)));
+#include "api.h"
+
+#define MT_FS_TESTS_NS_PER_SEC (UINT64_C(1000000000))
+
+static inline uint64_t mt_fs_tests_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t) ts.tv_sec * MT_FS_TESTS_NS_PER_SEC + (uint64_t) ts.tv_nsec;
+}
+
+MT_FS_TESTS_API void log_real(char const * file,
+                              int const line,
+                              char const * const function,
+                              char const * const format,
+                              ...) __attribute__ ((__format__(printf, 4, 5)));
 
 #define LOG_ERROR(...)                          \
     do                                          \
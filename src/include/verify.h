@@ -0,0 +1,28 @@
+#ifndef MT_FS_TESTS_VERIFY_H_
+#define MT_FS_TESTS_VERIFY_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "api.h"
+
+/* Bulk data verification. The implementation is selected at runtime on the
+   first call: AVX2 pattern compares and SSE4.2 CRC32C instructions when the
+   CPU supports them, word-wise compares and a slicing-by-8 table otherwise. */
+
+/* Returns the offset of the first byte of buffer differing from pattern, or
+   size if all of them match. */
+MT_FS_TESTS_API size_t mt_fs_tests_verify_pattern(void const * buffer,
+                                                  size_t size,
+                                                  uint8_t pattern);
+
+/* CRC32C (Castagnoli) of buffer. crc is 0 for the first block, or the value
+   returned for the previous block to checksum data in several calls. */
+MT_FS_TESTS_API uint32_t mt_fs_tests_crc32c(uint32_t crc,
+                                            void const * buffer,
+                                            size_t size);
+
+/* Describes the selected implementations, for logging purposes. */
+MT_FS_TESTS_API char const * mt_fs_tests_verify_implementation(void);
+
+#endif /* MT_FS_TESTS_VERIFY_H_ */
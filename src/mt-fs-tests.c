@@ -1,31 +1,99 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <getopt.h>
+#include <libgen.h>
 #include <limits.h>
+#include <signal.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <strings.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 #define DEFAULT_THREADS_COUNT (500)
+#define DEFAULT_TRACE_EVENTS (65536)
+#define MAX_THREADS_COUNTS (MT_FS_TESTS_COORDINATOR_MAX_THREADS_COUNTS)
+#define DEFAULT_REGRESSION_THRESHOLD (5.0)
+/* Above errno values, returned when --compare finds a regression. */
+#define REGRESSION_EXIT_STATUS (200)
 
 #include "suites/suites.h"
 #include "barrier.h"
+#include "cold_cache.h"
+#include "coordinator.h"
+#include "ops.h"
+#include "options.h"
+#include "perf_counters.h"
+#include "plugins.h"
+#include "prng.h"
+#include "progress.h"
+#include "races.h"
+#include "results.h"
+#include "shared_memory.h"
+#include "stacks.h"
+#include "trace.h"
 #include "utils.h"
 
+typedef enum
+{
+    workers_mode_thread = 0,
+    workers_mode_process,
+} workers_mode;
+
 typedef struct
 {
-    mt_fs_tests_barrier_t barrier;
+    mt_fs_tests_ops_config ops_config;
     test_suite const * selected_suite;
+    /* Resolved along with results_path when given, before --directory
+       changes the current directory. */
+    char * trace_path;
+    FILE * trace_fp;
+    /* Suites are run for each of these numbers of threads in turn,
+       nb_threads being the current one. */
+    size_t threads_counts[MAX_THREADS_COUNTS];
+    size_t nb_threads_counts;
     size_t nb_runs;
     size_t nb_threads;
+    /* Stack size of thread workers, in bytes. */
+    size_t stack_size;
+    /* Interval of the progress reporter, disabled when 0. */
+    uint64_t progress_interval_ns;
+    workers_mode workers;
+    /* Directory the suites are run from, the current one if NULL. */
+    char const * directory;
+    /* Set with --coordinator or --client, see coordinator.h. */
+    char coordination_name[MT_FS_TESTS_COORDINATOR_SUITE_NAME_SIZE];
+    size_t nb_clients;
+    size_t client_id;
+    bool client_id_set;
+    mt_fs_tests_coordinator * coordinator;
+    mt_fs_tests_coordinator * client;
+    /* Results of each suite run, when saved with --results or compared
+       with --compare. */
+    char * results_path;
+    mt_fs_tests_results * results;
+    char const * baseline_path;
+    mt_fs_tests_results * baseline;
+    /* In percent. */
+    double regression_threshold;
+    uint64_t seed;
+    bool seed_set;
+    bool perf_counters;
 } global_params;
 
 typedef struct
 {
     pthread_t thread;
+    pid_t pid;
+    mt_fs_tests_barrier_t * barrier;
     global_params * params;
     test_suite const * suite;
+    mt_fs_tests_ops_run * ops_run;
+    mt_fs_tests_perf_thread * perf;
     void * suite_data;
     size_t id;
 } thread_params;
@@ -39,11 +107,31 @@ static void * suite_thread_run(void * th_data)
     assert(th_params->suite != NULL);
     assert(th_params->suite->run != NULL);
 
-    mt_fs_tests_barrier_wait(&(th_params->params->barrier));
+    mt_fs_tests_ops_thread_attach(th_params->ops_run,
+                                  th_params->id);
+
+    if (th_params->perf != NULL)
+    {
+        mt_fs_tests_perf_thread_open(th_params->perf);
+    }
+
+    mt_fs_tests_barrier_wait(th_params->barrier);
+
+    if (th_params->perf != NULL)
+    {
+        mt_fs_tests_perf_thread_start(th_params->perf);
+    }
 
     result = (*(th_params->suite->run))(th_params->suite_data,
                                         th_params->id);
 
+    if (th_params->perf != NULL)
+    {
+        mt_fs_tests_perf_thread_stop(th_params->perf);
+    }
+
+    mt_fs_tests_ops_thread_detach();
+
     if (result != 0)
     {
         LOG_ERROR("Error in suite run for thread %zu of suite %s: %d",
@@ -55,11 +143,213 @@ static void * suite_thread_run(void * th_data)
     return NULL;
 }
 
+static int run_workers_threads(global_params const * const params,
+                               test_suite const * const suite,
+                               mt_fs_tests_stacks const * const stacks,
+                               thread_params * const threads_params)
+{
+    int result = 0;
+    size_t idx = 0;
+
+    for (idx = 0;
+         result == 0 &&
+             idx < params->nb_threads;
+         idx++)
+    {
+        thread_params * tp = &(threads_params[idx]);
+        pthread_attr_t attr;
+
+        result = mt_fs_tests_stacks_attr_init(stacks,
+                                              idx,
+                                              &attr);
+
+        if (result == 0)
+        {
+            result = pthread_create(&(tp->thread),
+                                    &attr,
+                                    &suite_thread_run,
+                                    tp);
+
+            pthread_attr_destroy(&attr);
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Creation of thread %zu for suite %s failed: %d\n",
+                      idx,
+                      suite->name,
+                      result);
+        }
+    }
+
+    if (result != 0)
+    {
+        for (size_t cancel_idx = 0;
+             cancel_idx < idx;
+             cancel_idx++)
+        {
+            thread_params * tp = &(threads_params[cancel_idx]);
+            pthread_cancel(tp->thread);
+        }
+    }
+
+    for(size_t join_idx = 0;
+        join_idx < idx;
+        join_idx++)
+    {
+        thread_params * tp = &(threads_params[join_idx]);
+
+        result = pthread_join(tp->thread,
+                              NULL);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error joining thread %zu for suite %s: %d",
+                      join_idx,
+                      suite->name,
+                      result);
+        }
+    }
+
+    return result;
+}
+
+static int run_workers_processes(global_params const * const params,
+                                 test_suite const * const suite,
+                                 thread_params * const threads_params)
+{
+    int result = 0;
+    size_t nb_started = 0;
+
+    /* Do not let children flush what has been buffered so far. */
+    fflush(stdout);
+    fflush(stderr);
+
+    while (result == 0 &&
+           nb_started < params->nb_threads)
+    {
+        thread_params * tp = &(threads_params[nb_started]);
+
+        tp->pid = fork();
+
+        if (tp->pid == 0)
+        {
+            suite_thread_run(tp);
+            _exit(EXIT_SUCCESS);
+        }
+        else if (tp->pid > 0)
+        {
+            nb_started++;
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Creation of process %zu for suite %s failed: %d",
+                      nb_started,
+                      suite->name,
+                      result);
+        }
+    }
+
+    if (result != 0)
+    {
+        /* Started workers would wait forever on the barrier. */
+        for (size_t kill_idx = 0;
+             kill_idx < nb_started;
+             kill_idx++)
+        {
+            kill(threads_params[kill_idx].pid, SIGKILL);
+        }
+    }
+
+    for (size_t wait_idx = 0;
+         wait_idx < nb_started;
+         wait_idx++)
+    {
+        thread_params * tp = &(threads_params[wait_idx]);
+        int status = 0;
+        pid_t res = 0;
+
+        do
+        {
+            res = waitpid(tp->pid, &status, 0);
+        }
+        while (res == -1 && errno == EINTR);
+
+        if (res == -1)
+        {
+            result = errno;
+            LOG_ERROR("Error waiting for process %zu for suite %s: %d",
+                      wait_idx,
+                      suite->name,
+                      result);
+        }
+        else if (result == 0 &&
+                 (!WIFEXITED(status) || WEXITSTATUS(status) != EXIT_SUCCESS))
+        {
+            result = ECHILD;
+            LOG_ERROR("Process %zu for suite %s terminated abnormally: %d",
+                      wait_idx,
+                      suite->name,
+                      status);
+        }
+    }
+
+    return result;
+}
+
+/* Records the run in the results, under the configuration it ran with. */
+static int record_results(global_params const * const params,
+                          mt_fs_tests_ops_run const * const ops_run,
+                          char const * const suite_name)
+{
+    int result = 0;
+    char config[128];
+    mt_fs_tests_ops_summary summary;
+    assert(params != NULL);
+    assert(params->results != NULL);
+
+    mt_fs_tests_ops_run_summarize(ops_run,
+                                  &summary);
+
+    if (params->ops_config.arrival != mt_fs_tests_arrival_closed_loop)
+    {
+        snprintf(config,
+                 sizeof config,
+                 "threads=%zu workers=%s arrival=%s rate=%.1f",
+                 params->nb_threads,
+                 params->workers == workers_mode_process ? "process" : "thread",
+                 mt_fs_tests_ops_arrival_name(params->ops_config.arrival),
+                 params->ops_config.rate);
+    }
+    else
+    {
+        snprintf(config,
+                 sizeof config,
+                 "threads=%zu workers=%s",
+                 params->nb_threads,
+                 params->workers == workers_mode_process ? "process" : "thread");
+    }
+
+    result = mt_fs_tests_results_add(params->results,
+                                     suite_name,
+                                     config,
+                                     &summary);
+
+    return result;
+}
+
 static int run_suite(global_params * const params,
-                     test_suite const * const suite)
+                     test_suite const * const suite,
+                     size_t const run_idx)
 {
     int result = 0;
     void * suite_data = NULL;
+    mt_fs_tests_ops_run * ops_run = NULL;
+    mt_fs_tests_perf_thread * perf = NULL;
+    mt_fs_tests_stacks * stacks = NULL;
+    mt_fs_tests_progress * progress = NULL;
+    size_t const nb_threads = suite->type == test_suite_type_mt ? params->nb_threads : 1;
 
     assert(params != NULL);
     assert(suite != NULL);
@@ -68,6 +358,15 @@ static int run_suite(global_params * const params,
     assert(suite->type > test_suite_type_none);
     assert(suite->type < test_suite_type_count);
 
+    mt_fs_tests_prng_set_run(run_idx);
+
+    if (params->client != NULL)
+    {
+        /* Clients race on the same targets, created by the first one. */
+        mt_fs_tests_races_set_shared(mt_fs_tests_coordinator_get_step_key(params->client),
+                                     mt_fs_tests_coordinator_get_client_id(params->client) == 0);
+    }
+
     if (suite->init != NULL)
     {
         result = (*(suite->init))(&suite_data,
@@ -81,13 +380,95 @@ static int run_suite(global_params * const params,
         }
     }
 
+    if (result == 0)
+    {
+        /* Do not let the run hit caches warmed by the initialization. */
+        mt_fs_tests_cold_cache_evict();
+
+        result = mt_fs_tests_ops_run_init(&ops_run,
+                                          &(params->ops_config),
+                                          nb_threads);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error allocating operations data for suite %s: %d",
+                      suite->name,
+                      result);
+        }
+    }
+
+    if (result == 0 &&
+        params->perf_counters == true)
+    {
+        perf = mt_fs_tests_shared_calloc(nb_threads,
+                                         sizeof *perf);
+
+        if (perf == NULL)
+        {
+            result = ENOMEM;
+            LOG_ERROR("Error allocating perf counters for suite %s: %d",
+                      suite->name,
+                      result);
+        }
+    }
+
+    if (params->client != NULL)
+    {
+        /* Sent even on failure, the other clients are waiting for it. */
+        int const res = mt_fs_tests_coordinator_client_ready(params->client,
+                                                             result);
+
+        if (result == 0)
+        {
+            result = res;
+        }
+    }
+
+    if (result == 0 &&
+        params->progress_interval_ns > 0)
+    {
+        result = mt_fs_tests_progress_start(&progress,
+                                            ops_run,
+                                            suite->name,
+                                            params->progress_interval_ns);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error starting progress reporter for suite %s: %d",
+                      suite->name,
+                      result);
+        }
+    }
+
     if (result == 0)
     {
         if (suite->type == test_suite_type_single)
         {
+            mt_fs_tests_ops_thread_attach(ops_run,
+                                          0);
+
+            if (params->client != NULL)
+            {
+                /* Start along with the other clients. */
+                mt_fs_tests_barrier_wait(mt_fs_tests_coordinator_get_barrier(params->client));
+            }
+
+            if (perf != NULL)
+            {
+                mt_fs_tests_perf_thread_open(perf);
+                mt_fs_tests_perf_thread_start(perf);
+            }
+
             result = (*(suite->run))(suite_data,
                                      0);
 
+            if (perf != NULL)
+            {
+                mt_fs_tests_perf_thread_stop(perf);
+            }
+
+            mt_fs_tests_ops_thread_detach();
+
             if (result != 0)
             {
                 LOG_ERROR("Error running suite %s: %d",
@@ -98,20 +479,53 @@ static int run_suite(global_params * const params,
         else if (suite->type == test_suite_type_mt)
         {
             thread_params * threads_params = malloc(sizeof *threads_params * params->nb_threads);
+            /* Shared in case workers are processes. The barrier of a
+               client is the one of the coordinator, shared with the workers
+               of all clients and initialized for them. */
+            mt_fs_tests_barrier_t * barrier = params->client != NULL ?
+                mt_fs_tests_coordinator_get_barrier(params->client) :
+                mt_fs_tests_shared_calloc(1,
+                                          sizeof *barrier);
+            bool barrier_initialized = false;
 
-            if (threads_params != NULL)
+            if (threads_params != NULL &&
+                barrier != NULL)
             {
-                size_t idx = 0;
                 assert(params->nb_threads <= UINT_MAX);
 
-                result = mt_fs_tests_barrier_init(&(params->barrier),
-                                                  (unsigned int) params->nb_threads);
+                if (params->client == NULL)
+                {
+                    if (params->workers == workers_mode_process)
+                    {
+                        result = mt_fs_tests_barrier_init_shared(barrier,
+                                                                 (unsigned int) params->nb_threads);
+                    }
+                    else
+                    {
+                        result = mt_fs_tests_barrier_init(barrier,
+                                                          (unsigned int) params->nb_threads);
+                    }
+
+                    barrier_initialized = result == 0;
+                }
+
+                if (result != 0)
+                {
+                    LOG_ERROR("Error creating barrier for suite %s: %d",
+                              suite->name,
+                              result);
+                }
+                else if (params->workers == workers_mode_thread)
+                {
+                    result = mt_fs_tests_stacks_init(&stacks,
+                                                     params->nb_threads,
+                                                     params->stack_size);
+                }
 
                 if (result == 0)
                 {
-                    for (idx = 0;
-                         result == 0 &&
-                             idx < params->nb_threads;
+                    for (size_t idx = 0;
+                         idx < params->nb_threads;
                          idx++)
                     {
                         thread_params * tp = &(threads_params[idx]);
@@ -119,60 +533,30 @@ static int run_suite(global_params * const params,
                         tp->suite_data = suite_data;
                         tp->params = params;
                         tp->suite = suite;
-
-                        result = pthread_create(&(tp->thread),
-                                                NULL,
-                                                &suite_thread_run,
-                                                tp);
-
-                        if (result != 0)
-                        {
-                            LOG_ERROR("Creation of thread %zu for suite %s failed: %d\n",
-                                      idx,
-                                      suite->name,
-                                      result);
-                        }
+                        tp->ops_run = ops_run;
+                        tp->perf = perf != NULL ? &(perf[idx]) : NULL;
+                        tp->barrier = barrier;
                     }
 
-                    if (result != 0)
+                    if (params->workers == workers_mode_process)
                     {
-                        for (size_t cancel_idx = 0;
-                             cancel_idx < idx;
-                             cancel_idx++)
-                        {
-                            thread_params * tp = &(threads_params[cancel_idx]);
-                            pthread_cancel(tp->thread);
-                        }
+                        result = run_workers_processes(params,
+                                                       suite,
+                                                       threads_params);
                     }
-
-                    for(size_t join_idx = 0;
-                        join_idx < idx;
-                        join_idx++)
+                    else
                     {
-                        thread_params * tp = &(threads_params[join_idx]);
-
-                        result = pthread_join(tp->thread,
-                                              NULL);
-
-                        if (result != 0)
-                        {
-                            LOG_ERROR("Error joining thread %zu for suite %s: %d",
-                                      join_idx,
-                                      suite->name,
-                                      result);
-                        }
+                        result = run_workers_threads(params,
+                                                     suite,
+                                                     stacks,
+                                                     threads_params);
                     }
-
-                    mt_fs_tests_barrier_destroy(&(params->barrier));
                 }
-                else
+
+                if (barrier_initialized == true)
                 {
-                    LOG_ERROR("Error creating barrier for suite %s: %d",
-                              suite->name,
-                              result);
+                    mt_fs_tests_barrier_destroy(barrier);
                 }
-
-                free(threads_params), threads_params = NULL;
             }
             else
             {
@@ -181,6 +565,17 @@ static int run_suite(global_params * const params,
                           suite->name,
                           result);
             }
+
+            if (barrier != NULL &&
+                params->client == NULL)
+            {
+                mt_fs_tests_shared_free(barrier), barrier = NULL;
+            }
+
+            if (threads_params != NULL)
+            {
+                free(threads_params), threads_params = NULL;
+            }
         }
         else
         {
@@ -191,6 +586,87 @@ static int run_suite(global_params * const params,
         }
     }
 
+    if (progress != NULL)
+    {
+        mt_fs_tests_progress_stop(progress);
+    }
+
+    if (params->client != NULL)
+    {
+        mt_fs_tests_expectation expectations[MT_FS_TESTS_RACES_MAX_EXPECTATIONS];
+        size_t nb_expectations = 0;
+
+        if (mt_fs_tests_races_get_shared(expectations,
+                                         &nb_expectations) == false)
+        {
+            nb_expectations = 0;
+        }
+
+        mt_fs_tests_coordinator_client_publish(params->client,
+                                               ops_run,
+                                               expectations,
+                                               nb_expectations,
+                                               result);
+    }
+
+    if (result == 0)
+    {
+        mt_fs_tests_ops_run_report(ops_run,
+                                   suite->name);
+
+        if (params->results != NULL)
+        {
+            result = record_results(params,
+                                    ops_run,
+                                    suite->name);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error recording results of suite %s: %d",
+                          suite->name,
+                          result);
+            }
+        }
+
+        if (progress != NULL)
+        {
+            mt_fs_tests_progress_report(progress);
+        }
+
+        if (stacks != NULL)
+        {
+            mt_fs_tests_stacks_report(stacks,
+                                      suite->name,
+                                      mt_fs_tests_ops_run_thread_footprint(ops_run) +
+                                      (perf != NULL ? sizeof *perf : 0));
+        }
+
+        if (perf != NULL)
+        {
+            mt_fs_tests_perf_report(perf,
+                                    nb_threads,
+                                    suite->name);
+        }
+
+        mt_fs_tests_cold_cache_report(suite->name);
+
+        if (params->trace_fp != NULL)
+        {
+            int const res = mt_fs_tests_ops_run_write_trace(ops_run,
+                                                            params->trace_fp,
+                                                            suite->name,
+                                                            run_idx);
+
+            if (res != 0)
+            {
+                LOG_ERROR("Error writing trace of suite %s to %s: %d",
+                          suite->name,
+                          params->trace_path,
+                          res);
+            }
+        }
+    }
+
     if (result == 0 &&
         suite->post_run != NULL)
     {
@@ -204,6 +680,15 @@ static int run_suite(global_params * const params,
         }
     }
 
+    mt_fs_tests_progress_free(progress), progress = NULL;
+    mt_fs_tests_ops_run_free(ops_run), ops_run = NULL;
+    mt_fs_tests_stacks_free(stacks), stacks = NULL;
+
+    if (perf != NULL)
+    {
+        mt_fs_tests_shared_free(perf), perf = NULL;
+    }
+
     if (suite->deinit != NULL)
     {
         result = (*(suite->deinit))(suite_data);
@@ -219,15 +704,40 @@ static int run_suite(global_params * const params,
     return result;
 }
 
-static int str_to_unsigned_int64(char const * const str_val,
-                                 uint64_t * const out)
+static int run_step(global_params * const params,
+                    test_suite const * const suite,
+                    size_t const run_idx)
 {
     int result = 0;
+    assert(params != NULL);
+    assert(suite != NULL);
 
-    if (str_val != NULL && out != NULL)
+    if (params->coordinator != NULL)
     {
-        long long int val = 0;
-        char *endptr;
+        /* The workers are those of the clients. */
+        result = mt_fs_tests_coordinator_run_step(params->coordinator,
+                                                  suite->name,
+                                                  suite->type == test_suite_type_mt ? params->nb_threads : 1);
+    }
+    else
+    {
+        result = run_suite(params,
+                           suite,
+                           run_idx);
+    }
+
+    return result;
+}
+
+static int str_to_unsigned_int64(char const * const str_val,
+                                 uint64_t * const out)
+{
+    int result = 0;
+
+    if (str_val != NULL && out != NULL)
+    {
+        long long int val = 0;
+        char *endptr;
 
         errno = 0;
         val = strtoll(str_val, &endptr, 10);
@@ -259,60 +769,538 @@ static int str_to_unsigned_int64(char const * const str_val,
     return result;
 }
 
+/* Makes path absolute, the file itself not having to exist yet. */
+static int resolve_path(char const * const path,
+                        char ** const out)
+{
+    int result = 0;
+    char * const dir_copy = strdup(path);
+    char * const base_copy = strdup(path);
+
+    if (dir_copy != NULL &&
+        base_copy != NULL)
+    {
+        char * const dir = realpath(dirname(dir_copy), NULL);
+
+        if (dir != NULL)
+        {
+            char const * const base = basename(base_copy);
+            size_t const size = strlen(dir) + strlen(base) + 2;
+
+            free(*out), *out = malloc(size);
+
+            if (*out != NULL)
+            {
+                snprintf(*out,
+                         size,
+                         "%s/%s",
+                         strcmp(dir, "/") != 0 ? dir : "",
+                         base);
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+
+            free(dir);
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error resolving path %s: %d",
+                  path,
+                  result);
+    }
+
+    free(base_copy);
+    free(dir_copy);
+
+    return result;
+}
+
+static int str_to_double(char const * const str_val,
+                         double * const out)
+{
+    int result = 0;
+
+    if (str_val != NULL && out != NULL)
+    {
+        char * endptr = NULL;
+        double val = 0.0;
+
+        errno = 0;
+        val = strtod(str_val, &endptr);
+
+        if (errno != 0)
+        {
+            result = errno;
+        }
+        else if (endptr == str_val || *endptr != '\0')
+        {
+            result = ENOENT;
+        }
+        else
+        {
+            *out = val;
+        }
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+static void print_usage(char const * const program)
+{
+    LOG_ERROR("Usage: %s [options] [<nb threads>[,<nb threads>...] [<nb runs> [<selected suite>]]]\n"
+              "Options:\n"
+              "  -o, --option=<suite>.<name>=<value> set a suite option\n"
+              "  --rate=<ops/s>                   open-loop mode, issue operations at this total rate\n"
+              "  --arrival=constant|poisson       arrival schedule of open-loop mode (default: constant)\n"
+              "  --seed=<seed>                    seed of the random generators, to replay a previous run\n"
+              "  --cold-cache                     evict caches after suites initialization, and between their phases\n"
+              "  --perf                           collect perf counters and resource usage of threads\n"
+              "  --trace=<file>                   record begin and end events of operations to a binary trace file\n"
+              "  --trace-events=<count>           capacity of the per-thread trace buffer (default: %d)\n"
+              "  --plugin=<file or directory>     load suites from a shared object, or from all of those in a directory\n"
+              "  --workers=thread|process         run workers as threads of a single process (default), or as forked processes\n"
+              "  --stack-size=<bytes>[k|m|g]      stack size of thread workers (default: %dk)\n"
+              "  --progress=<ms>                  print throughput and latency every <ms> milliseconds while suites run\n"
+              "  --results=<file>                 save the throughput and latency of each run to a JSON file\n"
+              "  --compare=<file>                 compare runs against a results file, exiting with %d on regression\n"
+              "  --regression-threshold=<percent> change of median throughput or p99 latency deemed a regression (default: %.0f)\n"
+              "  --directory=<path>               run the suites from this directory, a mount point for example\n"
+              "  --coordinator=<name>:<nb>        coordinate the runs of <nb> client processes, without running suites\n"
+              "  --client=<name>:<id>             run as client <id> of a coordinator, taking the threads, runs, suite and seed from it",
+              program,
+              DEFAULT_TRACE_EVENTS,
+              MT_FS_TESTS_STACKS_DEFAULT_SIZE / 1024,
+              REGRESSION_EXIT_STATUS,
+              DEFAULT_REGRESSION_THRESHOLD);
+}
+
+typedef enum
+{
+    option_rate = 256,
+    option_arrival,
+    option_perf,
+    option_trace,
+    option_trace_events,
+    option_plugin,
+    option_workers,
+    option_cold_cache,
+    option_seed,
+    option_stack_size,
+    option_progress,
+    option_results,
+    option_compare,
+    option_regression_threshold,
+    option_directory,
+    option_coordinator,
+    option_client,
+    option_suite_option = 'o',
+} option_id;
+
+static struct option const long_options[] =
+{
+    { "rate", required_argument, NULL, option_rate },
+    { "arrival", required_argument, NULL, option_arrival },
+    { "perf", no_argument, NULL, option_perf },
+    { "trace", required_argument, NULL, option_trace },
+    { "trace-events", required_argument, NULL, option_trace_events },
+    { "plugin", required_argument, NULL, option_plugin },
+    { "workers", required_argument, NULL, option_workers },
+    { "cold-cache", no_argument, NULL, option_cold_cache },
+    { "seed", required_argument, NULL, option_seed },
+    { "stack-size", required_argument, NULL, option_stack_size },
+    { "progress", required_argument, NULL, option_progress },
+    { "results", required_argument, NULL, option_results },
+    { "compare", required_argument, NULL, option_compare },
+    { "regression-threshold", required_argument, NULL, option_regression_threshold },
+    { "directory", required_argument, NULL, option_directory },
+    { "coordinator", required_argument, NULL, option_coordinator },
+    { "client", required_argument, NULL, option_client },
+    { "option", required_argument, NULL, option_suite_option },
+    { NULL, 0, NULL, 0 }
+};
+
+/* Parses <name>:<number>, as given to --coordinator and --client. */
+static int parse_coordination(char const * const str,
+                              global_params * const params,
+                              size_t * const number)
+{
+    int result = 0;
+    char const * const colon = strrchr(str, ':');
+    assert(str != NULL);
+    assert(params != NULL);
+    assert(number != NULL);
+
+    if (params->coordination_name[0] != '\0')
+    {
+        result = EINVAL;
+        LOG_ERROR("--coordinator and --client can only be given once, and not together!");
+    }
+    else if (colon != NULL &&
+             colon != str &&
+             (size_t) (colon - str) < sizeof params->coordination_name)
+    {
+        uint64_t temp = 0;
+
+        result = str_to_unsigned_int64(colon + 1,
+                                       &temp);
+
+        if (result == 0)
+        {
+            memcpy(params->coordination_name, str, (size_t) (colon - str));
+            params->coordination_name[colon - str] = '\0';
+            *number = temp;
+        }
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+static int parse_options(int const argc,
+                         char const * const * const argv,
+                         global_params * const params)
+{
+    int result = 0;
+    int option = 0;
+
+    while (result == 0 &&
+           (option = getopt_long(argc,
+                                 (char * const *) argv,
+                                 "o:",
+                                 long_options,
+                                 NULL)) != -1)
+    {
+        switch(option)
+        {
+        case option_rate:
+            result = str_to_double(optarg,
+                                   &(params->ops_config.rate));
+
+            if (result != 0 ||
+                params->ops_config.rate <= 0.0)
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid rate!");
+            }
+            break;
+        case option_arrival:
+            result = mt_fs_tests_ops_config_parse_arrival(optarg,
+                                                          &(params->ops_config.arrival));
+
+            if (result != 0)
+            {
+                LOG_ERROR("Invalid arrival schedule!");
+            }
+            break;
+        case option_perf:
+            params->perf_counters = true;
+            break;
+        case option_trace:
+            result = resolve_path(optarg,
+                                  &(params->trace_path));
+            break;
+        case option_trace_events:
+        {
+            uint64_t temp = 0;
+            result = str_to_unsigned_int64(optarg,
+                                           &temp);
+
+            if (result == 0 &&
+                temp > 0)
+            {
+                params->ops_config.trace_events = temp;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid number of trace events!");
+            }
+            break;
+        }
+        case option_plugin:
+            result = mt_fs_tests_plugins_load(optarg);
+            break;
+        case option_seed:
+            result = str_to_unsigned_int64(optarg,
+                                           &(params->seed));
+
+            if (result == 0)
+            {
+                params->seed_set = true;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid seed!");
+            }
+            break;
+        case option_cold_cache:
+            result = mt_fs_tests_cold_cache_enable();
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error enabling cold-cache mode: %d",
+                          result);
+            }
+            break;
+        case option_stack_size:
+        {
+            uint64_t temp = 0;
+            result = mt_fs_tests_parse_size(optarg,
+                                            &temp);
+
+            if (result == 0 &&
+                temp > 0 &&
+                temp <= SIZE_MAX)
+            {
+                params->stack_size = (size_t) temp;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid stack size!");
+            }
+            break;
+        }
+        case option_progress:
+        {
+            uint64_t temp = 0;
+            result = str_to_unsigned_int64(optarg,
+                                           &temp);
+
+            if (result == 0 &&
+                temp > 0 &&
+                temp <= UINT64_MAX / 1000000)
+            {
+                params->progress_interval_ns = temp * 1000000;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid progress interval!");
+            }
+            break;
+        }
+        case option_results:
+            result = resolve_path(optarg,
+                                  &(params->results_path));
+            break;
+        case option_compare:
+            params->baseline_path = optarg;
+            break;
+        case option_regression_threshold:
+            result = str_to_double(optarg,
+                                   &(params->regression_threshold));
+
+            if (result != 0 ||
+                params->regression_threshold < 0.0)
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid regression threshold!");
+            }
+            break;
+        case option_directory:
+            params->directory = optarg;
+            break;
+        case option_coordinator:
+            result = parse_coordination(optarg,
+                                        params,
+                                        &(params->nb_clients));
+
+            if (result != 0 ||
+                params->nb_clients == 0)
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid coordinator, expected <name>:<nb clients>!");
+            }
+            break;
+        case option_client:
+            /* Any id is valid until checked against the coordinator. */
+            result = parse_coordination(optarg,
+                                        params,
+                                        &(params->client_id));
+
+            if (result == 0)
+            {
+                params->client_id_set = true;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid client, expected <name>:<id>!");
+            }
+            break;
+        case option_suite_option:
+            result = mt_fs_tests_options_add(optarg);
+            break;
+        case option_workers:
+            if (strcasecmp(optarg, "thread") == 0)
+            {
+                params->workers = workers_mode_thread;
+            }
+            else if (strcasecmp(optarg, "process") == 0)
+            {
+                params->workers = workers_mode_process;
+            }
+            else
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid workers mode!");
+            }
+            break;
+        default:
+            result = EINVAL;
+            break;
+        }
+    }
+
+    if (result == 0)
+    {
+        if (params->trace_path == NULL)
+        {
+            params->ops_config.trace_events = 0;
+        }
+        else if (params->ops_config.trace_events == 0)
+        {
+            params->ops_config.trace_events = DEFAULT_TRACE_EVENTS;
+        }
+
+        if (params->ops_config.rate > 0.0 &&
+            params->ops_config.arrival == mt_fs_tests_arrival_closed_loop)
+        {
+            params->ops_config.arrival = mt_fs_tests_arrival_constant;
+        }
+        else if (params->ops_config.rate <= 0.0 &&
+                 params->ops_config.arrival != mt_fs_tests_arrival_closed_loop)
+        {
+            result = EINVAL;
+            LOG_ERROR("An open-loop arrival schedule requires a rate!");
+        }
+    }
+
+    return result;
+}
+
+static int parse_threads_counts(char const * const str,
+                                global_params * const params)
+{
+    int result = 0;
+    char const * current = str;
+    assert(str != NULL);
+    assert(params != NULL);
+
+    params->nb_threads_counts = 0;
+
+    while (result == 0 &&
+           current != NULL)
+    {
+        char const * const comma = strchr(current, ',');
+        char value[32];
+        size_t const len = comma != NULL ? (size_t) (comma - current) : strlen(current);
+        uint64_t temp = 0;
+
+        if (len < sizeof value &&
+            params->nb_threads_counts < MAX_THREADS_COUNTS)
+        {
+            memcpy(value, current, len);
+            value[len] = '\0';
+
+            result = str_to_unsigned_int64(value,
+                                           &temp);
+
+            if (result == 0 &&
+                temp > 0)
+            {
+                params->threads_counts[params->nb_threads_counts] = temp;
+                params->nb_threads_counts++;
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+        else
+        {
+            result = EINVAL;
+        }
+
+        current = comma != NULL ? comma + 1 : NULL;
+    }
+
+    return result;
+}
+
 static int parse_params(int const argc,
                         char const * const * const argv,
                         global_params * const params)
 {
-    int result = 0;
+    int result = parse_options(argc,
+                               argv,
+                               params);
+    int const nb_params = argc - optind;
+    char const * const * const params_values = argv + optind;
 
-    if (argc >= 2 &&
-        argc <= 4)
+    if (result != 0)
+    {
+        print_usage(argv[0]);
+    }
+    else if (params->client_id_set == true &&
+             nb_params != 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("A client takes its threads, runs and suite from the coordinator!");
+    }
+    else if (nb_params >= 1 &&
+             nb_params <= 3)
     {
         /* nb threads */
         uint64_t temp = 0;
 
-        result = str_to_unsigned_int64(argv[1],
-                                       &temp);
+        result = parse_threads_counts(params_values[0],
+                                      params);
 
         if (result == 0)
         {
-            params->nb_threads = temp;
-
-            if (argc >= 3)
+            if (nb_params >= 2)
             {
                 /* nb runs */
 
-                result = str_to_unsigned_int64(argv[2],
+                result = str_to_unsigned_int64(params_values[1],
                                                &temp);
 
                 if (result == 0)
                 {
                     params->nb_runs = temp;
 
-                    if (argc == 4)
+                    if (nb_params == 3)
                     {
                         /* suite name */
-                        if (strcasecmp(argv[3], "all") != 0)
+                        if (strcasecmp(params_values[2], "all") != 0)
                         {
-                            result = ENOENT;
-
-                            for (size_t suite_idx = 0;
-                                 result == ENOENT &&
-                                     suite_idx < test_suites_count;
-                                 suite_idx++)
-                            {
-                                assert(test_suites[suite_idx]->name != NULL);
-
-                                if (strcasecmp(argv[3],
-                                               test_suites[suite_idx]->name) == 0)
-                                {
-                                    params->selected_suite = test_suites[suite_idx];
-                                    result = 0;
-                                }
-                            }
+                            params->selected_suite = test_suites_find(params_values[2]);
 
-                            if (result != 0)
+                            if (params->selected_suite == NULL)
                             {
+                                result = ENOENT;
                                 LOG_ERROR("Suite not found!");
                             }
                         }
@@ -329,11 +1317,99 @@ static int parse_params(int const argc,
             LOG_ERROR("Invalid number of threads!");
         }
     }
-    else if (argc != 1)
+    else if (nb_params != 0)
     {
         result = EINVAL;
-        LOG_ERROR("Usage: %s [<nb threads> [<nb runs> [<selected suite>]]]",
-                  argv[0]);
+        print_usage(argv[0]);
+    }
+
+    return result;
+}
+
+/* The configuration of a client is the one of its coordinator. */
+static int attach_client(global_params * const params)
+{
+    int result = 0;
+    char directory[PATH_MAX];
+    assert(params != NULL);
+
+    if (getcwd(directory, sizeof directory) == NULL)
+    {
+        snprintf(directory, sizeof directory, "%s", ".");
+    }
+
+    result = mt_fs_tests_coordinator_attach(&(params->client),
+                                            params->coordination_name,
+                                            params->client_id,
+                                            directory);
+
+    if (result == 0)
+    {
+        mt_fs_tests_coordinator_config const * const config = mt_fs_tests_coordinator_get_config(params->client);
+        assert(config->nb_threads_counts > 0);
+        assert(config->nb_threads_counts <= MAX_THREADS_COUNTS);
+
+        memcpy(params->threads_counts,
+               config->threads_counts,
+               sizeof params->threads_counts);
+        params->nb_threads_counts = config->nb_threads_counts;
+        params->nb_threads = params->threads_counts[0];
+        params->nb_runs = config->nb_runs;
+        params->seed = config->seed;
+        params->seed_set = true;
+
+        if (config->suite_name[0] != '\0')
+        {
+            params->selected_suite = test_suites_find(config->suite_name);
+
+            if (params->selected_suite == NULL)
+            {
+                result = ENOENT;
+                LOG_ERROR("Suite %s of the coordinator not found, are the same plugins loaded?",
+                          config->suite_name);
+            }
+        }
+    }
+
+    return result;
+}
+
+static int create_coordinator(global_params * const params)
+{
+    int result = 0;
+    mt_fs_tests_coordinator_config config;
+    assert(params != NULL);
+
+    memset(&config, 0, sizeof config);
+    memcpy(config.threads_counts,
+           params->threads_counts,
+           sizeof config.threads_counts);
+    config.nb_threads_counts = params->nb_threads_counts;
+    config.nb_runs = params->nb_runs;
+    config.seed = params->seed;
+
+    if (params->selected_suite != NULL)
+    {
+        if (strlen(params->selected_suite->name) < sizeof config.suite_name)
+        {
+            memcpy(config.suite_name,
+                   params->selected_suite->name,
+                   strlen(params->selected_suite->name) + 1);
+        }
+        else
+        {
+            result = ENAMETOOLONG;
+            LOG_ERROR("Suite name %s is too long to be sent to clients",
+                      params->selected_suite->name);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_coordinator_create(&(params->coordinator),
+                                                params->coordination_name,
+                                                params->nb_clients,
+                                                &config);
     }
 
     return result;
@@ -344,47 +1420,237 @@ int main(int const argc,
 {
     global_params params =
         {
+            .threads_counts = { DEFAULT_THREADS_COUNT },
+            .nb_threads_counts = 1,
             .nb_runs = 1,
-            .nb_threads = DEFAULT_THREADS_COUNT
+            .nb_threads = DEFAULT_THREADS_COUNT,
+            .stack_size = MT_FS_TESTS_STACKS_DEFAULT_SIZE,
+            .regression_threshold = DEFAULT_REGRESSION_THRESHOLD
         };
+    size_t nb_regressions = 0;
     int result = parse_params(argc,
                               argv,
                               &params);
 
+    /* Loaded first, so that an invalid baseline does not waste a run. */
+    if (result == 0 &&
+        params.baseline_path != NULL)
+    {
+        result = mt_fs_tests_results_load(&(params.baseline),
+                                          params.baseline_path);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error loading baseline %s: %d",
+                      params.baseline_path,
+                      result);
+        }
+    }
+
+    if (result == 0 &&
+        (params.results_path != NULL || params.baseline_path != NULL))
+    {
+        result = mt_fs_tests_results_init(&(params.results));
+    }
+
+    if (result == 0 &&
+        params.directory != NULL &&
+        chdir(params.directory) != 0)
+    {
+        result = errno;
+        LOG_ERROR("Error changing to directory %s: %d",
+                  params.directory,
+                  result);
+    }
+
+    if (result == 0 &&
+        params.client_id_set == true)
+    {
+        result = attach_client(&params);
+    }
+
     if (result == 0)
     {
-        LOG_OK("Launching %s with %zu runs of %zu threads",
-               params.selected_suite != NULL ? params.selected_suite->name : "all suites",
-               params.nb_runs,
-               params.nb_threads);
+        mt_fs_tests_options_log();
 
-        for (size_t run_idx = 0;
-             result == 0 &&
-                 run_idx < params.nb_runs;
-             run_idx++)
+        if (params.seed_set == false)
+        {
+            /* Kept below 2^63 to be accepted back by --seed. */
+            params.seed = (mt_fs_tests_now_ns() ^ ((uint64_t) getpid() << 32)) & (uint64_t) INT64_MAX;
+        }
+
+        mt_fs_tests_prng_set_seed(params.seed);
+        LOG_OK("Random seed %llu, use --seed=%llu to replay this run",
+               (unsigned long long) params.seed,
+               (unsigned long long) params.seed);
+
+        if (params.nb_clients > 0)
+        {
+            result = create_coordinator(&params);
+        }
+
+        if (params.ops_config.arrival != mt_fs_tests_arrival_closed_loop)
+        {
+            LOG_OK("Open-loop mode, %s arrivals at %.1f ops/s",
+                   mt_fs_tests_ops_arrival_name(params.ops_config.arrival),
+                   params.ops_config.rate);
+        }
+
+        if (params.perf_counters == true)
+        {
+            mt_fs_tests_perf_init();
+        }
+
+        if (params.workers == workers_mode_thread &&
+            params.coordinator == NULL)
         {
-            if (params.selected_suite != NULL)
+            size_t max_threads = 0;
+
+            for (size_t idx = 0;
+                 idx < params.nb_threads_counts;
+                 idx++)
             {
-                result = run_suite(&params,
-                                   params.selected_suite);
+                if (params.threads_counts[idx] > max_threads)
+                {
+                    max_threads = params.threads_counts[idx];
+                }
             }
-            else
+
+            mt_fs_tests_stacks_check_limits(max_threads);
+        }
+
+        if (result == 0 &&
+            params.trace_path != NULL)
+        {
+            result = mt_fs_tests_trace_open(params.trace_path,
+                                            &(params.trace_fp));
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error opening trace file %s: %d",
+                          params.trace_path,
+                          result);
+            }
+        }
+
+        for (size_t count_idx = 0;
+             result == 0 &&
+                 count_idx < params.nb_threads_counts;
+             count_idx++)
+        {
+            params.nb_threads = params.threads_counts[count_idx];
+
+            LOG_OK("Launching %s with %zu runs of %zu %s",
+                   params.selected_suite != NULL ? params.selected_suite->name : "all suites",
+                   params.nb_runs,
+                   params.nb_threads,
+                   params.workers == workers_mode_process ? "processes" : "threads");
+
+            for (size_t run_idx = 0;
+                 result == 0 &&
+                     run_idx < params.nb_runs;
+                 run_idx++)
             {
-                for (size_t suite_idx = 0;
-                     result == 0 &&
-                         suite_idx < test_suites_count;
-                     suite_idx++)
+                if (params.selected_suite != NULL)
                 {
-                    result = run_suite(&params,
-                                       test_suites[suite_idx]);
+                    result = run_step(&params,
+                                      params.selected_suite,
+                                      run_idx);
+                }
+                else
+                {
+                    for (size_t suite_idx = 0;
+                         result == 0 &&
+                             suite_idx < test_suites_get_count();
+                         suite_idx++)
+                    {
+                        result = run_step(&params,
+                                          test_suites_get(suite_idx),
+                                          run_idx);
+                    }
                 }
             }
         }
+
+        if (params.trace_fp != NULL)
+        {
+            if (fclose(params.trace_fp) != 0 &&
+                result == 0)
+            {
+                result = errno;
+                LOG_ERROR("Error closing trace file %s: %d",
+                          params.trace_path,
+                          result);
+            }
+
+            params.trace_fp = NULL;
+        }
+
+        if (result == 0 &&
+            params.results_path != NULL)
+        {
+            result = mt_fs_tests_results_write(params.results,
+                                               params.results_path);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error writing results to %s: %d",
+                          params.results_path,
+                          result);
+            }
+        }
+
+        if (result == 0 &&
+            params.baseline != NULL)
+        {
+            LOG_OK("Comparing with baseline %s, regression threshold %.1f%%",
+                   params.baseline_path,
+                   params.regression_threshold);
+
+            result = mt_fs_tests_results_compare(params.results,
+                                                 params.baseline,
+                                                 params.regression_threshold,
+                                                 &nb_regressions);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error comparing with baseline %s: %d",
+                          params.baseline_path,
+                          result);
+            }
+            else if (nb_regressions > 0)
+            {
+                LOG_ERROR("%zu regressions against baseline %s",
+                          nb_regressions,
+                          params.baseline_path);
+            }
+            else
+            {
+                LOG_OK("No regression against baseline %s",
+                       params.baseline_path);
+            }
+        }
     }
 
+    mt_fs_tests_coordinator_free(params.coordinator), params.coordinator = NULL;
+    mt_fs_tests_coordinator_free(params.client), params.client = NULL;
+    mt_fs_tests_results_free(params.results), params.results = NULL;
+    mt_fs_tests_results_free(params.baseline), params.baseline = NULL;
+    free(params.trace_path), params.trace_path = NULL;
+    free(params.results_path), params.results_path = NULL;
+    mt_fs_tests_plugins_unload();
+    mt_fs_tests_options_free();
+    mt_fs_tests_cold_cache_free();
+
     fclose(stdin);
     fclose(stdout);
     fclose(stderr);
 
+    if (result == 0 &&
+        nb_regressions > 0)
+    {
+        result = REGRESSION_EXIT_STATUS;
+    }
+
     return result;
 }
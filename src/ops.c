@@ -0,0 +1,869 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <time.h>
+
+#include "histogram.h"
+#include "ops.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "trace.h"
+#include "utils.h"
+
+#define MT_FS_TESTS_CACHE_LINE_SIZE (64)
+/* Distinct operation names accounted separately per thread, operations with
+   other names only count in the totals. */
+#define MT_FS_TESTS_OPS_MAX_NAMES (32)
+
+typedef struct
+{
+    char const * name;
+    mt_fs_tests_histogram latency;
+    uint64_t ops_count;
+    uint64_t errors_count;
+} mt_fs_tests_op_stats;
+
+typedef struct
+{
+    mt_fs_tests_histogram latency;
+    /* Results given to mt_fs_tests_op_end(). */
+    mt_fs_tests_outcomes outcomes;
+    /* MT_FS_TESTS_OPS_MAX_NAMES slots, the histograms of unused ones are
+       never touched so that their pages are not even allocated. */
+    mt_fs_tests_op_stats * names;
+    size_t nb_names;
+    mt_fs_tests_trace_buffer trace;
+    mt_fs_tests_ops_run * run;
+    uint64_t next_intended_ns;
+    uint64_t first_start_ns;
+    uint64_t last_end_ns;
+    /* Counters and latency histogram are also read, without
+       synchronization, by the progress reporter while the run goes on. */
+    uint64_t ops_count;
+    uint64_t errors_count;
+    uint64_t bytes;
+    size_t id;
+    /* Arrival schedule of this thread, the one of the run unless overridden
+       by the suite. */
+    double interval_ns;
+    mt_fs_tests_arrival arrival;
+    mt_fs_tests_prng prng;
+} __attribute__((aligned(MT_FS_TESTS_CACHE_LINE_SIZE))) mt_fs_tests_thread_ops;
+
+struct mt_fs_tests_ops_run
+{
+    mt_fs_tests_ops_config config;
+    mt_fs_tests_thread_ops * threads;
+    mt_fs_tests_op_stats * names;
+    size_t nb_threads;
+    /* Time of the first scheduled arrival, shared by all threads in
+       open-loop mode. Set by the first thread issuing an operation. */
+    uint64_t schedule_start_ns;
+    /* Mean interval between two arrivals of a given thread. */
+    double thread_interval_ns;
+};
+
+static __thread mt_fs_tests_thread_ops * mt_fs_tests_current_thread_ops = NULL;
+
+static char const * const mt_fs_tests_arrival_names[] =
+{
+    "closed-loop",
+    "constant",
+    "poisson",
+};
+
+int mt_fs_tests_ops_config_parse_arrival(char const * const str,
+                                         mt_fs_tests_arrival * const arrival)
+{
+    int result = ENOENT;
+    assert(str != NULL);
+    assert(arrival != NULL);
+
+    for (size_t idx = 0;
+         result == ENOENT &&
+             idx < mt_fs_tests_arrival_count;
+         idx++)
+    {
+        if (strcasecmp(str, mt_fs_tests_arrival_names[idx]) == 0)
+        {
+            *arrival = (mt_fs_tests_arrival) idx;
+            result = 0;
+        }
+    }
+
+    return result;
+}
+
+char const * mt_fs_tests_ops_arrival_name(mt_fs_tests_arrival const arrival)
+{
+    assert(arrival < mt_fs_tests_arrival_count);
+    return mt_fs_tests_arrival_names[arrival];
+}
+
+int mt_fs_tests_ops_run_init(mt_fs_tests_ops_run ** const run,
+                             mt_fs_tests_ops_config const * const config,
+                             size_t const nb_threads)
+{
+    int result = 0;
+    assert(run != NULL);
+    assert(config != NULL);
+    assert(nb_threads > 0);
+    /* Workers may be forked processes, everything they update has to be
+       shared. */
+    mt_fs_tests_ops_run * ops_run = mt_fs_tests_shared_calloc(1,
+                                                              sizeof *ops_run);
+
+    if (ops_run != NULL)
+    {
+        ops_run->config = *config;
+        ops_run->nb_threads = nb_threads;
+        ops_run->schedule_start_ns = 0;
+        ops_run->thread_interval_ns = 0.0;
+
+        if (config->arrival != mt_fs_tests_arrival_closed_loop)
+        {
+            assert(config->rate > 0.0);
+            ops_run->thread_interval_ns = (double) MT_FS_TESTS_NS_PER_SEC * (double) nb_threads / config->rate;
+        }
+
+        ops_run->threads = mt_fs_tests_shared_calloc(nb_threads,
+                                                     sizeof *(ops_run->threads));
+        ops_run->names = mt_fs_tests_shared_calloc(nb_threads * MT_FS_TESTS_OPS_MAX_NAMES,
+                                                   sizeof *(ops_run->names));
+
+        if (ops_run->threads != NULL &&
+            ops_run->names != NULL)
+        {
+            for (size_t idx = 0;
+                 idx < nb_threads;
+                 idx++)
+            {
+                mt_fs_tests_thread_ops * th = &(ops_run->threads[idx]);
+                mt_fs_tests_histogram_reset(&(th->latency));
+                mt_fs_tests_trace_buffer_init(&(th->trace),
+                                              0);
+                th->names = &(ops_run->names[idx * MT_FS_TESTS_OPS_MAX_NAMES]);
+                th->nb_names = 0;
+                th->run = ops_run;
+                th->next_intended_ns = 0;
+                th->first_start_ns = 0;
+                th->last_end_ns = 0;
+                th->ops_count = 0;
+                th->errors_count = 0;
+                th->bytes = 0;
+                th->id = idx;
+                th->interval_ns = ops_run->thread_interval_ns;
+                th->arrival = config->arrival;
+                mt_fs_tests_prng_stream_init(&(th->prng),
+                                             MT_FS_TESTS_PRNG_STREAM_ARRIVALS,
+                                             idx);
+            }
+
+            for (size_t idx = 0;
+                 result == 0 &&
+                     idx < nb_threads;
+                 idx++)
+            {
+                result = mt_fs_tests_trace_buffer_init(&(ops_run->threads[idx].trace),
+                                                       config->trace_events);
+            }
+
+            if (result == 0)
+            {
+                *run = ops_run;
+            }
+            else
+            {
+                mt_fs_tests_ops_run_free(ops_run), ops_run = NULL;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+            mt_fs_tests_ops_run_free(ops_run), ops_run = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_ops_thread_attach(mt_fs_tests_ops_run * const run,
+                                   size_t const id)
+{
+    assert(run != NULL);
+    assert(id < run->nb_threads);
+
+    mt_fs_tests_current_thread_ops = &(run->threads[id]);
+}
+
+void mt_fs_tests_ops_thread_detach(void)
+{
+    mt_fs_tests_current_thread_ops = NULL;
+}
+
+static uint64_t mt_fs_tests_ops_next_interval(mt_fs_tests_thread_ops * const th)
+{
+    double interval = th->interval_ns;
+
+    if (th->arrival == mt_fs_tests_arrival_poisson)
+    {
+        /* The generator returns a value in [0, 1), hence 1 - u is never 0. */
+        interval = -log(1.0 - mt_fs_tests_prng_double(&(th->prng))) * interval;
+    }
+
+    return (uint64_t) interval;
+}
+
+static uint64_t mt_fs_tests_ops_schedule_start(mt_fs_tests_ops_run * const run,
+                                               uint64_t const now)
+{
+    uint64_t expected = 0;
+
+    if (__atomic_compare_exchange_n(&(run->schedule_start_ns),
+                                    &expected,
+                                    now,
+                                    false,
+                                    __ATOMIC_ACQ_REL,
+                                    __ATOMIC_ACQUIRE))
+    {
+        expected = now;
+    }
+
+    return expected;
+}
+
+static void mt_fs_tests_ops_sleep_until(uint64_t const deadline_ns)
+{
+    struct timespec const deadline =
+        {
+            .tv_sec = (time_t) (deadline_ns / MT_FS_TESTS_NS_PER_SEC),
+            .tv_nsec = (long) (deadline_ns % MT_FS_TESTS_NS_PER_SEC)
+        };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC,
+                           TIMER_ABSTIME,
+                           &deadline,
+                           NULL) == EINTR)
+    {
+    }
+}
+
+void mt_fs_tests_op_set_thread_rate(double const rate)
+{
+    mt_fs_tests_thread_ops * const th = mt_fs_tests_current_thread_ops;
+    assert(rate > 0.0);
+
+    if (th != NULL)
+    {
+        assert(th->next_intended_ns == 0);
+        th->interval_ns = (double) MT_FS_TESTS_NS_PER_SEC / rate;
+
+        if (th->arrival == mt_fs_tests_arrival_closed_loop)
+        {
+            th->arrival = mt_fs_tests_arrival_constant;
+        }
+    }
+}
+
+void mt_fs_tests_op_add_bytes(uint64_t const bytes)
+{
+    mt_fs_tests_thread_ops * const th = mt_fs_tests_current_thread_ops;
+
+    if (th != NULL)
+    {
+        th->bytes += bytes;
+    }
+}
+
+void mt_fs_tests_phase_begin(mt_fs_tests_phase * const phase)
+{
+    assert(phase != NULL);
+    phase->start_ns = mt_fs_tests_now_ns();
+}
+
+void mt_fs_tests_phase_end(mt_fs_tests_phase * const phase)
+{
+    assert(phase != NULL);
+    phase->end_ns = mt_fs_tests_now_ns();
+}
+
+void mt_fs_tests_phase_reset(mt_fs_tests_phase * const total)
+{
+    assert(total != NULL);
+    total->start_ns = UINT64_MAX;
+    total->end_ns = 0;
+    total->count = 0;
+    total->bytes = 0;
+}
+
+void mt_fs_tests_phase_merge(mt_fs_tests_phase * const total,
+                             mt_fs_tests_phase const * const thread)
+{
+    assert(total != NULL);
+    assert(thread != NULL);
+
+    if (thread->start_ns != 0)
+    {
+        total->start_ns = thread->start_ns < total->start_ns ? thread->start_ns : total->start_ns;
+        total->end_ns = thread->end_ns > total->end_ns ? thread->end_ns : total->end_ns;
+        total->count += thread->count;
+        total->bytes += thread->bytes;
+    }
+}
+
+double mt_fs_tests_phase_elapsed(mt_fs_tests_phase const * const phase)
+{
+    double result = 0.0;
+    assert(phase != NULL);
+
+    if (phase->end_ns > phase->start_ns)
+    {
+        result = (double) (phase->end_ns - phase->start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_op_begin(mt_fs_tests_op * const op,
+                          char const * const name)
+{
+    mt_fs_tests_thread_ops * const th = mt_fs_tests_current_thread_ops;
+    assert(op != NULL);
+    assert(name != NULL);
+
+    op->name = name;
+
+    if (th != NULL)
+    {
+        uint64_t now = mt_fs_tests_now_ns();
+
+        if (th->arrival != mt_fs_tests_arrival_closed_loop)
+        {
+            if (th->next_intended_ns == 0)
+            {
+                uint64_t const start = mt_fs_tests_ops_schedule_start(th->run,
+                                                                      now);
+
+                if (th->arrival == mt_fs_tests_arrival_constant)
+                {
+                    /* Interleave threads so that arrivals are evenly spread
+                       over time for the whole run. */
+                    th->next_intended_ns = start + (uint64_t) (th->interval_ns * (double) th->id / (double) th->run->nb_threads);
+                }
+                else
+                {
+                    th->next_intended_ns = start + mt_fs_tests_ops_next_interval(th);
+                }
+
+                th->first_start_ns = start;
+            }
+
+            op->intended_ns = th->next_intended_ns;
+            th->next_intended_ns += mt_fs_tests_ops_next_interval(th);
+
+            if (op->intended_ns > now)
+            {
+                mt_fs_tests_ops_sleep_until(op->intended_ns);
+                now = mt_fs_tests_now_ns();
+            }
+        }
+        else
+        {
+            op->intended_ns = now;
+
+            if (th->first_start_ns == 0)
+            {
+                th->first_start_ns = now;
+            }
+        }
+
+        op->start_ns = now;
+
+        if (th->trace.capacity > 0)
+        {
+            mt_fs_tests_trace_record(&(th->trace),
+                                     now,
+                                     name,
+                                     mt_fs_tests_trace_phase_begin,
+                                     0);
+        }
+    }
+    else
+    {
+        op->intended_ns = 0;
+        op->start_ns = 0;
+    }
+}
+
+static mt_fs_tests_op_stats * mt_fs_tests_ops_name_stats(mt_fs_tests_thread_ops * const th,
+                                                          char const * const name)
+{
+    mt_fs_tests_op_stats * result = NULL;
+
+    for (size_t idx = 0;
+         result == NULL &&
+             idx < th->nb_names;
+         idx++)
+    {
+        if (th->names[idx].name == name ||
+            strcmp(th->names[idx].name, name) == 0)
+        {
+            result = &(th->names[idx]);
+        }
+    }
+
+    if (result == NULL &&
+        th->nb_names < MT_FS_TESTS_OPS_MAX_NAMES)
+    {
+        result = &(th->names[th->nb_names]);
+        result->name = name;
+        mt_fs_tests_histogram_reset(&(result->latency));
+        th->nb_names++;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_op_end(mt_fs_tests_op * const op,
+                        int const result)
+{
+    mt_fs_tests_thread_ops * const th = mt_fs_tests_current_thread_ops;
+    assert(op != NULL);
+
+    if (th != NULL)
+    {
+        uint64_t const now = mt_fs_tests_now_ns();
+        mt_fs_tests_op_stats * const stats = mt_fs_tests_ops_name_stats(th,
+                                                                        op->name);
+
+        mt_fs_tests_histogram_record(&(th->latency),
+                                     now - op->intended_ns);
+        mt_fs_tests_outcomes_add(&(th->outcomes),
+                                 result);
+        th->ops_count++;
+        th->last_end_ns = now;
+
+        if (result != 0)
+        {
+            th->errors_count++;
+        }
+
+        if (stats != NULL)
+        {
+            mt_fs_tests_histogram_record(&(stats->latency),
+                                         now - op->intended_ns);
+            stats->ops_count++;
+
+            if (result != 0)
+            {
+                stats->errors_count++;
+            }
+        }
+
+        if (th->trace.capacity > 0)
+        {
+            mt_fs_tests_trace_record(&(th->trace),
+                                     now,
+                                     op->name,
+                                     mt_fs_tests_trace_phase_end,
+                                     result);
+        }
+    }
+}
+
+/* Per operation name breakdown, only worth printing when the suite issues
+   more than one kind of operation. */
+static void mt_fs_tests_ops_run_report_names(mt_fs_tests_ops_run const * const run,
+                                             char const * const suite_name,
+                                             double const duration)
+{
+    mt_fs_tests_op_stats * names = NULL;
+    size_t nb_names = 0;
+
+    names = malloc(sizeof *names * MT_FS_TESTS_OPS_MAX_NAMES);
+
+    if (names != NULL)
+    {
+        for (size_t idx = 0;
+             idx < run->nb_threads;
+             idx++)
+        {
+            mt_fs_tests_thread_ops const * const th = &(run->threads[idx]);
+
+            for (size_t name_idx = 0;
+                 name_idx < th->nb_names;
+                 name_idx++)
+            {
+                mt_fs_tests_op_stats const * const source = &(th->names[name_idx]);
+                mt_fs_tests_op_stats * destination = NULL;
+
+                for (size_t merged_idx = 0;
+                     destination == NULL &&
+                         merged_idx < nb_names;
+                     merged_idx++)
+                {
+                    if (strcmp(names[merged_idx].name, source->name) == 0)
+                    {
+                        destination = &(names[merged_idx]);
+                    }
+                }
+
+                if (destination == NULL &&
+                    nb_names < MT_FS_TESTS_OPS_MAX_NAMES)
+                {
+                    destination = &(names[nb_names]);
+                    destination->name = source->name;
+                    destination->ops_count = 0;
+                    destination->errors_count = 0;
+                    mt_fs_tests_histogram_reset(&(destination->latency));
+                    nb_names++;
+                }
+
+                if (destination != NULL)
+                {
+                    mt_fs_tests_histogram_merge(&(destination->latency),
+                                                &(source->latency));
+                    destination->ops_count += source->ops_count;
+                    destination->errors_count += source->errors_count;
+                }
+            }
+        }
+
+        for (size_t idx = 0;
+             nb_names > 1 &&
+                 idx < nb_names;
+             idx++)
+        {
+            mt_fs_tests_op_stats const * const stats = &(names[idx]);
+            uint64_t const p50 = mt_fs_tests_histogram_percentile(&(stats->latency), 50.0);
+            uint64_t const p99 = mt_fs_tests_histogram_percentile(&(stats->latency), 99.0);
+
+            LOG_OK("%s: %s: %" PRIu64 " ops (%" PRIu64 " failed), %.1f ops/s, latency (us) p50 %.1f p99 %.1f max %.1f",
+                   suite_name,
+                   stats->name,
+                   stats->ops_count,
+                   stats->errors_count,
+                   duration > 0.0 ? (double) stats->ops_count / duration : 0.0,
+                   (double) p50 / 1000.0,
+                   (double) p99 / 1000.0,
+                   (double) stats->latency.max / 1000.0);
+        }
+
+        free(names), names = NULL;
+    }
+    else
+    {
+        LOG_ERROR("Error allocating memory for the per operation report");
+    }
+}
+
+void mt_fs_tests_ops_run_summarize(mt_fs_tests_ops_run const * const run,
+                                   mt_fs_tests_ops_summary * const summary)
+{
+    assert(run != NULL);
+    assert(summary != NULL);
+
+    mt_fs_tests_histogram_reset(&(summary->latency));
+    mt_fs_tests_outcomes_reset(&(summary->outcomes));
+    summary->ops_count = 0;
+    summary->errors_count = 0;
+    summary->start_ns = UINT64_MAX;
+    summary->end_ns = 0;
+
+    for (size_t idx = 0;
+         idx < run->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_thread_ops const * const th = &(run->threads[idx]);
+
+        if (th->ops_count > 0)
+        {
+            mt_fs_tests_histogram_merge(&(summary->latency),
+                                        &(th->latency));
+            mt_fs_tests_outcomes_merge(&(summary->outcomes),
+                                       &(th->outcomes));
+            summary->ops_count += th->ops_count;
+            summary->errors_count += th->errors_count;
+
+            if (th->first_start_ns < summary->start_ns)
+            {
+                summary->start_ns = th->first_start_ns;
+            }
+
+            if (th->last_end_ns > summary->end_ns)
+            {
+                summary->end_ns = th->last_end_ns;
+            }
+        }
+    }
+}
+
+void mt_fs_tests_ops_summary_merge(mt_fs_tests_ops_summary * const destination,
+                                   mt_fs_tests_ops_summary const * const source)
+{
+    assert(destination != NULL);
+    assert(source != NULL);
+
+    if (source->ops_count > 0)
+    {
+        mt_fs_tests_histogram_merge(&(destination->latency),
+                                    &(source->latency));
+        mt_fs_tests_outcomes_merge(&(destination->outcomes),
+                                   &(source->outcomes));
+        destination->ops_count += source->ops_count;
+        destination->errors_count += source->errors_count;
+
+        if (source->start_ns < destination->start_ns)
+        {
+            destination->start_ns = source->start_ns;
+        }
+
+        if (source->end_ns > destination->end_ns)
+        {
+            destination->end_ns = source->end_ns;
+        }
+    }
+}
+
+void mt_fs_tests_ops_report_outcomes(mt_fs_tests_outcomes const * const outcomes,
+                                     char const * const suite_name)
+{
+    char formatted[MT_FS_TESTS_OUTCOMES_FORMAT_SIZE];
+    assert(outcomes != NULL);
+    assert(suite_name != NULL);
+
+    mt_fs_tests_outcomes_format(outcomes,
+                                formatted,
+                                sizeof formatted);
+
+    LOG_OK("%s: outcomes %s",
+           suite_name,
+           formatted);
+}
+
+void mt_fs_tests_ops_run_report(mt_fs_tests_ops_run const * const run,
+                                char const * const suite_name)
+{
+    mt_fs_tests_ops_summary summary;
+    /* Threads may have their own rate, see mt_fs_tests_op_set_thread_rate(). */
+    double requested_rate = 0.0;
+    size_t paced_threads = 0;
+    mt_fs_tests_arrival arrival = run->config.arrival;
+    assert(run != NULL);
+    assert(suite_name != NULL);
+
+    mt_fs_tests_ops_run_summarize(run,
+                                  &summary);
+
+    for (size_t idx = 0;
+         idx < run->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_thread_ops const * const th = &(run->threads[idx]);
+
+        if (th->arrival != mt_fs_tests_arrival_closed_loop)
+        {
+            requested_rate += (double) MT_FS_TESTS_NS_PER_SEC / th->interval_ns;
+            arrival = th->arrival;
+            paced_threads++;
+        }
+    }
+
+    if (summary.ops_count > 0)
+    {
+        mt_fs_tests_histogram const * const latency = &(summary.latency);
+        uint64_t const ops_count = summary.ops_count;
+        uint64_t const errors_count = summary.errors_count;
+        double const duration = (double) (summary.end_ns - summary.start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+        double const achieved = duration > 0.0 ? (double) ops_count / duration : 0.0;
+
+        if (paced_threads > 0 &&
+            paced_threads == run->nb_threads)
+        {
+            LOG_OK("%s: %zu threads, %" PRIu64 " ops (%" PRIu64 " failed) in %.3f s, %.1f ops/s achieved for %.1f ops/s requested (%s)",
+                   suite_name,
+                   run->nb_threads,
+                   ops_count,
+                   errors_count,
+                   duration,
+                   achieved,
+                   requested_rate,
+                   mt_fs_tests_ops_arrival_name(arrival));
+        }
+        else
+        {
+            LOG_OK("%s: %zu threads, %" PRIu64 " ops (%" PRIu64 " failed) in %.3f s, %.1f ops/s",
+                   suite_name,
+                   run->nb_threads,
+                   ops_count,
+                   errors_count,
+                   duration,
+                   achieved);
+
+            if (paced_threads > 0)
+            {
+                LOG_OK("%s: %zu of these threads requested %.1f ops/s (%s)",
+                       suite_name,
+                       paced_threads,
+                       requested_rate,
+                       mt_fs_tests_ops_arrival_name(arrival));
+            }
+        }
+
+        uint64_t const p50 = mt_fs_tests_histogram_percentile(latency, 50.0);
+        uint64_t const p90 = mt_fs_tests_histogram_percentile(latency, 90.0);
+        uint64_t const p99 = mt_fs_tests_histogram_percentile(latency, 99.0);
+        uint64_t const p999 = mt_fs_tests_histogram_percentile(latency, 99.9);
+
+        LOG_OK("%s: latency (us) min %.1f p50 %.1f p90 %.1f p99 %.1f p99.9 %.1f max %.1f",
+               suite_name,
+               (double) latency->min / 1000.0,
+               (double) p50 / 1000.0,
+               (double) p90 / 1000.0,
+               (double) p99 / 1000.0,
+               (double) p999 / 1000.0,
+               (double) latency->max / 1000.0);
+
+        mt_fs_tests_ops_report_outcomes(&(summary.outcomes),
+                                        suite_name);
+
+        mt_fs_tests_ops_run_report_names(run,
+                                         suite_name,
+                                         duration);
+    }
+}
+
+void mt_fs_tests_ops_run_sample(mt_fs_tests_ops_run const * const run,
+                                mt_fs_tests_ops_sample * const sample)
+{
+    assert(run != NULL);
+    assert(sample != NULL);
+
+    mt_fs_tests_histogram_reset(&(sample->latency));
+    sample->ops_count = 0;
+    sample->errors_count = 0;
+    sample->bytes = 0;
+
+    for (size_t idx = 0;
+         idx < run->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_thread_ops const * const th = &(run->threads[idx]);
+        mt_fs_tests_histogram const * const latency = &(th->latency);
+        uint64_t const min = __atomic_load_n(&(latency->min), __ATOMIC_RELAXED);
+        uint64_t const max = __atomic_load_n(&(latency->max), __ATOMIC_RELAXED);
+
+        sample->ops_count += __atomic_load_n(&(th->ops_count), __ATOMIC_RELAXED);
+        sample->errors_count += __atomic_load_n(&(th->errors_count), __ATOMIC_RELAXED);
+        sample->bytes += __atomic_load_n(&(th->bytes), __ATOMIC_RELAXED);
+
+        /* The count of the histogram may be ahead of its buckets, it is
+           recomputed from the latter. */
+        for (size_t bucket = 0;
+             bucket < MT_FS_TESTS_HISTOGRAM_BUCKETS;
+             bucket++)
+        {
+            uint64_t const count = __atomic_load_n(&(latency->buckets[bucket]), __ATOMIC_RELAXED);
+
+            sample->latency.buckets[bucket] += count;
+            sample->latency.count += count;
+        }
+
+        if (min < sample->latency.min)
+        {
+            sample->latency.min = min;
+        }
+
+        if (max > sample->latency.max)
+        {
+            sample->latency.max = max;
+        }
+    }
+}
+
+size_t mt_fs_tests_ops_run_thread_footprint(mt_fs_tests_ops_run const * const run)
+{
+    size_t total = 0;
+    assert(run != NULL);
+
+    for (size_t idx = 0;
+         idx < run->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_thread_ops const * const th = &(run->threads[idx]);
+
+        total += sizeof *th +
+            th->trace.capacity * sizeof *(th->trace.events) +
+            th->nb_names * sizeof *(th->names);
+    }
+
+    return total / run->nb_threads;
+}
+
+int mt_fs_tests_ops_run_write_trace(mt_fs_tests_ops_run const * const run,
+                                    FILE * const fp,
+                                    char const * const suite_name,
+                                    size_t const run_idx)
+{
+    int result = 0;
+    mt_fs_tests_trace_buffer const ** buffers = NULL;
+    assert(run != NULL);
+    assert(fp != NULL);
+    assert(suite_name != NULL);
+
+    buffers = malloc(sizeof *buffers * run->nb_threads);
+
+    if (buffers != NULL)
+    {
+        for (size_t idx = 0;
+             idx < run->nb_threads;
+             idx++)
+        {
+            buffers[idx] = &(run->threads[idx].trace);
+        }
+
+        result = mt_fs_tests_trace_write_section(fp,
+                                                 suite_name,
+                                                 run_idx,
+                                                 buffers,
+                                                 run->nb_threads);
+
+        free(buffers), buffers = NULL;
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_ops_run_free(mt_fs_tests_ops_run * const run)
+{
+    if (run != NULL)
+    {
+        if (run->threads != NULL)
+        {
+            for (size_t idx = 0;
+                 idx < run->nb_threads;
+                 idx++)
+            {
+                mt_fs_tests_trace_buffer_free(&(run->threads[idx].trace));
+            }
+        }
+
+        mt_fs_tests_shared_free(run->threads), run->threads = NULL;
+        mt_fs_tests_shared_free(run->names), run->names = NULL;
+        mt_fs_tests_shared_free(run);
+    }
+}
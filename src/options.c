@@ -0,0 +1,315 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "options.h"
+#include "utils.h"
+
+typedef struct
+{
+    char * name;
+    char * value;
+} mt_fs_tests_option;
+
+static mt_fs_tests_option * options = NULL;
+static size_t options_count = 0;
+
+int mt_fs_tests_options_add(char const * const option)
+{
+    int result = 0;
+    char const * const equal = option != NULL ? strchr(option, '=') : NULL;
+
+    if (equal != NULL &&
+        equal != option)
+    {
+        mt_fs_tests_option * const new_options = realloc(options,
+                                                         sizeof *new_options * (options_count + 1));
+
+        if (new_options != NULL)
+        {
+            mt_fs_tests_option * const new_option = &(new_options[options_count]);
+            options = new_options;
+
+            new_option->name = strndup(option, (size_t) (equal - option));
+            new_option->value = strdup(equal + 1);
+
+            if (new_option->name != NULL &&
+                new_option->value != NULL)
+            {
+                options_count++;
+            }
+            else
+            {
+                free(new_option->name), new_option->name = NULL;
+                free(new_option->value), new_option->value = NULL;
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+    else
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid option %s, expected <name>=<value>",
+                  option != NULL ? option : "(null)");
+    }
+
+    return result;
+}
+
+void mt_fs_tests_options_log(void)
+{
+    for (size_t idx = 0;
+         idx < options_count;
+         idx++)
+    {
+        LOG_OK("Option %s = %s",
+               options[idx].name,
+               options[idx].value);
+    }
+}
+
+void mt_fs_tests_options_free(void)
+{
+    for (size_t idx = 0;
+         idx < options_count;
+         idx++)
+    {
+        free(options[idx].name), options[idx].name = NULL;
+        free(options[idx].value), options[idx].value = NULL;
+    }
+
+    free(options), options = NULL;
+    options_count = 0;
+}
+
+char const * mt_fs_tests_option_get_string(char const * const name,
+                                           char const * const default_value)
+{
+    char const * result = default_value;
+    assert(name != NULL);
+
+    /* The last occurrence wins. */
+    for (size_t idx = options_count;
+         idx > 0;
+         idx--)
+    {
+        if (strcasecmp(options[idx - 1].name, name) == 0)
+        {
+            result = options[idx - 1].value;
+            break;
+        }
+    }
+
+    return result;
+}
+
+int mt_fs_tests_option_get_uint64(char const * const name,
+                                  uint64_t const default_value,
+                                  uint64_t * const out)
+{
+    int result = 0;
+    char const * const value = mt_fs_tests_option_get_string(name,
+                                                             NULL);
+    assert(out != NULL);
+
+    if (value != NULL)
+    {
+        char * endptr = NULL;
+        unsigned long long val = 0;
+
+        errno = 0;
+        val = strtoull(value, &endptr, 0);
+
+        if (errno != 0 ||
+            endptr == value ||
+            *endptr != '\0' ||
+            value[0] == '-')
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid value %s for option %s, expected an unsigned integer",
+                      value,
+                      name);
+        }
+        else
+        {
+            *out = val;
+        }
+    }
+    else
+    {
+        *out = default_value;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_parse_size(char const * const str,
+                           uint64_t * const out)
+{
+    int result = 0;
+    char * endptr = NULL;
+    unsigned long long val = 0;
+    uint64_t multiplier = 1;
+    assert(str != NULL);
+    assert(out != NULL);
+
+    errno = 0;
+    val = strtoull(str, &endptr, 10);
+
+    if (errno == 0 &&
+        endptr != str)
+    {
+        switch(*endptr)
+        {
+        case 'k':
+        case 'K':
+            multiplier = UINT64_C(1) << 10;
+            endptr++;
+            break;
+        case 'm':
+        case 'M':
+            multiplier = UINT64_C(1) << 20;
+            endptr++;
+            break;
+        case 'g':
+        case 'G':
+            multiplier = UINT64_C(1) << 30;
+            endptr++;
+            break;
+        default:
+            break;
+        }
+    }
+
+    /* strtoull() negates negative values instead of rejecting them. */
+    if (errno != 0 ||
+        endptr == str ||
+        *endptr != '\0' ||
+        strchr(str, '-') != NULL ||
+        val > UINT64_MAX / multiplier)
+    {
+        result = EINVAL;
+    }
+    else
+    {
+        *out = (uint64_t) val * multiplier;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_option_get_size(char const * const name,
+                                uint64_t const default_value,
+                                uint64_t * const out)
+{
+    int result = 0;
+    char const * const value = mt_fs_tests_option_get_string(name,
+                                                             NULL);
+    assert(out != NULL);
+
+    if (value != NULL)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        out);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Invalid value %s for option %s, expected a size in bytes, with an optional k, m or g suffix",
+                      value,
+                      name);
+        }
+    }
+    else
+    {
+        *out = default_value;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_option_get_double(char const * const name,
+                                  double const default_value,
+                                  double * const out)
+{
+    int result = 0;
+    char const * const value = mt_fs_tests_option_get_string(name,
+                                                             NULL);
+    assert(out != NULL);
+
+    if (value != NULL)
+    {
+        char * endptr = NULL;
+        double val = 0.0;
+
+        errno = 0;
+        val = strtod(value, &endptr);
+
+        if (errno != 0 ||
+            endptr == value ||
+            *endptr != '\0')
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid value %s for option %s, expected a number",
+                      value,
+                      name);
+        }
+        else
+        {
+            *out = val;
+        }
+    }
+    else
+    {
+        *out = default_value;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_option_get_bool(char const * const name,
+                                bool const default_value,
+                                bool * const out)
+{
+    int result = 0;
+    char const * const value = mt_fs_tests_option_get_string(name,
+                                                             NULL);
+    assert(out != NULL);
+
+    if (value != NULL)
+    {
+        if (strcasecmp(value, "1") == 0 ||
+            strcasecmp(value, "true") == 0 ||
+            strcasecmp(value, "yes") == 0 ||
+            strcasecmp(value, "on") == 0)
+        {
+            *out = true;
+        }
+        else if (strcasecmp(value, "0") == 0 ||
+                 strcasecmp(value, "false") == 0 ||
+                 strcasecmp(value, "no") == 0 ||
+                 strcasecmp(value, "off") == 0)
+        {
+            *out = false;
+        }
+        else
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid value %s for option %s, expected a boolean",
+                      value,
+                      name);
+        }
+    }
+    else
+    {
+        *out = default_value;
+    }
+
+    return result;
+}
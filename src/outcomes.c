@@ -0,0 +1,232 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "outcomes.h"
+#include "utils.h"
+
+/* strerrorname_np() appeared in glibc 2.32. */
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 32))
+#define OUTCOMES_HAVE_ERRNO_NAMES
+#endif
+
+static char const * const outcomes_kind_names[] =
+{
+    "exactly",
+    "at least",
+    "any number of",
+};
+
+void mt_fs_tests_outcomes_reset(mt_fs_tests_outcomes * const outcomes)
+{
+    assert(outcomes != NULL);
+
+    memset(outcomes, 0, sizeof *outcomes);
+}
+
+void mt_fs_tests_outcomes_merge(mt_fs_tests_outcomes * const destination,
+                                mt_fs_tests_outcomes const * const source)
+{
+    assert(destination != NULL);
+    assert(source != NULL);
+
+    for (size_t idx = 0;
+         idx <= MT_FS_TESTS_OUTCOMES_OTHER;
+         idx++)
+    {
+        destination->counts[idx] += source->counts[idx];
+    }
+}
+
+uint64_t mt_fs_tests_outcomes_get(mt_fs_tests_outcomes const * const outcomes,
+                                  int const outcome)
+{
+    assert(outcomes != NULL);
+
+    return outcomes->counts[mt_fs_tests_outcomes_index(outcome)];
+}
+
+uint64_t mt_fs_tests_outcomes_total(mt_fs_tests_outcomes const * const outcomes)
+{
+    uint64_t result = 0;
+    assert(outcomes != NULL);
+
+    for (size_t idx = 0;
+         idx <= MT_FS_TESTS_OUTCOMES_OTHER;
+         idx++)
+    {
+        result += outcomes->counts[idx];
+    }
+
+    return result;
+}
+
+bool mt_fs_tests_outcomes_match(mt_fs_tests_outcomes const * const outcomes,
+                                mt_fs_tests_expectation const * const expectations,
+                                size_t const nb_expectations)
+{
+    bool result = true;
+    uint64_t expected = 0;
+    assert(outcomes != NULL);
+    assert(expectations != NULL || nb_expectations == 0);
+
+    for (size_t idx = 0;
+         result == true &&
+             idx < nb_expectations;
+         idx++)
+    {
+        mt_fs_tests_expectation const * const expectation = &(expectations[idx]);
+        uint64_t const count = mt_fs_tests_outcomes_get(outcomes,
+                                                        expectation->outcome);
+
+        if (expectation->kind == mt_fs_tests_expect_exactly)
+        {
+            result = count == expectation->count;
+        }
+        else if (expectation->kind == mt_fs_tests_expect_at_least)
+        {
+            result = count >= expectation->count;
+        }
+
+        expected += count;
+    }
+
+    /* Any other outcome is unexpected. */
+    return result == true &&
+        expected == mt_fs_tests_outcomes_total(outcomes);
+}
+
+static int outcomes_name(int const outcome,
+                         char * const buffer,
+                         size_t const size)
+{
+    char const * name = NULL;
+
+    if (outcome == 0)
+    {
+        name = "success";
+    }
+    else if (outcome == MT_FS_TESTS_OUTCOMES_OTHER)
+    {
+        name = "other";
+    }
+#ifdef OUTCOMES_HAVE_ERRNO_NAMES
+    else
+    {
+        name = strerrorname_np(outcome);
+    }
+#endif
+
+    return name != NULL ?
+        snprintf(buffer, size, "%s", name) :
+        snprintf(buffer, size, "errno %d", outcome);
+}
+
+void mt_fs_tests_outcomes_format(mt_fs_tests_outcomes const * const outcomes,
+                                 char * const buffer,
+                                 size_t const size)
+{
+    size_t used = 0;
+    assert(outcomes != NULL);
+    assert(buffer != NULL);
+    assert(size > 0);
+
+    buffer[0] = '\0';
+
+    for (size_t idx = 0;
+         used < size &&
+             idx <= MT_FS_TESTS_OUTCOMES_OTHER;
+         idx++)
+    {
+        if (outcomes->counts[idx] > 0)
+        {
+            char name[64];
+            int written = 0;
+
+            outcomes_name((int) idx,
+                          name,
+                          sizeof name);
+
+            written = snprintf(buffer + used,
+                               size - used,
+                               "%s%s %" PRIu64,
+                               used > 0 ? ", " : "",
+                               name,
+                               outcomes->counts[idx]);
+
+            /* Stops there once truncated. */
+            used = written > 0 && (size_t) written < size - used ? used + (size_t) written : size;
+        }
+    }
+}
+
+bool mt_fs_tests_outcomes_check(mt_fs_tests_outcomes const * const outcomes,
+                                mt_fs_tests_expectation const * const expectations,
+                                size_t const nb_expectations)
+{
+    bool const result = mt_fs_tests_outcomes_match(outcomes,
+                                                   expectations,
+                                                   nb_expectations);
+
+    if (result == true)
+    {
+        LOG_OK("Success!");
+    }
+    else
+    {
+        char expected[MT_FS_TESTS_OUTCOMES_FORMAT_SIZE];
+        char got[MT_FS_TESTS_OUTCOMES_FORMAT_SIZE];
+        size_t used = 0;
+
+        expected[0] = '\0';
+
+        for (size_t idx = 0;
+             used < sizeof expected &&
+                 idx < nb_expectations;
+             idx++)
+        {
+            mt_fs_tests_expectation const * const expectation = &(expectations[idx]);
+            char name[64];
+            int written = 0;
+
+            outcomes_name(expectation->outcome,
+                          name,
+                          sizeof name);
+
+            if (expectation->kind == mt_fs_tests_expect_any)
+            {
+                written = snprintf(expected + used,
+                                   sizeof expected - used,
+                                   "%s%s %s",
+                                   used > 0 ? ", " : "",
+                                   outcomes_kind_names[expectation->kind],
+                                   name);
+            }
+            else
+            {
+                written = snprintf(expected + used,
+                                   sizeof expected - used,
+                                   "%s%s %" PRIu64 " %s",
+                                   used > 0 ? ", " : "",
+                                   outcomes_kind_names[expectation->kind],
+                                   expectation->count,
+                                   name);
+            }
+
+            used = written > 0 && (size_t) written < sizeof expected - used ? used + (size_t) written : sizeof expected;
+        }
+
+        mt_fs_tests_outcomes_format(outcomes,
+                                    got,
+                                    sizeof got);
+
+        LOG_ERROR("Error, expected %s and nothing else, got %s.",
+                  expected,
+                  got);
+    }
+
+    return result;
+}
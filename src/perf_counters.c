@@ -0,0 +1,360 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <linux/perf_event.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "perf_counters.h"
+#include "utils.h"
+
+#define SYSCALLS_TRACEPOINT_ID_PATH "/sys/kernel/tracing/events/raw_syscalls/sys_enter/id"
+#define SYSCALLS_TRACEPOINT_ID_LEGACY_PATH "/sys/kernel/debug/tracing/events/raw_syscalls/sys_enter/id"
+
+typedef struct
+{
+    char const * const name;
+    uint32_t type;
+    uint64_t config;
+    bool available;
+    bool exclude_kernel;
+} mt_fs_tests_perf_counter_desc;
+
+static mt_fs_tests_perf_counter_desc mt_fs_tests_perf_counters[mt_fs_tests_perf_count] =
+{
+    { "cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, false, false },
+    { "instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, false, false },
+    { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, false, false },
+    { "cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS, false, false },
+    { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS, false, false },
+    /* config is the tracepoint id, looked up in tracefs */
+    { "syscalls", PERF_TYPE_TRACEPOINT, 0, false, false },
+};
+
+static int mt_fs_tests_perf_event_open(mt_fs_tests_perf_counter_desc const * const desc,
+                                       bool const exclude_kernel)
+{
+    struct perf_event_attr attr;
+    assert(desc != NULL);
+
+    memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = desc->type;
+    attr.config = desc->config;
+    attr.disabled = 1;
+    attr.exclude_kernel = exclude_kernel ? 1 : 0;
+    attr.exclude_hv = exclude_kernel ? 1 : 0;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    return (int) syscall(SYS_perf_event_open,
+                         &attr,
+                         0,
+                         -1,
+                         -1,
+                         PERF_FLAG_FD_CLOEXEC);
+}
+
+static int mt_fs_tests_perf_read_tracepoint_id(char const * const path,
+                                               uint64_t * const id)
+{
+    int result = 0;
+    FILE * fp = fopen(path, "r");
+
+    if (fp != NULL)
+    {
+        unsigned long long value = 0;
+
+        if (fscanf(fp, "%llu", &value) == 1)
+        {
+            *id = value;
+        }
+        else
+        {
+            result = EINVAL;
+        }
+
+        fclose(fp), fp = NULL;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_perf_init(void)
+{
+    struct rlimit limit;
+    size_t available = 0;
+    bool has_tracepoint = false;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 &&
+        limit.rlim_cur < limit.rlim_max)
+    {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+
+    has_tracepoint = mt_fs_tests_perf_read_tracepoint_id(SYSCALLS_TRACEPOINT_ID_PATH,
+                                                         &(mt_fs_tests_perf_counters[mt_fs_tests_perf_syscalls].config)) == 0 ||
+        mt_fs_tests_perf_read_tracepoint_id(SYSCALLS_TRACEPOINT_ID_LEGACY_PATH,
+                                            &(mt_fs_tests_perf_counters[mt_fs_tests_perf_syscalls].config)) == 0;
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count;
+         idx++)
+    {
+        mt_fs_tests_perf_counter_desc * const desc = &(mt_fs_tests_perf_counters[idx]);
+        int fd = -1;
+
+        if (idx == mt_fs_tests_perf_syscalls &&
+            has_tracepoint == false)
+        {
+            LOG_OK("Perf counter %s is not available: tracepoint not found",
+                   desc->name);
+            continue;
+        }
+
+        fd = mt_fs_tests_perf_event_open(desc,
+                                         false);
+
+        if (fd == -1 &&
+            (errno == EACCES || errno == EPERM))
+        {
+            /* Unprivileged users may still be allowed to count user space
+               events (perf_event_paranoid <= 2). */
+            fd = mt_fs_tests_perf_event_open(desc,
+                                             true);
+            desc->exclude_kernel = true;
+        }
+
+        if (fd != -1)
+        {
+            desc->available = true;
+            available++;
+
+            close(fd), fd = -1;
+
+            if (desc->exclude_kernel == true)
+            {
+                LOG_OK("Perf counter %s is only available for user space",
+                       desc->name);
+            }
+        }
+        else
+        {
+            LOG_OK("Perf counter %s is not available: %d",
+                   desc->name,
+                   errno);
+        }
+    }
+
+    if (available == 0)
+    {
+        LOG_OK("No perf counter available, only reporting getrusage(RUSAGE_THREAD) data");
+    }
+}
+
+void mt_fs_tests_perf_thread_open(mt_fs_tests_perf_thread * const perf)
+{
+    assert(perf != NULL);
+
+    memset(perf, 0, sizeof *perf);
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count;
+         idx++)
+    {
+        mt_fs_tests_perf_counter_desc const * const desc = &(mt_fs_tests_perf_counters[idx]);
+        perf->fds[idx] = -1;
+
+        if (desc->available == true)
+        {
+            perf->fds[idx] = mt_fs_tests_perf_event_open(desc,
+                                                         desc->exclude_kernel);
+        }
+    }
+}
+
+void mt_fs_tests_perf_thread_start(mt_fs_tests_perf_thread * const perf)
+{
+    assert(perf != NULL);
+
+    getrusage(RUSAGE_THREAD, &(perf->rusage_start));
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count;
+         idx++)
+    {
+        if (perf->fds[idx] != -1)
+        {
+            ioctl(perf->fds[idx], PERF_EVENT_IOC_RESET, 0);
+            ioctl(perf->fds[idx], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+}
+
+void mt_fs_tests_perf_thread_stop(mt_fs_tests_perf_thread * const perf)
+{
+    assert(perf != NULL);
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count;
+         idx++)
+    {
+        if (perf->fds[idx] != -1)
+        {
+            ioctl(perf->fds[idx], PERF_EVENT_IOC_DISABLE, 0);
+        }
+    }
+
+    getrusage(RUSAGE_THREAD, &(perf->rusage_end));
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count;
+         idx++)
+    {
+        if (perf->fds[idx] != -1)
+        {
+            /* value, time enabled, time running */
+            uint64_t data[3] = { 0, 0, 0 };
+
+            if (read(perf->fds[idx], data, sizeof data) == sizeof data)
+            {
+                if (data[2] > 0 &&
+                    data[2] < data[1])
+                {
+                    /* The counter has been multiplexed, scale it. */
+                    data[0] = (uint64_t) ((double) data[0] * (double) data[1] / (double) data[2]);
+                }
+
+                perf->values[idx] = data[0];
+                perf->collected |= 1U << idx;
+            }
+
+            close(perf->fds[idx]), perf->fds[idx] = -1;
+        }
+    }
+}
+
+static double mt_fs_tests_perf_timeval_to_seconds(struct timeval const * const tv)
+{
+    return (double) tv->tv_sec + (double) tv->tv_usec / 1000000.0;
+}
+
+void mt_fs_tests_perf_report(mt_fs_tests_perf_thread const * const threads,
+                             size_t const nb_threads,
+                             char const * const suite_name)
+{
+    uint64_t values[mt_fs_tests_perf_count] = { 0 };
+    size_t collected[mt_fs_tests_perf_count] = { 0 };
+    double user_time = 0.0;
+    double system_time = 0.0;
+    uint64_t voluntary_switches = 0;
+    uint64_t involuntary_switches = 0;
+    uint64_t minor_faults = 0;
+    uint64_t major_faults = 0;
+    char buffer[512] = "";
+    size_t used = 0;
+    assert(threads != NULL);
+    assert(suite_name != NULL);
+
+    for (size_t th_idx = 0;
+         th_idx < nb_threads;
+         th_idx++)
+    {
+        mt_fs_tests_perf_thread const * const perf = &(threads[th_idx]);
+
+        for (size_t idx = 0;
+             idx < mt_fs_tests_perf_count;
+             idx++)
+        {
+            if ((perf->collected & (1U << idx)) != 0)
+            {
+                values[idx] += perf->values[idx];
+                collected[idx]++;
+            }
+        }
+
+        user_time += mt_fs_tests_perf_timeval_to_seconds(&(perf->rusage_end.ru_utime)) -
+            mt_fs_tests_perf_timeval_to_seconds(&(perf->rusage_start.ru_utime));
+        system_time += mt_fs_tests_perf_timeval_to_seconds(&(perf->rusage_end.ru_stime)) -
+            mt_fs_tests_perf_timeval_to_seconds(&(perf->rusage_start.ru_stime));
+        voluntary_switches += (uint64_t) (perf->rusage_end.ru_nvcsw - perf->rusage_start.ru_nvcsw);
+        involuntary_switches += (uint64_t) (perf->rusage_end.ru_nivcsw - perf->rusage_start.ru_nivcsw);
+        minor_faults += (uint64_t) (perf->rusage_end.ru_minflt - perf->rusage_start.ru_minflt);
+        major_faults += (uint64_t) (perf->rusage_end.ru_majflt - perf->rusage_start.ru_majflt);
+    }
+
+    LOG_OK("%s: cpu time user %.3f s system %.3f s, context switches %" PRIu64 " voluntary %" PRIu64 " involuntary, page faults %" PRIu64 " minor %" PRIu64 " major",
+           suite_name,
+           user_time,
+           system_time,
+           voluntary_switches,
+           involuntary_switches,
+           minor_faults,
+           major_faults);
+
+    for (size_t idx = 0;
+         idx < mt_fs_tests_perf_count &&
+             used < sizeof buffer;
+         idx++)
+    {
+        int printed = 0;
+
+        if (collected[idx] == 0)
+        {
+            continue;
+        }
+        else if (collected[idx] == nb_threads)
+        {
+            printed = snprintf(buffer + used,
+                               sizeof buffer - used,
+                               " %s %" PRIu64,
+                               mt_fs_tests_perf_counters[idx].name,
+                               values[idx]);
+        }
+        else
+        {
+            printed = snprintf(buffer + used,
+                               sizeof buffer - used,
+                               " %s %" PRIu64 " (%zu/%zu threads)",
+                               mt_fs_tests_perf_counters[idx].name,
+                               values[idx],
+                               collected[idx],
+                               nb_threads);
+        }
+
+        if (printed > 0)
+        {
+            used += (size_t) printed;
+        }
+    }
+
+    if (used > 0)
+    {
+        if (collected[mt_fs_tests_perf_cycles] > 0 &&
+            collected[mt_fs_tests_perf_instructions] > 0 &&
+            values[mt_fs_tests_perf_cycles] > 0 &&
+            used < sizeof buffer)
+        {
+            snprintf(buffer + used,
+                     sizeof buffer - used,
+                     ", IPC %.2f",
+                     (double) values[mt_fs_tests_perf_instructions] / (double) values[mt_fs_tests_perf_cycles]);
+        }
+
+        LOG_OK("%s:%s",
+               suite_name,
+               buffer);
+    }
+}
@@ -0,0 +1,203 @@
+
+#include <assert.h>
+#include <dirent.h>
+#include <dlfcn.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include "plugins.h"
+#include "suites/suites.h"
+#include "utils.h"
+
+#define PLUGIN_SUFFIX ".so"
+
+static void ** plugins_handles = NULL;
+static size_t plugins_count = 0;
+
+static int mt_fs_tests_plugins_load_file(char const * const path)
+{
+    int result = 0;
+    void * handle = NULL;
+    assert(path != NULL);
+
+    handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+
+    if (handle != NULL)
+    {
+        test_suite_plugin const * const plugin = dlsym(handle,
+                                                       MT_FS_TESTS_PLUGIN_SYMBOL);
+
+        if (plugin == NULL)
+        {
+            result = ENOENT;
+            LOG_ERROR("No %s symbol found in plugin %s",
+                      MT_FS_TESTS_PLUGIN_SYMBOL,
+                      path);
+        }
+        else if (plugin->api_version != MT_FS_TESTS_SUITE_API_VERSION)
+        {
+            result = EPROTO;
+            LOG_ERROR("Plugin %s has been built for API version %u, expected %u",
+                      path,
+                      plugin->api_version,
+                      MT_FS_TESTS_SUITE_API_VERSION);
+        }
+        else if (plugin->suite == NULL ||
+                 plugin->suite->name == NULL ||
+                 plugin->suite->run == NULL ||
+                 plugin->suite->type <= test_suite_type_none ||
+                 plugin->suite->type >= test_suite_type_count)
+        {
+            result = EINVAL;
+            LOG_ERROR("Plugin %s exports an invalid suite",
+                      path);
+        }
+        else
+        {
+            void ** handles = realloc(plugins_handles,
+                                      sizeof *handles * (plugins_count + 1));
+
+            if (handles != NULL)
+            {
+                plugins_handles = handles;
+
+                result = test_suites_register(plugin->suite);
+
+                if (result == 0)
+                {
+                    plugins_handles[plugins_count] = handle;
+                    plugins_count++;
+
+                    LOG_OK("Loaded suite %s from plugin %s",
+                           plugin->suite->name,
+                           path);
+                }
+                else if (result == EEXIST)
+                {
+                    LOG_ERROR("Plugin %s exports suite %s which already exists",
+                              path,
+                              plugin->suite->name);
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result != 0)
+        {
+            dlclose(handle), handle = NULL;
+        }
+    }
+    else
+    {
+        result = ENOENT;
+        LOG_ERROR("Error loading plugin %s: %s",
+                  path,
+                  dlerror());
+    }
+
+    return result;
+}
+
+static int mt_fs_tests_plugins_load_directory(char const * const path)
+{
+    int result = 0;
+    DIR * dir = NULL;
+    assert(path != NULL);
+
+    dir = opendir(path);
+
+    if (dir != NULL)
+    {
+        struct dirent * entry = NULL;
+
+        while (result == 0 &&
+               (entry = readdir(dir)) != NULL)
+        {
+            size_t const name_len = strlen(entry->d_name);
+
+            if (name_len > sizeof PLUGIN_SUFFIX - 1 &&
+                strcmp(entry->d_name + name_len - (sizeof PLUGIN_SUFFIX - 1),
+                       PLUGIN_SUFFIX) == 0)
+            {
+                char plugin_path[PATH_MAX];
+                int const printed = snprintf(plugin_path,
+                                             sizeof plugin_path,
+                                             "%s/%s",
+                                             path,
+                                             entry->d_name);
+
+                if (printed > 0 &&
+                    (size_t) printed < sizeof plugin_path)
+                {
+                    result = mt_fs_tests_plugins_load_file(plugin_path);
+                }
+                else
+                {
+                    result = ENAMETOOLONG;
+                }
+            }
+        }
+
+        closedir(dir), dir = NULL;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening plugins directory %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+int mt_fs_tests_plugins_load(char const * const path)
+{
+    int result = 0;
+    struct stat st;
+    assert(path != NULL);
+
+    if (stat(path, &st) == 0)
+    {
+        if (S_ISDIR(st.st_mode))
+        {
+            result = mt_fs_tests_plugins_load_directory(path);
+        }
+        else
+        {
+            result = mt_fs_tests_plugins_load_file(path);
+        }
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error accessing plugin %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+void mt_fs_tests_plugins_unload(void)
+{
+    test_suites_free();
+
+    for (size_t idx = 0;
+         idx < plugins_count;
+         idx++)
+    {
+        dlclose(plugins_handles[idx]), plugins_handles[idx] = NULL;
+    }
+
+    free(plugins_handles), plugins_handles = NULL;
+    plugins_count = 0;
+}
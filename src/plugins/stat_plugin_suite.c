@@ -0,0 +1,201 @@
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ops.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Example of a suite built as a plugin: threads concurrently stat() the
+   same file. Load it with --plugin=lib/libmt-fs-tests-stat-plugin.so */
+
+#define FILENAME_TEMPLATE "stat_plugin_suite_XXXXXX"
+#define ITERATIONS (1000)
+
+typedef struct {
+    char * filename;
+    int * results;
+    size_t nb_threads;
+} stat_plugin_mt_data;
+
+static int stat_plugin_mt_init(void ** test_suite_data,
+                               size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    stat_plugin_mt_data * data = malloc(sizeof *data);
+
+    if (data != NULL)
+    {
+        data->results = mt_fs_tests_shared_calloc(nb_threads,
+                                                  sizeof *(data->results));
+
+        if (data->results != NULL)
+        {
+            for (size_t idx = 0;
+                 idx < nb_threads;
+                 idx++)
+            {
+                data->results[idx] = -1;
+            }
+
+            data->nb_threads = nb_threads;
+
+            data->filename = strdup(FILENAME_TEMPLATE);
+
+            if (data->filename != NULL)
+            {
+                int fd = mkstemp(data->filename);
+
+                if (fd != -1)
+                {
+                    *test_suite_data = data;
+
+                    close(fd), fd = -1;
+                }
+                else
+                {
+                    result = errno;
+                    LOG_ERROR("Error in mkstemp: %d",
+                              result);
+                }
+
+                if (result != 0)
+                {
+                    free(data->filename), data->filename = NULL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+
+            if (result != 0)
+            {
+                mt_fs_tests_shared_free(data->results), data->results = NULL;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+
+        if (result != 0)
+        {
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int stat_plugin_mt_run(void * test_suite_data,
+                              size_t id)
+{
+    int result = 0;
+    stat_plugin_mt_data * data = test_suite_data;
+
+    assert(data != NULL);
+    assert(data->filename != NULL);
+    assert(data->results[id] == -1);
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < ITERATIONS;
+         idx++)
+    {
+        struct stat st;
+        mt_fs_tests_op op;
+
+        mt_fs_tests_op_begin(&op,
+                             "stat");
+
+        if (stat(data->filename, &st) != 0)
+        {
+            result = errno;
+        }
+
+        mt_fs_tests_op_end(&op,
+                           result);
+    }
+
+    data->results[id] = result;
+
+    return 0;
+}
+
+static int stat_plugin_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    stat_plugin_mt_data * data = test_suite_data;
+    size_t ok_count = 0;
+    assert(data != NULL);
+
+    for (size_t idx = 0;
+         idx < data->nb_threads;
+         idx++)
+    {
+        if (data->results[idx] == 0)
+        {
+            ok_count++;
+        }
+    }
+
+    if (ok_count == data->nb_threads)
+    {
+        LOG_OK("Success!");
+    }
+    else
+    {
+        LOG_ERROR("Error, we got %zu success and %zu invalid return codes.",
+                  ok_count,
+                  data->nb_threads - ok_count);
+    }
+
+    return result;
+}
+
+static int stat_plugin_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    stat_plugin_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        if (data->results != NULL)
+        {
+            mt_fs_tests_shared_free(data->results), data->results = NULL;
+        }
+
+        if (data->filename != NULL)
+        {
+            unlink(data->filename);
+            free(data->filename), data->filename = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+static test_suite const test_suite_stat_plugin_mt =
+{
+    "stat_plugin_mt",
+    &stat_plugin_mt_init,
+    &stat_plugin_mt_run,
+    &stat_plugin_mt_post_run,
+    &stat_plugin_mt_deinit,
+    test_suite_type_mt
+};
+
+MT_FS_TESTS_PLUGIN(stat_plugin_mt);
@@ -0,0 +1,47 @@
+
+#include <assert.h>
+
+#include "prng.h"
+
+static uint64_t prng_seed = 0;
+static size_t prng_run_idx = 0;
+
+void mt_fs_tests_prng_set_seed(uint64_t const seed)
+{
+    prng_seed = seed;
+}
+
+uint64_t mt_fs_tests_prng_get_seed(void)
+{
+    return prng_seed;
+}
+
+void mt_fs_tests_prng_set_run(size_t const run_idx)
+{
+    prng_run_idx = run_idx;
+}
+
+void mt_fs_tests_prng_stream_init(mt_fs_tests_prng * const prng,
+                                  uint64_t const stream,
+                                  size_t const id)
+{
+    uint64_t x = prng_seed;
+    assert(prng != NULL);
+
+    /* Mixing each component separately keeps nearby seeds, runs and ids from
+       giving related streams. */
+    x = mt_fs_tests_prng_splitmix64(&x) ^ (uint64_t) prng_run_idx;
+    x = mt_fs_tests_prng_splitmix64(&x) ^ stream;
+    x = mt_fs_tests_prng_splitmix64(&x) ^ (uint64_t) id;
+
+    mt_fs_tests_prng_seed(prng,
+                          mt_fs_tests_prng_splitmix64(&x));
+}
+
+void mt_fs_tests_prng_thread_init(mt_fs_tests_prng * const prng,
+                                  size_t const id)
+{
+    mt_fs_tests_prng_stream_init(prng,
+                                 MT_FS_TESTS_PRNG_STREAM_SUITE,
+                                 id);
+}
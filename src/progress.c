@@ -0,0 +1,365 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "progress.h"
+#include "utils.h"
+
+#define PROGRESS_INITIAL_INTERVALS (64)
+
+typedef struct
+{
+    /* End of the interval, from the start of the reporter. */
+    uint64_t end_ns;
+    uint64_t duration_ns;
+    uint64_t ops_count;
+    uint64_t errors_count;
+    uint64_t bytes;
+    uint64_t p99_ns;
+} progress_interval;
+
+struct mt_fs_tests_progress
+{
+    pthread_t thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    mt_fs_tests_ops_run const * run;
+    char const * suite_name;
+    progress_interval * intervals;
+    size_t nb_intervals;
+    size_t intervals_capacity;
+    /* Cumulative counters at the end of the previous interval, the current
+       ones and the difference between both. */
+    mt_fs_tests_ops_sample previous;
+    mt_fs_tests_ops_sample current;
+    mt_fs_tests_ops_sample delta;
+    uint64_t interval_ns;
+    uint64_t start_ns;
+    uint64_t previous_ns;
+    struct timespec start_time;
+    bool stopping;
+};
+
+static void progress_sample(mt_fs_tests_progress * const progress,
+                            bool const live)
+{
+    uint64_t const now = mt_fs_tests_now_ns();
+    progress_interval * interval = NULL;
+
+    mt_fs_tests_ops_run_sample(progress->run,
+                               &(progress->current));
+
+    progress->delta = progress->current;
+    mt_fs_tests_histogram_subtract(&(progress->delta.latency),
+                                   &(progress->previous.latency));
+    progress->delta.ops_count -= progress->previous.ops_count;
+    progress->delta.errors_count -= progress->previous.errors_count;
+    progress->delta.bytes -= progress->previous.bytes;
+
+    if (progress->nb_intervals == progress->intervals_capacity)
+    {
+        size_t const capacity = progress->intervals_capacity > 0 ? progress->intervals_capacity * 2 : PROGRESS_INITIAL_INTERVALS;
+        progress_interval * const intervals = realloc(progress->intervals,
+                                                      sizeof *intervals * capacity);
+
+        if (intervals != NULL)
+        {
+            progress->intervals = intervals;
+            progress->intervals_capacity = capacity;
+        }
+    }
+
+    if (progress->nb_intervals < progress->intervals_capacity)
+    {
+        interval = &(progress->intervals[progress->nb_intervals]);
+        progress->nb_intervals++;
+    }
+    else
+    {
+        LOG_ERROR("%s: error allocating memory for the progress series, interval not kept",
+                  progress->suite_name);
+    }
+
+    if (interval != NULL)
+    {
+        interval->end_ns = now - progress->start_ns;
+        interval->duration_ns = now - progress->previous_ns;
+        interval->ops_count = progress->delta.ops_count;
+        interval->errors_count = progress->delta.errors_count;
+        interval->bytes = progress->delta.bytes;
+        interval->p99_ns = mt_fs_tests_histogram_percentile(&(progress->delta.latency),
+                                                            99.0);
+
+        if (live == true)
+        {
+            double const duration = (double) interval->duration_ns / (double) MT_FS_TESTS_NS_PER_SEC;
+
+            LOG_OK("%s: %.1f s: %.1f ops/s, %.2f MB/s, p99 %.1f us, %" PRIu64 " failed",
+                   progress->suite_name,
+                   (double) interval->end_ns / (double) MT_FS_TESTS_NS_PER_SEC,
+                   (double) interval->ops_count / duration,
+                   (double) interval->bytes / duration / 1000000.0,
+                   (double) interval->p99_ns / 1000.0,
+                   interval->errors_count);
+        }
+    }
+
+    progress->previous = progress->current;
+    progress->previous_ns = now;
+}
+
+static void * progress_thread_run(void * const data)
+{
+    mt_fs_tests_progress * const progress = data;
+    uint64_t next_ns = progress->start_ns + progress->interval_ns;
+    assert(progress != NULL);
+
+    pthread_mutex_lock(&(progress->mutex));
+
+    while (progress->stopping == false)
+    {
+        struct timespec const deadline =
+            {
+                .tv_sec = (time_t) (next_ns / MT_FS_TESTS_NS_PER_SEC),
+                .tv_nsec = (long) (next_ns % MT_FS_TESTS_NS_PER_SEC)
+            };
+        int const res = pthread_cond_timedwait(&(progress->cond),
+                                               &(progress->mutex),
+                                               &deadline);
+
+        if (res == ETIMEDOUT)
+        {
+            uint64_t now = 0;
+
+            progress_sample(progress,
+                            true);
+
+            /* Ticks missed while the host was overloaded are merged into
+               the next interval. */
+            now = mt_fs_tests_now_ns();
+
+            do
+            {
+                next_ns += progress->interval_ns;
+            }
+            while (next_ns <= now);
+        }
+    }
+
+    pthread_mutex_unlock(&(progress->mutex));
+
+    return NULL;
+}
+
+int mt_fs_tests_progress_start(mt_fs_tests_progress ** const progress,
+                               mt_fs_tests_ops_run const * const run,
+                               char const * const suite_name,
+                               uint64_t const interval_ns)
+{
+    int result = 0;
+    mt_fs_tests_progress * result_progress = NULL;
+    assert(progress != NULL);
+    assert(run != NULL);
+    assert(suite_name != NULL);
+    assert(interval_ns > 0);
+
+    result_progress = calloc(1, sizeof *result_progress);
+
+    if (result_progress != NULL)
+    {
+        pthread_condattr_t attr;
+
+        result_progress->run = run;
+        result_progress->suite_name = suite_name;
+        result_progress->interval_ns = interval_ns;
+        mt_fs_tests_ops_run_sample(run,
+                                   &(result_progress->previous));
+
+        result = pthread_condattr_init(&attr);
+
+        if (result == 0)
+        {
+            /* Deadlines are computed from mt_fs_tests_now_ns(). */
+            result = pthread_condattr_setclock(&attr,
+                                               CLOCK_MONOTONIC);
+
+            if (result == 0)
+            {
+                result = pthread_cond_init(&(result_progress->cond),
+                                           &attr);
+            }
+
+            pthread_condattr_destroy(&attr);
+        }
+
+        if (result == 0)
+        {
+            result = pthread_mutex_init(&(result_progress->mutex),
+                                        NULL);
+
+            if (result == 0)
+            {
+                clock_gettime(CLOCK_REALTIME,
+                              &(result_progress->start_time));
+                result_progress->start_ns = mt_fs_tests_now_ns();
+                result_progress->previous_ns = result_progress->start_ns;
+
+                result = pthread_create(&(result_progress->thread),
+                                        NULL,
+                                        &progress_thread_run,
+                                        result_progress);
+
+                if (result != 0)
+                {
+                    pthread_mutex_destroy(&(result_progress->mutex));
+                }
+            }
+
+            if (result != 0)
+            {
+                pthread_cond_destroy(&(result_progress->cond));
+            }
+        }
+
+        if (result == 0)
+        {
+            *progress = result_progress;
+        }
+        else
+        {
+            free(result_progress), result_progress = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+void mt_fs_tests_progress_stop(mt_fs_tests_progress * const progress)
+{
+    assert(progress != NULL);
+
+    pthread_mutex_lock(&(progress->mutex));
+    progress->stopping = true;
+    pthread_cond_signal(&(progress->cond));
+    pthread_mutex_unlock(&(progress->mutex));
+
+    pthread_join(progress->thread,
+                 NULL);
+
+    progress_sample(progress,
+                    false);
+}
+
+void mt_fs_tests_progress_report(mt_fs_tests_progress const * const progress)
+{
+    assert(progress != NULL);
+
+    if (progress->nb_intervals > 0)
+    {
+        struct tm tm;
+        char start[32] = "";
+        size_t first = 0;
+        size_t last = progress->nb_intervals;
+        size_t slowest = 0;
+        uint64_t ops_count = 0;
+        uint64_t duration_ns = 0;
+
+        if (localtime_r(&(progress->start_time.tv_sec), &tm) != NULL)
+        {
+            strftime(start, sizeof start, "%Y-%m-%d %H:%M:%S", &tm);
+        }
+
+        LOG_OK("%s: progress, %zu intervals of %.3f s from %s.%03ld",
+               progress->suite_name,
+               progress->nb_intervals,
+               (double) progress->interval_ns / (double) MT_FS_TESTS_NS_PER_SEC,
+               start,
+               progress->start_time.tv_nsec / 1000000);
+
+        for (size_t idx = 0;
+             idx < progress->nb_intervals;
+             idx++)
+        {
+            progress_interval const * const interval = &(progress->intervals[idx]);
+            double const duration = (double) interval->duration_ns / (double) MT_FS_TESTS_NS_PER_SEC;
+
+            LOG_OK("%s: %9.3f s %12.1f ops/s %10.2f MB/s p99 %10.1f us %10" PRIu64 " failed",
+                   progress->suite_name,
+                   (double) interval->end_ns / (double) MT_FS_TESTS_NS_PER_SEC,
+                   duration > 0.0 ? (double) interval->ops_count / duration : 0.0,
+                   duration > 0.0 ? (double) interval->bytes / duration / 1000000.0 : 0.0,
+                   (double) interval->p99_ns / 1000.0,
+                   interval->errors_count);
+        }
+
+        /* Intervals before the first operation only cover the start of the
+           workers, and the last one is partial. */
+        while (first < last &&
+               progress->intervals[first].ops_count == 0)
+        {
+            first++;
+        }
+
+        if (last - first > 1)
+        {
+            last--;
+        }
+
+        slowest = first;
+
+        for (size_t idx = first;
+             idx < last;
+             idx++)
+        {
+            progress_interval const * const interval = &(progress->intervals[idx]);
+            progress_interval const * const slowest_interval = &(progress->intervals[slowest]);
+
+            /* Compared as rates, intervals may have different durations. */
+            if ((double) interval->ops_count / (double) interval->duration_ns <
+                (double) slowest_interval->ops_count / (double) slowest_interval->duration_ns)
+            {
+                slowest = idx;
+            }
+
+            ops_count += interval->ops_count;
+            duration_ns += interval->duration_ns;
+        }
+
+        if (last - first > 1 &&
+            duration_ns > 0)
+        {
+            progress_interval const * const interval = &(progress->intervals[slowest]);
+
+            LOG_OK("%s: slowest interval ending at %.3f s, %.1f ops/s for %.1f ops/s on average",
+                   progress->suite_name,
+                   (double) interval->end_ns / (double) MT_FS_TESTS_NS_PER_SEC,
+                   (double) interval->ops_count * (double) MT_FS_TESTS_NS_PER_SEC / (double) interval->duration_ns,
+                   (double) ops_count * (double) MT_FS_TESTS_NS_PER_SEC / (double) duration_ns);
+        }
+    }
+}
+
+void mt_fs_tests_progress_free(mt_fs_tests_progress * const progress)
+{
+    if (progress != NULL)
+    {
+        pthread_cond_destroy(&(progress->cond));
+        pthread_mutex_destroy(&(progress->mutex));
+
+        if (progress->intervals != NULL)
+        {
+            free(progress->intervals), progress->intervals = NULL;
+        }
+
+        free(progress);
+    }
+}
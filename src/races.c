@@ -0,0 +1,320 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "barrier.h"
+#include "options.h"
+#include "prng.h"
+#include "races.h"
+#include "shared_memory.h"
+#include "utils.h"
+
+#define OPTION_NAME_MAX (128)
+#define DEFAULT_ROUNDS (1)
+#define TARGET_SUFFIX "XXXXXX"
+#define TARGET_SUFFIX_SIZE (sizeof TARGET_SUFFIX - 1)
+
+struct mt_fs_tests_races
+{
+    mt_fs_tests_barrier_t barrier;
+    mt_fs_tests_races_reset * reset;
+    void * suite_data;
+    char prefix[OPTION_NAME_MAX];
+    size_t nb_threads;
+    uint64_t nb_rounds;
+    mt_fs_tests_expectation expectations[MT_FS_TESTS_RACES_MAX_EXPECTATIONS];
+    size_t nb_expectations;
+    /* Only changed by the last thread of a round, between the two barrier
+       waits ending it. */
+    uint64_t round;
+    uint64_t failed_rounds;
+    uint64_t first_failed_round;
+    mt_fs_tests_outcomes first_failed_outcomes;
+    int reset_error;
+    /* Outcomes of the current round. */
+    mt_fs_tests_outcomes outcomes;
+};
+
+static char const races_target_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789";
+
+/* Targets shared by the clients of a coordinator, for the current step. */
+static bool races_shared = false;
+static bool races_shared_owner = false;
+static uint64_t races_shared_key = 0;
+static uint64_t races_shared_nb_targets = 0;
+static mt_fs_tests_expectation races_shared_expectations[MT_FS_TESTS_RACES_MAX_EXPECTATIONS];
+static size_t races_shared_nb_expectations = 0;
+
+void mt_fs_tests_races_set_shared(uint64_t const key,
+                                  bool const owner)
+{
+    races_shared = true;
+    races_shared_owner = owner;
+    races_shared_key = key;
+    races_shared_nb_targets = 0;
+    races_shared_nb_expectations = 0;
+}
+
+bool mt_fs_tests_races_get_shared(mt_fs_tests_expectation * const expectations,
+                                  size_t * const nb_expectations)
+{
+    assert(expectations != NULL);
+    assert(nb_expectations != NULL);
+
+    memcpy(expectations,
+           races_shared_expectations,
+           sizeof *expectations * races_shared_nb_expectations);
+    *nb_expectations = races_shared_nb_expectations;
+
+    /* Only names given by mt_fs_tests_races_target() are shared. */
+    return races_shared_nb_targets > 0;
+}
+
+int mt_fs_tests_races_target(char * const name,
+                             mt_fs_tests_expectation const * const expectations,
+                             size_t const nb_expectations,
+                             bool * const create)
+{
+    int result = 0;
+    size_t len = 0;
+    assert(name != NULL);
+    assert(expectations != NULL);
+    assert(nb_expectations <= MT_FS_TESTS_RACES_MAX_EXPECTATIONS);
+    assert(create != NULL);
+
+    len = strlen(name);
+
+    if (len < TARGET_SUFFIX_SIZE ||
+        strcmp(name + len - TARGET_SUFFIX_SIZE, TARGET_SUFFIX) != 0)
+    {
+        result = EINVAL;
+    }
+    else if (races_shared == false)
+    {
+        if (mktemp(name) == NULL ||
+            name[0] == '\0')
+        {
+            result = errno;
+        }
+
+        *create = true;
+    }
+    else
+    {
+        /* Several targets of a suite get different names. */
+        uint64_t x = races_shared_key ^ races_shared_nb_targets;
+
+        for (size_t idx = len - TARGET_SUFFIX_SIZE;
+             idx < len;
+             idx++)
+        {
+            name[idx] = races_target_chars[mt_fs_tests_prng_splitmix64(&x) % (sizeof races_target_chars - 1)];
+        }
+
+        races_shared_nb_targets++;
+        memcpy(races_shared_expectations,
+               expectations,
+               sizeof *expectations * nb_expectations);
+        races_shared_nb_expectations = nb_expectations;
+        *create = races_shared_owner;
+    }
+
+    return result;
+}
+
+bool mt_fs_tests_races_shared(void)
+{
+    return races_shared;
+}
+
+int mt_fs_tests_races_init(mt_fs_tests_races ** const races,
+                           char const * const prefix,
+                           size_t const nb_threads,
+                           mt_fs_tests_expectation const * const expectations,
+                           size_t const nb_expectations,
+                           mt_fs_tests_races_reset * const reset,
+                           void * const suite_data)
+{
+    int result = 0;
+    char name[OPTION_NAME_MAX];
+    uint64_t nb_rounds = DEFAULT_ROUNDS;
+    assert(races != NULL);
+    assert(prefix != NULL);
+    assert(nb_threads > 0);
+    assert(nb_threads <= UINT_MAX);
+    assert(expectations != NULL);
+    assert(nb_expectations <= MT_FS_TESTS_RACES_MAX_EXPECTATIONS);
+    assert(reset != NULL);
+
+    snprintf(name, sizeof name, "%s.rounds", prefix);
+    result = mt_fs_tests_option_get_uint64(name,
+                                           DEFAULT_ROUNDS,
+                                           &nb_rounds);
+
+    if (result == 0 &&
+        nb_rounds == 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid %s, at least one round is needed",
+                  name);
+    }
+    else if (result == 0 &&
+             nb_rounds > 1 &&
+             races_shared == true)
+    {
+        /* Rounds are not synchronized across clients, each run of the
+           coordinator is a round. */
+        result = EINVAL;
+        LOG_ERROR("Invalid %s, clients of a coordinator race a single round per run",
+                  name);
+    }
+
+    if (result == 0)
+    {
+        mt_fs_tests_races * const result_races = mt_fs_tests_shared_calloc(1,
+                                                                           sizeof *result_races);
+
+        if (result_races != NULL)
+        {
+            result = mt_fs_tests_barrier_init_shared(&(result_races->barrier),
+                                                     (unsigned int) nb_threads);
+
+            if (result == 0)
+            {
+                snprintf(result_races->prefix, sizeof result_races->prefix, "%s", prefix);
+                result_races->reset = reset;
+                result_races->suite_data = suite_data;
+                result_races->nb_threads = nb_threads;
+                result_races->nb_rounds = nb_rounds;
+                memcpy(result_races->expectations,
+                       expectations,
+                       sizeof *expectations * nb_expectations);
+                result_races->nb_expectations = nb_expectations;
+                *races = result_races;
+            }
+            else
+            {
+                LOG_ERROR("Error creating race rounds barrier for %s: %d",
+                          prefix,
+                          result);
+                mt_fs_tests_shared_free(result_races);
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+bool mt_fs_tests_races_next(mt_fs_tests_races const * const races)
+{
+    assert(races != NULL);
+
+    return races->round < races->nb_rounds &&
+        races->reset_error == 0;
+}
+
+/* Called by the last thread of the round only. */
+static void races_end_round(mt_fs_tests_races * const races)
+{
+    if (mt_fs_tests_outcomes_match(&(races->outcomes),
+                                   races->expectations,
+                                   races->nb_expectations) == false)
+    {
+        if (races->failed_rounds == 0)
+        {
+            races->first_failed_round = races->round;
+            races->first_failed_outcomes = races->outcomes;
+        }
+
+        races->failed_rounds++;
+    }
+
+    mt_fs_tests_outcomes_reset(&(races->outcomes));
+
+    races->round++;
+
+    /* The target of the last round is left as is for post_run. */
+    if (races->round < races->nb_rounds)
+    {
+        races->reset_error = (*(races->reset))(races->suite_data);
+    }
+}
+
+void mt_fs_tests_races_end(mt_fs_tests_races * const races,
+                           int const outcome)
+{
+    assert(races != NULL);
+
+    mt_fs_tests_outcomes_add_atomic(&(races->outcomes),
+                                    outcome);
+
+    if (mt_fs_tests_barrier_wait(&(races->barrier)) == MT_FS_TESTS_BARRIER_SERIAL_THREAD)
+    {
+        races_end_round(races);
+    }
+
+    /* Holds the others until the round has been checked and reset. */
+    mt_fs_tests_barrier_wait(&(races->barrier));
+}
+
+void mt_fs_tests_races_report(mt_fs_tests_races const * const races)
+{
+    assert(races != NULL);
+
+    if (races->reset_error != 0)
+    {
+        LOG_ERROR("Error resetting the target of %s after round %llu, remaining rounds skipped: %d",
+                  races->prefix,
+                  (unsigned long long) races->round,
+                  races->reset_error);
+    }
+
+    if (races_shared == true)
+    {
+        LOG_OK("Outcomes checked by the coordinator, along with those of the other clients");
+    }
+    else if (races->failed_rounds == 0)
+    {
+        if (races->nb_rounds == 1)
+        {
+            LOG_OK("Success!");
+        }
+        else
+        {
+            LOG_OK("Success, %llu rounds!",
+                   (unsigned long long) races->round);
+        }
+    }
+    else
+    {
+        if (races->nb_rounds > 1)
+        {
+            LOG_ERROR("Error in %llu of %llu rounds, the first one being round %llu:",
+                      (unsigned long long) races->failed_rounds,
+                      (unsigned long long) races->round,
+                      (unsigned long long) races->first_failed_round);
+        }
+
+        mt_fs_tests_outcomes_check(&(races->first_failed_outcomes),
+                                   races->expectations,
+                                   races->nb_expectations);
+    }
+}
+
+void mt_fs_tests_races_free(mt_fs_tests_races * const races)
+{
+    if (races != NULL)
+    {
+        mt_fs_tests_barrier_destroy(&(races->barrier));
+        mt_fs_tests_shared_free(races);
+    }
+}
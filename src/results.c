@@ -0,0 +1,1091 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "results.h"
+#include "statistics.h"
+#include "utils.h"
+
+#define RESULTS_VERSION (1)
+/* Results files only nest a few levels. */
+#define RESULTS_JSON_MAX_DEPTH (16)
+
+typedef struct
+{
+    uint64_t ops_count;
+    uint64_t errors_count;
+    double seconds;
+    double ops_per_sec;
+    double p50_us;
+    double p99_us;
+} results_run;
+
+typedef struct
+{
+    char * suite_name;
+    char * config;
+    results_run * runs;
+    size_t nb_runs;
+} results_entry;
+
+struct mt_fs_tests_results
+{
+    results_entry * entries;
+    size_t nb_entries;
+};
+
+/* Minimal JSON reader, enough for the files written here. */
+typedef enum
+{
+    results_json_null = 0,
+    results_json_bool,
+    results_json_number,
+    results_json_string,
+    results_json_array,
+    results_json_object,
+} results_json_type;
+
+typedef struct results_json results_json;
+
+struct results_json
+{
+    results_json_type type;
+    double number;
+    char * string;
+    /* Elements of an array, or values of an object. */
+    results_json * items;
+    /* Keys of an object. */
+    char ** keys;
+    size_t nb_items;
+};
+
+typedef struct
+{
+    char const * pos;
+    char const * end;
+} results_json_parser;
+
+int mt_fs_tests_results_init(mt_fs_tests_results ** const results)
+{
+    int result = 0;
+    assert(results != NULL);
+
+    *results = calloc(1, sizeof **results);
+
+    if (*results == NULL)
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+__attribute__ ((__pure__))
+static results_entry * results_find(mt_fs_tests_results const * const results,
+                                    char const * const suite_name,
+                                    char const * const config)
+{
+    results_entry * result = NULL;
+
+    for (size_t idx = 0;
+         result == NULL &&
+             idx < results->nb_entries;
+         idx++)
+    {
+        results_entry * const entry = &(results->entries[idx]);
+
+        if (strcmp(entry->suite_name, suite_name) == 0 &&
+            strcmp(entry->config, config) == 0)
+        {
+            result = entry;
+        }
+    }
+
+    return result;
+}
+
+static int results_add_run(mt_fs_tests_results * const results,
+                           char const * const suite_name,
+                           char const * const config,
+                           results_run const * const run)
+{
+    int result = 0;
+    results_entry * entry = results_find(results,
+                                         suite_name,
+                                         config);
+
+    if (entry == NULL)
+    {
+        results_entry * const entries = realloc(results->entries,
+                                                sizeof *entries * (results->nb_entries + 1));
+
+        if (entries != NULL)
+        {
+            results->entries = entries;
+            entry = &(entries[results->nb_entries]);
+            memset(entry, 0, sizeof *entry);
+            entry->suite_name = strdup(suite_name);
+            entry->config = strdup(config);
+
+            if (entry->suite_name != NULL &&
+                entry->config != NULL)
+            {
+                results->nb_entries++;
+            }
+            else
+            {
+                free(entry->suite_name), entry->suite_name = NULL;
+                free(entry->config), entry->config = NULL;
+                entry = NULL;
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if (result == 0)
+    {
+        results_run * const runs = realloc(entry->runs,
+                                           sizeof *runs * (entry->nb_runs + 1));
+
+        if (runs != NULL)
+        {
+            entry->runs = runs;
+            runs[entry->nb_runs] = *run;
+            entry->nb_runs++;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+int mt_fs_tests_results_add(mt_fs_tests_results * const results,
+                            char const * const suite_name,
+                            char const * const config,
+                            mt_fs_tests_ops_summary const * const summary)
+{
+    int result = 0;
+    results_run run;
+    assert(results != NULL);
+    assert(suite_name != NULL);
+    assert(config != NULL);
+    assert(summary != NULL);
+
+    if (summary->ops_count > 0)
+    {
+        uint64_t const p50 = mt_fs_tests_histogram_percentile(&(summary->latency), 50.0);
+        uint64_t const p99 = mt_fs_tests_histogram_percentile(&(summary->latency), 99.0);
+
+        run.ops_count = summary->ops_count;
+        run.errors_count = summary->errors_count;
+        run.seconds = (double) (summary->end_ns - summary->start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+        run.ops_per_sec = run.seconds > 0.0 ? (double) run.ops_count / run.seconds : 0.0;
+        run.p50_us = (double) p50 / 1000.0;
+        run.p99_us = (double) p99 / 1000.0;
+
+        result = results_add_run(results,
+                                 suite_name,
+                                 config,
+                                 &run);
+    }
+
+    return result;
+}
+
+static void results_write_string(FILE * const fp,
+                                 char const * const str)
+{
+    fputc('"', fp);
+
+    for (char const * ptr = str;
+         *ptr != '\0';
+         ptr++)
+    {
+        if (*ptr == '"' ||
+            *ptr == '\\')
+        {
+            fputc('\\', fp);
+            fputc(*ptr, fp);
+        }
+        else if ((unsigned char) *ptr < 0x20)
+        {
+            fprintf(fp, "\\u%04x", (unsigned int) (unsigned char) *ptr);
+        }
+        else
+        {
+            fputc(*ptr, fp);
+        }
+    }
+
+    fputc('"', fp);
+}
+
+int mt_fs_tests_results_write(mt_fs_tests_results const * const results,
+                              char const * const path)
+{
+    int result = 0;
+    FILE * fp = NULL;
+    assert(results != NULL);
+    assert(path != NULL);
+
+    fp = fopen(path, "w");
+
+    if (fp != NULL)
+    {
+        fprintf(fp, "{\"version\": %d, \"results\": [", RESULTS_VERSION);
+
+        for (size_t idx = 0;
+             idx < results->nb_entries;
+             idx++)
+        {
+            results_entry const * const entry = &(results->entries[idx]);
+
+            fprintf(fp, "%s\n {\"suite\": ", idx > 0 ? "," : "");
+            results_write_string(fp, entry->suite_name);
+            fprintf(fp, ", \"config\": ");
+            results_write_string(fp, entry->config);
+            fprintf(fp, ",\n  \"runs\": [");
+
+            for (size_t run_idx = 0;
+                 run_idx < entry->nb_runs;
+                 run_idx++)
+            {
+                results_run const * const run = &(entry->runs[run_idx]);
+
+                fprintf(fp,
+                        "%s\n   {\"ops\": %" PRIu64 ", \"failed\": %" PRIu64 ", \"seconds\": %.9f, \"ops_per_sec\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f}",
+                        run_idx > 0 ? "," : "",
+                        run->ops_count,
+                        run->errors_count,
+                        run->seconds,
+                        run->ops_per_sec,
+                        run->p50_us,
+                        run->p99_us);
+            }
+
+            fprintf(fp, "]}");
+        }
+
+        fprintf(fp, "]}\n");
+
+        if (ferror(fp) != 0)
+        {
+            result = EIO;
+        }
+
+        if (fclose(fp) != 0 &&
+            result == 0)
+        {
+            result = errno;
+        }
+
+        fp = NULL;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static void results_json_free(results_json * const value)
+{
+    if (value != NULL)
+    {
+        free(value->string), value->string = NULL;
+
+        for (size_t idx = 0;
+             idx < value->nb_items;
+             idx++)
+        {
+            results_json_free(&(value->items[idx]));
+
+            if (value->keys != NULL)
+            {
+                free(value->keys[idx]);
+            }
+        }
+
+        free(value->items), value->items = NULL;
+        free(value->keys), value->keys = NULL;
+        value->nb_items = 0;
+    }
+}
+
+static void results_json_skip_spaces(results_json_parser * const parser)
+{
+    while (parser->pos < parser->end &&
+           (*parser->pos == ' ' || *parser->pos == '\t' || *parser->pos == '\n' || *parser->pos == '\r'))
+    {
+        parser->pos++;
+    }
+}
+
+static bool results_json_accept(results_json_parser * const parser,
+                                char const expected)
+{
+    bool result = false;
+
+    results_json_skip_spaces(parser);
+
+    if (parser->pos < parser->end &&
+        *parser->pos == expected)
+    {
+        parser->pos++;
+        result = true;
+    }
+
+    return result;
+}
+
+static int results_json_parse_string(results_json_parser * const parser,
+                                     char ** const out)
+{
+    int result = 0;
+    char * str = NULL;
+    size_t len = 0;
+
+    if (results_json_accept(parser, '"') == true)
+    {
+        /* Escaped strings only get shorter. */
+        char const * const closing = memchr(parser->pos, '"', (size_t) (parser->end - parser->pos));
+        size_t const max_len = (size_t) (parser->end - parser->pos);
+
+        str = closing != NULL ? malloc(max_len + 1) : NULL;
+
+        if (closing == NULL)
+        {
+            result = EINVAL;
+        }
+        else if (str == NULL)
+        {
+            result = ENOMEM;
+        }
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    while (result == 0 &&
+           parser->pos < parser->end &&
+           *parser->pos != '"')
+    {
+        char current = *parser->pos;
+        parser->pos++;
+
+        if (current == '\\')
+        {
+            if (parser->pos < parser->end)
+            {
+                current = *parser->pos;
+                parser->pos++;
+
+                switch(current)
+                {
+                case 'n':
+                    current = '\n';
+                    break;
+                case 't':
+                    current = '\t';
+                    break;
+                case 'r':
+                    current = '\r';
+                    break;
+                case 'b':
+                    current = '\b';
+                    break;
+                case 'f':
+                    current = '\f';
+                    break;
+                case 'u':
+                {
+                    unsigned int code = 0;
+
+                    if (parser->end - parser->pos >= 4 &&
+                        sscanf(parser->pos, "%4x", &code) == 1)
+                    {
+                        /* Only control characters are written escaped. */
+                        current = code < 0x80 ? (char) code : '?';
+                        parser->pos += 4;
+                    }
+                    else
+                    {
+                        result = EINVAL;
+                    }
+                    break;
+                }
+                default:
+                    /* Quotes, backslashes and slashes. */
+                    break;
+                }
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+
+        str[len] = current;
+        len++;
+    }
+
+    if (result == 0)
+    {
+        if (parser->pos < parser->end)
+        {
+            /* Closing quote. */
+            parser->pos++;
+            str[len] = '\0';
+            *out = str;
+        }
+        else
+        {
+            result = EINVAL;
+        }
+    }
+
+    if (result != 0)
+    {
+        free(str), str = NULL;
+    }
+
+    return result;
+}
+
+static int results_json_parse_value(results_json_parser * const parser,
+                                    results_json * const value,
+                                    size_t const depth);
+
+static int results_json_parse_items(results_json_parser * const parser,
+                                    results_json * const value,
+                                    char const closing,
+                                    size_t const depth)
+{
+    int result = 0;
+    bool const object = value->type == results_json_object;
+
+    if (results_json_accept(parser, closing) == false)
+    {
+        do
+        {
+            results_json * const items = realloc(value->items,
+                                                 sizeof *items * (value->nb_items + 1));
+            char ** const keys = object == true ? realloc(value->keys,
+                                                          sizeof *keys * (value->nb_items + 1)) : NULL;
+
+            if (items != NULL)
+            {
+                value->items = items;
+            }
+
+            if (keys != NULL)
+            {
+                value->keys = keys;
+            }
+
+            if (items == NULL ||
+                (object == true && keys == NULL))
+            {
+                result = ENOMEM;
+            }
+            else
+            {
+                results_json * const item = &(items[value->nb_items]);
+                char * key = NULL;
+
+                memset(item, 0, sizeof *item);
+
+                if (object == true)
+                {
+                    result = results_json_parse_string(parser,
+                                                       &key);
+
+                    if (result == 0 &&
+                        results_json_accept(parser, ':') == false)
+                    {
+                        free(key), key = NULL;
+                        result = EINVAL;
+                    }
+                }
+
+                if (result == 0)
+                {
+                    result = results_json_parse_value(parser,
+                                                      item,
+                                                      depth + 1);
+
+                    if (object == true)
+                    {
+                        value->keys[value->nb_items] = key;
+                    }
+
+                    /* Freed along with the others, even if incomplete. */
+                    value->nb_items++;
+                }
+            }
+        }
+        while (result == 0 &&
+               results_json_accept(parser, ',') == true);
+
+        if (result == 0 &&
+            results_json_accept(parser, closing) == false)
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+static int results_json_parse_value(results_json_parser * const parser,
+                                    results_json * const value,
+                                    size_t const depth)
+{
+    int result = 0;
+
+    results_json_skip_spaces(parser);
+
+    if (depth > RESULTS_JSON_MAX_DEPTH ||
+        parser->pos >= parser->end)
+    {
+        result = EINVAL;
+    }
+    else if (results_json_accept(parser, '{') == true)
+    {
+        value->type = results_json_object;
+        result = results_json_parse_items(parser,
+                                          value,
+                                          '}',
+                                          depth);
+    }
+    else if (results_json_accept(parser, '[') == true)
+    {
+        value->type = results_json_array;
+        result = results_json_parse_items(parser,
+                                          value,
+                                          ']',
+                                          depth);
+    }
+    else if (*parser->pos == '"')
+    {
+        value->type = results_json_string;
+        result = results_json_parse_string(parser,
+                                           &(value->string));
+    }
+    else if ((size_t) (parser->end - parser->pos) >= 4 &&
+             strncmp(parser->pos, "true", 4) == 0)
+    {
+        value->type = results_json_bool;
+        value->number = 1.0;
+        parser->pos += 4;
+    }
+    else if ((size_t) (parser->end - parser->pos) >= 5 &&
+             strncmp(parser->pos, "false", 5) == 0)
+    {
+        value->type = results_json_bool;
+        parser->pos += 5;
+    }
+    else if ((size_t) (parser->end - parser->pos) >= 4 &&
+             strncmp(parser->pos, "null", 4) == 0)
+    {
+        value->type = results_json_null;
+        parser->pos += 4;
+    }
+    else
+    {
+        /* The buffer is NUL-terminated, strtod() stops there at worst. */
+        char * endptr = NULL;
+
+        value->type = results_json_number;
+        value->number = strtod(parser->pos, &endptr);
+
+        if (endptr != parser->pos)
+        {
+            parser->pos = endptr;
+        }
+        else
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+__attribute__ ((__pure__))
+static results_json const * results_json_get(results_json const * const object,
+                                             char const * const key,
+                                             results_json_type const type)
+{
+    results_json const * result = NULL;
+
+    if (object->type == results_json_object)
+    {
+        for (size_t idx = 0;
+             result == NULL &&
+                 idx < object->nb_items;
+             idx++)
+        {
+            if (strcmp(object->keys[idx], key) == 0 &&
+                object->items[idx].type == type)
+            {
+                result = &(object->items[idx]);
+            }
+        }
+    }
+
+    return result;
+}
+
+static int results_read_file(char const * const path,
+                             char ** const content,
+                             size_t * const size)
+{
+    int result = 0;
+    FILE * fp = fopen(path, "r");
+
+    if (fp != NULL)
+    {
+        char * buffer = NULL;
+        size_t capacity = 0;
+        size_t used = 0;
+        size_t got = 0;
+
+        do
+        {
+            if (used + 1 >= capacity)
+            {
+                size_t const new_capacity = capacity > 0 ? capacity * 2 : 65536;
+                char * const new_buffer = realloc(buffer, new_capacity);
+
+                if (new_buffer != NULL)
+                {
+                    buffer = new_buffer;
+                    capacity = new_capacity;
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+
+            if (result == 0)
+            {
+                got = fread(buffer + used, 1, capacity - used - 1, fp);
+                used += got;
+            }
+        }
+        while (result == 0 &&
+               got > 0);
+
+        if (result == 0 &&
+            ferror(fp) != 0)
+        {
+            result = EIO;
+        }
+
+        if (result == 0)
+        {
+            buffer[used] = '\0';
+            *content = buffer;
+            *size = used;
+        }
+        else
+        {
+            free(buffer), buffer = NULL;
+        }
+
+        fclose(fp), fp = NULL;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static int results_from_json(mt_fs_tests_results * const results,
+                             results_json const * const root)
+{
+    int result = 0;
+    results_json const * const version = results_json_get(root, "version", results_json_number);
+    results_json const * const entries = results_json_get(root, "results", results_json_array);
+
+    if (version == NULL ||
+        (int) version->number != RESULTS_VERSION ||
+        entries == NULL)
+    {
+        result = EINVAL;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < entries->nb_items;
+         idx++)
+    {
+        results_json const * const entry = &(entries->items[idx]);
+        results_json const * const suite_name = results_json_get(entry, "suite", results_json_string);
+        results_json const * const config = results_json_get(entry, "config", results_json_string);
+        results_json const * const runs = results_json_get(entry, "runs", results_json_array);
+
+        if (suite_name == NULL ||
+            config == NULL ||
+            runs == NULL)
+        {
+            result = EINVAL;
+        }
+
+        for (size_t run_idx = 0;
+             result == 0 &&
+                 run_idx < runs->nb_items;
+             run_idx++)
+        {
+            results_json const * const item = &(runs->items[run_idx]);
+            results_json const * const ops = results_json_get(item, "ops", results_json_number);
+            results_json const * const failed = results_json_get(item, "failed", results_json_number);
+            results_json const * const seconds = results_json_get(item, "seconds", results_json_number);
+            results_json const * const ops_per_sec = results_json_get(item, "ops_per_sec", results_json_number);
+            results_json const * const p50_us = results_json_get(item, "p50_us", results_json_number);
+            results_json const * const p99_us = results_json_get(item, "p99_us", results_json_number);
+
+            if (ops != NULL &&
+                failed != NULL &&
+                seconds != NULL &&
+                ops_per_sec != NULL &&
+                p50_us != NULL &&
+                p99_us != NULL &&
+                ops->number >= 0.0 &&
+                failed->number >= 0.0)
+            {
+                results_run const run =
+                    {
+                        .ops_count = (uint64_t) ops->number,
+                        .errors_count = (uint64_t) failed->number,
+                        .seconds = seconds->number,
+                        .ops_per_sec = ops_per_sec->number,
+                        .p50_us = p50_us->number,
+                        .p99_us = p99_us->number
+                    };
+
+                result = results_add_run(results,
+                                         suite_name->string,
+                                         config->string,
+                                         &run);
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+    }
+
+    return result;
+}
+
+int mt_fs_tests_results_load(mt_fs_tests_results ** const results,
+                             char const * const path)
+{
+    int result = 0;
+    char * content = NULL;
+    size_t size = 0;
+    mt_fs_tests_results * result_results = NULL;
+    assert(results != NULL);
+    assert(path != NULL);
+
+    result = results_read_file(path,
+                               &content,
+                               &size);
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_results_init(&result_results);
+    }
+
+    if (result == 0)
+    {
+        results_json root;
+        results_json_parser parser =
+            {
+                .pos = content,
+                .end = content + size
+            };
+
+        memset(&root, 0, sizeof root);
+
+        result = results_json_parse_value(&parser,
+                                          &root,
+                                          0);
+
+        if (result == 0)
+        {
+            result = results_from_json(result_results,
+                                       &root);
+        }
+
+        if (result == EINVAL)
+        {
+            LOG_ERROR("Invalid results file %s, near offset %zu",
+                      path,
+                      (size_t) (parser.pos - content));
+        }
+
+        results_json_free(&root);
+    }
+
+    if (result == 0)
+    {
+        *results = result_results;
+    }
+    else
+    {
+        mt_fs_tests_results_free(result_results), result_results = NULL;
+    }
+
+    free(content), content = NULL;
+
+    return result;
+}
+
+/* Compares one metric of a suite, values being modified. */
+static int results_compare_metric(results_entry const * const entry,
+                                  char const * const metric,
+                                  double * const values,
+                                  size_t const nb_values,
+                                  double * const baseline_values,
+                                  size_t const nb_baseline_values,
+                                  bool const higher_is_better,
+                                  double const threshold,
+                                  bool * const regressed)
+{
+    int result = 0;
+    double p_value = 1.0;
+    bool const testable = mt_fs_tests_statistics_mann_whitney_min_p(nb_values, nb_baseline_values) < MT_FS_TESTS_RESULTS_SIGNIFICANCE;
+
+    /* Probability of the new values being at least this much worse by
+       chance. */
+    if (higher_is_better == true)
+    {
+        result = mt_fs_tests_statistics_mann_whitney(values,
+                                                     nb_values,
+                                                     baseline_values,
+                                                     nb_baseline_values,
+                                                     &p_value);
+    }
+    else
+    {
+        result = mt_fs_tests_statistics_mann_whitney(baseline_values,
+                                                     nb_baseline_values,
+                                                     values,
+                                                     nb_values,
+                                                     &p_value);
+    }
+
+    if (result == 0)
+    {
+        double const median = mt_fs_tests_statistics_median(values,
+                                                            nb_values);
+        double const baseline_median = mt_fs_tests_statistics_median(baseline_values,
+                                                                     nb_baseline_values);
+        double const change = baseline_median > 0.0 ? (median - baseline_median) / baseline_median * 100.0 : 0.0;
+        double const worsening = higher_is_better == true ? -change : change;
+
+        *regressed = worsening > threshold &&
+            (testable == false || p_value < MT_FS_TESTS_RESULTS_SIGNIFICANCE);
+
+        if (*regressed == true)
+        {
+            LOG_ERROR("%s (%s): %s median %.1f -> %.1f (%+.1f%%), p = %.4f, regression",
+                      entry->suite_name,
+                      entry->config,
+                      metric,
+                      baseline_median,
+                      median,
+                      change,
+                      p_value);
+        }
+        else
+        {
+            LOG_OK("%s (%s): %s median %.1f -> %.1f (%+.1f%%), p = %.4f",
+                   entry->suite_name,
+                   entry->config,
+                   metric,
+                   baseline_median,
+                   median,
+                   change,
+                   p_value);
+        }
+    }
+
+    return result;
+}
+
+static int results_compare_entry(results_entry const * const entry,
+                                 results_entry const * const baseline,
+                                 double const threshold,
+                                 bool * const regressed)
+{
+    int result = 0;
+    double * const values = malloc(sizeof *values * entry->nb_runs);
+    double * const baseline_values = malloc(sizeof *baseline_values * baseline->nb_runs);
+
+    *regressed = false;
+
+    if (values != NULL &&
+        baseline_values != NULL)
+    {
+        bool metric_regressed = false;
+
+        if (mt_fs_tests_statistics_mann_whitney_min_p(entry->nb_runs, baseline->nb_runs) >= MT_FS_TESTS_RESULTS_SIGNIFICANCE)
+        {
+            LOG_OK("%s (%s): %zu runs against %zu are too few for a significance test, only the threshold applies",
+                   entry->suite_name,
+                   entry->config,
+                   entry->nb_runs,
+                   baseline->nb_runs);
+        }
+
+        for (size_t idx = 0;
+             idx < entry->nb_runs;
+             idx++)
+        {
+            values[idx] = entry->runs[idx].ops_per_sec;
+        }
+
+        for (size_t idx = 0;
+             idx < baseline->nb_runs;
+             idx++)
+        {
+            baseline_values[idx] = baseline->runs[idx].ops_per_sec;
+        }
+
+        result = results_compare_metric(entry,
+                                        "ops/s",
+                                        values,
+                                        entry->nb_runs,
+                                        baseline_values,
+                                        baseline->nb_runs,
+                                        true,
+                                        threshold,
+                                        &metric_regressed);
+        *regressed = metric_regressed;
+
+        if (result == 0)
+        {
+            for (size_t idx = 0;
+                 idx < entry->nb_runs;
+                 idx++)
+            {
+                values[idx] = entry->runs[idx].p99_us;
+            }
+
+            for (size_t idx = 0;
+                 idx < baseline->nb_runs;
+                 idx++)
+            {
+                baseline_values[idx] = baseline->runs[idx].p99_us;
+            }
+
+            result = results_compare_metric(entry,
+                                            "p99 (us)",
+                                            values,
+                                            entry->nb_runs,
+                                            baseline_values,
+                                            baseline->nb_runs,
+                                            false,
+                                            threshold,
+                                            &metric_regressed);
+            *regressed = *regressed || metric_regressed;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    free(values);
+    free(baseline_values);
+
+    return result;
+}
+
+int mt_fs_tests_results_compare(mt_fs_tests_results const * const results,
+                                mt_fs_tests_results const * const baseline,
+                                double const threshold,
+                                size_t * const nb_regressions)
+{
+    int result = 0;
+    assert(results != NULL);
+    assert(baseline != NULL);
+    assert(nb_regressions != NULL);
+
+    *nb_regressions = 0;
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < results->nb_entries;
+         idx++)
+    {
+        results_entry const * const entry = &(results->entries[idx]);
+        results_entry const * const baseline_entry = results_find(baseline,
+                                                                  entry->suite_name,
+                                                                  entry->config);
+
+        if (baseline_entry != NULL)
+        {
+            bool regressed = false;
+
+            result = results_compare_entry(entry,
+                                           baseline_entry,
+                                           threshold,
+                                           &regressed);
+
+            if (regressed == true)
+            {
+                (*nb_regressions)++;
+            }
+        }
+        else
+        {
+            LOG_OK("%s (%s): not in the baseline",
+                   entry->suite_name,
+                   entry->config);
+        }
+    }
+
+    return result;
+}
+
+void mt_fs_tests_results_free(mt_fs_tests_results * const results)
+{
+    if (results != NULL)
+    {
+        for (size_t idx = 0;
+             idx < results->nb_entries;
+             idx++)
+        {
+            results_entry * const entry = &(results->entries[idx]);
+
+            free(entry->suite_name), entry->suite_name = NULL;
+            free(entry->config), entry->config = NULL;
+            free(entry->runs), entry->runs = NULL;
+        }
+
+        free(results->entries), results->entries = NULL;
+        free(results);
+    }
+}
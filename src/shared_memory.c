@@ -0,0 +1,47 @@
+
+#include <assert.h>
+#include <stdint.h>
+#include <sys/mman.h>
+
+#include "shared_memory.h"
+
+/* The mapping size is stored in front of the returned pointer, keeping it
+   aligned on a cache line. */
+#define SHARED_MEMORY_HEADER_SIZE (64)
+
+void * mt_fs_tests_shared_calloc(size_t const nmemb,
+                                 size_t const size)
+{
+    void * result = NULL;
+
+    if (size == 0 ||
+        nmemb <= (SIZE_MAX - SHARED_MEMORY_HEADER_SIZE) / size)
+    {
+        size_t const mapping_size = SHARED_MEMORY_HEADER_SIZE + nmemb * size;
+        void * const mapping = mmap(NULL,
+                                    mapping_size,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_ANONYMOUS,
+                                    -1,
+                                    0);
+
+        if (mapping != MAP_FAILED)
+        {
+            *((size_t *) mapping) = mapping_size;
+            result = (char *) mapping + SHARED_MEMORY_HEADER_SIZE;
+        }
+    }
+
+    return result;
+}
+
+void mt_fs_tests_shared_free(void * const ptr)
+{
+    if (ptr != NULL)
+    {
+        void * const mapping = (char *) ptr - SHARED_MEMORY_HEADER_SIZE;
+
+        munmap(mapping,
+               *((size_t *) mapping));
+    }
+}
@@ -0,0 +1,301 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#include "stacks.h"
+#include "utils.h"
+
+/* Stacks whose high-water mark goes above this share of their size are
+   reported, a slightly different run could overflow them. */
+#define STACKS_WARNING_PERCENT (75)
+/* Mappings of the process other than worker stacks. */
+#define STACKS_OTHER_MAPPINGS (1024)
+
+struct mt_fs_tests_stacks
+{
+    char * mapping;
+    size_t mapping_size;
+    size_t page_size;
+    /* Guard page excluded. */
+    size_t stack_size;
+    size_t nb_stacks;
+};
+
+static uint64_t mt_fs_tests_stacks_read_limit(char const * const path)
+{
+    unsigned long long result = 0;
+    FILE * fp = fopen(path, "r");
+
+    if (fp != NULL)
+    {
+        if (fscanf(fp, "%llu", &result) != 1)
+        {
+            result = 0;
+        }
+
+        fclose(fp), fp = NULL;
+    }
+
+    return (uint64_t) result;
+}
+
+void mt_fs_tests_stacks_check_limits(size_t const nb_threads)
+{
+    /* Each stack takes two mappings, itself and its guard page. */
+    uint64_t const needed_maps = (uint64_t) nb_threads * 2 + STACKS_OTHER_MAPPINGS;
+    uint64_t const max_map_count = mt_fs_tests_stacks_read_limit("/proc/sys/vm/max_map_count");
+    uint64_t const threads_max = mt_fs_tests_stacks_read_limit("/proc/sys/kernel/threads-max");
+    uint64_t const pid_max = mt_fs_tests_stacks_read_limit("/proc/sys/kernel/pid_max");
+    struct rlimit nproc;
+
+    if (max_map_count > 0 &&
+        needed_maps > max_map_count)
+    {
+        LOG_ERROR("Warning, %zu threads need about %llu memory mappings, above vm.max_map_count (%llu)",
+                  nb_threads,
+                  (unsigned long long) needed_maps,
+                  (unsigned long long) max_map_count);
+    }
+
+    if (threads_max > 0 &&
+        nb_threads > threads_max)
+    {
+        LOG_ERROR("Warning, %zu threads are above kernel.threads-max (%llu)",
+                  nb_threads,
+                  (unsigned long long) threads_max);
+    }
+
+    if (pid_max > 0 &&
+        nb_threads > pid_max)
+    {
+        LOG_ERROR("Warning, %zu threads are above kernel.pid_max (%llu)",
+                  nb_threads,
+                  (unsigned long long) pid_max);
+    }
+
+    /* Privileged users are not limited. */
+    if (geteuid() != 0 &&
+        getrlimit(RLIMIT_NPROC, &nproc) == 0 &&
+        nproc.rlim_cur != RLIM_INFINITY &&
+        nb_threads > nproc.rlim_cur)
+    {
+        LOG_ERROR("Warning, %zu threads are above the limit of processes of the user (%llu)",
+                  nb_threads,
+                  (unsigned long long) nproc.rlim_cur);
+    }
+}
+
+int mt_fs_tests_stacks_init(mt_fs_tests_stacks ** const stacks,
+                            size_t const nb_stacks,
+                            size_t const stack_size)
+{
+    int result = 0;
+    long const page_size = sysconf(_SC_PAGESIZE);
+    mt_fs_tests_stacks * result_stacks = NULL;
+    assert(stacks != NULL);
+    assert(nb_stacks > 0);
+    assert(page_size > 0);
+
+    result_stacks = calloc(1, sizeof *result_stacks);
+
+    if (result_stacks != NULL)
+    {
+        /* A sysconf() call on recent glibc versions. */
+        long const stack_min = PTHREAD_STACK_MIN;
+        size_t const minimum = stack_size > (size_t) stack_min ? stack_size : (size_t) stack_min;
+
+        result_stacks->page_size = (size_t) page_size;
+        result_stacks->stack_size = (minimum + result_stacks->page_size - 1) / result_stacks->page_size * result_stacks->page_size;
+        result_stacks->nb_stacks = nb_stacks;
+
+        if (nb_stacks <= SIZE_MAX / (result_stacks->stack_size + result_stacks->page_size))
+        {
+            result_stacks->mapping_size = nb_stacks * (result_stacks->stack_size + result_stacks->page_size);
+            /* Only touched pages use memory, do not reserve the rest. */
+            result_stacks->mapping = mmap(NULL,
+                                          result_stacks->mapping_size,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_STACK,
+                                          -1,
+                                          0);
+
+            if (result_stacks->mapping == MAP_FAILED)
+            {
+                result = errno;
+                result_stacks->mapping = NULL;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+
+        if (result == 0)
+        {
+            /* A huge page would make a whole stack resident at once, and
+               the high-water mark meaningless. */
+            madvise(result_stacks->mapping,
+                    result_stacks->mapping_size,
+                    MADV_NOHUGEPAGE);
+        }
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < nb_stacks;
+             idx++)
+        {
+            char * const guard = result_stacks->mapping + idx * (result_stacks->stack_size + result_stacks->page_size);
+
+            if (mprotect(guard,
+                         result_stacks->page_size,
+                         PROT_NONE) != 0)
+            {
+                result = errno;
+            }
+        }
+
+        if (result == 0)
+        {
+            *stacks = result_stacks;
+        }
+        else
+        {
+            LOG_ERROR("Error allocating %zu stacks of %zu bytes: %d",
+                      nb_stacks,
+                      result_stacks->stack_size,
+                      result);
+            mt_fs_tests_stacks_free(result_stacks), result_stacks = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static char * mt_fs_tests_stacks_get(mt_fs_tests_stacks const * const stacks,
+                                     size_t const idx)
+{
+    return stacks->mapping + idx * (stacks->stack_size + stacks->page_size) + stacks->page_size;
+}
+
+int mt_fs_tests_stacks_attr_init(mt_fs_tests_stacks const * const stacks,
+                                 size_t const idx,
+                                 pthread_attr_t * const attr)
+{
+    int result = 0;
+    assert(stacks != NULL);
+    assert(idx < stacks->nb_stacks);
+    assert(attr != NULL);
+
+    result = pthread_attr_init(attr);
+
+    if (result == 0)
+    {
+        result = pthread_attr_setstack(attr,
+                                       mt_fs_tests_stacks_get(stacks, idx),
+                                       stacks->stack_size);
+
+        if (result != 0)
+        {
+            pthread_attr_destroy(attr);
+        }
+    }
+
+    return result;
+}
+
+void mt_fs_tests_stacks_report(mt_fs_tests_stacks const * const stacks,
+                               char const * const suite_name,
+                               size_t const framework_size)
+{
+    size_t nb_pages = 0;
+    unsigned char * resident = NULL;
+    assert(stacks != NULL);
+    assert(suite_name != NULL);
+
+    nb_pages = stacks->stack_size / stacks->page_size;
+    resident = malloc(nb_pages);
+
+    if (resident != NULL)
+    {
+        uint64_t total_used = 0;
+        size_t max_used = 0;
+        size_t max_idx = 0;
+
+        for (size_t idx = 0;
+             idx < stacks->nb_stacks;
+             idx++)
+        {
+            size_t used = 0;
+
+            if (mincore(mt_fs_tests_stacks_get(stacks, idx),
+                        stacks->stack_size,
+                        resident) == 0)
+            {
+                /* Stacks grow down, from the end of the mapping. */
+                for (size_t page = 0;
+                     used == 0 &&
+                         page < nb_pages;
+                     page++)
+                {
+                    if ((resident[page] & 1) != 0)
+                    {
+                        used = (nb_pages - page) * stacks->page_size;
+                    }
+                }
+            }
+
+            total_used += used;
+
+            if (used > max_used)
+            {
+                max_used = used;
+                max_idx = idx;
+            }
+        }
+
+        LOG_OK("%s: %zu KiB of stack per thread, high-water %.1f KiB on average and %zu KiB at most, %.1f KiB of framework data per thread",
+               suite_name,
+               stacks->stack_size / 1024,
+               (double) total_used / (double) stacks->nb_stacks / 1024.0,
+               max_used / 1024,
+               (double) framework_size / 1024.0);
+
+        if (max_used * 100 > stacks->stack_size * STACKS_WARNING_PERCENT)
+        {
+            LOG_ERROR("Warning, thread %zu of suite %s used %zu of its %zu KiB of stack, raise it with --stack-size",
+                      max_idx,
+                      suite_name,
+                      max_used / 1024,
+                      stacks->stack_size / 1024);
+        }
+
+        free(resident), resident = NULL;
+    }
+}
+
+void mt_fs_tests_stacks_free(mt_fs_tests_stacks * const stacks)
+{
+    if (stacks != NULL)
+    {
+        if (stacks->mapping != NULL)
+        {
+            munmap(stacks->mapping,
+                   stacks->mapping_size);
+            stacks->mapping = NULL;
+        }
+
+        free(stacks);
+    }
+}
@@ -0,0 +1,258 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdlib.h>
+
+#include "statistics.h"
+
+typedef struct
+{
+    double value;
+    bool from_a;
+} statistics_observation;
+
+static int statistics_compare_doubles(void const * const first,
+                                      void const * const second)
+{
+    double const a = *((double const *) first);
+    double const b = *((double const *) second);
+
+    return (a > b) - (a < b);
+}
+
+static int statistics_compare_observations(void const * const first,
+                                           void const * const second)
+{
+    return statistics_compare_doubles(&(((statistics_observation const *) first)->value),
+                                      &(((statistics_observation const *) second)->value));
+}
+
+double mt_fs_tests_statistics_median(double * const values,
+                                     size_t const nb_values)
+{
+    double result = 0.0;
+    assert(values != NULL || nb_values == 0);
+
+    if (nb_values > 0)
+    {
+        qsort(values,
+              nb_values,
+              sizeof *values,
+              &statistics_compare_doubles);
+
+        result = nb_values % 2 == 1 ?
+            values[nb_values / 2] :
+            (values[nb_values / 2 - 1] + values[nb_values / 2]) / 2.0;
+    }
+
+    return result;
+}
+
+/* Probability of U being at most u, from the number of arrangements of the
+   two samples giving each value of U: the coefficients of the Gaussian
+   binomial coefficient [nb_a + nb_b, nb_a], computed as the product for i
+   from 1 to nb_a of (1 - q^(nb_b + i)) / (1 - q^i). */
+static int statistics_mann_whitney_exact(size_t const nb_a,
+                                         size_t const nb_b,
+                                         double const u,
+                                         double * const p_value)
+{
+    int result = 0;
+    /* Room for the degree of the products before their division. */
+    size_t const size = nb_a * nb_b + nb_a + nb_b + 1;
+    double * const counts = calloc(size, sizeof *counts);
+
+    if (counts != NULL)
+    {
+        size_t degree = 0;
+        double total = 0.0;
+        double below = 0.0;
+
+        counts[0] = 1.0;
+
+        for (size_t idx = 1;
+             idx <= nb_a;
+             idx++)
+        {
+            size_t const factor = nb_b + idx;
+
+            degree += factor;
+            assert(degree < size);
+
+            for (size_t k = degree;
+                 k >= factor;
+                 k--)
+            {
+                counts[k] -= counts[k - factor];
+            }
+
+            for (size_t k = idx;
+                 k <= degree;
+                 k++)
+            {
+                counts[k] += counts[k - idx];
+            }
+
+            degree -= idx;
+        }
+
+        for (size_t k = 0;
+             k <= degree;
+             k++)
+        {
+            total += counts[k];
+
+            if ((double) k <= u)
+            {
+                below += counts[k];
+            }
+        }
+
+        *p_value = below / total;
+
+        free(counts);
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+int mt_fs_tests_statistics_mann_whitney(double const * const a,
+                                        size_t const nb_a,
+                                        double const * const b,
+                                        size_t const nb_b,
+                                        double * const p_value)
+{
+    int result = 0;
+    size_t const total = nb_a + nb_b;
+    statistics_observation * observations = NULL;
+    assert(p_value != NULL);
+
+    if (nb_a == 0 ||
+        nb_b == 0 ||
+        a == NULL ||
+        b == NULL)
+    {
+        result = EINVAL;
+    }
+    else
+    {
+        observations = malloc(sizeof *observations * total);
+
+        if (observations == NULL)
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if (result == 0)
+    {
+        double rank_sum_a = 0.0;
+        /* Sum of t^3 - t over groups of t tied values. */
+        double ties = 0.0;
+        double u = 0.0;
+
+        for (size_t idx = 0;
+             idx < total;
+             idx++)
+        {
+            observations[idx].from_a = idx < nb_a;
+            observations[idx].value = idx < nb_a ? a[idx] : b[idx - nb_a];
+        }
+
+        qsort(observations,
+              total,
+              sizeof *observations,
+              &statistics_compare_observations);
+
+        for (size_t start = 0;
+             start < total;)
+        {
+            size_t end = start + 1;
+            double rank = 0.0;
+
+            while (end < total &&
+                   statistics_compare_doubles(&(observations[end].value), &(observations[start].value)) == 0)
+            {
+                end++;
+            }
+
+            /* Ranks start at 1, tied values get the average of theirs. */
+            rank = (double) (start + 1 + end) / 2.0;
+
+            for (size_t idx = start;
+                 idx < end;
+                 idx++)
+            {
+                if (observations[idx].from_a == true)
+                {
+                    rank_sum_a += rank;
+                }
+            }
+
+            if (end - start > 1)
+            {
+                double const group = (double) (end - start);
+                ties += group * group * group - group;
+            }
+
+            start = end;
+        }
+
+        u = rank_sum_a - (double) nb_a * (double) (nb_a + 1) / 2.0;
+
+        if (ties <= 0.0 &&
+            nb_a <= MT_FS_TESTS_STATISTICS_EXACT_MAX &&
+            nb_b <= MT_FS_TESTS_STATISTICS_EXACT_MAX)
+        {
+            result = statistics_mann_whitney_exact(nb_a,
+                                                   nb_b,
+                                                   u,
+                                                   p_value);
+        }
+        else
+        {
+            double const n = (double) total;
+            double const mean = (double) nb_a * (double) nb_b / 2.0;
+            double const variance = (double) nb_a * (double) nb_b / 12.0 * ((n + 1.0) - ties / (n * (n - 1.0)));
+
+            if (variance > 0.0)
+            {
+                /* With continuity correction. */
+                double const z = (u + 0.5 - mean) / sqrt(variance);
+
+                *p_value = 0.5 * erfc(-z / M_SQRT2);
+            }
+            else
+            {
+                /* All values are equal. */
+                *p_value = 1.0;
+            }
+        }
+
+        free(observations), observations = NULL;
+    }
+
+    return result;
+}
+
+double mt_fs_tests_statistics_mann_whitney_min_p(size_t const nb_a,
+                                                 size_t const nb_b)
+{
+    double arrangements = 1.0;
+
+    /* C(nb_a + nb_b, nb_a), all arrangements being equally likely. */
+    for (size_t idx = 1;
+         idx <= nb_a;
+         idx++)
+    {
+        arrangements = arrangements * (double) (nb_b + idx) / (double) idx;
+    }
+
+    return 1.0 / arrangements;
+}
@@ -1,27 +1,83 @@
+#define _GNU_SOURCE
 
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "cold_cache.h"
+#include "distributions.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "shared_memory.h"
 #include "test_suites.h"
 #include "utils.h"
+#include "verify.h"
 
 #define FILENAME_TEMPLATE "bonnie64_suite_XXXXXX"
 #define FILE_SIZE ((size_t) 8 * 1024 * 1024) /* 8 MB */
 #define BUFFER_SIZE (16384)
 #define ITERATIONS (4000)
 #define UPDATE_EVERY_N_SEEKS (10)
-
+#define PATTERN ('X')
+#define CHUNK_CRC_SIZE (sizeof (uint32_t))
+
+/* Option bonnie64_mt.verifiers=<count>: the first <count> threads verify
+   random chunks instead of updating them, while updaters write chunks ending
+   with the CRC32C of their content. Reads are not atomic with regard to
+   concurrent writes, a verifier could see part of two versions of a chunk,
+   so in this mode chunks are locked while being verified or updated.
+   Chunks are chosen according to the bonnie64_mt.distribution options, see
+   distributions.h. */
 typedef struct {
+    mt_fs_tests_distribution distribution;
     char * filename;
-    int * results;
+    /* BUFFER_SIZE bytes for the single-threaded phases, on the heap rather
+       than on the stack of small-stack workers or in static storage. */
+    uint8_t * buffer;
+    /* Results of the threads, one per thread. */
+    mt_fs_tests_outcomes * outcomes;
     size_t nb_threads;
+    uint64_t nb_verifiers;
 } bonnie64_mt_data;
 
+/* A valid chunk is either still filled with the initial pattern, or has
+   been written by an updater in verification mode. */
+static bool bonnie64_mt_chunk_is_valid(uint8_t const * const chunk,
+                                       size_t const size)
+{
+    bool valid = mt_fs_tests_verify_pattern(chunk, size, PATTERN) == size;
+
+    if (valid == false &&
+        size > CHUNK_CRC_SIZE)
+    {
+        uint32_t stored = 0;
+        memcpy(&stored, chunk + size - CHUNK_CRC_SIZE, sizeof stored);
+
+        valid = mt_fs_tests_crc32c(0, chunk, size - CHUNK_CRC_SIZE) == stored;
+    }
+
+    return valid;
+}
+
+static void bonnie64_mt_fill_chunk(uint8_t * const chunk,
+                                   size_t const size,
+                                   uint8_t const value)
+{
+    uint32_t crc = 0;
+    assert(size > CHUNK_CRC_SIZE);
+
+    memset(chunk, value, size - CHUNK_CRC_SIZE);
+    crc = mt_fs_tests_crc32c(0, chunk, size - CHUNK_CRC_SIZE);
+    memcpy(chunk + size - CHUNK_CRC_SIZE, &crc, sizeof crc);
+}
+
 static int bonnie64_mt_write_one_byte_at_a_time(char const * const filename)
 {
     assert(filename != NULL);
@@ -79,7 +135,8 @@ static int bonnie64_mt_write_one_byte_at_a_time(char const * const filename)
     return result;
 }
 
-static int bonnie64_mt_rewrite_chunks(char const * const filename)
+static int bonnie64_mt_rewrite_chunks(char const * const filename,
+                                       uint8_t * const buffer)
 {
     assert(filename != NULL);
     int result = 0;
@@ -97,8 +154,7 @@ static int bonnie64_mt_rewrite_chunks(char const * const filename)
 
             do
             {
-                static char buffer[BUFFER_SIZE];
-                static size_t const buffer_size = sizeof buffer;
+                size_t const buffer_size = BUFFER_SIZE;
 
                 got = read(fd,
                            buffer,
@@ -106,7 +162,7 @@ static int bonnie64_mt_rewrite_chunks(char const * const filename)
 
                 if (got > 0)
                 {
-                    buffer[got -1] ^= 'J';
+                    buffer[got - 1] = (uint8_t) (buffer[got - 1] ^ 'J');
 
                     pos = lseek(fd, -got, SEEK_CUR);
 
@@ -169,7 +225,8 @@ static int bonnie64_mt_rewrite_chunks(char const * const filename)
     return result;
 }
 
-static int bonnie64_mt_write_chunks(char const * const filename)
+static int bonnie64_mt_write_chunks(char const * const filename,
+                                     uint8_t * const buffer)
 {
     assert(filename != NULL);
     int result = 0;
@@ -181,8 +238,7 @@ static int bonnie64_mt_write_chunks(char const * const filename)
 
         if (pos != -1)
         {
-            static char buffer[BUFFER_SIZE];
-            static size_t const buffer_size = sizeof buffer;
+            size_t const buffer_size = BUFFER_SIZE;
             size_t to_write = FILE_SIZE;
 
             result = 0;
@@ -238,7 +294,8 @@ static int bonnie64_mt_write_chunks(char const * const filename)
     return result;
 }
 
-static int bonnie64_mt_read_one_byte_at_a_time(char const * const filename)
+static int bonnie64_mt_read_one_byte_at_a_time(char const * const filename,
+                                                uint8_t * const buffer)
 {
     assert(filename != NULL);
     int result = 0;
@@ -250,6 +307,10 @@ static int bonnie64_mt_read_one_byte_at_a_time(char const * const filename)
 
         if (fp != NULL)
         {
+            /* Bytes are verified a chunk at a time rather than one by one. */
+            uint8_t * const chunk = buffer;
+            size_t filled = 0;
+
             for (size_t idx = 0;
                  idx < FILE_SIZE &&
                      result == 0;
@@ -257,21 +318,36 @@ static int bonnie64_mt_read_one_byte_at_a_time(char const * const filename)
             {
                 int const value = getc(fp);
 
-                if (!ferror(fp))
+                if (value != EOF)
                 {
-                    if (value != 'X')
+                    chunk[filled] = (uint8_t) value;
+                    filled++;
+
+                    if (filled == BUFFER_SIZE ||
+                        idx + 1 == FILE_SIZE)
                     {
-                        LOG_ERROR("Error, expected %c, got %d",
-                                  'X',
-                                  value);
-                        result = EIO;
+                        size_t const mismatch = mt_fs_tests_verify_pattern(chunk,
+                                                                           filled,
+                                                                           PATTERN);
+
+                        if (mismatch != filled)
+                        {
+                            LOG_ERROR("Error, expected %c at offset %zu, got %d",
+                                      PATTERN,
+                                      idx + 1 - filled + mismatch,
+                                      chunk[mismatch]);
+                            result = EIO;
+                        }
+
+                        filled = 0;
                     }
                 }
                 else
                 {
                     result = EIO;
-                    LOG_ERROR("Error writing to file: %d",
-                              errno);
+                    LOG_ERROR("Error reading from file at offset %zu: %d",
+                              idx,
+                              ferror(fp) ? errno : 0);
                 }
             }
 
@@ -299,7 +375,8 @@ static int bonnie64_mt_read_one_byte_at_a_time(char const * const filename)
     return result;
 }
 
-static int bonnie64_mt_read_chunks(char const * const filename)
+static int bonnie64_mt_read_chunks(char const * const filename,
+                                    uint8_t * const buffer)
 {
     assert(filename != NULL);
     int result = 0;
@@ -311,9 +388,11 @@ static int bonnie64_mt_read_chunks(char const * const filename)
 
         if (pos != -1)
         {
-            static char buffer[BUFFER_SIZE];
-            static size_t buffer_size = sizeof buffer;
+            size_t const buffer_size = BUFFER_SIZE;
             ssize_t got = 0;
+            size_t total = 0;
+            uint32_t crc = 0;
+            uint64_t const start_ns = mt_fs_tests_now_ns();
 
             result = 0;
 
@@ -323,16 +402,58 @@ static int bonnie64_mt_read_chunks(char const * const filename)
                            buffer,
                            buffer_size);
 
-                if (got < 0)
+                if (got > 0)
+                {
+                    size_t const mismatch = mt_fs_tests_verify_pattern(buffer,
+                                                                       (size_t) got,
+                                                                       PATTERN);
+
+                    if (mismatch == (size_t) got)
+                    {
+                        crc = mt_fs_tests_crc32c(crc,
+                                                 buffer,
+                                                 (size_t) got);
+                        total += (size_t) got;
+                    }
+                    else
+                    {
+                        result = EIO;
+                        LOG_ERROR("Error, expected %c at offset %zu, got %d",
+                                  PATTERN,
+                                  total + mismatch,
+                                  buffer[mismatch]);
+                    }
+                }
+                else if (got < 0)
                 {
                     result = errno;
-                    LOG_ERROR("Error writing %zu to file: %d",
-                              got,
+                    LOG_ERROR("Error reading from file: %d",
                               result);
                 }
             }
             while (result == 0 &&
                    got > 0);
+
+            if (result == 0)
+            {
+                uint64_t const elapsed_ns = mt_fs_tests_now_ns() - start_ns;
+
+                if (total == FILE_SIZE)
+                {
+                    LOG_DEBUG("Verified %zu bytes, CRC32C %08x, in %.3f ms (%s)",
+                              total,
+                              crc,
+                              (double) elapsed_ns / 1000000.0,
+                              mt_fs_tests_verify_implementation());
+                }
+                else
+                {
+                    result = EIO;
+                    LOG_ERROR("Error, expected %zu bytes, got %zu",
+                              FILE_SIZE,
+                              total);
+                }
+            }
         }
         else
         {
@@ -360,59 +481,90 @@ static int bonnie64_mt_read_chunks(char const * const filename)
 static int bonnie64_mt_init(void ** test_suite_data,
                             size_t const nb_threads)
 {
-    int result = 0;
+    uint64_t nb_verifiers = 0;
+    mt_fs_tests_distribution distribution;
+    int result = mt_fs_tests_option_get_uint64("bonnie64_mt.verifiers",
+                                               0,
+                                               &nb_verifiers);
     assert(test_suite_data != NULL);
-    bonnie64_mt_data * data = malloc(sizeof *data);
 
-    if (data != NULL)
+    if (result == 0)
     {
-        data->results = malloc(sizeof *(data->results) * nb_threads);
+        result = mt_fs_tests_distribution_from_options("bonnie64_mt",
+                                                       FILE_SIZE / BUFFER_SIZE,
+                                                       &distribution);
 
-        if (data->results != NULL)
+        if (result == 0)
         {
-            for (size_t idx = 0;
-                 idx < nb_threads;
-                 idx++)
-            {
-                data->results[idx] = -1;
-            }
+            LOG_DEBUG("Chunks chosen following a %s distribution",
+                      mt_fs_tests_distribution_name(&distribution));
+        }
+    }
 
+    bonnie64_mt_data * data = result == 0 ? malloc(sizeof *data) : NULL;
+
+    if (data != NULL)
+    {
+        data->outcomes = mt_fs_tests_shared_calloc(1,
+                                                   sizeof *(data->outcomes));
+
+        if (data->outcomes != NULL)
+        {
             data->nb_threads = nb_threads;
+            data->nb_verifiers = nb_verifiers;
+            data->distribution = distribution;
 
             data->filename = strdup(FILENAME_TEMPLATE);
+            data->buffer = malloc(BUFFER_SIZE);
 
-            if (data->filename != NULL)
+            if (data->filename != NULL &&
+                data->buffer != NULL)
             {
                 int fd = mkstemp(data->filename);
 
                 if (fd != -1)
                 {
-                    LOG_DEBUG("Writing one byte at a time..");
-                    result = bonnie64_mt_write_one_byte_at_a_time(data->filename);
+                    result = mt_fs_tests_cold_cache_track(data->filename);
+
+                    if (result == 0)
+                    {
+                        LOG_DEBUG("Writing one byte at a time..");
+                        result = bonnie64_mt_write_one_byte_at_a_time(data->filename);
+                    }
 
+                    /* In cold-cache mode, each phase starts with cold caches,
+                       as it would with separate bonnie runs. */
                     if (result == 0)
                     {
+                        mt_fs_tests_cold_cache_evict();
                         LOG_DEBUG("Reading and rewriting chunks..");
-                        result = bonnie64_mt_rewrite_chunks(data->filename);
+                        result = bonnie64_mt_rewrite_chunks(data->filename,
+                                                            data->buffer);
+                    }
 
-                        if (result == 0)
-                        {
-                            LOG_DEBUG("Writing over chunks..");
-                            result = bonnie64_mt_write_chunks(data->filename);
+                    if (result == 0)
+                    {
+                        mt_fs_tests_cold_cache_evict();
+                        LOG_DEBUG("Writing over chunks..");
+                        result = bonnie64_mt_write_chunks(data->filename,
+                                                          data->buffer);
+                    }
 
-                            if (result == 0)
-                            {
-                                LOG_DEBUG("Writing a byte at a time..");
-                                result = bonnie64_mt_read_one_byte_at_a_time(data->filename);
+                    if (result == 0)
+                    {
+                        mt_fs_tests_cold_cache_evict();
+                        LOG_DEBUG("Reading a byte at a time..");
+                        result = bonnie64_mt_read_one_byte_at_a_time(data->filename,
+                                                                     data->buffer);
+                    }
 
-                                if (result == 0)
-                                {
-                                    LOG_DEBUG("Reading chunks..");
-                                    result = bonnie64_mt_read_chunks(data->filename);
-                                    LOG_DEBUG("Init done.");
-                                }
-                            }
-                        }
+                    if (result == 0)
+                    {
+                        mt_fs_tests_cold_cache_evict();
+                        LOG_DEBUG("Reading chunks..");
+                        result = bonnie64_mt_read_chunks(data->filename,
+                                                         data->buffer);
+                        LOG_DEBUG("Init done.");
                     }
 
                     close(fd), fd = -1;
@@ -424,6 +576,8 @@ static int bonnie64_mt_init(void ** test_suite_data,
 
                 if (result != 0)
                 {
+                    mt_fs_tests_cold_cache_untrack(data->filename);
+                    unlink(data->filename);
                     free(data->filename), data->filename = NULL;
                 }
             }
@@ -434,7 +588,9 @@ static int bonnie64_mt_init(void ** test_suite_data,
 
             if (result != 0)
             {
-                free(data->results), data->results = NULL;
+                free(data->filename), data->filename = NULL;
+                free(data->buffer), data->buffer = NULL;
+                mt_fs_tests_shared_free(data->outcomes), data->outcomes = NULL;
             }
         }
         else
@@ -451,7 +607,7 @@ static int bonnie64_mt_init(void ** test_suite_data,
             free(data), data = NULL;
         }
     }
-    else
+    else if (result == 0)
     {
         result = ENOMEM;
     }
@@ -459,6 +615,77 @@ static int bonnie64_mt_init(void ** test_suite_data,
     return result;
 }
 
+static int bonnie64_mt_lock_chunk(int const fd,
+                                  off_t const pos,
+                                  size_t const size,
+                                  short const type)
+{
+    int result = 0;
+    /* Open file description locks, as each thread or process opens the file
+       on its own. */
+    struct flock lock =
+        {
+            .l_type = type,
+            .l_whence = SEEK_SET,
+            .l_start = pos,
+            .l_len = (off_t) size
+        };
+
+    if (fcntl(fd, F_OFD_SETLKW, &lock) != 0)
+    {
+        result = errno;
+        LOG_ERROR("Error locking chunk at %lld: %d",
+                  (long long int) pos,
+                  result);
+    }
+
+    return result;
+}
+
+static int bonnie64_mt_verify_chunk(int const fd,
+                                    off_t const pos,
+                                    uint8_t * const buffer,
+                                    size_t const size)
+{
+    int result = bonnie64_mt_lock_chunk(fd,
+                                        pos,
+                                        size,
+                                        F_RDLCK);
+
+    if (result == 0)
+    {
+        ssize_t const got = pread(fd,
+                                  buffer,
+                                  size,
+                                  pos);
+
+        if (got > 0)
+        {
+            if (bonnie64_mt_chunk_is_valid(buffer,
+                                           (size_t) got) == false)
+            {
+                result = EIO;
+                LOG_ERROR("Error, corrupted chunk at %lld",
+                          (long long int) pos);
+            }
+        }
+        else
+        {
+            result = got == 0 ? EIO : errno;
+            LOG_ERROR("Error reading from %lld: %d",
+                      (long long int) pos,
+                      result);
+        }
+
+        bonnie64_mt_lock_chunk(fd,
+                               pos,
+                               size,
+                               F_UNLCK);
+    }
+
+    return result;
+}
+
 static int bonnie64_mt_run(void * const test_suite_data,
                               size_t const id)
 {
@@ -468,90 +695,157 @@ static int bonnie64_mt_run(void * const test_suite_data,
 
     assert(data != NULL);
     assert(data->filename != NULL);
-    assert(data->results[id] == -1);
 
     fd = open(data->filename,
               O_RDWR);
 
     if (fd != -1)
     {
-        static char buffer[BUFFER_SIZE];
-        static size_t buffer_size = sizeof buffer;
-        size_t const nb_chunks = FILE_SIZE / buffer_size;
+        size_t const buffer_size = BUFFER_SIZE;
+        bool const verifier = id < data->nb_verifiers;
+        /* Not shared with other threads, whose reads would overwrite the
+           content being verified or written back. */
+        uint8_t * const buffer = malloc(buffer_size);
+        mt_fs_tests_sampler sampler;
+
+        if (buffer == NULL)
+        {
+            result = ENOMEM;
+        }
 
-        srandom((unsigned int) id);
+        mt_fs_tests_sampler_init(&sampler,
+                                 &(data->distribution),
+                                 id,
+                                 data->nb_threads);
 
         for (size_t idx = 0;
              result == 0 &&
                  idx < ITERATIONS;
              idx++)
         {
-            off_t const pos = (off_t) (random() % (unsigned int) nb_chunks);
+            off_t const pos = (off_t) (mt_fs_tests_sampler_next(&sampler) * buffer_size);
+            bool const update = verifier == false && idx % UPDATE_EVERY_N_SEEKS == 0;
+            mt_fs_tests_op op;
 
-            off_t res = lseek(fd,
-                              pos,
-                              SEEK_SET);
+            mt_fs_tests_op_begin(&op,
+                                 verifier == true ? "verify_read" : update == true ? "seek_read_write" : "seek_read");
 
-            if (res != -1)
+            if (verifier == true)
             {
-                ssize_t got = read(fd,
-                                   buffer,
-                                   buffer_size);
+                result = bonnie64_mt_verify_chunk(fd,
+                                                  pos,
+                                                  buffer,
+                                                  buffer_size);
+            }
+            else
+            {
+                bool const locked = update == true && data->nb_verifiers > 0;
 
-                if (got > 0)
+                if (locked == true)
                 {
-                    if (idx % UPDATE_EVERY_N_SEEKS == 0)
-                    {
-                        buffer[got - 1] ^= 'Z';
+                    result = bonnie64_mt_lock_chunk(fd,
+                                                    pos,
+                                                    buffer_size,
+                                                    F_WRLCK);
+                }
 
-                        res = lseek(fd,
-                                    pos,
-                                    SEEK_SET);
+                if (result == 0)
+                {
+                    off_t res = lseek(fd,
+                                      pos,
+                                      SEEK_SET);
 
-                        if (res != -1)
+                    if (res != -1)
+                    {
+                        ssize_t got = read(fd,
+                                           buffer,
+                                           buffer_size);
+
+                        if (got > 0)
                         {
-                            ssize_t const written = write(fd,
-                                                          buffer,
-                                                          buffer_size);
+                            mt_fs_tests_op_add_bytes((uint64_t) got);
 
-                            if (written > 0)
+                            if (update == true)
                             {
-                                result = 0;
-                            }
-                            else
-                            {
-                                result = errno;
-                                LOG_ERROR("Error writing to file: %d",
-                                          result);
+                                if (data->nb_verifiers > 0)
+                                {
+                                    bonnie64_mt_fill_chunk(buffer,
+                                                           buffer_size,
+                                                           (uint8_t) ('a' + (id + idx) % 26));
+                                }
+                                else
+                                {
+                                    buffer[got - 1] ^= 'Z';
+                                }
+
+                                res = lseek(fd,
+                                            pos,
+                                            SEEK_SET);
+
+                                if (res != -1)
+                                {
+                                    ssize_t const written = write(fd,
+                                                                  buffer,
+                                                                  buffer_size);
+
+                                    if (written > 0)
+                                    {
+                                        mt_fs_tests_op_add_bytes((uint64_t) written);
+                                        result = 0;
+                                    }
+                                    else
+                                    {
+                                        result = errno;
+                                        LOG_ERROR("Error writing to file: %d",
+                                                  result);
+                                    }
+                                }
+                                else
+                                {
+                                    result = errno;
+                                    LOG_ERROR("Error seeking to %lld: %d",
+                                              (long long int) pos,
+                                              result);
+                                }
                             }
                         }
                         else
                         {
                             result = errno;
-                            LOG_ERROR("Error seeking to %lld: %d",
+                            LOG_ERROR("Error reading from %lld: %d",
                                       (long long int) pos,
                                       result);
                         }
                     }
+                    else
+                    {
+                        result = errno;
+                        LOG_ERROR("Error seeking to %lld: %d",
+                                  (long long int) pos,
+                                  result);
+                    }
                 }
-                else
+
+                if (locked == true)
                 {
-                    result = errno;
-                    LOG_ERROR("Error reading from %lld: %d",
-                              (long long int) pos,
-                              result);
+                    bonnie64_mt_lock_chunk(fd,
+                                           pos,
+                                           buffer_size,
+                                           F_UNLCK);
                 }
             }
-            else
-            {
-                result = errno;
-                LOG_ERROR("Error seeking to %lld: %d",
-                          (long long int) pos,
-                          result);
-            }
+
+            mt_fs_tests_op_end(&op,
+                               result);
         }
 
-        data->results[id] = result;
+        if (buffer != NULL)
+        {
+            free(buffer);
+        }
+
+        mt_fs_tests_outcomes_add_atomic(data->outcomes,
+                                        result);
         close(fd), fd = -1;
     }
     else
@@ -560,44 +854,77 @@ static int bonnie64_mt_run(void * const test_suite_data,
         LOG_ERROR("Error opening file %s: %d",
                   data->filename,
                   result);
-        data->results[id] = errno;
+        mt_fs_tests_outcomes_add_atomic(data->outcomes,
+                                        result);
     }
 
     return 0;
 }
 
+static int bonnie64_mt_verify_file(char const * const filename,
+                                   uint8_t * const buffer)
+{
+    int result = 0;
+    int fd = open(filename,
+                  O_RDONLY);
+
+    if (fd != -1)
+    {
+        for (size_t pos = 0;
+             result == 0 &&
+                 pos < FILE_SIZE;
+             pos += BUFFER_SIZE)
+        {
+            result = bonnie64_mt_verify_chunk(fd,
+                                              (off_t) pos,
+                                              buffer,
+                                              BUFFER_SIZE);
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  filename,
+                  result);
+    }
+
+    return result;
+}
+
 static int bonnie64_mt_post_run(void * test_suite_data)
 {
     int result = 0;
     bonnie64_mt_data * data = test_suite_data;
-    size_t ok_count = 0;
-    size_t invalid_count = 0;
     assert(data != NULL);
 
-    for (size_t idx = 0;
-         idx < data->nb_threads;
-         idx++)
+    if (data->nb_verifiers > 0)
     {
-        if (data->results[idx] == 0)
+        int const res = bonnie64_mt_verify_file(data->filename,
+                                                data->buffer);
+
+        if (res == 0)
         {
-            ok_count++;
+            LOG_OK("File content verified after the run.");
         }
         else
         {
-            invalid_count++;
+            LOG_ERROR("Error verifying file content after the run: %d",
+                      res);
         }
     }
 
-    if (ok_count == data->nb_threads)
-    {
-        LOG_OK("Success!");
-    }
-    else
-    {
-        LOG_ERROR("Error, we got %zu success and %zu invalid return codes.",
-                  ok_count,
-                  invalid_count);
-    }
+    /* Every thread succeeds. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads }
+        };
+
+    mt_fs_tests_outcomes_check(data->outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
 
     return result;
 }
@@ -609,17 +936,19 @@ static int bonnie64_mt_deinit(void * test_suite_data)
 
     if (data != NULL)
     {
-        if (data->results != NULL)
+        if (data->outcomes != NULL)
         {
-            free(data->results), data->results = NULL;
+            mt_fs_tests_shared_free(data->outcomes), data->outcomes = NULL;
         }
 
         if (data->filename != NULL)
         {
+            mt_fs_tests_cold_cache_untrack(data->filename);
             unlink(data->filename);
             free(data->filename), data->filename = NULL;
         }
 
+        free(data->buffer), data->buffer = NULL;
         free(data);
     }
 
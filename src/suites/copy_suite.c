@@ -0,0 +1,957 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <linux/fs.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "barrier.h"
+#include "cold_cache.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+#include "verify.h"
+
+/* File copies: each thread writes a source file of its own, then copies it
+   to a destination file with each method in turn, all threads using the
+   same method at the same time: read() and write() through a user-space
+   buffer, copy_file_range(), sendfile(), splice() through a pipe, and
+   ioctl(FICLONE), sharing the extents of the source instead of copying
+   them. Reported per method are the bytes copied per second, from the
+   first thread starting to copy to the last one finishing. The last copy
+   of each method is checked against the CRC32C of the source.
+
+   Options:
+   - copy_mt.method: read_write, copy_file_range, sendfile, splice, ficlone,
+     or all (default). Methods the filesystem does not support, usually
+     ficlone, are then skipped;
+   - copy_mt.size: size of the files, with an optional k, m or g suffix
+     (default 8m);
+   - copy_mt.chunk_size: size of the buffer of read_write, and of the
+     transfers of the other methods but ficlone (default 1m);
+   - copy_mt.copies: copies per thread and method (default 4).
+
+   In cold-cache mode, threads evict their files from the page cache
+   before each method. */
+
+#define DIRECTORY_TEMPLATE "copy_suite_XXXXXX"
+#define SOURCE_NAME_FORMAT "%s/s%zu"
+#define DESTINATION_NAME_FORMAT "%s/d%zu"
+#define PROBE_SOURCE_FORMAT "%s/probe_source"
+#define PROBE_DESTINATION_FORMAT "%s/probe_destination"
+#define PATH_SIZE (256)
+#define PROBE_SIZE (4096)
+#define DEFAULT_SIZE (8 * 1024 * 1024)
+#define DEFAULT_CHUNK_SIZE (1024 * 1024)
+#define DEFAULT_COPIES (4)
+
+typedef enum
+{
+    copy_mt_method_read_write = 0,
+    copy_mt_method_copy_file_range,
+    copy_mt_method_sendfile,
+    copy_mt_method_splice,
+    copy_mt_method_ficlone,
+    copy_mt_method_count
+} copy_mt_method;
+
+static char const * const copy_mt_methods_names[] =
+{
+    "read_write",
+    "copy_file_range",
+    "sendfile",
+    "splice",
+    "ficlone",
+};
+
+/* Each method is a phase, counting copies. */
+typedef struct
+{
+    mt_fs_tests_phase methods[copy_mt_method_count];
+    mt_fs_tests_outcomes outcomes;
+} copy_mt_thread;
+
+typedef struct
+{
+    mt_fs_tests_barrier_t barrier;
+    copy_mt_thread threads[];
+} copy_mt_shared;
+
+typedef struct {
+    char * directory;
+    copy_mt_shared * shared;
+    size_t nb_threads;
+    size_t nb_methods;
+    uint64_t size;
+    uint64_t chunk_size;
+    uint64_t copies;
+    bool methods[copy_mt_method_count];
+    bool barrier_initialized;
+} copy_mt_data;
+
+static int copy_mt_get_options(copy_mt_data * const data)
+{
+    char const * const method = mt_fs_tests_option_get_string("copy_mt.method",
+                                                              "all");
+    int result = mt_fs_tests_option_get_size("copy_mt.size",
+                                             DEFAULT_SIZE,
+                                             &(data->size));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("copy_mt.chunk_size",
+                                             DEFAULT_CHUNK_SIZE,
+                                             &(data->chunk_size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("copy_mt.copies",
+                                               DEFAULT_COPIES,
+                                               &(data->copies));
+    }
+
+    if (result == 0 &&
+        (data->size == 0 ||
+         data->chunk_size == 0 ||
+         data->chunk_size > INT_MAX ||
+         data->copies == 0))
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid options, expected 0 < size, 0 < chunk_size <= %d and 0 < copies",
+                  INT_MAX);
+    }
+
+    if (result == 0)
+    {
+        if (strcasecmp(method, "all") == 0)
+        {
+            for (size_t idx = 0;
+                 idx < copy_mt_method_count;
+                 idx++)
+            {
+                data->methods[idx] = true;
+            }
+        }
+        else
+        {
+            result = ENOENT;
+
+            for (size_t idx = 0;
+                 result == ENOENT &&
+                     idx < copy_mt_method_count;
+                 idx++)
+            {
+                if (strcasecmp(method, copy_mt_methods_names[idx]) == 0)
+                {
+                    data->methods[idx] = true;
+                    result = 0;
+                }
+            }
+
+            if (result != 0)
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid method %s", method);
+            }
+        }
+    }
+
+    return result;
+}
+
+static void copy_mt_fill(mt_fs_tests_prng * const prng,
+                         uint8_t * const buffer,
+                         size_t const size)
+{
+    for (size_t offset = 0;
+         offset < size;
+         offset += sizeof (uint64_t))
+    {
+        uint64_t const value = mt_fs_tests_prng_next(prng);
+        size_t const len = size - offset < sizeof value ? size - offset : sizeof value;
+
+        memcpy(buffer + offset, &value, len);
+    }
+}
+
+static int copy_mt_copy(copy_mt_data const * const data,
+                        copy_mt_method const method,
+                        int const source,
+                        int const destination,
+                        int const * const pipe_fds,
+                        size_t const pipe_size,
+                        uint8_t * const buffer,
+                        uint64_t const size)
+{
+    int result = 0;
+    off_t in = 0;
+    off_t out = 0;
+
+    if (method == copy_mt_method_ficlone)
+    {
+        if (ioctl(destination, FICLONE, source) != 0)
+        {
+            result = errno;
+        }
+
+        out = (off_t) size;
+    }
+
+    while (result == 0 &&
+           (uint64_t) out < size)
+    {
+        size_t const len = size - (uint64_t) out < data->chunk_size ? (size_t) (size - (uint64_t) out) : (size_t) data->chunk_size;
+        ssize_t done = -1;
+
+        switch (method)
+        {
+        case copy_mt_method_read_write:
+            /* Both files at the same offset, a short write being read
+               again. */
+            done = pread(source, buffer, len, out);
+
+            if (done > 0)
+            {
+                done = pwrite(destination, buffer, (size_t) done, out);
+                out += done > 0 ? done : 0;
+            }
+            break;
+        case copy_mt_method_copy_file_range:
+            /* Both offsets are updated by the call. */
+            done = copy_file_range(source, &in, destination, &out, len, 0);
+            break;
+        case copy_mt_method_sendfile:
+            /* Writes at the offset of the destination, 0 once opened. */
+            done = sendfile(destination, source, &in, len);
+            out += done > 0 ? done : 0;
+            break;
+        case copy_mt_method_splice:
+            done = splice(source, &in, pipe_fds[1], NULL, len < pipe_size ? len : pipe_size, SPLICE_F_MOVE);
+
+            for (ssize_t drained = 0;
+                 done > 0 &&
+                     drained < done;
+                 )
+            {
+                ssize_t const moved = splice(pipe_fds[0], NULL, destination, &out, (size_t) (done - drained), SPLICE_F_MOVE);
+
+                if (moved > 0)
+                {
+                    drained += moved;
+                }
+                else
+                {
+                    done = moved;
+                }
+            }
+            break;
+        case copy_mt_method_ficlone:
+        case copy_mt_method_count:
+            assert(false);
+            break;
+        }
+
+        if (done == 0)
+        {
+            /* The source is shorter than expected. */
+            result = EIO;
+        }
+        else if (done < 0 &&
+                 errno != EINTR)
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/* Checks that the methods the filesystem may not support, copy_file_range()
+   across filesystems or FICLONE, work in the directory of the suite. */
+static int copy_mt_probe(copy_mt_data * const data)
+{
+    int result = 0;
+    char source_path[PATH_SIZE];
+    char destination_path[PATH_SIZE];
+    uint8_t buffer[PROBE_SIZE] = { 0 };
+
+    snprintf(source_path,
+             sizeof source_path,
+             PROBE_SOURCE_FORMAT,
+             data->directory);
+    snprintf(destination_path,
+             sizeof destination_path,
+             PROBE_DESTINATION_FORMAT,
+             data->directory);
+
+    int source = open(source_path,
+                      O_CREAT | O_RDWR,
+                      S_IRUSR | S_IWUSR);
+    int destination = open(destination_path,
+                           O_CREAT | O_RDWR,
+                           S_IRUSR | S_IWUSR);
+
+    if (source != -1 &&
+        destination != -1)
+    {
+        if (pwrite(source, buffer, sizeof buffer, 0) == (ssize_t) sizeof buffer)
+        {
+            copy_mt_method const methods[] =
+                {
+                    copy_mt_method_copy_file_range,
+                    copy_mt_method_ficlone
+                };
+
+            for (size_t idx = 0;
+                 result == 0 &&
+                     idx < sizeof methods / sizeof *methods;
+                 idx++)
+            {
+                copy_mt_method const method = methods[idx];
+
+                if (data->methods[method] == true)
+                {
+                    int const res = copy_mt_copy(data,
+                                                 method,
+                                                 source,
+                                                 destination,
+                                                 NULL,
+                                                 0,
+                                                 NULL,
+                                                 sizeof buffer);
+
+                    if (res != 0)
+                    {
+                        if (data->nb_methods > 1)
+                        {
+                            LOG_OK("%s is not supported here (%d), skipped",
+                                   copy_mt_methods_names[method],
+                                   res);
+                            data->methods[method] = false;
+                            data->nb_methods--;
+                        }
+                        else
+                        {
+                            result = res;
+                            LOG_ERROR("%s is not supported here: %d",
+                                      copy_mt_methods_names[method],
+                                      result);
+                        }
+                    }
+                }
+            }
+        }
+        else
+        {
+            result = errno != 0 ? errno : EIO;
+            LOG_ERROR("Error writing %s: %d",
+                      source_path,
+                      result);
+        }
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error creating probe files: %d",
+                  result);
+    }
+
+    if (source != -1)
+    {
+        close(source), source = -1;
+    }
+
+    if (destination != -1)
+    {
+        close(destination), destination = -1;
+    }
+
+    unlink(source_path);
+    unlink(destination_path);
+
+    return result;
+}
+
+static void copy_mt_remove_files(copy_mt_data * const data)
+{
+    if (data->directory != NULL)
+    {
+        char path[PATH_SIZE];
+
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            snprintf(path,
+                     sizeof path,
+                     SOURCE_NAME_FORMAT,
+                     data->directory,
+                     id);
+            unlink(path);
+
+            snprintf(path,
+                     sizeof path,
+                     DESTINATION_NAME_FORMAT,
+                     data->directory,
+                     id);
+            unlink(path);
+        }
+
+        rmdir(data->directory);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+static int copy_mt_init(void ** test_suite_data,
+                        size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    assert(nb_threads > 0);
+    assert(nb_threads <= UINT_MAX);
+    copy_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = copy_mt_get_options(data);
+
+        if (result == 0)
+        {
+            for (size_t idx = 0;
+                 idx < copy_mt_method_count;
+                 idx++)
+            {
+                data->nb_methods += data->methods[idx] == true ? 1 : 0;
+            }
+
+            data->shared = mt_fs_tests_shared_calloc(1,
+                                                     sizeof *(data->shared) + nb_threads * sizeof *(data->shared->threads));
+
+            if (data->shared != NULL)
+            {
+                result = mt_fs_tests_barrier_init_shared(&(data->shared->barrier),
+                                                         (unsigned int) nb_threads);
+
+                if (result == 0)
+                {
+                    data->barrier_initialized = true;
+                }
+                else
+                {
+                    LOG_ERROR("Error creating methods barrier: %d",
+                              result);
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            data->directory = strdup(DIRECTORY_TEMPLATE);
+
+            if (data->directory != NULL)
+            {
+                if (mkdtemp(data->directory) == NULL)
+                {
+                    result = errno;
+                    LOG_ERROR("Error in mkdtemp: %d",
+                              result);
+                    free(data->directory), data->directory = NULL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            result = copy_mt_probe(data);
+        }
+
+        if (result == 0)
+        {
+            LOG_DEBUG("%llu copies of %llu bytes per thread and method, in chunks of %llu bytes",
+                      (unsigned long long) data->copies,
+                      (unsigned long long) data->size,
+                      (unsigned long long) data->chunk_size);
+            *test_suite_data = data;
+        }
+        else
+        {
+            copy_mt_remove_files(data);
+
+            if (data->shared != NULL)
+            {
+                if (data->barrier_initialized == true)
+                {
+                    mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+                }
+
+                mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+/* Writes the source file of the thread, returning its CRC32C in *crc. */
+static int copy_mt_write_source(copy_mt_data const * const data,
+                                size_t const id,
+                                int const fd,
+                                uint8_t * const buffer,
+                                uint32_t * const crc)
+{
+    int result = 0;
+    mt_fs_tests_prng prng;
+
+    mt_fs_tests_prng_thread_init(&prng, id);
+    *crc = 0;
+
+    for (uint64_t offset = 0;
+         result == 0 &&
+             offset < data->size;
+         offset += data->chunk_size)
+    {
+        size_t const len = data->size - offset < data->chunk_size ? (size_t) (data->size - offset) : (size_t) data->chunk_size;
+
+        copy_mt_fill(&prng,
+                     buffer,
+                     len);
+
+        *crc = mt_fs_tests_crc32c(*crc,
+                                  buffer,
+                                  len);
+
+        if (pwrite(fd, buffer, len, (off_t) offset) != (ssize_t) len)
+        {
+            result = errno != 0 ? errno : EIO;
+        }
+    }
+
+    return result;
+}
+
+static int copy_mt_verify(copy_mt_data const * const data,
+                          char const * const path,
+                          uint8_t * const buffer,
+                          uint32_t const expected)
+{
+    int result = 0;
+    uint32_t crc = 0;
+    uint64_t offset = 0;
+    int fd = open(path,
+                  O_RDONLY);
+
+    if (fd != -1)
+    {
+        ssize_t got = 0;
+
+        do
+        {
+            got = pread(fd, buffer, (size_t) data->chunk_size, (off_t) offset);
+
+            if (got > 0)
+            {
+                crc = mt_fs_tests_crc32c(crc,
+                                         buffer,
+                                         (size_t) got);
+                offset += (uint64_t) got;
+            }
+        }
+        while (got > 0);
+
+        if (got == -1)
+        {
+            result = errno;
+            LOG_ERROR("Error reading %s: %d",
+                      path,
+                      result);
+        }
+        else if (offset != data->size ||
+                 crc != expected)
+        {
+            result = EIO;
+            LOG_ERROR("Error, %s holds %llu bytes of CRC32C %08x, expected %llu bytes of CRC32C %08x",
+                      path,
+                      (unsigned long long) offset,
+                      crc,
+                      (unsigned long long) data->size,
+                      expected);
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static int copy_mt_run_method(copy_mt_data const * const data,
+                              size_t const id,
+                              copy_mt_method const method,
+                              int const source,
+                              char const * const destination_path,
+                              int const * const pipe_fds,
+                              size_t const pipe_size,
+                              uint8_t * const buffer,
+                              uint32_t const crc)
+{
+    int result = 0;
+    copy_mt_thread * const thread = &(data->shared->threads[id]);
+    mt_fs_tests_phase * const stats = &(thread->methods[method]);
+
+    mt_fs_tests_phase_begin(stats);
+
+    for (uint64_t idx = 0;
+         result == 0 &&
+             idx < data->copies;
+         idx++)
+    {
+        mt_fs_tests_op op;
+
+        mt_fs_tests_op_begin(&op,
+                             copy_mt_methods_names[method]);
+
+        int destination = open(destination_path,
+                               O_CREAT | O_TRUNC | O_WRONLY,
+                               S_IRUSR | S_IWUSR);
+
+        if (destination != -1)
+        {
+            result = copy_mt_copy(data,
+                                  method,
+                                  source,
+                                  destination,
+                                  pipe_fds,
+                                  pipe_size,
+                                  buffer,
+                                  data->size);
+
+            close(destination), destination = -1;
+        }
+        else
+        {
+            result = errno;
+        }
+
+        if (result == 0)
+        {
+            mt_fs_tests_op_add_bytes(data->size);
+        }
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+
+        if (result == 0)
+        {
+            stats->count++;
+            stats->bytes += data->size;
+        }
+        else
+        {
+            LOG_ERROR("Error copying to %s with %s: %d",
+                      destination_path,
+                      copy_mt_methods_names[method],
+                      result);
+        }
+    }
+
+    mt_fs_tests_phase_end(stats);
+
+    if (result == 0)
+    {
+        result = copy_mt_verify(data,
+                                destination_path,
+                                buffer,
+                                crc);
+
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+
+    return result;
+}
+
+static int copy_mt_run(void * const test_suite_data,
+                       size_t const id)
+{
+    int result = 0;
+    copy_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    copy_mt_thread * const thread = &(data->shared->threads[id]);
+    char source_path[PATH_SIZE];
+    char destination_path[PATH_SIZE];
+    int pipe_fds[2] = { -1, -1 };
+    size_t pipe_size = 0;
+    uint32_t crc = 0;
+    int source = -1;
+    bool copied = false;
+    uint8_t * buffer = malloc((size_t) data->chunk_size);
+
+    snprintf(source_path,
+             sizeof source_path,
+             SOURCE_NAME_FORMAT,
+             data->directory,
+             id);
+    snprintf(destination_path,
+             sizeof destination_path,
+             DESTINATION_NAME_FORMAT,
+             data->directory,
+             id);
+
+    if (buffer != NULL)
+    {
+        source = open(source_path,
+                      O_CREAT | O_TRUNC | O_RDWR,
+                      S_IRUSR | S_IWUSR);
+
+        if (source != -1)
+        {
+            result = copy_mt_write_source(data,
+                                          id,
+                                          source,
+                                          buffer,
+                                          &crc);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error writing %s: %d",
+                          source_path,
+                          result);
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating %s: %d",
+                      source_path,
+                      result);
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    if (result == 0 &&
+        data->methods[copy_mt_method_splice] == true)
+    {
+        if (pipe2(pipe_fds, O_CLOEXEC) == 0)
+        {
+            /* Larger pipes may not be allowed, which is not an error. */
+            fcntl(pipe_fds[1], F_SETPIPE_SZ, (int) data->chunk_size);
+
+            int const size = fcntl(pipe_fds[1], F_GETPIPE_SZ);
+
+            if (size > 0)
+            {
+                pipe_size = (size_t) size;
+            }
+            else
+            {
+                result = errno;
+                LOG_ERROR("Error getting the size of the pipe: %d",
+                          result);
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating a pipe: %d",
+                      result);
+        }
+    }
+
+    if (result != 0)
+    {
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+
+    for (size_t method = 0;
+         method < copy_mt_method_count;
+         method++)
+    {
+        if (data->methods[method] == true)
+        {
+            if (mt_fs_tests_cold_cache_enabled() == true)
+            {
+                mt_fs_tests_cold_cache_evict_path(source_path);
+
+                /* Created by the first method. */
+                if (copied == true)
+                {
+                    mt_fs_tests_cold_cache_evict_path(destination_path);
+                }
+
+                mt_fs_tests_cold_cache_evict_phase(&(data->shared->barrier));
+            }
+
+            /* Even threads which failed wait for the others, or they would
+               never get past the barrier. */
+            mt_fs_tests_barrier_wait(&(data->shared->barrier));
+
+            if (result == 0)
+            {
+                copied = true;
+                result = copy_mt_run_method(data,
+                                            id,
+                                            (copy_mt_method) method,
+                                            source,
+                                            destination_path,
+                                            pipe_fds,
+                                            pipe_size,
+                                            buffer,
+                                            crc);
+            }
+        }
+    }
+
+    if (pipe_fds[0] != -1)
+    {
+        close(pipe_fds[0]), pipe_fds[0] = -1;
+        close(pipe_fds[1]), pipe_fds[1] = -1;
+    }
+
+    if (source != -1)
+    {
+        close(source), source = -1;
+    }
+
+    free(buffer), buffer = NULL;
+
+    return 0;
+}
+
+static int copy_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    copy_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t method = 0;
+         method < copy_mt_method_count;
+         method++)
+    {
+        mt_fs_tests_phase total;
+        double elapsed;
+
+        mt_fs_tests_phase_reset(&total);
+
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            mt_fs_tests_phase_merge(&total,
+                                    &(data->shared->threads[id].methods[method]));
+        }
+
+        elapsed = mt_fs_tests_phase_elapsed(&total);
+
+        if (elapsed > 0.0)
+        {
+            LOG_OK("%s: %llu copies, %llu bytes in %.3f s with %zu threads, %.2f GB/s",
+                   copy_mt_methods_names[method],
+                   (unsigned long long) total.count,
+                   (unsigned long long) total.bytes,
+                   elapsed,
+                   data->nb_threads,
+                   (double) total.bytes / elapsed / 1000000000.0);
+        }
+    }
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->shared->threads[id].outcomes));
+    }
+
+    /* Every copy goes through, and the last copy of each method is
+       verified. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads * data->nb_methods * (data->copies + 1) }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int copy_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    copy_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        copy_mt_remove_files(data);
+
+        if (data->shared != NULL)
+        {
+            mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+            mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_copy_mt =
+{
+    "copy_mt",
+    &copy_mt_init,
+    &copy_mt_run,
+    &copy_mt_post_run,
+    &copy_mt_deinit,
+    test_suite_type_mt
+};
@@ -2,11 +2,14 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "ops.h"
+#include "races.h"
 #include "test_suites.h"
 #include "utils.h"
 
@@ -14,10 +17,32 @@
 
 typedef struct {
     char * directory_name;
-    int * results;
-    size_t nb_threads;
+    mt_fs_tests_races * races;
 } directory_create_mt_data;
 
+/* Exactly one thread wins each round. */
+static mt_fs_tests_expectation const directory_create_mt_expectations[] =
+{
+    { 0, mt_fs_tests_expect_exactly, 1 },
+    { EEXIST, mt_fs_tests_expect_any, 0 },
+};
+
+/* Removes the directory created in the previous round. */
+static int directory_create_mt_reset(void * test_suite_data)
+{
+    int result = 0;
+    directory_create_mt_data * data = test_suite_data;
+    assert(data != NULL);
+
+    if (rmdir(data->directory_name) != 0 &&
+        errno != ENOENT)
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
 static int directory_create_mt_init(void ** test_suite_data,
                                     size_t const nb_threads)
 {
@@ -27,30 +52,36 @@ static int directory_create_mt_init(void ** test_suite_data,
 
     if (data != NULL)
     {
-        data->results = malloc(sizeof *(data->results) * nb_threads);
-
-        if (data->results != NULL)
+        result = mt_fs_tests_races_init(&(data->races),
+                                        "directory_create_mt",
+                                        nb_threads,
+                                        directory_create_mt_expectations,
+                                        sizeof directory_create_mt_expectations / sizeof *directory_create_mt_expectations,
+                                        &directory_create_mt_reset,
+                                        data);
+
+        if (result == 0)
         {
-            for (size_t idx = 0;
-                 idx < nb_threads;
-                 idx++)
-            {
-                data->results[idx] = -1;
-            }
-
-            data->nb_threads = nb_threads;
-
             data->directory_name = strdup(DIRECTORY_NAME_TEMPLATE);
 
             if (data->directory_name != NULL)
             {
-                if (mktemp(data->directory_name) != NULL)
+                /* Created by the race itself. */
+                bool create = false;
+
+                result = mt_fs_tests_races_target(data->directory_name,
+                                                  directory_create_mt_expectations,
+                                                  sizeof directory_create_mt_expectations / sizeof *directory_create_mt_expectations,
+                                                  &create);
+
+                if (result == 0)
                 {
                     *test_suite_data = data;
                 }
                 else
                 {
-                    result = errno;
+                    LOG_ERROR("Error naming the target of the race: %d",
+                              result);
                 }
 
                 if (result != 0)
@@ -65,13 +96,9 @@ static int directory_create_mt_init(void ** test_suite_data,
 
             if (result != 0)
             {
-                free(data->results), data->results = NULL;
+                mt_fs_tests_races_free(data->races), data->races = NULL;
             }
         }
-        else
-        {
-            result = ENOMEM;
-        }
 
         if (result != 0)
         {
@@ -91,23 +118,29 @@ static int directory_create_mt_run(void * test_suite_data,
 {
     int result = 0;
     directory_create_mt_data * data = test_suite_data;
-
-//    LOG_OK("ID is %zu", id);
+    (void) id;
 
     assert(data != NULL);
     assert(data->directory_name != NULL);
-    assert(data->results[id] == -1);
-
-    result = mkdir(data->directory_name, S_IRUSR | S_IWUSR);
 
-    if (result == 0)
+    while (mt_fs_tests_races_next(data->races) == true)
     {
-        data->results[id] = 0;
-    }
-    else
-    {
-        data->results[id] = errno;
-        result = 0;
+        mt_fs_tests_op op;
+        int outcome = 0;
+
+        mt_fs_tests_op_begin(&op,
+                             "mkdir");
+
+        if (mkdir(data->directory_name, S_IRUSR | S_IWUSR) != 0)
+        {
+            outcome = errno;
+        }
+
+        mt_fs_tests_op_end(&op,
+                           outcome);
+
+        mt_fs_tests_races_end(data->races,
+                              outcome);
     }
 
     return result;
@@ -117,41 +150,9 @@ static int directory_create_mt_post_run(void * test_suite_data)
 {
     int result = 0;
     directory_create_mt_data * data = test_suite_data;
-    size_t exist_count = 0;
-    size_t ok_count = 0;
-    size_t invalid_count = 0;
     assert(data != NULL);
 
-    for (size_t idx = 0;
-         idx < data->nb_threads;
-         idx++)
-    {
-        if (data->results[idx] == 0)
-        {
-            ok_count++;
-        }
-        else if (data->results[idx] == EEXIST)
-        {
-            exist_count++;
-        }
-        else
-        {
-            invalid_count++;
-        }
-    }
-
-    if (ok_count == 1 &&
-        exist_count == (data->nb_threads - 1))
-    {
-        LOG_OK("Success!");
-    }
-    else
-    {
-        LOG_ERROR("Error, we got %zu creation, %zu already exist and %zu invalid return codes.",
-                  ok_count,
-                  exist_count,
-                  invalid_count);
-    }
+    mt_fs_tests_races_report(data->races);
 
     return result;
 }
@@ -163,10 +164,7 @@ static int directory_create_mt_deinit(void * test_suite_data)
 
     if (data != NULL)
     {
-        if (data->results != NULL)
-        {
-            free(data->results), data->results = NULL;
-        }
+        mt_fs_tests_races_free(data->races), data->races = NULL;
 
         if (data->directory_name != NULL)
         {
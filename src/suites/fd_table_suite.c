@@ -0,0 +1,550 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Stresses file descriptors allocation and release rather than the
+   filesystem: threads open and close a shared hot file, open their own
+   file through openat(), or duplicate descriptors, all with O_CLOEXEC.
+
+   Options:
+   - fd_table_mt.mode: open, openat, dup, dup3 or all (default), the
+     latter cycling through the others;
+   - fd_table_mt.iterations: operations per thread (default 10000);
+   - fd_table_mt.prealloc: grow the descriptor table of the process to at
+     least this many entries before the run (default 0). */
+
+#define FILENAME_TEMPLATE "fd_table_suite_XXXXXX"
+#define THREAD_FILENAME_FORMAT "fd_table_suite_thread_%zu"
+#define DEFAULT_ITERATIONS (10000)
+
+typedef enum
+{
+    fd_table_mt_mode_open = 0,
+    fd_table_mt_mode_openat,
+    fd_table_mt_mode_dup,
+    fd_table_mt_mode_dup3,
+    fd_table_mt_mode_all,
+    fd_table_mt_mode_count
+} fd_table_mt_mode;
+
+static char const * const fd_table_mt_modes_names[] =
+{
+    "open",
+    "openat",
+    "dup",
+    "dup3",
+    "all",
+};
+
+typedef struct {
+    char * filename;
+    char ** threads_filenames;
+    /* One per thread. */
+    mt_fs_tests_outcomes * threads_outcomes;
+    size_t nb_threads;
+    uint64_t iterations;
+    fd_table_mt_mode mode;
+    int dir_fd;
+} fd_table_mt_data;
+
+static int fd_table_mt_prealloc(uint64_t const prealloc)
+{
+    int result = 0;
+    struct rlimit limit;
+
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0)
+    {
+        if (limit.rlim_cur < prealloc &&
+            prealloc <= limit.rlim_max)
+        {
+            limit.rlim_cur = prealloc;
+
+            if (setrlimit(RLIMIT_NOFILE, &limit) != 0)
+            {
+                result = errno;
+            }
+        }
+        else if (limit.rlim_cur < prealloc)
+        {
+            result = EMFILE;
+        }
+    }
+    else
+    {
+        result = errno;
+    }
+
+    if (result == 0)
+    {
+        /* The kernel never shrinks a descriptor table, installing then closing
+           a descriptor at least as high is enough to grow it. The kernel picks
+           a free one, not to replace one of ours. */
+        int const fd = fcntl(STDERR_FILENO,
+                             F_DUPFD_CLOEXEC,
+                             (int) prealloc - 1);
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error growing the file descriptors table to %llu entries: %d",
+                  (unsigned long long) prealloc,
+                  result);
+    }
+
+    return result;
+}
+
+static int fd_table_mt_get_options(fd_table_mt_data * const data)
+{
+    uint64_t prealloc = 0;
+    char const * const mode = mt_fs_tests_option_get_string("fd_table_mt.mode",
+                                                            "all");
+    int result = mt_fs_tests_option_get_uint64("fd_table_mt.iterations",
+                                               DEFAULT_ITERATIONS,
+                                               &(data->iterations));
+
+    if (result == 0)
+    {
+        result = ENOENT;
+
+        for (size_t idx = 0;
+             result == ENOENT &&
+                 idx < fd_table_mt_mode_count;
+             idx++)
+        {
+            if (strcasecmp(mode, fd_table_mt_modes_names[idx]) == 0)
+            {
+                data->mode = (fd_table_mt_mode) idx;
+                result = 0;
+            }
+        }
+
+        if (result != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid mode %s", mode);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("fd_table_mt.prealloc",
+                                               0,
+                                               &prealloc);
+
+        if (result == 0 &&
+            prealloc > 0)
+        {
+            if (prealloc <= INT32_MAX)
+            {
+                result = fd_table_mt_prealloc(prealloc);
+            }
+            else
+            {
+                result = EINVAL;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int fd_table_mt_create_files(fd_table_mt_data * const data)
+{
+    int result = 0;
+
+    data->threads_filenames = calloc(data->nb_threads, sizeof *(data->threads_filenames));
+
+    if (data->threads_filenames != NULL)
+    {
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < data->nb_threads;
+             idx++)
+        {
+            char name[64];
+            int fd = -1;
+
+            snprintf(name,
+                     sizeof name,
+                     THREAD_FILENAME_FORMAT,
+                     idx);
+
+            fd = open(name,
+                      O_CREAT | O_WRONLY | O_CLOEXEC,
+                      S_IRUSR | S_IWUSR);
+
+            if (fd != -1)
+            {
+                close(fd), fd = -1;
+
+                data->threads_filenames[idx] = strdup(name);
+
+                if (data->threads_filenames[idx] == NULL)
+                {
+                    unlink(name);
+                    result = ENOMEM;
+                }
+            }
+            else
+            {
+                result = errno;
+                LOG_ERROR("Error creating %s: %d",
+                          name,
+                          result);
+            }
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static void fd_table_mt_remove_files(fd_table_mt_data * const data)
+{
+    if (data->threads_filenames != NULL)
+    {
+        for (size_t idx = 0;
+             idx < data->nb_threads;
+             idx++)
+        {
+            if (data->threads_filenames[idx] != NULL)
+            {
+                unlink(data->threads_filenames[idx]);
+                free(data->threads_filenames[idx]), data->threads_filenames[idx] = NULL;
+            }
+        }
+
+        free(data->threads_filenames), data->threads_filenames = NULL;
+    }
+}
+
+static int fd_table_mt_init(void ** test_suite_data,
+                            size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    fd_table_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->dir_fd = -1;
+        data->nb_threads = nb_threads;
+
+        result = fd_table_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->threads_outcomes = mt_fs_tests_shared_calloc(nb_threads,
+                                                               sizeof *(data->threads_outcomes));
+
+            if (data->threads_outcomes != NULL)
+            {
+                data->filename = strdup(FILENAME_TEMPLATE);
+
+                if (data->filename != NULL)
+                {
+                    int fd = mkstemp(data->filename);
+
+                    if (fd != -1)
+                    {
+                        close(fd), fd = -1;
+
+                        data->dir_fd = open(".",
+                                            O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+                        if (data->dir_fd != -1)
+                        {
+                            result = fd_table_mt_create_files(data);
+                        }
+                        else
+                        {
+                            result = errno;
+                            LOG_ERROR("Error opening the current directory: %d",
+                                      result);
+                        }
+                    }
+                    else
+                    {
+                        result = errno;
+                        LOG_ERROR("Error in mkstemp: %d",
+                                  result);
+                        free(data->filename), data->filename = NULL;
+                    }
+                }
+                else
+                {
+                    result = ENOMEM;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            fd_table_mt_remove_files(data);
+
+            if (data->dir_fd != -1)
+            {
+                close(data->dir_fd), data->dir_fd = -1;
+            }
+
+            if (data->filename != NULL)
+            {
+                unlink(data->filename);
+                free(data->filename), data->filename = NULL;
+            }
+
+            if (data->threads_outcomes != NULL)
+            {
+                mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int fd_table_mt_run_one(fd_table_mt_data const * const data,
+                               fd_table_mt_mode const mode,
+                               size_t const id,
+                               int const own_fd,
+                               int const reserved_fd)
+{
+    int result = 0;
+    int fd = -1;
+    mt_fs_tests_op op;
+
+    mt_fs_tests_op_begin(&op,
+                         fd_table_mt_modes_names[mode]);
+
+    switch(mode)
+    {
+    case fd_table_mt_mode_open:
+        fd = open(data->filename,
+                  O_RDONLY | O_CLOEXEC);
+        break;
+    case fd_table_mt_mode_openat:
+        fd = openat(data->dir_fd,
+                    data->threads_filenames[id],
+                    O_RDONLY | O_CLOEXEC);
+        break;
+    case fd_table_mt_mode_dup:
+        fd = fcntl(own_fd,
+                   F_DUPFD_CLOEXEC,
+                   0);
+        break;
+    case fd_table_mt_mode_dup3:
+        /* Atomically replaces the descriptor installed in the reserved
+           slot, there is nothing to close afterwards. */
+        if (dup3(own_fd,
+                 reserved_fd,
+                 O_CLOEXEC) == -1)
+        {
+            result = errno;
+        }
+        break;
+    default:
+        assert(false);
+        result = EINVAL;
+        break;
+    }
+
+    if (mode != fd_table_mt_mode_dup3)
+    {
+        if (fd != -1)
+        {
+            close(fd), fd = -1;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    mt_fs_tests_op_end(&op,
+                       result);
+
+    return result;
+}
+
+static int fd_table_mt_run(void * test_suite_data,
+                           size_t id)
+{
+    int result = 0;
+    fd_table_mt_data * data = test_suite_data;
+    int own_fd = -1;
+
+    assert(data != NULL);
+    assert(data->filename != NULL);
+    assert(data->threads_filenames != NULL);
+
+    own_fd = openat(data->dir_fd,
+                    data->threads_filenames[id],
+                    O_RDONLY | O_CLOEXEC);
+
+    if (own_fd != -1)
+    {
+        int reserved_fd = fcntl(own_fd,
+                                F_DUPFD_CLOEXEC,
+                                0);
+
+        if (reserved_fd != -1)
+        {
+            for (uint64_t idx = 0;
+                 result == 0 &&
+                     idx < data->iterations;
+                 idx++)
+            {
+                fd_table_mt_mode const mode = data->mode == fd_table_mt_mode_all ?
+                    (fd_table_mt_mode) (idx % fd_table_mt_mode_all) :
+                    data->mode;
+
+                result = fd_table_mt_run_one(data,
+                                             mode,
+                                             id,
+                                             own_fd,
+                                             reserved_fd);
+                mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                         result);
+            }
+
+            close(reserved_fd), reserved_fd = -1;
+        }
+        else
+        {
+            result = errno;
+            mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                     result);
+        }
+
+        close(own_fd), own_fd = -1;
+    }
+    else
+    {
+        result = errno;
+        mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                 result);
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error in thread %zu: %d",
+                  id,
+                  result);
+    }
+
+    return 0;
+}
+
+static int fd_table_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    fd_table_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t idx = 0;
+         idx < data->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->threads_outcomes[idx]));
+    }
+
+    /* Every operation of every thread succeeds. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads * data->iterations }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int fd_table_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    fd_table_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        fd_table_mt_remove_files(data);
+
+        if (data->dir_fd != -1)
+        {
+            close(data->dir_fd), data->dir_fd = -1;
+        }
+
+        if (data->threads_outcomes != NULL)
+        {
+            mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
+        }
+
+        if (data->filename != NULL)
+        {
+            unlink(data->filename);
+            free(data->filename), data->filename = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_fd_table_mt =
+{
+    "fd_table_mt",
+    &fd_table_mt_init,
+    &fd_table_mt_run,
+    &fd_table_mt_post_run,
+    &fd_table_mt_deinit,
+    test_suite_type_mt
+};
@@ -1,11 +1,14 @@
 #include <assert.h>
 #include <errno.h>
 #include <fcntl.h>
+#include <stdbool.h>
 #include <string.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "ops.h"
+#include "races.h"
 #include "test_suites.h"
 #include "utils.h"
 
@@ -13,10 +16,39 @@
 
 typedef struct {
     char * filename;
-    int * results;
-    size_t nb_threads;
+    mt_fs_tests_races * races;
 } file_removal_mt_data;
 
+/* Exactly one thread wins each round. */
+static mt_fs_tests_expectation const file_removal_mt_expectations[] =
+{
+    { 0, mt_fs_tests_expect_exactly, 1 },
+    { ENOENT, mt_fs_tests_expect_any, 0 },
+};
+
+/* Creates the file again, unless no thread removed it. */
+static int file_removal_mt_reset(void * test_suite_data)
+{
+    int result = 0;
+    file_removal_mt_data * data = test_suite_data;
+    assert(data != NULL);
+
+    int fd = open(data->filename,
+                  O_CREAT | O_WRONLY,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
 static int file_removal_mt_init(void ** test_suite_data,
                                 size_t const nb_threads)
 {
@@ -26,38 +58,58 @@ static int file_removal_mt_init(void ** test_suite_data,
 
     if (data != NULL)
     {
-        data->results = malloc(sizeof *(data->results) * nb_threads);
-
-        if (data->results != NULL)
+        result = mt_fs_tests_races_init(&(data->races),
+                                        "file_removal_mt",
+                                        nb_threads,
+                                        file_removal_mt_expectations,
+                                        sizeof file_removal_mt_expectations / sizeof *file_removal_mt_expectations,
+                                        &file_removal_mt_reset,
+                                        data);
+
+        if (result == 0)
         {
-            for (size_t idx = 0;
-                 idx < nb_threads;
-                 idx++)
-            {
-                data->results[idx] = -1;
-            }
-
-            data->nb_threads = nb_threads;
-
             data->filename = strdup(FILENAME_TEMPLATE);
 
             if (data->filename != NULL)
             {
-                int fd = mkstemp(data->filename);
+                /* Created once for all clients of a coordinator. */
+                bool create = false;
 
-                if (fd != -1)
-                {
-                    *test_suite_data = data;
+                result = mt_fs_tests_races_target(data->filename,
+                                                  file_removal_mt_expectations,
+                                                  sizeof file_removal_mt_expectations / sizeof *file_removal_mt_expectations,
+                                                  &create);
 
-                    close(fd), fd = -1;
+                if (result == 0 &&
+                    create == true)
+                {
+                    int fd = open(data->filename,
+                                  O_CREAT | O_EXCL | O_WRONLY,
+                                  S_IRUSR | S_IWUSR);
+
+                    if (fd != -1)
+                    {
+                        close(fd), fd = -1;
+                    }
+                    else
+                    {
+                        result = errno;
+                        LOG_ERROR("Error creating %s: %d",
+                                  data->filename,
+                                  result);
+                    }
                 }
-                else
+                else if (result != 0)
                 {
-                    result = errno;
-                    LOG_ERROR("Error in mkstemp: %d",
+                    LOG_ERROR("Error naming the target of the race: %d",
                               result);
                 }
 
+                if (result == 0)
+                {
+                    *test_suite_data = data;
+                }
+
                 if (result != 0)
                 {
                     free(data->filename), data->filename = NULL;
@@ -70,13 +122,9 @@ static int file_removal_mt_init(void ** test_suite_data,
 
             if (result != 0)
             {
-                free(data->results), data->results = NULL;
+                mt_fs_tests_races_free(data->races), data->races = NULL;
             }
         }
-        else
-        {
-            result = ENOMEM;
-        }
 
         if (result != 0)
         {
@@ -96,64 +144,41 @@ static int file_removal_mt_run(void * test_suite_data,
 {
     int result = 0;
     file_removal_mt_data * data = test_suite_data;
+    (void) id;
 
     assert(data != NULL);
     assert(data->filename != NULL);
-    assert(data->results[id] == -1);
 
-    result = unlink(data->filename);
-
-    if (result == 0)
-    {
-        data->results[id] = 0;
-    }
-    else
+    while (mt_fs_tests_races_next(data->races) == true)
     {
-        data->results[id] = errno;
+        mt_fs_tests_op op;
+        int outcome = 0;
+
+        mt_fs_tests_op_begin(&op,
+                             "unlink");
+
+        if (unlink(data->filename) != 0)
+        {
+            outcome = errno;
+        }
+
+        mt_fs_tests_op_end(&op,
+                           outcome);
+
+        mt_fs_tests_races_end(data->races,
+                              outcome);
     }
 
-    return 0;
+    return result;
 }
 
 static int file_removal_mt_post_run(void * test_suite_data)
 {
     int result = 0;
     file_removal_mt_data * data = test_suite_data;
-    size_t enoent_count = 0;
-    size_t ok_count = 0;
-    size_t invalid_count = 0;
     assert(data != NULL);
 
-    for (size_t idx = 0;
-         idx < data->nb_threads;
-         idx++)
-    {
-        if (data->results[idx] == 0)
-        {
-            ok_count++;
-        }
-        else if (data->results[idx] == ENOENT)
-        {
-            enoent_count++;
-        }
-        else
-        {
-            invalid_count++;
-        }
-    }
-
-    if (ok_count == 1 &&
-        enoent_count == (data->nb_threads - 1))
-    {
-        LOG_OK("Success!");
-    }
-    else
-    {
-        LOG_ERROR("Error, we got %zu removal, %zu does not exist and %zu invalid return codes.",
-                  ok_count,
-                  enoent_count,
-                  invalid_count);
-    }
+    mt_fs_tests_races_report(data->races);
 
     return result;
 }
@@ -165,10 +190,7 @@ static int file_removal_mt_deinit(void * test_suite_data)
 
     if (data != NULL)
     {
-        if (data->results != NULL)
-        {
-            free(data->results), data->results = NULL;
-        }
+        mt_fs_tests_races_free(data->races), data->races = NULL;
 
         if (data->filename != NULL)
         {
@@ -0,0 +1,763 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Lock contention: threads repeatedly take an exclusive lock, increment the
+   counters stored at the start of the regions they locked, then release
+   it. The latency of the lock operation is the time spent waiting for it.
+   Mutual exclusion is checked twice: threads count the holders of each
+   region in shared memory while they hold it, and once the run is over,
+   the counters in the file must add up to the number of increments.
+
+   Options:
+   - locks_mt.type: posix for fcntl(F_SETLKW), ofd (default) for
+     fcntl(F_OFD_SETLKW), or flock. POSIX locks belong to a process, threads
+     of the same process never wait for each other, so that mutual
+     exclusion only holds with --workers=process;
+   - locks_mt.pattern: whole (default) for the whole file, disjoint for a
+     region per thread, or overlapping for two adjacent regions out of one
+     more than there are threads, each overlapping with the ones of other
+     threads. As flock() only locks whole files, disjoint then gives each
+     thread a file of its own, and overlapping is the same as whole;
+   - locks_mt.region_size: size of a region (default 4k);
+   - locks_mt.iterations: locks taken per thread (default 10000). */
+
+#define FILENAME_TEMPLATE "locks_suite_XXXXXX"
+#define THREAD_FILENAME_FORMAT "%s_t%zu"
+#define DEFAULT_REGION_SIZE (4096)
+#define DEFAULT_ITERATIONS (10000)
+
+typedef enum
+{
+    locks_mt_type_posix = 0,
+    locks_mt_type_ofd,
+    locks_mt_type_flock,
+    locks_mt_type_count
+} locks_mt_type;
+
+static char const * const locks_mt_types_names[] =
+{
+    "posix",
+    "ofd",
+    "flock",
+};
+
+typedef enum
+{
+    locks_mt_pattern_whole = 0,
+    locks_mt_pattern_disjoint,
+    locks_mt_pattern_overlapping,
+    locks_mt_pattern_count
+} locks_mt_pattern;
+
+static char const * const locks_mt_patterns_names[] =
+{
+    "whole",
+    "disjoint",
+    "overlapping",
+};
+
+typedef struct
+{
+    uint64_t locks;
+    uint64_t violations;
+    pid_t pid;
+    mt_fs_tests_outcomes outcomes;
+} locks_mt_thread;
+
+typedef struct {
+    char * filename;
+    /* Files of the threads, for flock() on disjoint regions only. */
+    char ** threads_filenames;
+    locks_mt_thread * threads;
+    /* Threads holding each region, nb_regions. */
+    uint32_t * holders;
+    size_t nb_threads;
+    size_t nb_regions;
+    uint64_t region_size;
+    uint64_t iterations;
+    locks_mt_type type;
+    locks_mt_pattern pattern;
+} locks_mt_data;
+
+static int locks_mt_parse(char const * const option,
+                          char const * const default_value,
+                          char const * const * const names,
+                          size_t const nb_names,
+                          size_t * const out)
+{
+    char const * const value = mt_fs_tests_option_get_string(option,
+                                                             default_value);
+    int result = ENOENT;
+
+    for (size_t idx = 0;
+         result == ENOENT &&
+             idx < nb_names;
+         idx++)
+    {
+        if (strcasecmp(value, names[idx]) == 0)
+        {
+            *out = idx;
+            result = 0;
+        }
+    }
+
+    if (result != 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid value %s for %s",
+                  value,
+                  option);
+    }
+
+    return result;
+}
+
+static int locks_mt_get_options(locks_mt_data * const data)
+{
+    size_t type = 0;
+    size_t pattern = 0;
+    int result = locks_mt_parse("locks_mt.type",
+                                "ofd",
+                                locks_mt_types_names,
+                                locks_mt_type_count,
+                                &type);
+
+    if (result == 0)
+    {
+        data->type = (locks_mt_type) type;
+
+        result = locks_mt_parse("locks_mt.pattern",
+                                "whole",
+                                locks_mt_patterns_names,
+                                locks_mt_pattern_count,
+                                &pattern);
+    }
+
+    if (result == 0)
+    {
+        data->pattern = (locks_mt_pattern) pattern;
+
+        result = mt_fs_tests_option_get_size("locks_mt.region_size",
+                                             DEFAULT_REGION_SIZE,
+                                             &(data->region_size));
+
+        if (result == 0 &&
+            data->region_size < sizeof (uint64_t))
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid locks_mt.region_size, regions hold a %zu bytes counter",
+                      sizeof (uint64_t));
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("locks_mt.iterations",
+                                               DEFAULT_ITERATIONS,
+                                               &(data->iterations));
+    }
+
+    if (result == 0 &&
+        data->type == locks_mt_type_flock &&
+        data->pattern == locks_mt_pattern_overlapping)
+    {
+        data->pattern = locks_mt_pattern_whole;
+    }
+
+    return result;
+}
+
+static bool locks_mt_thread_files(locks_mt_data const * const data)
+{
+    return data->type == locks_mt_type_flock &&
+        data->pattern == locks_mt_pattern_disjoint;
+}
+
+static int locks_mt_create_file(locks_mt_data const * const data,
+                                char const * const filename,
+                                size_t const nb_regions)
+{
+    int result = 0;
+    int fd = open(filename,
+                  O_CREAT | O_WRONLY,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        /* Counters start at 0. */
+        if (ftruncate(fd, (off_t) (data->region_size * nb_regions)) != 0)
+        {
+            result = errno;
+            LOG_ERROR("Error resizing %s: %d",
+                      filename,
+                      result);
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error creating %s: %d",
+                  filename,
+                  result);
+    }
+
+    return result;
+}
+
+static int locks_mt_create_files(locks_mt_data * const data)
+{
+    int result = 0;
+
+    data->filename = strdup(FILENAME_TEMPLATE);
+
+    if (data->filename != NULL)
+    {
+        int fd = mkstemp(data->filename);
+
+        if (fd != -1)
+        {
+            close(fd), fd = -1;
+
+            result = locks_mt_create_file(data,
+                                          data->filename,
+                                          data->nb_regions);
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error in mkstemp: %d",
+                      result);
+            free(data->filename), data->filename = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    if (result == 0 &&
+        locks_mt_thread_files(data) == true)
+    {
+        data->threads_filenames = calloc(data->nb_threads,
+                                         sizeof *(data->threads_filenames));
+
+        if (data->threads_filenames != NULL)
+        {
+            for (size_t id = 0;
+                 result == 0 &&
+                     id < data->nb_threads;
+                 id++)
+            {
+                if (asprintf(&(data->threads_filenames[id]),
+                             THREAD_FILENAME_FORMAT,
+                             data->filename,
+                             id) != -1)
+                {
+                    result = locks_mt_create_file(data,
+                                                  data->threads_filenames[id],
+                                                  1);
+                }
+                else
+                {
+                    data->threads_filenames[id] = NULL;
+                    result = ENOMEM;
+                }
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+static void locks_mt_remove_files(locks_mt_data * const data)
+{
+    if (data->threads_filenames != NULL)
+    {
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            if (data->threads_filenames[id] != NULL)
+            {
+                unlink(data->threads_filenames[id]);
+                free(data->threads_filenames[id]), data->threads_filenames[id] = NULL;
+            }
+        }
+
+        free(data->threads_filenames), data->threads_filenames = NULL;
+    }
+
+    if (data->filename != NULL)
+    {
+        unlink(data->filename);
+        free(data->filename), data->filename = NULL;
+    }
+}
+
+static int locks_mt_init(void ** test_suite_data,
+                         size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    locks_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = locks_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->nb_regions = data->pattern == locks_mt_pattern_whole ? 1 :
+                data->pattern == locks_mt_pattern_disjoint ? nb_threads :
+                nb_threads + 1;
+
+            data->threads = mt_fs_tests_shared_calloc(nb_threads,
+                                                      sizeof *(data->threads));
+            data->holders = mt_fs_tests_shared_calloc(data->nb_regions,
+                                                      sizeof *(data->holders));
+
+            if (data->threads == NULL ||
+                data->holders == NULL)
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            result = locks_mt_create_files(data);
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            locks_mt_remove_files(data);
+
+            if (data->threads != NULL)
+            {
+                mt_fs_tests_shared_free(data->threads), data->threads = NULL;
+            }
+
+            if (data->holders != NULL)
+            {
+                mt_fs_tests_shared_free(data->holders), data->holders = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int locks_mt_lock(locks_mt_data const * const data,
+                         int const fd,
+                         off_t const start,
+                         off_t const length,
+                         short const type)
+{
+    int result = 0;
+
+    if (data->type == locks_mt_type_flock)
+    {
+        if (flock(fd, type == F_UNLCK ? LOCK_UN : LOCK_EX) != 0)
+        {
+            result = errno;
+        }
+    }
+    else
+    {
+        /* l_pid has to be 0 for OFD locks. */
+        struct flock lock =
+            {
+                .l_type = type,
+                .l_whence = SEEK_SET,
+                .l_start = start,
+                .l_len = length,
+                .l_pid = 0
+            };
+
+        if (fcntl(fd,
+                  data->type == locks_mt_type_ofd ? F_OFD_SETLKW : F_SETLKW,
+                  &lock) != 0)
+        {
+            result = errno;
+        }
+    }
+
+    return result;
+}
+
+/* Read-modify-write, only correct as long as no other thread holds the
+   region. */
+static int locks_mt_increment(int const fd,
+                              off_t const offset)
+{
+    int result = 0;
+    uint64_t counter = 0;
+
+    if (pread(fd, &counter, sizeof counter, offset) == (ssize_t) sizeof counter)
+    {
+        counter++;
+
+        if (pwrite(fd, &counter, sizeof counter, offset) != (ssize_t) sizeof counter)
+        {
+            result = errno != 0 ? errno : EIO;
+        }
+    }
+    else
+    {
+        result = errno != 0 ? errno : EIO;
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error updating the counter at %lld: %d",
+                  (long long int) offset,
+                  result);
+    }
+
+    return result;
+}
+
+static int locks_mt_run(void * const test_suite_data,
+                        size_t const id)
+{
+    int result = 0;
+    locks_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    locks_mt_thread * const thread = &(data->threads[id]);
+    bool const own_file = locks_mt_thread_files(data);
+    char const * const filename = own_file == true ? data->threads_filenames[id] : data->filename;
+    /* A descriptor per thread, OFD locks and flock() belong to it. */
+    int fd = open(filename,
+                  O_RDWR);
+
+    thread->pid = getpid();
+
+    if (fd != -1)
+    {
+        mt_fs_tests_prng prng;
+
+        mt_fs_tests_prng_thread_init(&prng, id);
+
+        for (uint64_t idx = 0;
+             result == 0 &&
+                 idx < data->iterations;
+             idx++)
+        {
+            size_t first = 0;
+            size_t count = 1;
+            mt_fs_tests_op op;
+
+            if (data->pattern == locks_mt_pattern_disjoint)
+            {
+                first = id;
+            }
+            else if (data->pattern == locks_mt_pattern_overlapping)
+            {
+                first = (size_t) mt_fs_tests_prng_bounded(&prng, data->nb_threads);
+                count = 2;
+            }
+
+            off_t const start = data->pattern == locks_mt_pattern_whole ? 0 : (off_t) (first * data->region_size);
+            off_t const length = data->pattern == locks_mt_pattern_whole ? 0 : (off_t) (count * data->region_size);
+
+            mt_fs_tests_op_begin(&op,
+                                 "lock");
+
+            result = locks_mt_lock(data,
+                                   fd,
+                                   start,
+                                   length,
+                                   F_WRLCK);
+
+            mt_fs_tests_op_end(&op,
+                               result);
+
+            if (result == 0)
+            {
+                thread->locks++;
+
+                for (size_t region = first;
+                     region < first + count;
+                     region++)
+                {
+                    if (__atomic_add_fetch(&(data->holders[region]), 1, __ATOMIC_ACQ_REL) > 1)
+                    {
+                        thread->violations++;
+                    }
+                }
+
+                for (size_t region = first;
+                     result == 0 &&
+                         region < first + count;
+                     region++)
+                {
+                    result = locks_mt_increment(fd,
+                                                own_file == true ? 0 : (off_t) (region * data->region_size));
+                }
+
+                for (size_t region = first;
+                     region < first + count;
+                     region++)
+                {
+                    __atomic_sub_fetch(&(data->holders[region]), 1, __ATOMIC_ACQ_REL);
+                }
+
+                mt_fs_tests_op_begin(&op,
+                                     "unlock");
+
+                int const res = locks_mt_lock(data,
+                                              fd,
+                                              start,
+                                              length,
+                                              F_UNLCK);
+
+                mt_fs_tests_op_end(&op,
+                                   res);
+
+                if (res != 0)
+                {
+                    LOG_ERROR("Error unlocking %s: %d",
+                              filename,
+                              res);
+                    result = result == 0 ? res : result;
+                }
+            }
+            else
+            {
+                LOG_ERROR("Error locking %s: %d",
+                          filename,
+                          result);
+            }
+
+            mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                     result);
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  filename,
+                  result);
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+
+    return 0;
+}
+
+static int locks_mt_read_counter(char const * const filename,
+                                 off_t const offset,
+                                 uint64_t * const counter)
+{
+    int result = 0;
+    int fd = open(filename,
+                  O_RDONLY);
+
+    if (fd != -1)
+    {
+        if (pread(fd, counter, sizeof *counter, offset) != (ssize_t) sizeof *counter)
+        {
+            result = errno != 0 ? errno : EIO;
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error reading the counter of %s at %lld: %d",
+                  filename,
+                  (long long int) offset,
+                  result);
+    }
+
+    return result;
+}
+
+/* Whether several threads ran in the same process, POSIX locks not
+   excluding them from each other. */
+__attribute__ ((__pure__))
+static bool locks_mt_threads_share_process(locks_mt_data const * const data)
+{
+    bool result = false;
+
+    for (size_t id = 1;
+         result == false &&
+             id < data->nb_threads;
+         id++)
+    {
+        result = data->threads[id].pid == data->threads[0].pid;
+    }
+
+    return result;
+}
+
+static int locks_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    locks_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    uint64_t locks = 0;
+    uint64_t violations = 0;
+    uint64_t increments = 0;
+    uint64_t counted = 0;
+    int res = 0;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        locks += data->threads[id].locks;
+        violations += data->threads[id].violations;
+
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->threads[id].outcomes));
+    }
+
+    increments = data->pattern == locks_mt_pattern_overlapping ? 2 * locks : locks;
+
+    for (size_t region = 0;
+         res == 0 &&
+             region < data->nb_regions;
+         region++)
+    {
+        uint64_t counter = 0;
+
+        if (locks_mt_thread_files(data) == true)
+        {
+            res = locks_mt_read_counter(data->threads_filenames[region],
+                                        0,
+                                        &counter);
+        }
+        else
+        {
+            res = locks_mt_read_counter(data->filename,
+                                        (off_t) (region * data->region_size),
+                                        &counter);
+        }
+
+        counted += counter;
+    }
+
+    if (data->type == locks_mt_type_posix &&
+        locks_mt_threads_share_process(data) == true)
+    {
+        LOG_OK("%s locks on %s regions, mutual exclusion not checked: threads of a process share their POSIX locks, use --workers=process",
+               locks_mt_types_names[data->type],
+               locks_mt_patterns_names[data->pattern]);
+    }
+    else if (res == 0 &&
+             violations == 0 &&
+             counted == increments)
+    {
+        LOG_OK("%s locks on %s regions, mutual exclusion verified over %llu locks.",
+               locks_mt_types_names[data->type],
+               locks_mt_patterns_names[data->pattern],
+               (unsigned long long) locks);
+    }
+    else
+    {
+        LOG_ERROR("Error, %s locks on %s regions, %llu regions held by several threads at once, counters add up to %llu for %llu increments",
+                  locks_mt_types_names[data->type],
+                  locks_mt_patterns_names[data->pattern],
+                  (unsigned long long) violations,
+                  (unsigned long long) counted,
+                  (unsigned long long) increments);
+    }
+
+    /* Every lock is taken. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads * data->iterations }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int locks_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    locks_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        locks_mt_remove_files(data);
+
+        if (data->threads != NULL)
+        {
+            mt_fs_tests_shared_free(data->threads), data->threads = NULL;
+        }
+
+        if (data->holders != NULL)
+        {
+            mt_fs_tests_shared_free(data->holders), data->holders = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_locks_mt =
+{
+    "locks_mt",
+    &locks_mt_init,
+    &locks_mt_run,
+    &locks_mt_post_run,
+    &locks_mt_deinit,
+    test_suite_type_mt
+};
@@ -0,0 +1,964 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "barrier.h"
+#include "histogram.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Change notifications under a metadata storm: the first
+   notify_mt.watchers threads watch a directory with inotify or fanotify,
+   while the other threads repeatedly create, rename and unlink files in
+   it. Each of these cycles yields four events per watcher: create, moved
+   from, moved to and delete. Names carry the time at which they were
+   created or renamed, giving the latency of create and moved to events,
+   from the system call to the return of the read() delivering them.
+   Reported are the events delivered per second, the queue overflows, the
+   events lost and the latency percentiles. Before watches are added, the
+   storm is first run alone, to measure how much watchers slow it down.
+
+   Options:
+   - notify_mt.api: inotify (default), or fanotify, which requires
+     CAP_SYS_ADMIN and reports names since Linux 5.9;
+   - notify_mt.watchers: threads watching the directory, each with an
+     instance of its own (default 1). Other threads run the storm;
+   - notify_mt.iterations: create, rename and unlink cycles per storm
+     thread (default 10000);
+   - notify_mt.buffer_size: size of the buffer events are read into
+     (default 256k);
+   - notify_mt.baseline: run the storm without watchers first (default
+     true).
+
+   The size of the queues is set by /proc/sys/fs/inotify/max_queued_events
+   for inotify, and is 16384 events for fanotify. */
+
+#define DIRECTORY_TEMPLATE "notify_suite_XXXXXX"
+#define CREATED_NAME_FORMAT "%s/c%zu_%llu_%llu"
+#define RENAMED_NAME_FORMAT "%s/m%zu_%llu_%llu"
+#define PATH_SIZE (256)
+#define DEFAULT_WATCHERS (1)
+#define DEFAULT_ITERATIONS (10000)
+#define DEFAULT_BUFFER_SIZE (256 * 1024)
+/* Once the storm is over, watchers stop when no event came for that
+   long, events lost to overflows never coming. */
+#define DRAIN_TIMEOUT_MS (100)
+#define EVENTS_PER_CYCLE (4)
+
+typedef enum
+{
+    notify_mt_api_inotify = 0,
+    notify_mt_api_fanotify,
+    notify_mt_api_count
+} notify_mt_api;
+
+static char const * const notify_mt_apis_names[] =
+{
+    "inotify",
+    "fanotify",
+};
+
+typedef enum
+{
+    notify_mt_phase_baseline = 0,
+    notify_mt_phase_watched,
+    notify_mt_phase_count
+} notify_mt_phase;
+
+static char const * const notify_mt_phases_names[] =
+{
+    "without watchers",
+    "with watchers",
+};
+
+typedef struct
+{
+    /* Storm threads, counting cycles. */
+    mt_fs_tests_phase phases[notify_mt_phase_count];
+    /* Watchers. */
+    uint64_t events;
+    uint64_t overflows;
+    uint64_t last_event_ns;
+    mt_fs_tests_histogram latencies;
+    mt_fs_tests_outcomes outcomes;
+} notify_mt_thread;
+
+typedef struct
+{
+    mt_fs_tests_barrier_t barrier;
+    size_t storms_done;
+    notify_mt_thread threads[];
+} notify_mt_shared;
+
+typedef struct {
+    char * directory;
+    notify_mt_shared * shared;
+    size_t nb_threads;
+    uint64_t nb_watchers;
+    uint64_t iterations;
+    uint64_t buffer_size;
+    notify_mt_api api;
+    bool baseline;
+    bool barrier_initialized;
+} notify_mt_data;
+
+static int notify_mt_get_options(notify_mt_data * const data)
+{
+    char const * const api = mt_fs_tests_option_get_string("notify_mt.api",
+                                                           "inotify");
+    int result = mt_fs_tests_option_get_uint64("notify_mt.watchers",
+                                               DEFAULT_WATCHERS,
+                                               &(data->nb_watchers));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("notify_mt.iterations",
+                                               DEFAULT_ITERATIONS,
+                                               &(data->iterations));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("notify_mt.buffer_size",
+                                             DEFAULT_BUFFER_SIZE,
+                                             &(data->buffer_size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_bool("notify_mt.baseline",
+                                             true,
+                                             &(data->baseline));
+    }
+
+    if (result == 0 &&
+        data->nb_watchers >= data->nb_threads)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid notify_mt.watchers, %llu for %zu threads, leaving no thread for the storm",
+                  (unsigned long long) data->nb_watchers,
+                  data->nb_threads);
+    }
+
+    if (result == 0 &&
+        data->buffer_size < sizeof (struct inotify_event) + NAME_MAX + 1)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid notify_mt.buffer_size, at least %zu bytes are needed to read an event",
+                  sizeof (struct inotify_event) + NAME_MAX + 1);
+    }
+
+    if (result == 0)
+    {
+        result = ENOENT;
+
+        for (size_t idx = 0;
+             result == ENOENT &&
+                 idx < notify_mt_api_count;
+             idx++)
+        {
+            if (strcasecmp(api, notify_mt_apis_names[idx]) == 0)
+            {
+                data->api = (notify_mt_api) idx;
+                result = 0;
+            }
+        }
+
+        if (result != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid api %s", api);
+        }
+    }
+
+    return result;
+}
+
+/* Returns a non-blocking descriptor watching directory in *fd. */
+static int notify_mt_watch(notify_mt_data const * const data,
+                           int * const fd)
+{
+    int result = 0;
+    assert(fd != NULL);
+
+    if (data->api == notify_mt_api_inotify)
+    {
+        *fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+        if (*fd != -1)
+        {
+            if (inotify_add_watch(*fd,
+                                  data->directory,
+                                  IN_CREATE | IN_MOVED_FROM | IN_MOVED_TO | IN_DELETE) == -1)
+            {
+                result = errno;
+                LOG_ERROR("Error watching %s with inotify: %d",
+                          data->directory,
+                          result);
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating an inotify instance: %d",
+                      result);
+        }
+    }
+    else
+    {
+        *fd = fanotify_init(FAN_CLASS_NOTIF | FAN_CLOEXEC | FAN_NONBLOCK | FAN_REPORT_DFID_NAME,
+                            O_RDONLY);
+
+        if (*fd != -1)
+        {
+            if (fanotify_mark(*fd,
+                              FAN_MARK_ADD,
+                              FAN_CREATE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE,
+                              AT_FDCWD,
+                              data->directory) != 0)
+            {
+                result = errno;
+                LOG_ERROR("Error watching %s with fanotify: %d",
+                          data->directory,
+                          result);
+            }
+        }
+        else
+        {
+            result = errno;
+
+            if (result == EPERM)
+            {
+                LOG_ERROR("Error creating a fanotify instance, CAP_SYS_ADMIN is required");
+            }
+            else
+            {
+                LOG_ERROR("Error creating a fanotify instance: %d",
+                          result);
+            }
+        }
+    }
+
+    if (result != 0 &&
+        *fd != -1)
+    {
+        close(*fd), *fd = -1;
+    }
+
+    return result;
+}
+
+static void notify_mt_remove_files(notify_mt_data * const data)
+{
+    if (data->directory != NULL)
+    {
+        /* Storm threads stopping at an error may leave a file behind,
+           whose name cannot be predicted. */
+        DIR * dir = opendir(data->directory);
+
+        if (dir != NULL)
+        {
+            struct dirent const * entry = NULL;
+            int const dir_fd = dirfd(dir);
+
+            while ((entry = readdir(dir)) != NULL)
+            {
+                if (strcmp(entry->d_name, ".") != 0 &&
+                    strcmp(entry->d_name, "..") != 0)
+                {
+                    unlinkat(dir_fd, entry->d_name, 0);
+                }
+            }
+
+            closedir(dir), dir = NULL;
+        }
+
+        rmdir(data->directory);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+static int notify_mt_init(void ** test_suite_data,
+                          size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    assert(nb_threads > 0);
+    assert(nb_threads <= UINT_MAX);
+    notify_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = notify_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->shared = mt_fs_tests_shared_calloc(1,
+                                                     sizeof *(data->shared) + nb_threads * sizeof *(data->shared->threads));
+
+            if (data->shared != NULL)
+            {
+                for (size_t id = 0;
+                     id < nb_threads;
+                     id++)
+                {
+                    mt_fs_tests_histogram_reset(&(data->shared->threads[id].latencies));
+                }
+
+                result = mt_fs_tests_barrier_init_shared(&(data->shared->barrier),
+                                                         (unsigned int) nb_threads);
+
+                if (result == 0)
+                {
+                    data->barrier_initialized = true;
+                }
+                else
+                {
+                    LOG_ERROR("Error creating phases barrier: %d",
+                              result);
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            data->directory = strdup(DIRECTORY_TEMPLATE);
+
+            if (data->directory != NULL)
+            {
+                if (mkdtemp(data->directory) == NULL)
+                {
+                    result = errno;
+                    LOG_ERROR("Error in mkdtemp: %d",
+                              result);
+                    free(data->directory), data->directory = NULL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            /* Fails early when fanotify is not permitted or lacks
+               names. */
+            int fd = -1;
+
+            result = notify_mt_watch(data,
+                                     &fd);
+
+            if (result == 0)
+            {
+                close(fd), fd = -1;
+            }
+        }
+
+        if (result == 0)
+        {
+            LOG_DEBUG("%llu %s watchers, %zu storm threads of %llu cycles",
+                      (unsigned long long) data->nb_watchers,
+                      notify_mt_apis_names[data->api],
+                      nb_threads - (size_t) data->nb_watchers,
+                      (unsigned long long) data->iterations);
+            *test_suite_data = data;
+        }
+        else
+        {
+            notify_mt_remove_files(data);
+
+            if (data->shared != NULL)
+            {
+                if (data->barrier_initialized == true)
+                {
+                    mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+                }
+
+                mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int notify_mt_storm_cycle(notify_mt_data const * const data,
+                                 size_t const id,
+                                 uint64_t const idx)
+{
+    int result = 0;
+    char created[PATH_SIZE];
+    char renamed[PATH_SIZE];
+    mt_fs_tests_op op;
+    mt_fs_tests_outcomes * const outcomes = &(data->shared->threads[id].outcomes);
+
+    mt_fs_tests_op_begin(&op,
+                         "create");
+
+    snprintf(created,
+             sizeof created,
+             CREATED_NAME_FORMAT,
+             data->directory,
+             id,
+             (unsigned long long) idx,
+             (unsigned long long) mt_fs_tests_now_ns());
+
+    int fd = open(created,
+                  O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    mt_fs_tests_op_end(&op,
+                       result);
+
+    mt_fs_tests_outcomes_add(outcomes,
+                             result);
+
+    if (result == 0)
+    {
+        mt_fs_tests_op_begin(&op,
+                             "rename");
+
+        snprintf(renamed,
+                 sizeof renamed,
+                 RENAMED_NAME_FORMAT,
+                 data->directory,
+                 id,
+                 (unsigned long long) idx,
+                 (unsigned long long) mt_fs_tests_now_ns());
+
+        if (rename(created, renamed) != 0)
+        {
+            result = errno;
+        }
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        mt_fs_tests_outcomes_add(outcomes,
+                                 result);
+
+        if (result == 0)
+        {
+            mt_fs_tests_op_begin(&op,
+                                 "unlink");
+
+            if (unlink(renamed) != 0)
+            {
+                result = errno;
+            }
+
+            mt_fs_tests_op_end(&op,
+                               result);
+
+            mt_fs_tests_outcomes_add(outcomes,
+                                     result);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error removing %s: %d",
+                          renamed,
+                          result);
+            }
+        }
+        else
+        {
+            LOG_ERROR("Error renaming %s to %s: %d",
+                      created,
+                      renamed,
+                      result);
+        }
+    }
+    else
+    {
+        LOG_ERROR("Error creating %s: %d",
+                  created,
+                  result);
+    }
+
+    return result;
+}
+
+static int notify_mt_storm(notify_mt_data const * const data,
+                           size_t const id,
+                           notify_mt_phase const phase)
+{
+    int result = 0;
+    mt_fs_tests_phase * const stats = &(data->shared->threads[id].phases[phase]);
+
+    mt_fs_tests_phase_begin(stats);
+
+    for (uint64_t idx = 0;
+         result == 0 &&
+             idx < data->iterations;
+         idx++)
+    {
+        result = notify_mt_storm_cycle(data,
+                                       id,
+                                       idx);
+
+        if (result == 0)
+        {
+            stats->count++;
+        }
+    }
+
+    mt_fs_tests_phase_end(stats);
+
+    return result;
+}
+
+/* Names are <c or m><thread>_<cycle>_<time in ns>. */
+static void notify_mt_record_latency(notify_mt_thread * const thread,
+                                     char const * const name,
+                                     uint64_t const now_ns)
+{
+    char const * const time = strrchr(name, '_');
+
+    if (time != NULL)
+    {
+        uint64_t const sent_ns = strtoull(time + 1, NULL, 10);
+
+        if (sent_ns > 0 &&
+            sent_ns <= now_ns)
+        {
+            mt_fs_tests_histogram_record(&(thread->latencies),
+                                         now_ns - sent_ns);
+        }
+    }
+}
+
+static void notify_mt_parse_inotify(notify_mt_thread * const thread,
+                                    char const * const buffer,
+                                    size_t const size,
+                                    uint64_t const now_ns)
+{
+    size_t offset = 0;
+
+    while (offset + sizeof (struct inotify_event) <= size)
+    {
+        struct inotify_event const * const event = (struct inotify_event const *) (buffer + offset);
+
+        if ((event->mask & IN_Q_OVERFLOW) != 0)
+        {
+            thread->overflows++;
+        }
+        else
+        {
+            thread->events++;
+
+            if (event->len > 0 &&
+                (event->mask & (IN_CREATE | IN_MOVED_TO)) != 0)
+            {
+                notify_mt_record_latency(thread,
+                                         event->name,
+                                         now_ns);
+            }
+        }
+
+        offset += sizeof (struct inotify_event) + event->len;
+    }
+}
+
+static void notify_mt_parse_fanotify(notify_mt_thread * const thread,
+                                     char const * const buffer,
+                                     size_t const size,
+                                     uint64_t const now_ns)
+{
+    struct fanotify_event_metadata const * event = (struct fanotify_event_metadata const *) buffer;
+    /* Named by FAN_EVENT_OK(). */
+    ssize_t len = (ssize_t) size;
+
+    for (;
+         FAN_EVENT_OK(event, len);
+         event = FAN_EVENT_NEXT(event, len))
+    {
+        if (event->fd >= 0)
+        {
+            close(event->fd);
+        }
+
+        if ((event->mask & FAN_Q_OVERFLOW) != 0)
+        {
+            thread->overflows++;
+        }
+        else
+        {
+            uint64_t const mask = event->mask & (FAN_CREATE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_DELETE);
+            char const * info = (char const *) event + event->metadata_len;
+            char const * const end = (char const *) event + event->event_len;
+
+            /* Identical events may be merged in a single one. */
+            thread->events += (uint64_t) __builtin_popcountll(mask);
+
+            while (info + sizeof (struct fanotify_event_info_header) <= end)
+            {
+                struct fanotify_event_info_header const * const header = (struct fanotify_event_info_header const *) info;
+
+                if (header->len == 0)
+                {
+                    break;
+                }
+
+                if (header->info_type == FAN_EVENT_INFO_TYPE_DFID_NAME &&
+                    (mask & (FAN_CREATE | FAN_MOVED_TO)) != 0)
+                {
+                    struct fanotify_event_info_fid const * const fid = (struct fanotify_event_info_fid const *) info;
+                    struct file_handle const * const handle = (struct file_handle const *) fid->handle;
+
+                    notify_mt_record_latency(thread,
+                                             (char const *) handle->f_handle + handle->handle_bytes,
+                                             now_ns);
+                }
+
+                info += header->len;
+            }
+        }
+    }
+}
+
+static int notify_mt_drain(notify_mt_data const * const data,
+                           size_t const id,
+                           int const fd,
+                           char * const buffer)
+{
+    int result = 0;
+    notify_mt_thread * const thread = &(data->shared->threads[id]);
+    size_t const nb_storms = data->nb_threads - (size_t) data->nb_watchers;
+    uint64_t const expected = (uint64_t) nb_storms * data->iterations * EVENTS_PER_CYCLE;
+    bool done = false;
+
+    while (result == 0 &&
+           done == false)
+    {
+        bool const storm_over = __atomic_load_n(&(data->shared->storms_done), __ATOMIC_ACQUIRE) == nb_storms;
+        struct pollfd pfd =
+            {
+                .fd = fd,
+                .events = POLLIN,
+                .revents = 0
+            };
+        int const res = poll(&pfd,
+                             1,
+                             DRAIN_TIMEOUT_MS);
+
+        if (res > 0)
+        {
+            ssize_t const got = read(fd,
+                                     buffer,
+                                     data->buffer_size);
+
+            if (got > 0)
+            {
+                uint64_t const now_ns = mt_fs_tests_now_ns();
+
+                if (data->api == notify_mt_api_inotify)
+                {
+                    notify_mt_parse_inotify(thread,
+                                            buffer,
+                                            (size_t) got,
+                                            now_ns);
+                }
+                else
+                {
+                    notify_mt_parse_fanotify(thread,
+                                             buffer,
+                                             (size_t) got,
+                                             now_ns);
+                }
+
+                thread->last_event_ns = now_ns;
+                done = storm_over == true &&
+                    thread->events >= expected;
+            }
+            else if (got == -1 &&
+                     errno != EAGAIN &&
+                     errno != EINTR)
+            {
+                result = errno;
+                LOG_ERROR("Error reading events: %d",
+                          result);
+            }
+        }
+        else if (res == 0)
+        {
+            done = storm_over;
+        }
+        else if (errno != EINTR)
+        {
+            result = errno;
+            LOG_ERROR("Error polling events: %d",
+                      result);
+        }
+    }
+
+    return result;
+}
+
+static int notify_mt_run(void * const test_suite_data,
+                         size_t const id)
+{
+    int result = 0;
+    notify_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    bool const watcher = id < data->nb_watchers;
+    notify_mt_thread * const thread = &(data->shared->threads[id]);
+
+    if (data->baseline == true)
+    {
+        if (watcher == false)
+        {
+            result = notify_mt_storm(data,
+                                     id,
+                                     notify_mt_phase_baseline);
+        }
+
+        mt_fs_tests_barrier_wait(&(data->shared->barrier));
+    }
+
+    if (watcher == true)
+    {
+        int fd = -1;
+        char * buffer = malloc(data->buffer_size);
+
+        if (buffer != NULL)
+        {
+            result = notify_mt_watch(data,
+                                     &fd);
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+
+        /* The storm starts once all watches are in place, even those
+           which could not be. */
+        mt_fs_tests_barrier_wait(&(data->shared->barrier));
+
+        if (result == 0)
+        {
+            result = notify_mt_drain(data,
+                                     id,
+                                     fd,
+                                     buffer);
+        }
+
+        if (fd != -1)
+        {
+            close(fd), fd = -1;
+        }
+
+        free(buffer), buffer = NULL;
+
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+    else
+    {
+        mt_fs_tests_barrier_wait(&(data->shared->barrier));
+
+        if (result == 0)
+        {
+            notify_mt_storm(data,
+                            id,
+                            notify_mt_phase_watched);
+        }
+
+        /* Even after a failure, watchers wait for every storm thread. */
+        __atomic_add_fetch(&(data->shared->storms_done), 1, __ATOMIC_RELEASE);
+    }
+
+    return 0;
+}
+
+static int notify_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    notify_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    mt_fs_tests_histogram latencies;
+    mt_fs_tests_phase totals[notify_mt_phase_count];
+    double rates[notify_mt_phase_count] = { 0 };
+    uint64_t last_event_ns = 0;
+    uint64_t events = 0;
+    uint64_t overflows = 0;
+    assert(data != NULL);
+    size_t const nb_watchers = (size_t) data->nb_watchers;
+    size_t const nb_storms = data->nb_threads - nb_watchers;
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+    mt_fs_tests_histogram_reset(&latencies);
+
+    for (size_t phase = 0;
+         phase < notify_mt_phase_count;
+         phase++)
+    {
+        double elapsed;
+
+        mt_fs_tests_phase_reset(&(totals[phase]));
+
+        for (size_t id = nb_watchers;
+             id < data->nb_threads;
+             id++)
+        {
+            mt_fs_tests_phase_merge(&(totals[phase]),
+                                    &(data->shared->threads[id].phases[phase]));
+        }
+
+        elapsed = mt_fs_tests_phase_elapsed(&(totals[phase]));
+
+        if (elapsed > 0.0)
+        {
+            rates[phase] = (double) totals[phase].count / elapsed;
+
+            LOG_OK("storm %s: %llu cycles in %.3f s, %.1f cycles/s",
+                   notify_mt_phases_names[phase],
+                   (unsigned long long) totals[phase].count,
+                   elapsed,
+                   rates[phase]);
+        }
+    }
+
+    uint64_t const storm_start_ns = rates[notify_mt_phase_watched] > 0.0 ? totals[notify_mt_phase_watched].start_ns : 0;
+
+    if (rates[notify_mt_phase_baseline] > 0.0 &&
+        rates[notify_mt_phase_watched] > 0.0)
+    {
+        LOG_OK("storm slowed down by %.1f%% with %zu %s watchers",
+               (1.0 - rates[notify_mt_phase_watched] / rates[notify_mt_phase_baseline]) * 100.0,
+               nb_watchers,
+               notify_mt_apis_names[data->api]);
+    }
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        notify_mt_thread const * const thread = &(data->shared->threads[id]);
+
+        if (id < nb_watchers)
+        {
+            events += thread->events;
+            overflows += thread->overflows;
+            last_event_ns = thread->last_event_ns > last_event_ns ? thread->last_event_ns : last_event_ns;
+
+            mt_fs_tests_histogram_merge(&latencies,
+                                        &(thread->latencies));
+        }
+
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(thread->outcomes));
+    }
+
+    if (last_event_ns > storm_start_ns &&
+        storm_start_ns > 0)
+    {
+        uint64_t const expected = totals[notify_mt_phase_watched].count * EVENTS_PER_CYCLE * nb_watchers;
+        double const elapsed = (double) (last_event_ns - storm_start_ns) / (double) MT_FS_TESTS_NS_PER_SEC;
+
+        LOG_OK("%s: %llu events delivered in %.3f s, %.1f events/s, %llu queue overflows, %llu events lost",
+               notify_mt_apis_names[data->api],
+               (unsigned long long) events,
+               elapsed,
+               (double) events / elapsed,
+               (unsigned long long) overflows,
+               (unsigned long long) (expected > events ? expected - events : 0));
+    }
+
+    if (latencies.count > 0)
+    {
+        uint64_t const p50 = mt_fs_tests_histogram_percentile(&latencies, 50.0);
+        uint64_t const p99 = mt_fs_tests_histogram_percentile(&latencies, 99.0);
+
+        LOG_OK("event latency (us): p50 %.1f p99 %.1f max %.1f over %llu create and moved to events",
+               (double) p50 / 1000.0,
+               (double) p99 / 1000.0,
+               (double) latencies.max / 1000.0,
+               (unsigned long long) latencies.count);
+    }
+
+    /* Every cycle of every phase goes through, and watchers drain their
+       events until the storm is over. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, nb_storms * data->iterations * 3 * (data->baseline == true ? 2 : 1) + nb_watchers }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int notify_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    notify_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        notify_mt_remove_files(data);
+
+        if (data->shared != NULL)
+        {
+            mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+            mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_notify_mt =
+{
+    "notify_mt",
+    &notify_mt_init,
+    &notify_mt_run,
+    &notify_mt_post_run,
+    &notify_mt_deinit,
+    test_suite_type_mt
+};
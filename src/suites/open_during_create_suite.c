@@ -8,24 +8,33 @@
 #include <sys/types.h>
 #include <unistd.h>
 
+#include "ops.h"
+#include "outcomes.h"
+#include "races.h"
+#include "shared_memory.h"
 #include "test_suites.h"
 #include "utils.h"
 
 #define FILENAME_TEMPLATE "open_during_create_suite_XXXXXX"
 #define ATTEMPTS_PER_THREAD (100)
 
-typedef struct
-{
-    int results[ATTEMPTS_PER_THREAD];
-} open_during_create_mt_thread_results;
-
 typedef struct
 {
     char * filename;
-    open_during_create_mt_thread_results * threads_results;
+    /* One per thread. */
+    mt_fs_tests_outcomes * threads_outcomes;
     size_t nb_threads;
+    /* Only one client of a coordinator creates the file. */
+    bool create;
 } open_during_create_mt_data;
 
+/* The file is created once, opens either find it or not. */
+static mt_fs_tests_expectation const open_during_create_mt_expectations[] =
+{
+    { 0, mt_fs_tests_expect_at_least, 1 },
+    { ENOENT, mt_fs_tests_expect_any, 0 },
+};
+
 static int open_during_create_mt_init(void ** test_suite_data,
                                       size_t const nb_threads)
 {
@@ -35,35 +44,30 @@ static int open_during_create_mt_init(void ** test_suite_data,
 
     if (data != NULL)
     {
-        data->threads_results = malloc(sizeof *(data->threads_results) * nb_threads);
+        data->threads_outcomes = mt_fs_tests_shared_calloc(nb_threads,
+                                                           sizeof *(data->threads_outcomes));
 
-        if (data->threads_results != NULL)
+        if (data->threads_outcomes != NULL)
         {
-            for (size_t idx = 0;
-                 idx < nb_threads;
-                 idx++)
-            {
-                for (size_t th_idx = 0;
-                     th_idx < ATTEMPTS_PER_THREAD;
-                     th_idx++)
-                {
-                    data->threads_results[idx].results[th_idx] = -1;
-                }
-            }
-
             data->nb_threads = nb_threads;
 
             data->filename = strdup(FILENAME_TEMPLATE);
 
             if (data->filename != NULL)
             {
-                if (mktemp(data->filename) != NULL)
+                result = mt_fs_tests_races_target(data->filename,
+                                                  open_during_create_mt_expectations,
+                                                  sizeof open_during_create_mt_expectations / sizeof *open_during_create_mt_expectations,
+                                                  &(data->create));
+
+                if (result == 0)
                 {
                     *test_suite_data = data;
                 }
                 else
                 {
-                    result = errno;
+                    LOG_ERROR("Error naming the target of the race: %d",
+                              result);
                 }
 
                 if (result != 0)
@@ -78,7 +82,7 @@ static int open_during_create_mt_init(void ** test_suite_data,
 
             if (result != 0)
             {
-                free(data->threads_results), data->threads_results = NULL;
+                mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
             }
         }
         else
@@ -113,14 +117,18 @@ static int open_during_create_mt_run(void * test_suite_data,
          idx++)
     {
         bool created = false;
-        assert(data->threads_results[id].results[idx] == -1);
+        mt_fs_tests_op op;
+        int outcome = 0;
 
         result = 0;
 
-        if (id == (data->nb_threads / 2) &&
+        if (data->create == true &&
+            id == (data->nb_threads / 2) &&
             (ATTEMPTS_PER_THREAD > 1 &&
              idx == ATTEMPTS_PER_THREAD / 2))
         {
+            mt_fs_tests_op_begin(&op,
+                                 "create");
             fd = open(data->filename,
                       O_CREAT | O_EXCL | O_WRONLY,
                       S_IRUSR | S_IWUSR);
@@ -128,6 +136,8 @@ static int open_during_create_mt_run(void * test_suite_data,
         }
         else
         {
+            mt_fs_tests_op_begin(&op,
+                                 "open");
             fd = open(data->filename,
                       O_RDONLY);
         }
@@ -151,13 +161,18 @@ static int open_during_create_mt_run(void * test_suite_data,
                 }
             }
 
-            data->threads_results[id].results[idx] = result;
+            outcome = result;
             close(fd), fd = -1;
         }
         else
         {
-            data->threads_results[id].results[idx] = errno;
+            outcome = errno;
         }
+
+        mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                 outcome);
+        mt_fs_tests_op_end(&op,
+                           outcome);
     }
 
     return result;
@@ -167,51 +182,28 @@ static int open_during_create_mt_post_run(void * test_suite_data)
 {
     int result = 0;
     open_during_create_mt_data * data = test_suite_data;
-    size_t enoent_count = 0;
-    size_t ok_count = 0;
-    size_t invalid_count = 0;
+    mt_fs_tests_outcomes outcomes;
     assert(data != NULL);
 
+    mt_fs_tests_outcomes_reset(&outcomes);
+
     for (size_t th_idx = 0;
          th_idx < data->nb_threads;
          th_idx++)
     {
-        for (size_t idx = 0;
-             idx < ATTEMPTS_PER_THREAD;
-             idx++)
-        {
-            if (data->threads_results[th_idx].results[idx] == 0)
-            {
-                ok_count++;
-            }
-            else if (data->threads_results[th_idx].results[idx] == ENOENT)
-            {
-                enoent_count++;
-            }
-            else
-            {
-                LOG_ERROR("Thread %zu got %d",
-                          th_idx,
-                          data->threads_results[th_idx].results[idx]);
-                invalid_count++;
-            }
-        }
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->threads_outcomes[th_idx]));
     }
 
-    if ((enoent_count + ok_count) == (data->nb_threads * ATTEMPTS_PER_THREAD) &&
-        ok_count >= 1)
+    if (mt_fs_tests_races_shared() == true)
     {
-        LOG_OK("Success (%zu / %zu / %zu)!",
-               ok_count,
-               enoent_count,
-               invalid_count);
+        LOG_OK("Outcomes checked by the coordinator, along with those of the other clients");
     }
     else
     {
-        LOG_ERROR("Error, we got %zu valid open, %zu does not exist and %zu invalid return codes.",
-                  ok_count,
-                  enoent_count,
-                  invalid_count);
+        mt_fs_tests_outcomes_check(&outcomes,
+                                   open_during_create_mt_expectations,
+                                   sizeof open_during_create_mt_expectations / sizeof *open_during_create_mt_expectations);
     }
 
     return result;
@@ -224,9 +216,9 @@ static int open_during_create_mt_deinit(void * test_suite_data)
 
     if (data != NULL)
     {
-        if (data->threads_results != NULL)
+        if (data->threads_outcomes != NULL)
         {
-            free(data->threads_results), data->threads_results = NULL;
+            mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
         }
 
         if (data->filename != NULL)
@@ -0,0 +1,3355 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "cold_cache.h"
+#include "ops.h"
+#include "options.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Replays the filesystem syscalls of a trace captured with
+   strace -f -ttt -o <file>, given with -o replay_mt.trace=<path>.
+
+   Each thread of the trace is replayed by its own worker, thread i of the
+   trace, in order of first appearance, by worker i modulo the number of
+   workers. Paths are mapped to a sandbox directory created in the current
+   directory, files and directories the trace expects to exist being created
+   beforehand, with the size the trace read from them or saw in stat
+   results. File descriptors are mapped from the traced ones to the replayed
+   ones, fds opened before the trace started, sockets and pipes being
+   ignored along with the syscalls using them.
+
+   Descriptors are mapped per traced process, told apart with the clone,
+   clone3, fork and vfork lines of the trace: threads, and children created
+   with CLONE_FILES, share the descriptors of their parent, other children
+   get a copy of them, duplicated when the fork is replayed. A thread whose
+   creation is not in the trace, as when strace attaches to a running
+   service with -p, is taken as a process of its own, the descriptors other
+   threads opened being unknown to it.
+
+   A syscall on a descriptor last used by another traced thread waits for
+   that one to be replayed, keeping the order of the trace on shared
+   descriptors at the cost of some concurrency. Descriptors only exist in
+   the worker process which opened them though: with process workers, such
+   a syscall replayed by another worker fails with EBADF, and is counted
+   apart from divergences.
+
+   Options:
+   - replay_mt.timing: asap (default) replays syscalls back to back, preserve
+     keeps the think times of the trace, syscalls being issued at the same
+     time relative to the start of the replay as in the trace;
+   - replay_mt.speed: with preserve timing, factor applied to the pace of the
+     trace (default 1.0, 2.0 replays twice as fast);
+   - replay_mt.convert=<path>: writes the parsed trace in a compact binary
+     form, in native byte order, which replay_mt.trace then loads without
+     parsing the strace output again.
+
+   Latency is reported per syscall. A syscall succeeding where the traced one
+   failed, or the reverse, is counted as a divergence from the trace, not as
+   an error of the suite. */
+
+#define DIRECTORY_TEMPLATE "replay_suite_XXXXXX"
+#define REPLAY_MT_MAGIC "MTFSRPL2"
+#define REPLAY_MT_MAX_ARGS (6)
+#define REPLAY_MT_MAX_FD (1 << 20)
+#define REPLAY_MT_MAX_IO_SIZE (16 * 1024 * 1024)
+#define REPLAY_MT_NO_PATH (UINT32_MAX)
+#define REPLAY_MT_NO_OP (UINT32_MAX)
+#define REPLAY_MT_NO_TABLE (UINT32_MAX)
+#define REPLAY_MT_FILL_SIZE (65536)
+#define REPLAY_MT_UNFINISHED "<unfinished ...>"
+#define REPLAY_MT_RESUMED " resumed>"
+
+typedef enum
+{
+    replay_mt_syscall_open = 0,
+    replay_mt_syscall_openat,
+    replay_mt_syscall_creat,
+    replay_mt_syscall_close,
+    replay_mt_syscall_read,
+    replay_mt_syscall_pread64,
+    replay_mt_syscall_write,
+    replay_mt_syscall_pwrite64,
+    replay_mt_syscall_lseek,
+    replay_mt_syscall_fstat,
+    replay_mt_syscall_stat,
+    replay_mt_syscall_lstat,
+    replay_mt_syscall_newfstatat,
+    replay_mt_syscall_statx,
+    replay_mt_syscall_fsync,
+    replay_mt_syscall_fdatasync,
+    replay_mt_syscall_ftruncate,
+    replay_mt_syscall_truncate,
+    replay_mt_syscall_unlink,
+    replay_mt_syscall_unlinkat,
+    replay_mt_syscall_rmdir,
+    replay_mt_syscall_mkdir,
+    replay_mt_syscall_mkdirat,
+    replay_mt_syscall_rename,
+    replay_mt_syscall_renameat,
+    replay_mt_syscall_renameat2,
+    /* fork, vfork, clone and clone3 creating a process with a copy of the
+       descriptors of its parent. */
+    replay_mt_syscall_fork,
+    replay_mt_syscall_count
+} replay_mt_syscall;
+
+static char const * const replay_mt_syscall_names[] =
+{
+    "open",
+    "openat",
+    "creat",
+    "close",
+    "read",
+    "pread64",
+    "write",
+    "pwrite64",
+    "lseek",
+    "fstat",
+    "stat",
+    "lstat",
+    "newfstatat",
+    "statx",
+    "fsync",
+    "fdatasync",
+    "ftruncate",
+    "truncate",
+    "unlink",
+    "unlinkat",
+    "rmdir",
+    "mkdir",
+    "mkdirat",
+    "rename",
+    "renameat",
+    "renameat2",
+    "fork",
+};
+
+typedef struct
+{
+    char const * name;
+    long long value;
+} replay_mt_constant;
+
+/* Symbolic values strace prints for the arguments we replay. O_DIRECT is
+   left out on purpose, the alignment of replayed buffers being unknown. */
+static replay_mt_constant const replay_mt_constants[] =
+{
+    { "AT_FDCWD", AT_FDCWD },
+    { "AT_EMPTY_PATH", AT_EMPTY_PATH },
+    { "AT_REMOVEDIR", AT_REMOVEDIR },
+    { "AT_SYMLINK_NOFOLLOW", AT_SYMLINK_NOFOLLOW },
+    { "AT_NO_AUTOMOUNT", AT_NO_AUTOMOUNT },
+    { "O_RDONLY", O_RDONLY },
+    { "O_WRONLY", O_WRONLY },
+    { "O_RDWR", O_RDWR },
+    { "O_CREAT", O_CREAT },
+    { "O_EXCL", O_EXCL },
+    { "O_NOCTTY", O_NOCTTY },
+    { "O_TRUNC", O_TRUNC },
+    { "O_APPEND", O_APPEND },
+    { "O_NONBLOCK", O_NONBLOCK },
+    { "O_DSYNC", O_DSYNC },
+    { "O_SYNC", O_SYNC },
+    { "O_DIRECTORY", O_DIRECTORY },
+    { "O_NOFOLLOW", O_NOFOLLOW },
+    { "O_NOATIME", O_NOATIME },
+    { "O_CLOEXEC", O_CLOEXEC },
+    { "O_PATH", O_PATH },
+    { "RENAME_NOREPLACE", RENAME_NOREPLACE },
+    { "RENAME_EXCHANGE", RENAME_EXCHANGE },
+    { "SEEK_SET", SEEK_SET },
+    { "SEEK_CUR", SEEK_CUR },
+    { "SEEK_END", SEEK_END },
+    { "SEEK_DATA", SEEK_DATA },
+    { "SEEK_HOLE", SEEK_HOLE },
+};
+
+/* Fixed size, written as is in the binary form of a trace. */
+typedef struct
+{
+    /* Relative to the first syscall of the trace. */
+    uint64_t timestamp_ns;
+    /* Count of read and write, length of truncate, descriptors table of
+       the child of fork. */
+    uint64_t size;
+    int64_t offset;
+    uint32_t path;
+    uint32_t path2;
+    uint32_t stream;
+    /* Descriptors table, that is traced process, of fd, and of the parent
+       for fork. */
+    uint32_t table;
+    /* Op of another stream which last used fd, to be replayed first,
+       REPLAY_MT_NO_OP otherwise. */
+    uint32_t after;
+    /* Traced fd operated on, or returned by open, -1 otherwise. */
+    int32_t fd;
+    /* Open, at, rename or lseek whence flags. */
+    int32_t flags;
+    uint32_t mode;
+    uint8_t syscall;
+    /* The traced syscall failed. */
+    uint8_t failed;
+    /* fd was opened by another stream. */
+    uint8_t foreign;
+    uint8_t padding[5];
+} replay_mt_op;
+
+typedef struct
+{
+    /* Normalized path, relative to the sandbox. */
+    char * relative;
+    char * full;
+    uint64_t size;
+    bool seen;
+    /* The trace expects it to exist before its first use. */
+    bool precreate;
+    bool directory;
+} replay_mt_path;
+
+typedef struct
+{
+    char magic[8];
+    uint64_t nb_ops;
+    uint64_t nb_paths;
+    uint64_t nb_streams;
+    uint64_t nb_tables;
+} replay_mt_header;
+
+typedef struct
+{
+    uint64_t size;
+    uint32_t length;
+    uint8_t precreate;
+    uint8_t directory;
+    uint8_t padding[2];
+} replay_mt_path_header;
+
+typedef struct
+{
+    long pid;
+    /* Syscall waiting for its <... resumed> line. */
+    char * pending;
+    uint64_t pending_ns;
+    /* Descriptors table, REPLAY_MT_NO_TABLE until the stream opens a file
+       or its creation is seen. */
+    uint32_t table;
+    uint32_t first_op;
+} replay_mt_stream;
+
+typedef struct
+{
+    uint32_t path;
+    uint64_t position;
+    /* Last op on this fd, REPLAY_MT_NO_OP if none. Kept once closed, a
+       later open of the same fd being ordered after the close. */
+    uint32_t last;
+    /* Open, or fork for a copy, giving this fd. */
+    uint32_t opener;
+} replay_mt_parse_fd;
+
+/* Descriptors of a traced process, shared by its threads. */
+typedef struct
+{
+    replay_mt_parse_fd * fds;
+    size_t nb_fds;
+} replay_mt_parse_table;
+
+/* State only needed while parsing a text trace. */
+typedef struct
+{
+    replay_mt_stream * streams;
+    size_t streams_capacity;
+    replay_mt_parse_table * tables;
+    size_t tables_capacity;
+    uint32_t * buckets;
+    size_t nb_buckets;
+    uint64_t first_ns;
+    bool has_first;
+    size_t nb_lines;
+    size_t skipped;
+} replay_mt_parser;
+
+typedef struct
+{
+    replay_mt_op * ops;
+    size_t nb_ops;
+    size_t ops_capacity;
+    replay_mt_path * paths;
+    size_t nb_paths;
+    size_t paths_capacity;
+    size_t nb_streams;
+    size_t nb_tables;
+    char * directory;
+    /* Replayed fd of each traced one, shared by the threads of a worker
+       process. Those of table i are fds[tables_first[i]] to
+       fds[tables_first[i + 1]] excluded. */
+    int * fds;
+    size_t nb_fds;
+    size_t * tables_first;
+    /* Operations of worker i are worker_ops[worker_first[i]] to
+       worker_ops[worker_first[i + 1]] excluded. */
+    uint32_t * worker_ops;
+    size_t * worker_first;
+    size_t io_size;
+    bool preserve;
+    double speed;
+    uint64_t * start_ns;
+    /* Ops replayed, for those ordered after them. */
+    uint8_t * done;
+    uint64_t * divergences;
+    /* Syscalls on an fd which another stream should have opened. */
+    uint64_t * unavailable;
+    int * results;
+    size_t nb_threads;
+} replay_mt_data;
+
+static int replay_mt_grow(void ** const array,
+                          size_t * const capacity,
+                          size_t const needed,
+                          size_t const element_size)
+{
+    int result = 0;
+
+    if (needed > *capacity)
+    {
+        size_t new_capacity = *capacity > 0 ? *capacity * 2 : 64;
+        void * new_array = NULL;
+
+        while (new_capacity < needed)
+        {
+            new_capacity *= 2;
+        }
+
+        new_array = realloc(*array, new_capacity * element_size);
+
+        if (new_array != NULL)
+        {
+            memset((char *) new_array + *capacity * element_size,
+                   0,
+                   (new_capacity - *capacity) * element_size);
+            *array = new_array;
+            *capacity = new_capacity;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+__attribute__ ((__pure__))
+static uint64_t replay_mt_hash(char const * str)
+{
+    /* FNV-1a */
+    uint64_t result = UINT64_C(14695981039346656037);
+
+    for (;
+         *str != '\0';
+         str++)
+    {
+        result ^= (unsigned char) *str;
+        result *= UINT64_C(1099511628211);
+    }
+
+    return result;
+}
+
+static int replay_mt_rehash(replay_mt_data const * const data,
+                            replay_mt_parser * const parser)
+{
+    int result = 0;
+    size_t const nb_buckets = parser->nb_buckets > 0 ? parser->nb_buckets * 2 : 1024;
+    uint32_t * const buckets = calloc(nb_buckets, sizeof *buckets);
+
+    if (buckets != NULL)
+    {
+        for (size_t idx = 0;
+             idx < data->nb_paths;
+             idx++)
+        {
+            size_t bucket = (size_t) replay_mt_hash(data->paths[idx].relative) & (nb_buckets - 1);
+
+            while (buckets[bucket] != 0)
+            {
+                bucket = (bucket + 1) & (nb_buckets - 1);
+            }
+
+            /* 0 marks empty buckets. */
+            buckets[bucket] = (uint32_t) idx + 1;
+        }
+
+        free(parser->buckets);
+        parser->buckets = buckets;
+        parser->nb_buckets = nb_buckets;
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+/* Appends the components of path to the normalized path in out, resolving
+   . and .. without ever going above the sandbox. */
+static void replay_mt_normalize(char * const out,
+                                size_t * const out_len,
+                                char const * path)
+{
+    while (*path != '\0')
+    {
+        char const * const end = strchrnul(path, '/');
+        size_t const len = (size_t) (end - path);
+
+        if (len == 0 ||
+            (len == 1 && path[0] == '.'))
+        {
+        }
+        else if (len == 2 &&
+                 path[0] == '.' &&
+                 path[1] == '.')
+        {
+            while (*out_len > 0 &&
+                   out[*out_len - 1] != '/')
+            {
+                (*out_len)--;
+            }
+
+            if (*out_len > 0)
+            {
+                (*out_len)--;
+            }
+        }
+        else
+        {
+            if (*out_len > 0)
+            {
+                out[(*out_len)++] = '/';
+            }
+
+            memcpy(out + *out_len, path, len);
+            *out_len += len;
+        }
+
+        path = *end == '/' ? end + 1 : end;
+    }
+
+    out[*out_len] = '\0';
+}
+
+static int replay_mt_intern_path(replay_mt_data * const data,
+                                 replay_mt_parser * const parser,
+                                 char const * const base,
+                                 char const * const raw,
+                                 uint32_t * const path_idx)
+{
+    int result = 0;
+    size_t const base_len = base != NULL ? strlen(base) : 0;
+    char * const normalized = malloc(base_len + strlen(raw) + 3);
+
+    if (normalized != NULL)
+    {
+        size_t len = 0;
+        size_t bucket = 0;
+
+        normalized[0] = '\0';
+
+        if (base != NULL &&
+            strcmp(base, ".") != 0)
+        {
+            replay_mt_normalize(normalized, &len, base);
+        }
+
+        replay_mt_normalize(normalized, &len, raw);
+
+        if (len == 0)
+        {
+            strcpy(normalized, ".");
+        }
+
+        if ((data->nb_paths + 1) * 2 > parser->nb_buckets)
+        {
+            result = replay_mt_rehash(data,
+                                      parser);
+        }
+
+        if (result == 0)
+        {
+            bucket = (size_t) replay_mt_hash(normalized) & (parser->nb_buckets - 1);
+
+            while (parser->buckets[bucket] != 0 &&
+                   strcmp(data->paths[parser->buckets[bucket] - 1].relative, normalized) != 0)
+            {
+                bucket = (bucket + 1) & (parser->nb_buckets - 1);
+            }
+
+            if (parser->buckets[bucket] != 0)
+            {
+                *path_idx = parser->buckets[bucket] - 1;
+                free(normalized);
+            }
+            else if (data->nb_paths < REPLAY_MT_NO_PATH - 1)
+            {
+                result = replay_mt_grow((void **) &(data->paths),
+                                        &(data->paths_capacity),
+                                        data->nb_paths + 1,
+                                        sizeof *(data->paths));
+
+                if (result == 0)
+                {
+                    *path_idx = (uint32_t) data->nb_paths;
+                    data->paths[data->nb_paths].relative = normalized;
+                    data->nb_paths++;
+                    parser->buckets[bucket] = *path_idx + 1;
+                }
+                else
+                {
+                    free(normalized);
+                }
+            }
+            else
+            {
+                result = E2BIG;
+                free(normalized);
+            }
+        }
+        else
+        {
+            free(normalized);
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+/* Parses numbers and symbolic values, possibly or'ed, unknown symbols
+   counting as 0. A 3</path> fd printed by strace -y parses as 3. */
+static int replay_mt_parse_value(char const * const arg,
+                                 long long * const value)
+{
+    int result = 0;
+    char const * token = arg;
+
+    *value = 0;
+
+    while (result == 0 &&
+           *token != '\0')
+    {
+        char const * const end = strchrnul(token, '|');
+
+        if (isdigit((unsigned char) *token) ||
+            *token == '-')
+        {
+            char * num_end = NULL;
+            errno = 0;
+            *value |= strtoll(token, &num_end, 0);
+
+            if (errno != 0 ||
+                num_end == token)
+            {
+                result = EINVAL;
+            }
+        }
+        else if (isupper((unsigned char) *token))
+        {
+            for (size_t idx = 0;
+                 idx < sizeof replay_mt_constants / sizeof *replay_mt_constants;
+                 idx++)
+            {
+                size_t const len = strlen(replay_mt_constants[idx].name);
+
+                if ((size_t) (end - token) == len &&
+                    strncmp(token, replay_mt_constants[idx].name, len) == 0)
+                {
+                    *value |= replay_mt_constants[idx].value;
+                }
+            }
+        }
+        else
+        {
+            result = EINVAL;
+        }
+
+        token = *end == '|' ? end + 1 : end;
+    }
+
+    return result;
+}
+
+/* Decodes, in place, a string argument as printed by strace. */
+static int replay_mt_parse_string(char * const arg)
+{
+    int result = 0;
+    char const * in = arg + 1;
+    char * out = arg;
+
+    if (arg[0] == '"')
+    {
+        while (*in != '"' &&
+               *in != '\0')
+        {
+            if (*in == '\\' &&
+                in[1] != '\0')
+            {
+                in++;
+
+                switch(*in)
+                {
+                case 'n':
+                    *out++ = '\n';
+                    in++;
+                    break;
+                case 't':
+                    *out++ = '\t';
+                    in++;
+                    break;
+                case 'r':
+                    *out++ = '\r';
+                    in++;
+                    break;
+                case 'x':
+                {
+                    char * end = NULL;
+                    char hex[3] = { in[1], in[1] != '\0' ? in[2] : '\0', '\0' };
+                    *out++ = (char) strtol(hex, &end, 16);
+                    in += 1 + (end - hex);
+                    break;
+                }
+                default:
+                    if (*in >= '0' &&
+                        *in <= '7')
+                    {
+                        int octal = 0;
+
+                        for (size_t digits = 0;
+                             digits < 3 &&
+                                 *in >= '0' &&
+                                 *in <= '7';
+                             digits++)
+                        {
+                            octal = octal * 8 + (*in - '0');
+                            in++;
+                        }
+
+                        *out++ = (char) octal;
+                    }
+                    else
+                    {
+                        *out++ = *in++;
+                    }
+                    break;
+                }
+            }
+            else
+            {
+                *out++ = *in++;
+            }
+        }
+
+        if (*in != '"')
+        {
+            result = EINVAL;
+        }
+
+        *out = '\0';
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+/* Returns the parenthesis closing the arguments starting at args, skipping
+   strings, structures and arrays. */
+__attribute__ ((__pure__))
+static char * replay_mt_args_end(char * args)
+{
+    char * result = NULL;
+    size_t depth = 0;
+    bool in_string = false;
+
+    for (;
+         result == NULL &&
+             *args != '\0';
+         args++)
+    {
+        if (in_string == true)
+        {
+            if (*args == '\\' &&
+                args[1] != '\0')
+            {
+                args++;
+            }
+            else if (*args == '"')
+            {
+                in_string = false;
+            }
+        }
+        else if (*args == '"')
+        {
+            in_string = true;
+        }
+        else if (*args == '(' ||
+                 *args == '{' ||
+                 *args == '[')
+        {
+            depth++;
+        }
+        else if (*args == ')' &&
+                 depth == 0)
+        {
+            result = args;
+        }
+        else if ((*args == ')' ||
+                  *args == '}' ||
+                  *args == ']') &&
+                 depth > 0)
+        {
+            depth--;
+        }
+    }
+
+    return result;
+}
+
+static size_t replay_mt_split_args(char * args,
+                                   char ** const argv,
+                                   size_t const max_args)
+{
+    size_t argc = 0;
+    size_t depth = 0;
+    bool in_string = false;
+    char * start = args;
+
+    while (*start == ' ')
+    {
+        start++;
+    }
+
+    for (;
+         argc < max_args;
+         args++)
+    {
+        if (*args == '\0' ||
+            (*args == ',' && depth == 0 && in_string == false))
+        {
+            bool const last = *args == '\0';
+
+            *args = '\0';
+
+            if (*start != '\0' ||
+                last == false)
+            {
+                argv[argc++] = start;
+            }
+
+            if (last == true)
+            {
+                break;
+            }
+
+            start = args + 1;
+
+            while (*start == ' ')
+            {
+                start++;
+            }
+        }
+        else if (in_string == true)
+        {
+            if (*args == '\\' &&
+                args[1] != '\0')
+            {
+                args++;
+            }
+            else if (*args == '"')
+            {
+                in_string = false;
+            }
+        }
+        else if (*args == '"')
+        {
+            in_string = true;
+        }
+        else if (*args == '(' ||
+                 *args == '{' ||
+                 *args == '[')
+        {
+            depth++;
+        }
+        else if ((*args == ')' ||
+                  *args == '}' ||
+                  *args == ']') &&
+                 depth > 0)
+        {
+            depth--;
+        }
+    }
+
+    return argc;
+}
+
+static int replay_mt_parse_timestamp(char const * const str,
+                                     char ** const end,
+                                     uint64_t * const timestamp_ns)
+{
+    int result = 0;
+    unsigned long long seconds = 0;
+
+    errno = 0;
+    seconds = strtoull(str, end, 10);
+
+    if (errno == 0 &&
+        *end != str &&
+        **end == '.')
+    {
+        uint64_t fraction = 0;
+        uint64_t scale = MT_FS_TESTS_NS_PER_SEC;
+
+        for ((*end)++;
+             isdigit((unsigned char) **end);
+             (*end)++)
+        {
+            if (scale > 1)
+            {
+                scale /= 10;
+                fraction += (uint64_t) (**end - '0') * scale;
+            }
+        }
+
+        *timestamp_ns = (uint64_t) seconds * MT_FS_TESTS_NS_PER_SEC + fraction;
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+static replay_mt_parse_fd * replay_mt_parse_fd_get(replay_mt_parser * const parser,
+                                                   uint32_t const stream,
+                                                   long long const fd)
+{
+    replay_mt_parse_fd * result = NULL;
+    uint32_t const table = parser->streams[stream].table;
+
+    if (table != REPLAY_MT_NO_TABLE &&
+        fd >= 0 &&
+        (size_t) fd < parser->tables[table].nb_fds &&
+        parser->tables[table].fds[fd].path != REPLAY_MT_NO_PATH)
+    {
+        result = &(parser->tables[table].fds[fd]);
+    }
+
+    return result;
+}
+
+/* Entry of fd in a descriptors table, growing it as needed. */
+static int replay_mt_parse_fd_slot(replay_mt_parser * const parser,
+                                   uint32_t const table,
+                                   long long const fd,
+                                   replay_mt_parse_fd ** const slot)
+{
+    int result = 0;
+    replay_mt_parse_table * const fds = &(parser->tables[table]);
+
+    if (fd >= 0 &&
+        fd < REPLAY_MT_MAX_FD)
+    {
+        size_t const previous = fds->nb_fds;
+
+        result = replay_mt_grow((void **) &(fds->fds),
+                                &(fds->nb_fds),
+                                (size_t) fd + 1,
+                                sizeof *(fds->fds));
+
+        for (size_t idx = previous;
+             result == 0 &&
+                 idx < fds->nb_fds;
+             idx++)
+        {
+            fds->fds[idx].path = REPLAY_MT_NO_PATH;
+            fds->fds[idx].last = REPLAY_MT_NO_OP;
+            fds->fds[idx].opener = REPLAY_MT_NO_OP;
+        }
+
+        if (result == 0)
+        {
+            *slot = &(fds->fds[fd]);
+        }
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+/* Gives a stream a descriptors table of its own if it has none yet. */
+static int replay_mt_stream_table(replay_mt_data * const data,
+                                  replay_mt_parser * const parser,
+                                  uint32_t const stream,
+                                  uint32_t * const table)
+{
+    int result = 0;
+
+    if (parser->streams[stream].table == REPLAY_MT_NO_TABLE)
+    {
+        result = data->nb_tables < REPLAY_MT_NO_TABLE ? 0 : EINVAL;
+
+        if (result == 0)
+        {
+            result = replay_mt_grow((void **) &(parser->tables),
+                                    &(parser->tables_capacity),
+                                    data->nb_tables + 1,
+                                    sizeof *(parser->tables));
+        }
+
+        if (result == 0)
+        {
+            parser->streams[stream].table = (uint32_t) data->nb_tables;
+            data->nb_tables++;
+        }
+    }
+
+    *table = parser->streams[stream].table;
+
+    return result;
+}
+
+/* Orders op after the last one on fd when another stream replays that one,
+   the replayed fd only existing once that stream opened it, and being gone
+   once it closed it. */
+static void replay_mt_parse_fd_use(replay_mt_data const * const data,
+                                   replay_mt_parse_fd * const fd,
+                                   replay_mt_op * const op)
+{
+    if (fd->last < data->nb_ops &&
+        data->ops[fd->last].stream != op->stream)
+    {
+        op->after = fd->last;
+    }
+
+    if (fd->opener < data->nb_ops &&
+        data->ops[fd->opener].stream != op->stream)
+    {
+        op->foreign = 1;
+    }
+
+    fd->last = data->nb_ops < REPLAY_MT_NO_OP ? (uint32_t) data->nb_ops : REPLAY_MT_NO_OP;
+}
+
+static int replay_mt_parse_fd_open(replay_mt_data * const data,
+                                   replay_mt_parser * const parser,
+                                   long long const fd,
+                                   replay_mt_op * const op)
+{
+    replay_mt_parse_fd * slot = NULL;
+    int result = replay_mt_stream_table(data,
+                                        parser,
+                                        op->stream,
+                                        &(op->table));
+
+    if (result == 0)
+    {
+        result = replay_mt_parse_fd_slot(parser,
+                                         op->table,
+                                         fd,
+                                         &slot);
+    }
+
+    if (result == 0)
+    {
+        slot->path = op->path;
+        slot->position = 0;
+        slot->opener = data->nb_ops < REPLAY_MT_NO_OP ? (uint32_t) data->nb_ops : REPLAY_MT_NO_OP;
+        op->fd = (int32_t) fd;
+        replay_mt_parse_fd_use(data,
+                               slot,
+                               op);
+    }
+
+    return result;
+}
+
+/* The child stream turns out to share the descriptors table of its parent.
+   When it opened files before the clone was resumed in the trace, those move
+   to the table of the parent along with the ops using them. */
+static int replay_mt_share_table(replay_mt_data * const data,
+                                 replay_mt_parser * const parser,
+                                 uint32_t const child,
+                                 uint32_t const table)
+{
+    int result = 0;
+    uint32_t const own = parser->streams[child].table;
+
+    if (own != REPLAY_MT_NO_TABLE &&
+        own != table)
+    {
+        replay_mt_parse_table * const from = &(parser->tables[own]);
+
+        for (size_t fd = 0;
+             result == 0 &&
+                 fd < from->nb_fds;
+             fd++)
+        {
+            replay_mt_parse_fd * slot = NULL;
+
+            if (from->fds[fd].path != REPLAY_MT_NO_PATH)
+            {
+                result = replay_mt_parse_fd_slot(parser,
+                                                 table,
+                                                 (long long) fd,
+                                                 &slot);
+
+                if (result == 0)
+                {
+                    *slot = from->fds[fd];
+                }
+            }
+        }
+
+        for (size_t idx = parser->streams[child].first_op;
+             result == 0 &&
+                 idx < data->nb_ops;
+             idx++)
+        {
+            replay_mt_op * const op = &(data->ops[idx]);
+
+            if (op->table == own)
+            {
+                op->table = table;
+            }
+
+            if (op->syscall == replay_mt_syscall_fork &&
+                op->size == own)
+            {
+                op->size = table;
+            }
+        }
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < data->nb_streams;
+             idx++)
+        {
+            if (parser->streams[idx].table == own)
+            {
+                parser->streams[idx].table = table;
+            }
+        }
+
+        free(from->fds), from->fds = NULL;
+        from->nb_fds = 0;
+    }
+
+    parser->streams[child].table = table;
+
+    return result;
+}
+
+/* Gives a child the open descriptors of its parent, replayed once the fork
+   op duplicated them. Those the child already opened itself, before the
+   fork was resumed in the trace, are kept. */
+static int replay_mt_copy_table(replay_mt_data const * const data,
+                                replay_mt_parser * const parser,
+                                uint32_t const parent,
+                                uint32_t const child)
+{
+    int result = 0;
+
+    for (size_t fd = 0;
+         result == 0 &&
+             fd < parser->tables[parent].nb_fds;
+         fd++)
+    {
+        replay_mt_parse_fd const entry = parser->tables[parent].fds[fd];
+        replay_mt_parse_fd * slot = NULL;
+
+        if (entry.path != REPLAY_MT_NO_PATH)
+        {
+            result = replay_mt_parse_fd_slot(parser,
+                                             child,
+                                             (long long) fd,
+                                             &slot);
+
+            if (result == 0 &&
+                slot->last == REPLAY_MT_NO_OP)
+            {
+                slot->path = entry.path;
+                slot->position = entry.position;
+                slot->last = data->nb_ops < REPLAY_MT_NO_OP ? (uint32_t) data->nb_ops : REPLAY_MT_NO_OP;
+                slot->opener = slot->last;
+            }
+        }
+    }
+
+    return result;
+}
+
+/* Records what the first use of a path tells about its existence before
+   the trace started. */
+static void replay_mt_path_use(replay_mt_path * const path,
+                               bool const exists)
+{
+    if (path->seen == false)
+    {
+        path->seen = true;
+        path->precreate = exists;
+    }
+}
+
+static void replay_mt_path_grow(replay_mt_path * const path,
+                                uint64_t const size)
+{
+    if (size > path->size)
+    {
+        path->size = size;
+    }
+}
+
+/* Size and type found in a stat structure printed by strace. */
+static void replay_mt_path_stat(replay_mt_path * const path,
+                                char const * const args)
+{
+    char const * size = strstr(args, "st_size=");
+
+    if (size == NULL)
+    {
+        size = strstr(args, "stx_size=");
+    }
+
+    if (size != NULL)
+    {
+        replay_mt_path_grow(path,
+                            strtoull(strchr(size, '=') + 1, NULL, 10));
+    }
+
+    if (strstr(args, "S_IFDIR") != NULL)
+    {
+        path->directory = true;
+    }
+}
+
+static int replay_mt_arg_value(char * const * const argv,
+                               size_t const argc,
+                               size_t const idx,
+                               long long * const value)
+{
+    int result = EINVAL;
+
+    if (idx < argc)
+    {
+        result = replay_mt_parse_value(argv[idx],
+                                       value);
+    }
+
+    return result;
+}
+
+/* Resolves a path argument relative to dirfd, AT_FDCWD and unknown
+   directory fds resolving to the root of the sandbox. */
+static int replay_mt_arg_path(replay_mt_data * const data,
+                              replay_mt_parser * const parser,
+                              uint32_t const stream,
+                              char * const * const argv,
+                              size_t const argc,
+                              long long const dirfd,
+                              size_t const idx,
+                              uint32_t * const path)
+{
+    int result = EINVAL;
+
+    if (idx < argc)
+    {
+        result = replay_mt_parse_string(argv[idx]);
+
+        if (result == 0)
+        {
+            replay_mt_parse_fd const * const dir = replay_mt_parse_fd_get(parser,
+                                                                          stream,
+                                                                          dirfd);
+            char const * const base = argv[idx][0] != '/' && dir != NULL ? data->paths[dir->path].relative : NULL;
+
+            result = replay_mt_intern_path(data,
+                                           parser,
+                                           base,
+                                           argv[idx],
+                                           path);
+        }
+    }
+
+    return result;
+}
+
+/* An fd argument has to be one opened in the trace by the same process. */
+static int replay_mt_arg_fd(replay_mt_data const * const data,
+                            replay_mt_parser * const parser,
+                            char * const * const argv,
+                            size_t const argc,
+                            size_t const idx,
+                            replay_mt_op * const op,
+                            replay_mt_parse_fd ** const fd)
+{
+    long long value = 0;
+    int result = replay_mt_arg_value(argv,
+                                     argc,
+                                     idx,
+                                     &value);
+
+    if (result == 0)
+    {
+        *fd = replay_mt_parse_fd_get(parser,
+                                     op->stream,
+                                     value);
+
+        if (*fd != NULL)
+        {
+            op->fd = (int32_t) value;
+            op->table = parser->streams[op->stream].table;
+            replay_mt_parse_fd_use(data,
+                                   *fd,
+                                   op);
+        }
+        else
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+static int replay_mt_parse_open(replay_mt_data * const data,
+                                replay_mt_parser * const parser,
+                                char * const * const argv,
+                                size_t const argc,
+                                long long const ret,
+                                bool const eexist,
+                                replay_mt_op * const op)
+{
+    int result = 0;
+    long long dirfd = AT_FDCWD;
+    long long flags = O_CREAT | O_WRONLY | O_TRUNC;
+    long long mode = 0;
+    size_t path_idx = 0;
+
+    if (op->syscall == replay_mt_syscall_openat)
+    {
+        result = replay_mt_arg_value(argv, argc, 0, &dirfd);
+        path_idx = 1;
+    }
+
+    if (result == 0 &&
+        op->syscall != replay_mt_syscall_creat)
+    {
+        result = replay_mt_arg_value(argv, argc, path_idx + 1, &flags);
+
+        if (result == 0 &&
+            path_idx + 2 < argc)
+        {
+            result = replay_mt_arg_value(argv, argc, path_idx + 2, &mode);
+        }
+    }
+    else if (result == 0)
+    {
+        result = replay_mt_arg_value(argv, argc, path_idx + 1, &mode);
+    }
+
+    if (result == 0)
+    {
+        result = replay_mt_arg_path(data, parser, op->stream, argv, argc, dirfd, path_idx, &(op->path));
+    }
+
+    if (result == 0)
+    {
+        replay_mt_path * const path = &(data->paths[op->path]);
+        bool const creates = (flags & O_CREAT) != 0 && (flags & (O_EXCL | O_TRUNC)) != 0;
+
+        op->flags = (int32_t) (flags & ~((long long) O_DIRECT));
+        op->mode = (uint32_t) mode;
+
+        replay_mt_path_use(path,
+                           op->failed == false ? creates == false : eexist);
+
+        if ((flags & O_DIRECTORY) != 0)
+        {
+            path->directory = true;
+        }
+
+        if (op->failed == false)
+        {
+            result = replay_mt_parse_fd_open(data,
+                                             parser,
+                                             ret,
+                                             op);
+        }
+    }
+
+    return result;
+}
+
+static int replay_mt_parse_io(replay_mt_data * const data,
+                              replay_mt_parser * const parser,
+                              char * const * const argv,
+                              size_t const argc,
+                              long long const ret,
+                              replay_mt_op * const op)
+{
+    replay_mt_parse_fd * fd = NULL;
+    long long count = 0;
+    long long offset = -1;
+    bool const positioned = op->syscall == replay_mt_syscall_pread64 ||
+        op->syscall == replay_mt_syscall_pwrite64;
+    int result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+    if (result == 0)
+    {
+        result = replay_mt_arg_value(argv, argc, 2, &count);
+    }
+
+    if (result == 0 &&
+        positioned == true)
+    {
+        result = replay_mt_arg_value(argv, argc, 3, &offset);
+    }
+
+    if (result == 0 &&
+        count >= 0)
+    {
+        op->size = (uint64_t) count;
+        op->offset = offset;
+
+        if (op->failed == false)
+        {
+            uint64_t const start = positioned == true ? (uint64_t) offset : fd->position;
+            uint64_t const end = start + (uint64_t) ret;
+
+            if (op->syscall == replay_mt_syscall_read ||
+                op->syscall == replay_mt_syscall_pread64)
+            {
+                replay_mt_path_grow(&(data->paths[fd->path]),
+                                    end);
+            }
+
+            if (positioned == false)
+            {
+                fd->position = end;
+            }
+        }
+    }
+    else if (result == 0)
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+static int replay_mt_get_stream(replay_mt_data * const data,
+                                replay_mt_parser * const parser,
+                                long const pid,
+                                size_t * const stream)
+{
+    int result = ENOENT;
+
+    for (size_t idx = 0;
+         result == ENOENT &&
+             idx < data->nb_streams;
+         idx++)
+    {
+        if (parser->streams[idx].pid == pid)
+        {
+            *stream = idx;
+            result = 0;
+        }
+    }
+
+    if (result == ENOENT)
+    {
+        result = replay_mt_grow((void **) &(parser->streams),
+                                &(parser->streams_capacity),
+                                data->nb_streams + 1,
+                                sizeof *(parser->streams));
+
+        if (result == 0)
+        {
+            parser->streams[data->nb_streams].pid = pid;
+            parser->streams[data->nb_streams].table = REPLAY_MT_NO_TABLE;
+            parser->streams[data->nb_streams].first_op = (uint32_t) data->nb_ops;
+            *stream = data->nb_streams;
+            data->nb_streams++;
+        }
+    }
+
+    return result;
+}
+
+/* Threads, and children created with CLONE_FILES, share the descriptors
+   table of their parent, nothing being replayed for them. Other children
+   get a copy of it, made by the fork op. */
+static int replay_mt_parse_fork(replay_mt_data * const data,
+                                replay_mt_parser * const parser,
+                                char const * const args,
+                                long long const ret,
+                                replay_mt_op * const op)
+{
+    size_t child = 0;
+    uint32_t child_table = REPLAY_MT_NO_TABLE;
+    int result = op->failed == false && ret > 0 && ret <= LONG_MAX ? 0 : EINVAL;
+
+    if (result == 0)
+    {
+        result = replay_mt_get_stream(data,
+                                      parser,
+                                      (long) ret,
+                                      &child);
+    }
+
+    if (result == 0)
+    {
+        result = replay_mt_stream_table(data,
+                                        parser,
+                                        op->stream,
+                                        &(op->table));
+    }
+
+    if (result == 0 &&
+        strstr(args, "CLONE_FILES") != NULL)
+    {
+        result = replay_mt_share_table(data,
+                                       parser,
+                                       (uint32_t) child,
+                                       op->table);
+
+        if (result == 0)
+        {
+            /* Skipped, as syscalls not replayed. */
+            result = EINVAL;
+        }
+    }
+    else if (result == 0)
+    {
+        result = replay_mt_stream_table(data,
+                                        parser,
+                                        (uint32_t) child,
+                                        &child_table);
+
+        if (result == 0)
+        {
+            op->size = child_table;
+            result = replay_mt_copy_table(data,
+                                          parser,
+                                          op->table,
+                                          child_table);
+        }
+    }
+
+    return result;
+}
+
+static int replay_mt_parse_syscall(replay_mt_data * const data,
+                                   replay_mt_parser * const parser,
+                                   char * const * const argv,
+                                   size_t const argc,
+                                   char const * const stat_args,
+                                   long long const ret,
+                                   bool const eexist,
+                                   replay_mt_op * const op)
+{
+    int result = 0;
+    replay_mt_parse_fd * fd = NULL;
+    long long dirfd = AT_FDCWD;
+    long long value = 0;
+    bool const succeeded = op->failed == false;
+
+    switch(op->syscall)
+    {
+    case replay_mt_syscall_open:
+    case replay_mt_syscall_openat:
+    case replay_mt_syscall_creat:
+        result = replay_mt_parse_open(data, parser, argv, argc, ret, eexist, op);
+        break;
+    case replay_mt_syscall_close:
+        result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+        if (result == 0)
+        {
+            fd->path = REPLAY_MT_NO_PATH;
+        }
+        break;
+    case replay_mt_syscall_read:
+    case replay_mt_syscall_pread64:
+    case replay_mt_syscall_write:
+    case replay_mt_syscall_pwrite64:
+        result = replay_mt_parse_io(data, parser, argv, argc, ret, op);
+        break;
+    case replay_mt_syscall_lseek:
+        result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv, argc, 1, &value);
+            op->offset = value;
+        }
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv, argc, 2, &value);
+            op->flags = (int32_t) value;
+        }
+
+        if (result == 0 &&
+            succeeded == true)
+        {
+            fd->position = (uint64_t) ret;
+        }
+        break;
+    case replay_mt_syscall_fstat:
+    case replay_mt_syscall_fsync:
+    case replay_mt_syscall_fdatasync:
+        result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+        if (result == 0 &&
+            succeeded == true &&
+            op->syscall == replay_mt_syscall_fstat)
+        {
+            replay_mt_path_stat(&(data->paths[fd->path]),
+                                stat_args);
+        }
+        break;
+    case replay_mt_syscall_ftruncate:
+        result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv, argc, 1, &value);
+            op->size = (uint64_t) value;
+        }
+        break;
+    case replay_mt_syscall_newfstatat:
+    case replay_mt_syscall_statx:
+        result = replay_mt_arg_value(argv, argc, 0, &dirfd);
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv,
+                                         argc,
+                                         op->syscall == replay_mt_syscall_statx ? 2 : 3,
+                                         &value);
+            op->flags = (int32_t) value;
+        }
+
+        if (result == 0 &&
+            (value & AT_EMPTY_PATH) != 0 &&
+            argc > 1 &&
+            strcmp(argv[1], "\"\"") == 0)
+        {
+            result = replay_mt_arg_fd(data, parser, argv, argc, 0, op, &fd);
+
+            if (result == 0 &&
+                succeeded == true)
+            {
+                replay_mt_path_stat(&(data->paths[fd->path]),
+                                    stat_args);
+            }
+            break;
+        }
+        /* Fall through */
+    case replay_mt_syscall_stat:
+    case replay_mt_syscall_lstat:
+        if (result == 0)
+        {
+            bool const at = op->syscall == replay_mt_syscall_newfstatat ||
+                op->syscall == replay_mt_syscall_statx;
+
+            result = replay_mt_arg_path(data, parser, op->stream, argv, argc, dirfd, at == true ? 1 : 0, &(op->path));
+
+            if (result == 0)
+            {
+                replay_mt_path_use(&(data->paths[op->path]),
+                                   succeeded);
+
+                if (succeeded == true)
+                {
+                    replay_mt_path_stat(&(data->paths[op->path]),
+                                        stat_args);
+                }
+            }
+        }
+        break;
+    case replay_mt_syscall_truncate:
+        result = replay_mt_arg_path(data, parser, op->stream, argv, argc, AT_FDCWD, 0, &(op->path));
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv, argc, 1, &value);
+            op->size = (uint64_t) value;
+            replay_mt_path_use(&(data->paths[op->path]),
+                               succeeded);
+        }
+        break;
+    case replay_mt_syscall_unlinkat:
+    case replay_mt_syscall_mkdirat:
+        result = replay_mt_arg_value(argv, argc, 0, &dirfd);
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_value(argv, argc, 2, &value);
+        }
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_path(data, parser, op->stream, argv, argc, dirfd, 1, &(op->path));
+        }
+        /* Fall through */
+    case replay_mt_syscall_unlink:
+    case replay_mt_syscall_rmdir:
+    case replay_mt_syscall_mkdir:
+        if (result == 0 &&
+            op->syscall != replay_mt_syscall_unlinkat &&
+            op->syscall != replay_mt_syscall_mkdirat)
+        {
+            result = replay_mt_arg_path(data, parser, op->stream, argv, argc, AT_FDCWD, 0, &(op->path));
+
+            if (result == 0 &&
+                op->syscall == replay_mt_syscall_mkdir)
+            {
+                result = replay_mt_arg_value(argv, argc, 1, &value);
+            }
+        }
+
+        if (result == 0)
+        {
+            replay_mt_path * const path = &(data->paths[op->path]);
+            bool const mkdir_op = op->syscall == replay_mt_syscall_mkdir ||
+                op->syscall == replay_mt_syscall_mkdirat;
+
+            if (mkdir_op == true)
+            {
+                op->mode = (uint32_t) value;
+            }
+            else if (op->syscall == replay_mt_syscall_unlinkat)
+            {
+                op->flags = (int32_t) value;
+            }
+
+            replay_mt_path_use(path,
+                               mkdir_op == true ? eexist : succeeded);
+
+            if (mkdir_op == true ||
+                op->syscall == replay_mt_syscall_rmdir ||
+                (op->flags & AT_REMOVEDIR) != 0)
+            {
+                path->directory = true;
+            }
+        }
+        break;
+    case replay_mt_syscall_rename:
+    case replay_mt_syscall_renameat:
+    case replay_mt_syscall_renameat2:
+    {
+        bool const at = op->syscall != replay_mt_syscall_rename;
+        long long new_dirfd = AT_FDCWD;
+
+        if (at == true)
+        {
+            result = replay_mt_arg_value(argv, argc, 0, &dirfd);
+
+            if (result == 0)
+            {
+                result = replay_mt_arg_value(argv, argc, 2, &new_dirfd);
+            }
+        }
+
+        if (result == 0 &&
+            op->syscall == replay_mt_syscall_renameat2)
+        {
+            result = replay_mt_arg_value(argv, argc, 4, &value);
+            op->flags = (int32_t) value;
+        }
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_path(data, parser, op->stream, argv, argc, dirfd, at == true ? 1 : 0, &(op->path));
+        }
+
+        if (result == 0)
+        {
+            result = replay_mt_arg_path(data, parser, op->stream, argv, argc, new_dirfd, at == true ? 3 : 1, &(op->path2));
+        }
+
+        if (result == 0)
+        {
+            replay_mt_path_use(&(data->paths[op->path]),
+                               succeeded);
+            replay_mt_path_use(&(data->paths[op->path2]),
+                               (op->flags & RENAME_EXCHANGE) != 0 && succeeded == true);
+        }
+        break;
+    }
+    case replay_mt_syscall_fork:
+        result = replay_mt_parse_fork(data, parser, stat_args, ret, op);
+        break;
+    default:
+        assert(false);
+        result = EINVAL;
+        break;
+    }
+
+    return result;
+}
+
+/* Parses "name(args) = ret ..." and appends the replayable syscalls. */
+static int replay_mt_add_syscall(replay_mt_data * const data,
+                                 replay_mt_parser * const parser,
+                                 size_t const stream,
+                                 uint64_t const timestamp_ns,
+                                 char * const text)
+{
+    int result = EINVAL;
+    replay_mt_op op =
+        {
+            .timestamp_ns = timestamp_ns > parser->first_ns ? timestamp_ns - parser->first_ns : 0,
+            .path = REPLAY_MT_NO_PATH,
+            .path2 = REPLAY_MT_NO_PATH,
+            .stream = (uint32_t) stream,
+            .table = REPLAY_MT_NO_TABLE,
+            .after = REPLAY_MT_NO_OP,
+            .fd = -1,
+            .syscall = replay_mt_syscall_count,
+        };
+    char * const args = strchr(text, '(');
+    char * end = NULL;
+
+    if (args != NULL)
+    {
+        *args = '\0';
+
+        for (size_t idx = 0;
+             idx < replay_mt_syscall_count;
+             idx++)
+        {
+            if (strcmp(text, replay_mt_syscall_names[idx]) == 0)
+            {
+                op.syscall = (uint8_t) idx;
+            }
+        }
+
+        if (strcmp(text, "vfork") == 0 ||
+            strcmp(text, "clone") == 0 ||
+            strcmp(text, "clone3") == 0)
+        {
+            op.syscall = replay_mt_syscall_fork;
+        }
+
+        end = replay_mt_args_end(args + 1);
+    }
+
+    if (op.syscall != replay_mt_syscall_count &&
+        end != NULL &&
+        strncmp(end, ") = ", 4) == 0)
+    {
+        char * ret_end = NULL;
+        long long ret = 0;
+
+        *end = '\0';
+        errno = 0;
+        /* Interrupted syscalls return ?, skipped along with garbage. */
+        ret = strtoll(end + 4, &ret_end, 0);
+
+        if (errno == 0 &&
+            ret_end != end + 4)
+        {
+            char * argv[REPLAY_MT_MAX_ARGS];
+            char * const stat_args = strdup(args + 1);
+
+            while (*ret_end == ' ')
+            {
+                ret_end++;
+            }
+
+            op.failed = ret < 0;
+
+            if (stat_args != NULL)
+            {
+                size_t const argc = replay_mt_split_args(args + 1,
+                                                         argv,
+                                                         REPLAY_MT_MAX_ARGS);
+
+                result = replay_mt_parse_syscall(data,
+                                                 parser,
+                                                 argv,
+                                                 argc,
+                                                 stat_args,
+                                                 ret,
+                                                 ret < 0 && strncmp(ret_end, "EEXIST", 6) == 0,
+                                                 &op);
+
+                free(stat_args);
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+
+    if (result == 0 &&
+        data->nb_ops < UINT32_MAX)
+    {
+        result = replay_mt_grow((void **) &(data->ops),
+                                &(data->ops_capacity),
+                                data->nb_ops + 1,
+                                sizeof *(data->ops));
+
+        if (result == 0)
+        {
+            data->ops[data->nb_ops++] = op;
+        }
+    }
+    else if (result == EINVAL ||
+             result == 0)
+    {
+        /* Malformed, unsupported, or on an fd not opened in the trace. */
+        parser->skipped++;
+        result = 0;
+    }
+
+    return result;
+}
+
+static int replay_mt_parse_line(replay_mt_data * const data,
+                                replay_mt_parser * const parser,
+                                char * line)
+{
+    int result = 0;
+    size_t len = strlen(line);
+    long pid = 0;
+    uint64_t timestamp_ns = 0;
+    char * end = NULL;
+
+    while (len > 0 &&
+           isspace((unsigned char) line[len - 1]))
+    {
+        line[--len] = '\0';
+    }
+
+    /* [pid N] when strace writes to a terminal, N with -o, nothing when a
+       single thread is traced. */
+    if (strncmp(line, "[pid", 4) == 0)
+    {
+        pid = strtol(line + 4, &end, 10);
+        line = end;
+
+        if (*line == ']')
+        {
+            line++;
+        }
+    }
+    else
+    {
+        long const value = strtol(line, &end, 10);
+
+        if (end != line &&
+            *end != '.')
+        {
+            pid = value;
+            line = end;
+        }
+    }
+
+    while (*line == ' ')
+    {
+        line++;
+    }
+
+    if (replay_mt_parse_timestamp(line,
+                                  &end,
+                                  &timestamp_ns) == 0)
+    {
+        size_t stream = 0;
+
+        line = end;
+
+        while (*line == ' ')
+        {
+            line++;
+        }
+
+        if (parser->has_first == false)
+        {
+            parser->first_ns = timestamp_ns;
+            parser->has_first = true;
+        }
+
+        if (strncmp(line, "+++", 3) == 0 ||
+            strncmp(line, "---", 3) == 0)
+        {
+            /* Exits and signals */
+        }
+        else
+        {
+            result = replay_mt_get_stream(data,
+                                          parser,
+                                          pid,
+                                          &stream);
+        }
+
+        if (result == 0 &&
+            strncmp(line, "+++", 3) != 0 &&
+            strncmp(line, "---", 3) != 0)
+        {
+            replay_mt_stream * const current = &(parser->streams[stream]);
+            size_t const unfinished_len = sizeof REPLAY_MT_UNFINISHED - 1;
+
+            len = strlen(line);
+
+            if (strncmp(line, "<... ", 5) == 0)
+            {
+                char const * const resumed = strstr(line, REPLAY_MT_RESUMED);
+
+                if (resumed != NULL &&
+                    current->pending != NULL)
+                {
+                    /* Detached first, a resumed clone adding streams, which
+                       moves them. */
+                    char * pending = current->pending;
+                    uint64_t const pending_ns = current->pending_ns;
+                    char * text = NULL;
+
+                    current->pending = NULL;
+
+                    if (asprintf(&text,
+                                 "%s%s",
+                                 pending,
+                                 resumed + sizeof REPLAY_MT_RESUMED - 1) > 0)
+                    {
+                        result = replay_mt_add_syscall(data,
+                                                       parser,
+                                                       stream,
+                                                       pending_ns,
+                                                       text);
+                        free(text);
+                    }
+                    else
+                    {
+                        result = ENOMEM;
+                    }
+
+                    free(pending), pending = NULL;
+                }
+                else
+                {
+                    parser->skipped++;
+                }
+            }
+            else if (len >= unfinished_len &&
+                     strcmp(line + len - unfinished_len, REPLAY_MT_UNFINISHED) == 0)
+            {
+                len -= unfinished_len;
+
+                while (len > 0 &&
+                       line[len - 1] == ' ')
+                {
+                    len--;
+                }
+
+                free(current->pending);
+                current->pending = strndup(line, len);
+                current->pending_ns = timestamp_ns;
+
+                if (current->pending == NULL)
+                {
+                    result = ENOMEM;
+                }
+            }
+            else
+            {
+                result = replay_mt_add_syscall(data,
+                                               parser,
+                                               stream,
+                                               timestamp_ns,
+                                               line);
+            }
+        }
+    }
+    else if (*line != '\0')
+    {
+        parser->skipped++;
+    }
+
+    return result;
+}
+
+static int replay_mt_load_text(replay_mt_data * const data,
+                               FILE * const fp)
+{
+    int result = 0;
+    replay_mt_parser parser = { 0 };
+    char * line = NULL;
+    size_t line_size = 0;
+
+    while (result == 0 &&
+           getline(&line, &line_size, fp) != -1)
+    {
+        parser.nb_lines++;
+        result = replay_mt_parse_line(data,
+                                      &parser,
+                                      line);
+    }
+
+    if (result == 0 &&
+        ferror(fp))
+    {
+        result = EIO;
+    }
+
+    if (result == 0 &&
+        data->nb_ops == 0 &&
+        parser.nb_lines > 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("No syscall to replay in %zu lines, was the trace captured with strace -f -ttt?",
+                  parser.nb_lines);
+    }
+
+    LOG_DEBUG("Parsed %zu lines, %zu skipped",
+              parser.nb_lines,
+              parser.skipped);
+
+    for (size_t idx = 0;
+         idx < data->nb_streams;
+         idx++)
+    {
+        free(parser.streams[idx].pending);
+    }
+
+    free(line), line = NULL;
+    for (size_t idx = 0;
+         idx < data->nb_tables;
+         idx++)
+    {
+        free(parser.tables[idx].fds);
+    }
+
+    free(parser.streams), parser.streams = NULL;
+    free(parser.tables), parser.tables = NULL;
+    free(parser.buckets), parser.buckets = NULL;
+
+    return result;
+}
+
+static int replay_mt_load_binary(replay_mt_data * const data,
+                                 replay_mt_header const * const header,
+                                 FILE * const fp)
+{
+    int result = 0;
+
+    if (header->nb_ops < UINT32_MAX &&
+        header->nb_paths < REPLAY_MT_NO_PATH &&
+        header->nb_streams <= header->nb_ops &&
+        header->nb_tables <= header->nb_streams)
+    {
+        data->paths = calloc((size_t) header->nb_paths, sizeof *(data->paths));
+        data->ops = malloc((size_t) header->nb_ops * sizeof *(data->ops));
+
+        if ((data->paths != NULL || header->nb_paths == 0) &&
+            (data->ops != NULL || header->nb_ops == 0))
+        {
+            data->paths_capacity = (size_t) header->nb_paths;
+            data->ops_capacity = (size_t) header->nb_ops;
+            data->nb_streams = (size_t) header->nb_streams;
+            data->nb_tables = (size_t) header->nb_tables;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+    else
+    {
+        result = EINVAL;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->paths_capacity;
+         idx++)
+    {
+        replay_mt_path_header path_header;
+        replay_mt_path * const path = &(data->paths[idx]);
+
+        if (fread(&path_header, sizeof path_header, 1, fp) == 1 &&
+            path_header.length > 0 &&
+            path_header.length < PATH_MAX)
+        {
+            path->relative = malloc(path_header.length + 1);
+
+            if (path->relative != NULL)
+            {
+                data->nb_paths++;
+
+                if (fread(path->relative, path_header.length, 1, fp) == 1)
+                {
+                    path->relative[path_header.length] = '\0';
+                    path->size = path_header.size;
+                    path->precreate = path_header.precreate != 0;
+                    path->directory = path_header.directory != 0;
+                }
+                else
+                {
+                    result = EINVAL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+        else
+        {
+            result = EINVAL;
+        }
+    }
+
+    if (result == 0 &&
+        data->ops_capacity > 0 &&
+        fread(data->ops, sizeof *(data->ops), data->ops_capacity, fp) != data->ops_capacity)
+    {
+        result = EINVAL;
+    }
+
+    if (result == 0)
+    {
+        data->nb_ops = data->ops_capacity;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_ops;
+         idx++)
+    {
+        replay_mt_op const * const op = &(data->ops[idx]);
+        bool const fork = op->syscall == replay_mt_syscall_fork;
+
+        if (op->syscall >= replay_mt_syscall_count ||
+            op->stream >= data->nb_streams ||
+            op->fd < -1 ||
+            op->fd >= REPLAY_MT_MAX_FD ||
+            ((op->fd != -1 || fork == true) && op->table >= data->nb_tables) ||
+            (fork == true && op->size >= data->nb_tables) ||
+            (op->after != REPLAY_MT_NO_OP && op->after >= idx) ||
+            (op->path != REPLAY_MT_NO_PATH && op->path >= data->nb_paths) ||
+            (op->path2 != REPLAY_MT_NO_PATH && op->path2 >= data->nb_paths))
+        {
+            result = EINVAL;
+        }
+    }
+
+    return result;
+}
+
+static int replay_mt_load(replay_mt_data * const data,
+                          char const * const path,
+                          bool * const text)
+{
+    int result = 0;
+    FILE * fp = fopen(path, "r");
+
+    if (fp != NULL)
+    {
+        replay_mt_header header;
+
+        if (fread(&header, sizeof header, 1, fp) == 1 &&
+            memcmp(header.magic, REPLAY_MT_MAGIC, sizeof header.magic) == 0)
+        {
+            *text = false;
+            result = replay_mt_load_binary(data,
+                                           &header,
+                                           fp);
+        }
+        else
+        {
+            *text = true;
+            rewind(fp);
+            result = replay_mt_load_text(data,
+                                         fp);
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error loading trace %s: %d",
+                      path,
+                      result);
+        }
+
+        fclose(fp), fp = NULL;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening trace %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static int replay_mt_convert(replay_mt_data const * const data,
+                             char const * const path)
+{
+    int result = 0;
+    FILE * fp = fopen(path, "wb");
+
+    if (fp != NULL)
+    {
+        replay_mt_header header =
+            {
+                .nb_ops = data->nb_ops,
+                .nb_paths = data->nb_paths,
+                .nb_streams = data->nb_streams,
+                .nb_tables = data->nb_tables,
+            };
+
+        memcpy(header.magic, REPLAY_MT_MAGIC, sizeof header.magic);
+
+        if (fwrite(&header, sizeof header, 1, fp) != 1)
+        {
+            result = EIO;
+        }
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < data->nb_paths;
+             idx++)
+        {
+            replay_mt_path const * const entry = &(data->paths[idx]);
+            replay_mt_path_header const path_header =
+                {
+                    .size = entry->size,
+                    .length = (uint32_t) strlen(entry->relative),
+                    .precreate = entry->precreate,
+                    .directory = entry->directory,
+                };
+
+            if (fwrite(&path_header, sizeof path_header, 1, fp) != 1 ||
+                fwrite(entry->relative, path_header.length, 1, fp) != 1)
+            {
+                result = EIO;
+            }
+        }
+
+        if (result == 0 &&
+            data->nb_ops > 0 &&
+            fwrite(data->ops, sizeof *(data->ops), data->nb_ops, fp) != data->nb_ops)
+        {
+            result = EIO;
+        }
+
+        if (fclose(fp) != 0 &&
+            result == 0)
+        {
+            result = errno;
+        }
+
+        fp = NULL;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error converting trace to %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static int replay_mt_compare_strings(void const * const first,
+                                     void const * const second)
+{
+    return strcmp(*(char const * const *) first,
+                  *(char const * const *) second);
+}
+
+/* Creates the parents of a path, up to the first one the trace creates
+   itself. created holds the relative paths of those, sorted. */
+static int replay_mt_create_parents(char * const full,
+                                    size_t const prefix_len,
+                                    char const * const * const created,
+                                    size_t const nb_created)
+{
+    int result = 0;
+    bool stop = false;
+
+    /* The sandbox itself has no parent to create. */
+    for (char * slash = full[prefix_len] != '\0' ? strchr(full + prefix_len + 1, '/') : NULL;
+         result == 0 &&
+             stop == false &&
+             slash != NULL;
+         slash = strchr(slash + 1, '/'))
+    {
+        char const * const relative = full + prefix_len + 1;
+
+        *slash = '\0';
+
+        if (bsearch(&relative,
+                    created,
+                    nb_created,
+                    sizeof *created,
+                    &replay_mt_compare_strings) != NULL)
+        {
+            stop = true;
+        }
+        /* A file in the way makes the replayed syscalls fail, as they would
+           have in the trace. */
+        else if (mkdir(full, S_IRWXU) != 0 &&
+                 errno != EEXIST &&
+                 errno != ENOTDIR)
+        {
+            result = errno;
+        }
+
+        *slash = '/';
+    }
+
+    return result;
+}
+
+static int replay_mt_create_file(char const * const path,
+                                 uint64_t const size,
+                                 char const * const buffer)
+{
+    int result = 0;
+    int fd = open(path,
+                  O_CREAT | O_WRONLY,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        for (uint64_t pos = 0;
+             result == 0 &&
+                 pos < size;
+             pos += REPLAY_MT_FILL_SIZE)
+        {
+            size_t const to_write = size - pos < REPLAY_MT_FILL_SIZE ? (size_t) (size - pos) : REPLAY_MT_FILL_SIZE;
+
+            if (write(fd, buffer, to_write) != (ssize_t) to_write)
+            {
+                result = errno != 0 ? errno : EIO;
+            }
+        }
+
+        close(fd), fd = -1;
+
+        if (result == 0)
+        {
+            result = mt_fs_tests_cold_cache_track(path);
+        }
+    }
+    else if (errno != EISDIR)
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static int replay_mt_create_sandbox(replay_mt_data * const data)
+{
+    int result = 0;
+    size_t prefix_len = 0;
+    size_t nb_created = 0;
+    char * const buffer = malloc(REPLAY_MT_FILL_SIZE);
+    char const ** const created = malloc((data->nb_paths > 0 ? data->nb_paths : 1) * sizeof *created);
+
+    data->directory = strdup(DIRECTORY_TEMPLATE);
+
+    if (buffer != NULL &&
+        created != NULL &&
+        data->directory != NULL)
+    {
+        memset(buffer, 'R', REPLAY_MT_FILL_SIZE);
+
+        for (size_t idx = 0;
+             idx < data->nb_paths;
+             idx++)
+        {
+            if (data->paths[idx].directory == true &&
+                data->paths[idx].precreate == false)
+            {
+                created[nb_created++] = data->paths[idx].relative;
+            }
+        }
+
+        qsort(created,
+              nb_created,
+              sizeof *created,
+              &replay_mt_compare_strings);
+
+        if (mkdtemp(data->directory) != NULL)
+        {
+            prefix_len = strlen(data->directory);
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error in mkdtemp: %d",
+                      result);
+            free(data->directory), data->directory = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_paths;
+         idx++)
+    {
+        replay_mt_path * const path = &(data->paths[idx]);
+
+        if (strcmp(path->relative, ".") == 0)
+        {
+            path->full = strdup(data->directory);
+        }
+        else if (asprintf(&(path->full),
+                          "%s/%s",
+                          data->directory,
+                          path->relative) < 0)
+        {
+            path->full = NULL;
+        }
+
+        if (path->full != NULL)
+        {
+            result = replay_mt_create_parents(path->full,
+                                              prefix_len,
+                                              created,
+                                              nb_created);
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    /* Directories first, so that they are not mistaken for files. */
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_paths;
+         idx++)
+    {
+        replay_mt_path const * const path = &(data->paths[idx]);
+
+        if (path->precreate == true &&
+            path->directory == true &&
+            mkdir(path->full, S_IRWXU) != 0 &&
+            errno != EEXIST)
+        {
+            result = errno;
+        }
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_paths;
+         idx++)
+    {
+        replay_mt_path const * const path = &(data->paths[idx]);
+
+        if (path->precreate == true &&
+            path->directory == false)
+        {
+            result = replay_mt_create_file(path->full,
+                                           path->size,
+                                           buffer);
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error creating %s: %d",
+                          path->full,
+                          result);
+            }
+        }
+    }
+
+    free(created);
+    free(buffer);
+
+    return result;
+}
+
+static int replay_mt_remove_entry(char const * const path,
+                                  struct stat const * const st,
+                                  int const type,
+                                  struct FTW * const ftw)
+{
+    (void) st;
+    (void) type;
+    (void) ftw;
+
+    /* Keep going, removing as much as possible. */
+    remove(path);
+
+    return 0;
+}
+
+static void replay_mt_remove_sandbox(replay_mt_data * const data)
+{
+    for (size_t idx = 0;
+         idx < data->nb_paths;
+         idx++)
+    {
+        replay_mt_path * const path = &(data->paths[idx]);
+
+        if (path->full != NULL)
+        {
+            if (path->precreate == true &&
+                path->directory == false)
+            {
+                mt_fs_tests_cold_cache_untrack(path->full);
+            }
+
+            free(path->full), path->full = NULL;
+        }
+    }
+
+    if (data->directory != NULL)
+    {
+        nftw(data->directory,
+             &replay_mt_remove_entry,
+             64,
+             FTW_DEPTH | FTW_PHYS);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+/* Streams are spread over workers, keeping the order of the trace. */
+static int replay_mt_assign_workers(replay_mt_data * const data)
+{
+    int result = 0;
+
+    data->worker_first = calloc(data->nb_threads + 1, sizeof *(data->worker_first));
+    data->worker_ops = malloc((data->nb_ops > 0 ? data->nb_ops : 1) * sizeof *(data->worker_ops));
+
+    if (data->worker_first != NULL &&
+        data->worker_ops != NULL)
+    {
+        for (size_t idx = 0;
+             idx < data->nb_ops;
+             idx++)
+        {
+            data->worker_first[data->ops[idx].stream % data->nb_threads + 1]++;
+        }
+
+        for (size_t idx = 1;
+             idx <= data->nb_threads;
+             idx++)
+        {
+            data->worker_first[idx] += data->worker_first[idx - 1];
+        }
+
+        {
+            size_t * const next = calloc(data->nb_threads, sizeof *next);
+
+            if (next != NULL)
+            {
+                memcpy(next, data->worker_first, data->nb_threads * sizeof *next);
+
+                for (size_t idx = 0;
+                     idx < data->nb_ops;
+                     idx++)
+                {
+                    data->worker_ops[next[data->ops[idx].stream % data->nb_threads]++] = (uint32_t) idx;
+                }
+
+                free(next);
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int replay_mt_prepare(replay_mt_data * const data)
+{
+    int result = 0;
+
+    data->tables_first = calloc(data->nb_tables + 1, sizeof *(data->tables_first));
+
+    if (data->tables_first == NULL)
+    {
+        result = ENOMEM;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_ops;
+         idx++)
+    {
+        replay_mt_op const * const op = &(data->ops[idx]);
+
+        /* Size of each table first, turned into offsets below. */
+        if (op->fd >= 0 &&
+            (size_t) op->fd >= data->tables_first[op->table + 1])
+        {
+            data->tables_first[op->table + 1] = (size_t) op->fd + 1;
+        }
+
+        if ((op->syscall == replay_mt_syscall_read ||
+             op->syscall == replay_mt_syscall_pread64 ||
+             op->syscall == replay_mt_syscall_write ||
+             op->syscall == replay_mt_syscall_pwrite64) &&
+            op->size > data->io_size)
+        {
+            data->io_size = op->size < REPLAY_MT_MAX_IO_SIZE ? (size_t) op->size : REPLAY_MT_MAX_IO_SIZE;
+        }
+    }
+
+    if (result == 0)
+    {
+        for (size_t idx = 1;
+             idx <= data->nb_tables;
+             idx++)
+        {
+            data->tables_first[idx] += data->tables_first[idx - 1];
+        }
+
+        data->nb_fds = data->tables_first[data->nb_tables];
+        data->fds = malloc((data->nb_fds > 0 ? data->nb_fds : 1) * sizeof *(data->fds));
+
+        if (data->fds != NULL)
+        {
+            for (size_t idx = 0;
+                 idx < data->nb_fds;
+                 idx++)
+            {
+                data->fds[idx] = -1;
+            }
+
+            result = replay_mt_assign_workers(data);
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    if (result == 0)
+    {
+        result = replay_mt_create_sandbox(data);
+    }
+
+    if (result == 0 &&
+        data->nb_streams > data->nb_threads)
+    {
+        LOG_OK("%zu threads in the trace for %zu workers, workers replay several of them",
+               data->nb_streams,
+               data->nb_threads);
+    }
+
+    return result;
+}
+
+static void replay_mt_free(replay_mt_data * const data)
+{
+    replay_mt_remove_sandbox(data);
+
+    if (data->fds != NULL)
+    {
+        for (size_t idx = 0;
+             idx < data->nb_fds;
+             idx++)
+        {
+            if (data->fds[idx] != -1)
+            {
+                close(data->fds[idx]);
+            }
+        }
+
+        free(data->fds), data->fds = NULL;
+    }
+
+    free(data->tables_first), data->tables_first = NULL;
+
+    for (size_t idx = 0;
+         idx < data->nb_paths;
+         idx++)
+    {
+        free(data->paths[idx].relative), data->paths[idx].relative = NULL;
+    }
+
+    free(data->paths), data->paths = NULL;
+    free(data->ops), data->ops = NULL;
+    free(data->worker_ops), data->worker_ops = NULL;
+    free(data->worker_first), data->worker_first = NULL;
+
+    if (data->results != NULL)
+    {
+        mt_fs_tests_shared_free(data->results), data->results = NULL;
+    }
+
+    if (data->divergences != NULL)
+    {
+        mt_fs_tests_shared_free(data->divergences), data->divergences = NULL;
+    }
+
+    if (data->unavailable != NULL)
+    {
+        mt_fs_tests_shared_free(data->unavailable), data->unavailable = NULL;
+    }
+
+    if (data->done != NULL)
+    {
+        mt_fs_tests_shared_free(data->done), data->done = NULL;
+    }
+
+    if (data->start_ns != NULL)
+    {
+        mt_fs_tests_shared_free(data->start_ns), data->start_ns = NULL;
+    }
+
+    free(data);
+}
+
+static int replay_mt_init(void ** test_suite_data,
+                          size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    replay_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        char const * const trace = mt_fs_tests_option_get_string("replay_mt.trace",
+                                                                 NULL);
+        char const * const convert = mt_fs_tests_option_get_string("replay_mt.convert",
+                                                                   NULL);
+        char const * const timing = mt_fs_tests_option_get_string("replay_mt.timing",
+                                                                  "asap");
+        bool text = false;
+
+        data->nb_threads = nb_threads;
+
+        if (strcasecmp(timing, "preserve") == 0)
+        {
+            data->preserve = true;
+        }
+        else if (strcasecmp(timing, "asap") != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid timing %s, expected asap or preserve",
+                      timing);
+        }
+
+        if (result == 0)
+        {
+            result = mt_fs_tests_option_get_double("replay_mt.speed",
+                                                   1.0,
+                                                   &(data->speed));
+
+            if (result == 0 &&
+                data->speed <= 0.0)
+            {
+                result = EINVAL;
+                LOG_ERROR("Invalid speed, expected a value greater than 0");
+            }
+        }
+
+        if (result == 0 &&
+            trace != NULL)
+        {
+            result = replay_mt_load(data,
+                                    trace,
+                                    &text);
+
+            if (result == 0)
+            {
+                LOG_DEBUG("Loaded %zu syscalls of %zu threads on %zu paths from %s",
+                          data->nb_ops,
+                          data->nb_streams,
+                          data->nb_paths,
+                          trace);
+            }
+        }
+
+        if (result == 0 &&
+            text == true &&
+            convert != NULL)
+        {
+            result = replay_mt_convert(data,
+                                       convert);
+        }
+
+        if (result == 0)
+        {
+            data->results = mt_fs_tests_shared_calloc(nb_threads,
+                                                      sizeof *(data->results));
+            data->divergences = mt_fs_tests_shared_calloc(nb_threads,
+                                                          sizeof *(data->divergences));
+            data->unavailable = mt_fs_tests_shared_calloc(nb_threads,
+                                                          sizeof *(data->unavailable));
+            data->start_ns = mt_fs_tests_shared_calloc(1,
+                                                       sizeof *(data->start_ns));
+            data->done = mt_fs_tests_shared_calloc(data->nb_ops > 0 ? data->nb_ops : 1,
+                                                   sizeof *(data->done));
+
+            if (data->results != NULL &&
+                data->divergences != NULL &&
+                data->unavailable != NULL &&
+                data->start_ns != NULL &&
+                data->done != NULL)
+            {
+                for (size_t idx = 0;
+                     idx < nb_threads;
+                     idx++)
+                {
+                    data->results[idx] = -1;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0 &&
+            data->nb_ops > 0)
+        {
+            result = replay_mt_prepare(data);
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            replay_mt_free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static void replay_mt_sleep_until(uint64_t const deadline_ns)
+{
+    struct timespec const deadline =
+        {
+            .tv_sec = (time_t) (deadline_ns / MT_FS_TESTS_NS_PER_SEC),
+            .tv_nsec = (long) (deadline_ns % MT_FS_TESTS_NS_PER_SEC)
+        };
+
+    while (clock_nanosleep(CLOCK_MONOTONIC,
+                           TIMER_ABSTIME,
+                           &deadline,
+                           NULL) == EINTR)
+    {
+    }
+}
+
+/* Replayed fd of a traced one. */
+__attribute__ ((__pure__))
+static int * replay_mt_fd(replay_mt_data const * const data,
+                          uint32_t const table,
+                          size_t const fd)
+{
+    return &(data->fds[data->tables_first[table] + fd]);
+}
+
+static int replay_mt_open(replay_mt_data * const data,
+                          replay_mt_op const * const op)
+{
+    int result = 0;
+    int const fd = open(data->paths[op->path].full,
+                        op->flags,
+                        (mode_t) op->mode);
+
+    if (fd == -1)
+    {
+        result = errno;
+    }
+
+    if (op->fd != -1)
+    {
+        int const previous = __atomic_exchange_n(replay_mt_fd(data, op->table, (size_t) op->fd),
+                                                 fd,
+                                                 __ATOMIC_ACQ_REL);
+
+        if (previous != -1)
+        {
+            close(previous);
+        }
+    }
+    else if (fd != -1)
+    {
+        /* The traced open failed, nothing uses this fd. */
+        close(fd);
+    }
+
+    return result;
+}
+
+/* Duplicates the replayed fds of the parent for the child, sharing their
+   offsets as fork does. */
+static int replay_mt_fork(replay_mt_data * const data,
+                          replay_mt_op const * const op)
+{
+    int result = 0;
+    uint32_t const child = (uint32_t) op->size;
+    size_t const parent_fds = data->tables_first[op->table + 1] - data->tables_first[op->table];
+    size_t const child_fds = data->tables_first[child + 1] - data->tables_first[child];
+
+    for (size_t fd = 0;
+         result == 0 &&
+             fd < parent_fds &&
+             fd < child_fds;
+         fd++)
+    {
+        int const parent_fd = __atomic_load_n(replay_mt_fd(data, op->table, fd),
+                                              __ATOMIC_ACQUIRE);
+
+        if (parent_fd != -1)
+        {
+            int const copy = dup(parent_fd);
+
+            if (copy != -1)
+            {
+                int const previous = __atomic_exchange_n(replay_mt_fd(data, child, fd),
+                                                         copy,
+                                                         __ATOMIC_ACQ_REL);
+
+                if (previous != -1)
+                {
+                    close(previous);
+                }
+            }
+            else
+            {
+                result = errno;
+            }
+        }
+    }
+
+    return result;
+}
+
+static int replay_mt_stat(replay_mt_op const * const op,
+                          char const * const path,
+                          int const fd)
+{
+    int result = 0;
+    int const at_flags = op->flags & ~AT_EMPTY_PATH;
+    struct stat st;
+    struct statx stx;
+    int res = 0;
+
+    switch(op->syscall)
+    {
+    case replay_mt_syscall_fstat:
+        res = fstat(fd, &st);
+        break;
+    case replay_mt_syscall_stat:
+        res = stat(path, &st);
+        break;
+    case replay_mt_syscall_lstat:
+        res = lstat(path, &st);
+        break;
+    case replay_mt_syscall_newfstatat:
+        res = path != NULL ?
+            fstatat(AT_FDCWD, path, &st, at_flags) :
+            fstatat(fd, "", &st, at_flags | AT_EMPTY_PATH);
+        break;
+    case replay_mt_syscall_statx:
+        res = path != NULL ?
+            statx(AT_FDCWD, path, at_flags, STATX_BASIC_STATS, &stx) :
+            statx(fd, "", at_flags | AT_EMPTY_PATH, STATX_BASIC_STATS, &stx);
+        break;
+    default:
+        assert(false);
+        break;
+    }
+
+    if (res != 0)
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+/* unavailable is set when op uses an fd opened by another stream, and which
+   is not there. */
+static int replay_mt_replay_op(replay_mt_data * const data,
+                               replay_mt_op const * const op,
+                               char * const buffer,
+                               bool * const unavailable)
+{
+    int result = 0;
+    char const * const path = op->path != REPLAY_MT_NO_PATH ? data->paths[op->path].full : NULL;
+    char const * const path2 = op->path2 != REPLAY_MT_NO_PATH ? data->paths[op->path2].full : NULL;
+    size_t const io_size = op->size < data->io_size ? (size_t) op->size : data->io_size;
+    int fd = -1;
+    ssize_t res = 0;
+
+    if (op->fd != -1 &&
+        op->syscall != replay_mt_syscall_open &&
+        op->syscall != replay_mt_syscall_openat &&
+        op->syscall != replay_mt_syscall_creat &&
+        op->syscall != replay_mt_syscall_close)
+    {
+        fd = __atomic_load_n(replay_mt_fd(data, op->table, (size_t) op->fd),
+                             __ATOMIC_ACQUIRE);
+
+        if (fd == -1)
+        {
+            /* Its open failed, or was replayed by another worker process. */
+            result = EBADF;
+            *unavailable = op->foreign != 0;
+        }
+    }
+
+    if (result == 0)
+    {
+        switch(op->syscall)
+        {
+        case replay_mt_syscall_open:
+        case replay_mt_syscall_openat:
+        case replay_mt_syscall_creat:
+            result = replay_mt_open(data, op);
+            break;
+        case replay_mt_syscall_close:
+            fd = __atomic_exchange_n(replay_mt_fd(data, op->table, (size_t) op->fd),
+                                     -1,
+                                     __ATOMIC_ACQ_REL);
+            if (fd != -1)
+            {
+                res = close(fd);
+            }
+            else
+            {
+                result = EBADF;
+                *unavailable = op->foreign != 0;
+            }
+            break;
+        case replay_mt_syscall_read:
+            res = read(fd, buffer, io_size);
+            break;
+        case replay_mt_syscall_pread64:
+            res = pread(fd, buffer, io_size, (off_t) op->offset);
+            break;
+        case replay_mt_syscall_write:
+            res = write(fd, buffer, io_size);
+            break;
+        case replay_mt_syscall_pwrite64:
+            res = pwrite(fd, buffer, io_size, (off_t) op->offset);
+            break;
+        case replay_mt_syscall_lseek:
+            res = lseek(fd, (off_t) op->offset, op->flags);
+            break;
+        case replay_mt_syscall_fstat:
+        case replay_mt_syscall_stat:
+        case replay_mt_syscall_lstat:
+        case replay_mt_syscall_newfstatat:
+        case replay_mt_syscall_statx:
+            result = replay_mt_stat(op, path, fd);
+            break;
+        case replay_mt_syscall_fsync:
+            res = fsync(fd);
+            break;
+        case replay_mt_syscall_fdatasync:
+            res = fdatasync(fd);
+            break;
+        case replay_mt_syscall_ftruncate:
+            res = ftruncate(fd, (off_t) op->size);
+            break;
+        case replay_mt_syscall_truncate:
+            res = truncate(path, (off_t) op->size);
+            break;
+        case replay_mt_syscall_unlink:
+        case replay_mt_syscall_unlinkat:
+            res = (op->flags & AT_REMOVEDIR) != 0 ? rmdir(path) : unlink(path);
+            break;
+        case replay_mt_syscall_rmdir:
+            res = rmdir(path);
+            break;
+        case replay_mt_syscall_mkdir:
+        case replay_mt_syscall_mkdirat:
+            res = mkdir(path, (mode_t) op->mode);
+            break;
+        case replay_mt_syscall_rename:
+        case replay_mt_syscall_renameat:
+            res = rename(path, path2);
+            break;
+        case replay_mt_syscall_renameat2:
+            res = renameat2(AT_FDCWD, path, AT_FDCWD, path2, (unsigned int) op->flags);
+            break;
+        case replay_mt_syscall_fork:
+            result = replay_mt_fork(data, op);
+            break;
+        default:
+            assert(false);
+            break;
+        }
+
+        if (res == -1)
+        {
+            result = errno;
+        }
+        else if (op->syscall == replay_mt_syscall_read ||
+                 op->syscall == replay_mt_syscall_pread64 ||
+                 op->syscall == replay_mt_syscall_write ||
+                 op->syscall == replay_mt_syscall_pwrite64)
+        {
+            mt_fs_tests_op_add_bytes((uint64_t) res);
+        }
+    }
+
+    return result;
+}
+
+/* Ops are only ordered after earlier ones of the trace, the earliest op not
+   replayed yet never waits. */
+static void replay_mt_wait(replay_mt_data const * const data,
+                           uint32_t const op)
+{
+    while (__atomic_load_n(&(data->done[op]), __ATOMIC_ACQUIRE) == 0)
+    {
+        sched_yield();
+    }
+}
+
+static int replay_mt_run(void * test_suite_data,
+                         size_t id)
+{
+    int result = 0;
+    replay_mt_data * data = test_suite_data;
+    char * buffer = NULL;
+
+    assert(data != NULL);
+    assert(data->results[id] == -1);
+
+    if (data->nb_ops > 0)
+    {
+        buffer = malloc(data->io_size > 0 ? data->io_size : 1);
+
+        if (buffer != NULL)
+        {
+            uint64_t start_ns = 0;
+
+            memset(buffer, 'r', data->io_size);
+
+            for (size_t idx = data->worker_first[id];
+                 idx < data->worker_first[id + 1];
+                 idx++)
+            {
+                uint32_t const op_idx = data->worker_ops[idx];
+                replay_mt_op const * const op = &(data->ops[op_idx]);
+                mt_fs_tests_op mt_op;
+                bool unavailable = false;
+                int res = 0;
+
+                if (data->preserve == true)
+                {
+                    if (start_ns == 0)
+                    {
+                        uint64_t expected = 0;
+                        uint64_t const now = mt_fs_tests_now_ns();
+
+                        /* The first worker to start sets the time origin
+                           of all of them. */
+                        start_ns = __atomic_compare_exchange_n(data->start_ns,
+                                                               &expected,
+                                                               now,
+                                                               false,
+                                                               __ATOMIC_ACQ_REL,
+                                                               __ATOMIC_ACQUIRE) ? now : expected;
+                    }
+
+                    replay_mt_sleep_until(start_ns + (uint64_t) ((double) op->timestamp_ns / data->speed));
+                }
+
+                if (op->after != REPLAY_MT_NO_OP)
+                {
+                    replay_mt_wait(data,
+                                   op->after);
+                }
+
+                mt_fs_tests_op_begin(&mt_op,
+                                     replay_mt_syscall_names[op->syscall]);
+
+                res = replay_mt_replay_op(data,
+                                          op,
+                                          buffer,
+                                          &unavailable);
+
+                mt_fs_tests_op_end(&mt_op,
+                                   res);
+
+                __atomic_store_n(&(data->done[op_idx]),
+                                 1,
+                                 __ATOMIC_RELEASE);
+
+                if (unavailable == true)
+                {
+                    data->unavailable[id]++;
+                }
+                else if ((res != 0) != (op->failed != 0))
+                {
+                    data->divergences[id]++;
+                }
+            }
+
+            free(buffer), buffer = NULL;
+        }
+        else
+        {
+            result = ENOMEM;
+
+            /* Not to leave other workers waiting for these. */
+            for (size_t idx = data->worker_first[id];
+                 idx < data->worker_first[id + 1];
+                 idx++)
+            {
+                __atomic_store_n(&(data->done[data->worker_ops[idx]]),
+                                 1,
+                                 __ATOMIC_RELEASE);
+            }
+        }
+    }
+
+    data->results[id] = result;
+
+    return 0;
+}
+
+static int replay_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    replay_mt_data * data = test_suite_data;
+    size_t ok_count = 0;
+    size_t invalid_count = 0;
+    uint64_t divergences = 0;
+    uint64_t unavailable = 0;
+    assert(data != NULL);
+
+    for (size_t idx = 0;
+         idx < data->nb_threads;
+         idx++)
+    {
+        divergences += data->divergences[idx];
+        unavailable += data->unavailable[idx];
+
+        if (data->results[idx] == 0)
+        {
+            ok_count++;
+        }
+        else
+        {
+            invalid_count++;
+        }
+    }
+
+    if (data->nb_ops == 0)
+    {
+        LOG_OK("Nothing to replay, give a trace with -o replay_mt.trace=<path>");
+    }
+    else
+    {
+        LOG_OK("Replayed %zu syscalls, %llu of them did not succeed or fail as in the trace",
+               data->nb_ops,
+               (unsigned long long) divergences);
+
+        if (unavailable > 0)
+        {
+            LOG_OK("%llu more used an fd opened by another traced thread which was not there, its open having failed or been replayed by another worker process",
+                   (unsigned long long) unavailable);
+        }
+    }
+
+    if (ok_count == data->nb_threads)
+    {
+        LOG_OK("Success!");
+    }
+    else
+    {
+        LOG_ERROR("Error, we got %zu success and %zu invalid return codes.",
+                  ok_count,
+                  invalid_count);
+    }
+
+    return result;
+}
+
+static int replay_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    replay_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        replay_mt_free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_replay_mt =
+{
+    "replay_mt",
+    &replay_mt_init,
+    &replay_mt_run,
+    &replay_mt_post_run,
+    &replay_mt_deinit,
+    test_suite_type_mt
+};
@@ -0,0 +1,757 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "barrier.h"
+#include "cold_cache.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+#include "verify.h"
+
+/* Many small files, as in image or mail stores: each thread creates and
+   writes its files in a directory of its own, then, once all threads are
+   done writing, reopens, reads and verifies them. Reported per phase are
+   the files and bytes per second, from the first thread starting the phase
+   to the last one finishing it.
+
+   Options:
+   - small_files_mt.files: files per thread (default 1000);
+   - small_files_mt.min_size and small_files_mt.max_size: bounds of the
+     size of the files, with an optional k, m or g suffix (default 1k and
+     64k);
+   - small_files_mt.size_distribution: uniform, or log (default) for sizes
+     uniformly distributed on a logarithmic scale, as many files between 1k
+     and 8k as between 8k and 64k;
+   - small_files_mt.fsync: fsync each file before closing it (default
+     false).
+
+   In cold-cache mode, threads evict their own files from the page cache
+   between the two phases. */
+
+#define DIRECTORY_TEMPLATE "small_files_suite_XXXXXX"
+#define THREAD_DIRECTORY_FORMAT "%s/t%zu"
+#define FILE_NAME_FORMAT "%s/t%zu/f%llu"
+#define PATH_SIZE (256)
+#define DEFAULT_FILES (1000)
+#define DEFAULT_MIN_SIZE (1024)
+#define DEFAULT_MAX_SIZE (64 * 1024)
+
+typedef enum
+{
+    small_files_mt_size_uniform = 0,
+    small_files_mt_size_log,
+    small_files_mt_size_count
+} small_files_mt_size_distribution;
+
+static char const * const small_files_mt_size_distributions_names[] =
+{
+    "uniform",
+    "log",
+};
+
+typedef enum
+{
+    small_files_mt_phase_write = 0,
+    small_files_mt_phase_read,
+    small_files_mt_phase_count
+} small_files_mt_phase;
+
+static char const * const small_files_mt_phases_names[] =
+{
+    "write",
+    "read",
+};
+
+/* The count of a phase is the number of files. */
+typedef struct
+{
+    mt_fs_tests_phase phases[small_files_mt_phase_count];
+    mt_fs_tests_outcomes outcomes;
+} small_files_mt_thread;
+
+typedef struct
+{
+    mt_fs_tests_barrier_t barrier;
+    small_files_mt_thread threads[];
+} small_files_mt_shared;
+
+typedef struct {
+    char * directory;
+    small_files_mt_shared * shared;
+    size_t nb_threads;
+    uint64_t nb_files;
+    uint64_t min_size;
+    uint64_t max_size;
+    small_files_mt_size_distribution size_distribution;
+    bool fsync;
+    bool barrier_initialized;
+} small_files_mt_data;
+
+static int small_files_mt_get_options(small_files_mt_data * const data)
+{
+    char const * const size_distribution = mt_fs_tests_option_get_string("small_files_mt.size_distribution",
+                                                                         "log");
+    int result = mt_fs_tests_option_get_uint64("small_files_mt.files",
+                                               DEFAULT_FILES,
+                                               &(data->nb_files));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("small_files_mt.min_size",
+                                             DEFAULT_MIN_SIZE,
+                                             &(data->min_size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("small_files_mt.max_size",
+                                             DEFAULT_MAX_SIZE,
+                                             &(data->max_size));
+    }
+
+    if (result == 0 &&
+        (data->min_size == 0 ||
+         data->min_size > data->max_size ||
+         data->max_size > SSIZE_MAX))
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid file sizes, expected 0 < min_size <= max_size, got %llu and %llu",
+                  (unsigned long long) data->min_size,
+                  (unsigned long long) data->max_size);
+    }
+
+    if (result == 0)
+    {
+        result = ENOENT;
+
+        for (size_t idx = 0;
+             result == ENOENT &&
+                 idx < small_files_mt_size_count;
+             idx++)
+        {
+            if (strcasecmp(size_distribution, small_files_mt_size_distributions_names[idx]) == 0)
+            {
+                data->size_distribution = (small_files_mt_size_distribution) idx;
+                result = 0;
+            }
+        }
+
+        if (result != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid size distribution %s", size_distribution);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_bool("small_files_mt.fsync",
+                                             false,
+                                             &(data->fsync));
+    }
+
+    return result;
+}
+
+static size_t small_files_mt_next_size(small_files_mt_data const * const data,
+                                       mt_fs_tests_prng * const prng)
+{
+    uint64_t result = data->min_size;
+
+    if (data->max_size > data->min_size)
+    {
+        if (data->size_distribution == small_files_mt_size_uniform)
+        {
+            result += mt_fs_tests_prng_bounded(prng,
+                                               data->max_size - data->min_size + 1);
+        }
+        else
+        {
+            double const ratio = (double) data->max_size / (double) data->min_size;
+
+            result = (uint64_t) ((double) data->min_size * pow(ratio,
+                                                                mt_fs_tests_prng_double(prng)));
+        }
+    }
+
+    return (size_t) result;
+}
+
+/* Tells files apart, so that reading the content of another one is noticed. */
+static uint8_t small_files_mt_pattern(size_t const id,
+                                      uint64_t const idx)
+{
+    return (uint8_t) ('A' + (id * 7 + idx) % 26);
+}
+
+static int small_files_mt_write_file(small_files_mt_data const * const data,
+                                     char const * const path,
+                                     uint8_t const * const buffer,
+                                     size_t const size)
+{
+    int result = 0;
+    int fd = open(path,
+                  O_CREAT | O_EXCL | O_WRONLY,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        size_t written = 0;
+
+        while (result == 0 &&
+               written < size)
+        {
+            ssize_t const res = write(fd,
+                                      buffer + written,
+                                      size - written);
+
+            if (res > 0)
+            {
+                written += (size_t) res;
+            }
+            else
+            {
+                result = res == 0 ? EIO : errno;
+                LOG_ERROR("Error writing to %s: %d",
+                          path,
+                          result);
+            }
+        }
+
+        if (result == 0 &&
+            data->fsync == true &&
+            fsync(fd) != 0)
+        {
+            result = errno;
+            LOG_ERROR("Error in fsync of %s: %d",
+                      path,
+                      result);
+        }
+
+        if (close(fd) != 0 &&
+            result == 0)
+        {
+            result = errno;
+            LOG_ERROR("Error closing %s: %d",
+                      path,
+                      result);
+        }
+
+        fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error creating %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static int small_files_mt_read_file(char const * const path,
+                                    uint8_t * const buffer,
+                                    size_t const size,
+                                    uint8_t const pattern)
+{
+    int result = 0;
+    int fd = open(path,
+                  O_RDONLY);
+
+    if (fd != -1)
+    {
+        size_t total = 0;
+        ssize_t got = 0;
+
+        /* One byte more than expected, to notice files longer than that. */
+        do
+        {
+            got = read(fd,
+                       buffer + total,
+                       size + 1 - total);
+
+            if (got > 0)
+            {
+                total += (size_t) got;
+            }
+            else if (got < 0)
+            {
+                result = errno;
+                LOG_ERROR("Error reading from %s: %d",
+                          path,
+                          result);
+            }
+        }
+        while (result == 0 &&
+               got > 0 &&
+               total <= size);
+
+        if (result == 0)
+        {
+            if (total == size)
+            {
+                size_t const mismatch = mt_fs_tests_verify_pattern(buffer,
+                                                                   size,
+                                                                   pattern);
+
+                if (mismatch != size)
+                {
+                    result = EIO;
+                    LOG_ERROR("Error, expected %c at offset %zu of %s, got %d",
+                              pattern,
+                              mismatch,
+                              path,
+                              buffer[mismatch]);
+                }
+            }
+            else
+            {
+                result = EIO;
+                LOG_ERROR("Error, expected %zu bytes in %s, got %s%zu",
+                          size,
+                          path,
+                          total > size ? "more than " : "",
+                          total > size ? size : total);
+            }
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static void small_files_mt_remove_files(small_files_mt_data * const data)
+{
+    if (data->directory != NULL)
+    {
+        char path[PATH_SIZE];
+
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            /* Threads stop at their first error, files after it do not
+               exist. */
+            for (uint64_t idx = 0;
+                 idx < data->nb_files;
+                 idx++)
+            {
+                snprintf(path,
+                         sizeof path,
+                         FILE_NAME_FORMAT,
+                         data->directory,
+                         id,
+                         (unsigned long long) idx);
+
+                if (unlink(path) != 0 &&
+                    errno == ENOENT)
+                {
+                    break;
+                }
+            }
+
+            snprintf(path,
+                     sizeof path,
+                     THREAD_DIRECTORY_FORMAT,
+                     data->directory,
+                     id);
+            rmdir(path);
+        }
+
+        rmdir(data->directory);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+static int small_files_mt_create_directories(small_files_mt_data * const data)
+{
+    int result = 0;
+
+    data->directory = strdup(DIRECTORY_TEMPLATE);
+
+    if (data->directory != NULL)
+    {
+        if (mkdtemp(data->directory) != NULL)
+        {
+            char path[PATH_SIZE];
+
+            for (size_t id = 0;
+                 result == 0 &&
+                     id < data->nb_threads;
+                 id++)
+            {
+                snprintf(path,
+                         sizeof path,
+                         THREAD_DIRECTORY_FORMAT,
+                         data->directory,
+                         id);
+
+                if (mkdir(path, S_IRWXU) != 0)
+                {
+                    result = errno;
+                    LOG_ERROR("Error creating %s: %d",
+                              path,
+                              result);
+                }
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error in mkdtemp: %d",
+                      result);
+            free(data->directory), data->directory = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int small_files_mt_init(void ** test_suite_data,
+                               size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    assert(nb_threads > 0);
+    assert(nb_threads <= UINT_MAX);
+    small_files_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = small_files_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->shared = mt_fs_tests_shared_calloc(1,
+                                                     sizeof *(data->shared) + nb_threads * sizeof *(data->shared->threads));
+
+            if (data->shared != NULL)
+            {
+                result = mt_fs_tests_barrier_init_shared(&(data->shared->barrier),
+                                                         (unsigned int) nb_threads);
+
+                if (result == 0)
+                {
+                    data->barrier_initialized = true;
+                }
+                else
+                {
+                    LOG_ERROR("Error creating phases barrier: %d",
+                              result);
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            result = small_files_mt_create_directories(data);
+        }
+
+        if (result == 0)
+        {
+            LOG_DEBUG("%llu files per thread, from %llu to %llu bytes following a %s distribution%s",
+                      (unsigned long long) data->nb_files,
+                      (unsigned long long) data->min_size,
+                      (unsigned long long) data->max_size,
+                      small_files_mt_size_distributions_names[data->size_distribution],
+                      data->fsync == true ? ", with fsync" : "");
+            *test_suite_data = data;
+        }
+        else
+        {
+            small_files_mt_remove_files(data);
+
+            if (data->shared != NULL)
+            {
+                if (data->barrier_initialized == true)
+                {
+                    mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+                }
+
+                mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int small_files_mt_run_phase(small_files_mt_data const * const data,
+                                    size_t const id,
+                                    small_files_mt_phase const phase,
+                                    size_t const * const sizes,
+                                    uint8_t * const buffer)
+{
+    int result = 0;
+    small_files_mt_thread * const thread = &(data->shared->threads[id]);
+    mt_fs_tests_phase * const stats = &(thread->phases[phase]);
+    char path[PATH_SIZE];
+
+    mt_fs_tests_phase_begin(stats);
+
+    for (uint64_t idx = 0;
+         result == 0 &&
+             idx < data->nb_files;
+         idx++)
+    {
+        size_t const size = sizes[idx];
+        uint8_t const pattern = small_files_mt_pattern(id, idx);
+        mt_fs_tests_op op;
+
+        snprintf(path,
+                 sizeof path,
+                 FILE_NAME_FORMAT,
+                 data->directory,
+                 id,
+                 (unsigned long long) idx);
+
+        mt_fs_tests_op_begin(&op,
+                             phase == small_files_mt_phase_write ? "write_file" : "read_file");
+
+        if (phase == small_files_mt_phase_write)
+        {
+            memset(buffer, pattern, size);
+            result = small_files_mt_write_file(data,
+                                               path,
+                                               buffer,
+                                               size);
+        }
+        else
+        {
+            result = small_files_mt_read_file(path,
+                                              buffer,
+                                              size,
+                                              pattern);
+        }
+
+        if (result == 0)
+        {
+            mt_fs_tests_op_add_bytes((uint64_t) size);
+            stats->count++;
+            stats->bytes += (uint64_t) size;
+        }
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+
+    mt_fs_tests_phase_end(stats);
+
+    return result;
+}
+
+static int small_files_mt_run(void * const test_suite_data,
+                              size_t const id)
+{
+    int result = 0;
+    small_files_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    /* One byte more than the largest file, see small_files_mt_read_file(). */
+    uint8_t * const buffer = malloc((size_t) data->max_size + 1);
+    size_t * const sizes = malloc((size_t) data->nb_files * sizeof *sizes);
+
+    if (buffer != NULL &&
+        sizes != NULL)
+    {
+        mt_fs_tests_prng prng;
+
+        mt_fs_tests_prng_thread_init(&prng, id);
+
+        for (uint64_t idx = 0;
+             idx < data->nb_files;
+             idx++)
+        {
+            sizes[idx] = small_files_mt_next_size(data,
+                                                  &prng);
+        }
+
+        result = small_files_mt_run_phase(data,
+                                          id,
+                                          small_files_mt_phase_write,
+                                          sizes,
+                                          buffer);
+    }
+    else
+    {
+        result = ENOMEM;
+        mt_fs_tests_outcomes_add(&(data->shared->threads[id].outcomes),
+                                 result);
+    }
+
+    if (mt_fs_tests_cold_cache_enabled() == true)
+    {
+        char path[PATH_SIZE];
+        uint64_t const written = data->shared->threads[id].phases[small_files_mt_phase_write].count;
+
+        for (uint64_t idx = 0;
+             idx < written;
+             idx++)
+        {
+            snprintf(path,
+                     sizeof path,
+                     FILE_NAME_FORMAT,
+                     data->directory,
+                     id,
+                     (unsigned long long) idx);
+            mt_fs_tests_cold_cache_evict_path(path);
+        }
+
+        mt_fs_tests_cold_cache_evict_phase(&(data->shared->barrier));
+    }
+
+    /* Even threads which failed to write their files wait for the others,
+       or they would never get past the barrier. */
+    mt_fs_tests_barrier_wait(&(data->shared->barrier));
+
+    if (result == 0)
+    {
+        result = small_files_mt_run_phase(data,
+                                          id,
+                                          small_files_mt_phase_read,
+                                          sizes,
+                                          buffer);
+    }
+
+    free(sizes);
+    free(buffer);
+
+    return 0;
+}
+
+static int small_files_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    small_files_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t phase = 0;
+         phase < small_files_mt_phase_count;
+         phase++)
+    {
+        mt_fs_tests_phase total;
+        double elapsed;
+
+        mt_fs_tests_phase_reset(&total);
+
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            mt_fs_tests_phase_merge(&total,
+                                    &(data->shared->threads[id].phases[phase]));
+        }
+
+        elapsed = mt_fs_tests_phase_elapsed(&total);
+
+        if (elapsed > 0.0)
+        {
+            LOG_OK("%s: %llu files, %llu bytes in %.3f s, %.1f files/s, %.2f MB/s",
+                   small_files_mt_phases_names[phase],
+                   (unsigned long long) total.count,
+                   (unsigned long long) total.bytes,
+                   elapsed,
+                   (double) total.count / elapsed,
+                   (double) total.bytes / elapsed / 1000000.0);
+        }
+    }
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->shared->threads[id].outcomes));
+    }
+
+    /* Every file is written, then read back. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads * data->nb_files * small_files_mt_phase_count }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int small_files_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    small_files_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        small_files_mt_remove_files(data);
+
+        if (data->shared != NULL)
+        {
+            mt_fs_tests_barrier_destroy(&(data->shared->barrier));
+            mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_small_files_mt =
+{
+    "small_files_mt",
+    &small_files_mt_init,
+    &small_files_mt_run,
+    &small_files_mt_post_run,
+    &small_files_mt_deinit,
+    test_suite_type_mt
+};
@@ -1,15 +1,104 @@
 
+#include <assert.h>
+#include <errno.h>
+#include <strings.h>
+
 #include "suites.h"
 
-#define SUITE(name) test_suite const test_suite_ ## name;
+#define SUITE(name) extern test_suite const test_suite_ ## name;
 #include "suites.itm"
 #undef SUITE
 
-test_suite const * const test_suites[] =
+static test_suite const * const builtin_test_suites[] =
 {
 #define SUITE(name) &test_suite_ ## name,
 #include "suites.itm"
 #undef SUITE
 };
 
-size_t const test_suites_count = sizeof test_suites / sizeof *test_suites;
+static size_t const builtin_test_suites_count = sizeof builtin_test_suites / sizeof *builtin_test_suites;
+
+static test_suite const ** registered_test_suites = NULL;
+static size_t registered_test_suites_count = 0;
+
+size_t test_suites_get_count(void)
+{
+    return builtin_test_suites_count + registered_test_suites_count;
+}
+
+test_suite const * test_suites_get(size_t const idx)
+{
+    test_suite const * result = NULL;
+    assert(idx < test_suites_get_count());
+
+    if (idx < builtin_test_suites_count)
+    {
+        result = builtin_test_suites[idx];
+    }
+    else
+    {
+        result = registered_test_suites[idx - builtin_test_suites_count];
+    }
+
+    return result;
+}
+
+test_suite const * test_suites_find(char const * const name)
+{
+    test_suite const * result = NULL;
+    size_t const count = test_suites_get_count();
+    assert(name != NULL);
+
+    for (size_t idx = 0;
+         result == NULL &&
+             idx < count;
+         idx++)
+    {
+        test_suite const * const suite = test_suites_get(idx);
+        assert(suite->name != NULL);
+
+        if (strcasecmp(name,
+                       suite->name) == 0)
+        {
+            result = suite;
+        }
+    }
+
+    return result;
+}
+
+int test_suites_register(test_suite const * const suite)
+{
+    int result = 0;
+    assert(suite != NULL);
+    assert(suite->name != NULL);
+
+    if (test_suites_find(suite->name) == NULL)
+    {
+        test_suite const ** suites = realloc(registered_test_suites,
+                                             sizeof *suites * (registered_test_suites_count + 1));
+
+        if (suites != NULL)
+        {
+            suites[registered_test_suites_count] = suite;
+            registered_test_suites = suites;
+            registered_test_suites_count++;
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+    else
+    {
+        result = EEXIST;
+    }
+
+    return result;
+}
+
+void test_suites_free(void)
+{
+    free(registered_test_suites), registered_test_suites = NULL;
+    registered_test_suites_count = 0;
+}
@@ -3,7 +3,15 @@
 
 #include "test_suites.h"
 
-extern test_suite const * const test_suites[];
-extern size_t const test_suites_count;
+/* Built-in suites, followed by the ones registered from plugins. */
+size_t test_suites_get_count(void) __attribute__ ((__pure__));
+
+test_suite const * test_suites_get(size_t idx) __attribute__ ((__pure__));
+
+test_suite const * test_suites_find(char const * name) __attribute__ ((__pure__));
+
+int test_suites_register(test_suite const * suite);
+
+void test_suites_free(void);
 
 #endif /* SUITES_H_ */
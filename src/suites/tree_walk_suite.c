@@ -0,0 +1,1229 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cold_cache.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Parallel crawl of a directory tree, as done by backup and indexing jobs.
+   The tree is built during init, by as many threads as the run has: each
+   directory holds tree_walk_mt.files empty files and tree_walk_mt.fanout
+   subdirectories, down to tree_walk_mt.depth levels below the root.
+
+   Threads then walk it with openat() and getdents64(), stating each entry
+   with fstatat() or statx(). Each thread has a deque of directories to
+   read: it pushes the subdirectories it finds and pops the last one pushed,
+   going depth first, while idle threads steal the oldest directories of
+   other threads, which tend to be the roots of the largest subtrees.
+   Directories are identified by an entry in a table shared by all threads,
+   holding their name and parent, as workers may be processes.
+
+   Unless tree_walk_mt.baseline is false, the tree is also walked by nftw()
+   in a single thread during init, for comparison.
+
+   Options:
+   - tree_walk_mt.fanout: subdirectories per directory (default 4);
+   - tree_walk_mt.depth: levels below the root (default 5);
+   - tree_walk_mt.files: files per directory (default 16);
+   - tree_walk_mt.stat: fstatat (default), statx with a reduced mask, for
+     the type, mode, size and modification time only, or none, file types
+     then coming from getdents64();
+   - tree_walk_mt.baseline: whether to time nftw() (default true). */
+
+#define DIRECTORY_TEMPLATE "tree_walk_suite_XXXXXX"
+#define DIRECTORY_NAME_FORMAT "d%llu"
+#define FILE_NAME_FORMAT "f%llu"
+#define DEFAULT_FANOUT (4)
+#define DEFAULT_DEPTH (5)
+#define DEFAULT_FILES (16)
+#define MAX_DEPTH (32)
+/* Trees are built in units of a subtree, at least as many per builder. */
+#define UNITS_PER_BUILDER (4)
+#define NODE_NAME_SIZE (24)
+#define NO_PARENT (UINT32_MAX)
+#define DIRENTS_BUFFER_SIZE (32768)
+#define NFTW_DESCRIPTORS (64)
+
+typedef enum
+{
+    tree_walk_mt_stat_fstatat = 0,
+    tree_walk_mt_stat_statx,
+    tree_walk_mt_stat_none,
+    tree_walk_mt_stat_count
+} tree_walk_mt_stat;
+
+static char const * const tree_walk_mt_stats_names[] =
+{
+    "fstatat",
+    "statx",
+    "none",
+};
+
+/* Fixed part of the records returned by getdents64(). */
+typedef struct
+{
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+} tree_walk_mt_dirent;
+
+#define DIRENT_NAME_OFFSET (offsetof(tree_walk_mt_dirent, d_type) + 1)
+
+typedef struct
+{
+    uint32_t parent;
+    char name[NODE_NAME_SIZE];
+} tree_walk_mt_node;
+
+/* Directories waiting to be read by a thread, as indexes in the nodes
+   table. The owner pushes and pops at the bottom, thieves take from the
+   top. The lock is only contended when stealing. */
+typedef struct
+{
+    uint32_t lock;
+    uint32_t top;
+    uint32_t bottom;
+} tree_walk_mt_deque;
+
+/* The count of the walk is the number of entries. */
+typedef struct
+{
+    mt_fs_tests_phase walk;
+    uint64_t directories;
+    mt_fs_tests_outcomes outcomes;
+} tree_walk_mt_thread;
+
+typedef struct
+{
+    /* Directories pushed and not entirely read yet, the walk being over
+       once it drops to 0. */
+    uint64_t pending;
+    uint32_t next_node;
+    int error;
+    tree_walk_mt_thread threads[];
+} tree_walk_mt_shared;
+
+typedef struct {
+    char * directory;
+    tree_walk_mt_shared * shared;
+    tree_walk_mt_node * nodes;
+    tree_walk_mt_deque * deques;
+    /* deque_capacity entries per thread. */
+    uint32_t * deques_items;
+    size_t nb_threads;
+    uint64_t fanout;
+    uint64_t depth;
+    uint64_t nb_files;
+    uint64_t nb_directories;
+    uint64_t nb_entries;
+    uint64_t deque_capacity;
+    uint64_t baseline_entries;
+    uint64_t baseline_ns;
+    tree_walk_mt_stat stat;
+    bool baseline;
+} tree_walk_mt_data;
+
+typedef struct
+{
+    tree_walk_mt_data const * data;
+    int root_fd;
+    uint64_t level;
+    uint64_t nb_units;
+    uint64_t next_unit;
+    int error;
+} tree_walk_mt_builders;
+
+/* nftw() callbacks have no user data. */
+static uint64_t tree_walk_mt_nftw_entries = 0;
+
+static int tree_walk_mt_get_options(tree_walk_mt_data * const data)
+{
+    char const * const stat_name = mt_fs_tests_option_get_string("tree_walk_mt.stat",
+                                                                 "fstatat");
+    int result = mt_fs_tests_option_get_uint64("tree_walk_mt.fanout",
+                                               DEFAULT_FANOUT,
+                                               &(data->fanout));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("tree_walk_mt.depth",
+                                               DEFAULT_DEPTH,
+                                               &(data->depth));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("tree_walk_mt.files",
+                                               DEFAULT_FILES,
+                                               &(data->nb_files));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_bool("tree_walk_mt.baseline",
+                                             true,
+                                             &(data->baseline));
+    }
+
+    if (result == 0 &&
+        (data->fanout == 0 ||
+         data->depth > MAX_DEPTH))
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid tree, expected a fanout of at least 1 and a depth of at most %d",
+                  MAX_DEPTH);
+    }
+
+    if (result == 0)
+    {
+        result = ENOENT;
+
+        for (size_t idx = 0;
+             result == ENOENT &&
+                 idx < tree_walk_mt_stat_count;
+             idx++)
+        {
+            if (strcasecmp(stat_name, tree_walk_mt_stats_names[idx]) == 0)
+            {
+                data->stat = (tree_walk_mt_stat) idx;
+                result = 0;
+            }
+        }
+
+        if (result != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid stat mode %s", stat_name);
+        }
+#ifndef STATX_TYPE
+        else if (data->stat == tree_walk_mt_stat_statx)
+        {
+            result = ENOTSUP;
+            LOG_ERROR("statx() is not available");
+        }
+#endif
+    }
+
+    if (result == 0)
+    {
+        uint64_t level_directories = 1;
+
+        data->nb_directories = 1;
+
+        for (uint64_t level = 1;
+             result == 0 &&
+                 level <= data->depth;
+             level++)
+        {
+            if (level_directories > UINT32_MAX / data->fanout)
+            {
+                result = EINVAL;
+            }
+            else
+            {
+                level_directories *= data->fanout;
+                data->nb_directories += level_directories;
+            }
+        }
+
+        /* Entries are counted without the root. */
+        if (result == 0 &&
+            data->nb_directories < UINT32_MAX &&
+            data->nb_files <= (UINT32_MAX - data->nb_directories) / data->nb_directories)
+        {
+            data->nb_entries = data->nb_directories - 1 + data->nb_directories * data->nb_files;
+        }
+        else
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid tree, more than %u entries",
+                      UINT32_MAX);
+        }
+    }
+
+    return result;
+}
+
+static int tree_walk_mt_build(tree_walk_mt_data const * const data,
+                              int const dir_fd,
+                              uint64_t const level,
+                              uint64_t const stop_level)
+{
+    int result = 0;
+    char name[NODE_NAME_SIZE];
+
+    for (uint64_t idx = 0;
+         result == 0 &&
+             idx < data->nb_files;
+         idx++)
+    {
+        snprintf(name,
+                 sizeof name,
+                 FILE_NAME_FORMAT,
+                 (unsigned long long) idx);
+
+        int fd = openat(dir_fd,
+                        name,
+                        O_CREAT | O_EXCL | O_WRONLY | O_CLOEXEC,
+                        S_IRUSR | S_IWUSR);
+
+        if (fd != -1)
+        {
+            close(fd), fd = -1;
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating file %s: %d",
+                      name,
+                      result);
+        }
+    }
+
+    for (uint64_t idx = 0;
+         result == 0 &&
+             level < data->depth &&
+             idx < data->fanout;
+         idx++)
+    {
+        snprintf(name,
+                 sizeof name,
+                 DIRECTORY_NAME_FORMAT,
+                 (unsigned long long) idx);
+
+        if (mkdirat(dir_fd,
+                    name,
+                    S_IRWXU) == 0)
+        {
+            /* Directories at the stop level are filled by someone else. */
+            if (level + 1 < stop_level)
+            {
+                int fd = openat(dir_fd,
+                                name,
+                                O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+                if (fd != -1)
+                {
+                    result = tree_walk_mt_build(data,
+                                                fd,
+                                                level + 1,
+                                                stop_level);
+                    close(fd), fd = -1;
+                }
+                else
+                {
+                    result = errno;
+                    LOG_ERROR("Error opening directory %s: %d",
+                              name,
+                              result);
+                }
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error creating directory %s: %d",
+                      name,
+                      result);
+        }
+    }
+
+    return result;
+}
+
+/* Builds the subtrees of the split level not taken by other builders yet. */
+static void * tree_walk_mt_builder(void * const arg)
+{
+    tree_walk_mt_builders * const builders = arg;
+    tree_walk_mt_data const * const data = builders->data;
+    int result = 0;
+    uint64_t unit = 0;
+
+    while (result == 0 &&
+           __atomic_load_n(&(builders->error), __ATOMIC_RELAXED) == 0 &&
+           (unit = __atomic_fetch_add(&(builders->next_unit), 1, __ATOMIC_RELAXED)) < builders->nb_units)
+    {
+        char path[MAX_DEPTH * NODE_NAME_SIZE];
+        size_t used = 0;
+        uint64_t divisor = builders->nb_units;
+
+        path[0] = '\0';
+
+        for (uint64_t level = 0;
+             level < builders->level;
+             level++)
+        {
+            int written = 0;
+
+            divisor /= data->fanout;
+            written = snprintf(path + used,
+                               sizeof path - used,
+                               "%s" DIRECTORY_NAME_FORMAT,
+                               level > 0 ? "/" : "",
+                               (unsigned long long) (unit / divisor % data->fanout));
+            used += written > 0 ? (size_t) written : 0;
+        }
+
+        int fd = openat(builders->root_fd,
+                        used > 0 ? path : ".",
+                        O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        if (fd != -1)
+        {
+            result = tree_walk_mt_build(data,
+                                        fd,
+                                        builders->level,
+                                        UINT64_MAX);
+            close(fd), fd = -1;
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error opening directory %s: %d",
+                      path,
+                      result);
+        }
+    }
+
+    if (result != 0)
+    {
+        __atomic_store_n(&(builders->error), result, __ATOMIC_RELAXED);
+    }
+
+    return NULL;
+}
+
+/* The top levels are built first, up to a level with enough directories
+   for each thread to build several subtrees, which threads then share. */
+static int tree_walk_mt_build_tree(tree_walk_mt_data const * const data)
+{
+    int result = 0;
+    int root_fd = open(data->directory,
+                       O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    if (root_fd != -1)
+    {
+        tree_walk_mt_builders builders =
+            {
+                .data = data,
+                .root_fd = root_fd,
+                .nb_units = 1,
+            };
+        pthread_t * const helpers = calloc(data->nb_threads, sizeof *helpers);
+        size_t nb_helpers = 0;
+
+        while (builders.level < data->depth &&
+               builders.nb_units < data->nb_threads * UNITS_PER_BUILDER)
+        {
+            builders.nb_units *= data->fanout;
+            builders.level++;
+        }
+
+        if (builders.level > 0)
+        {
+            result = tree_walk_mt_build(data,
+                                        root_fd,
+                                        0,
+                                        builders.level);
+        }
+
+        if (result == 0 &&
+            helpers != NULL)
+        {
+            /* The calling thread builds as well, a helper failing to start
+               only slows the build down. */
+            for (size_t idx = 1;
+                 idx < data->nb_threads &&
+                     idx < builders.nb_units;
+                 idx++)
+            {
+                if (pthread_create(&(helpers[nb_helpers]),
+                                   NULL,
+                                   &tree_walk_mt_builder,
+                                   &builders) == 0)
+                {
+                    nb_helpers++;
+                }
+            }
+        }
+
+        if (result == 0)
+        {
+            tree_walk_mt_builder(&builders);
+        }
+
+        for (size_t idx = 0;
+             idx < nb_helpers;
+             idx++)
+        {
+            pthread_join(helpers[idx], NULL);
+        }
+
+        if (result == 0)
+        {
+            result = builders.error;
+        }
+
+        free(helpers);
+        close(root_fd), root_fd = -1;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  data->directory,
+                  result);
+    }
+
+    return result;
+}
+
+static int tree_walk_mt_nftw_count(char const * const path,
+                                   struct stat const * const st,
+                                   int const type,
+                                   struct FTW * const ftw)
+{
+    (void) path;
+    (void) st;
+    (void) type;
+
+    if (ftw->level > 0)
+    {
+        tree_walk_mt_nftw_entries++;
+    }
+
+    return 0;
+}
+
+static int tree_walk_mt_run_baseline(tree_walk_mt_data * const data)
+{
+    int result = 0;
+    uint64_t start_ns = 0;
+
+    /* Walks the tree in the state the run will find it. */
+    mt_fs_tests_cold_cache_evict();
+
+    tree_walk_mt_nftw_entries = 0;
+    start_ns = mt_fs_tests_now_ns();
+
+    if (nftw(data->directory,
+             &tree_walk_mt_nftw_count,
+             NFTW_DESCRIPTORS,
+             FTW_PHYS) == 0)
+    {
+        data->baseline_ns = mt_fs_tests_now_ns() - start_ns;
+        data->baseline_entries = tree_walk_mt_nftw_entries;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error walking %s with nftw: %d",
+                  data->directory,
+                  result);
+    }
+
+    return result;
+}
+
+static int tree_walk_mt_nftw_remove(char const * const path,
+                                    struct stat const * const st,
+                                    int const type,
+                                    struct FTW * const ftw)
+{
+    (void) st;
+    (void) type;
+    (void) ftw;
+
+    remove(path);
+
+    return 0;
+}
+
+static void tree_walk_mt_remove_tree(tree_walk_mt_data * const data)
+{
+    if (data->directory != NULL)
+    {
+        nftw(data->directory,
+             &tree_walk_mt_nftw_remove,
+             NFTW_DESCRIPTORS,
+             FTW_DEPTH | FTW_PHYS);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+static void tree_walk_mt_free(tree_walk_mt_data * const data)
+{
+    if (data->shared != NULL)
+    {
+        mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+    }
+
+    if (data->nodes != NULL)
+    {
+        mt_fs_tests_shared_free(data->nodes), data->nodes = NULL;
+    }
+
+    if (data->deques != NULL)
+    {
+        mt_fs_tests_shared_free(data->deques), data->deques = NULL;
+    }
+
+    if (data->deques_items != NULL)
+    {
+        mt_fs_tests_shared_free(data->deques_items), data->deques_items = NULL;
+    }
+}
+
+static int tree_walk_mt_init(void ** test_suite_data,
+                             size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    assert(nb_threads > 0);
+    tree_walk_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = tree_walk_mt_get_options(data);
+
+        if (result == 0)
+        {
+            /* Going depth first, a deque holds at most the siblings not
+               read yet of the directories above the one being read. */
+            data->deque_capacity = (data->depth + 1) * data->fanout + 1;
+
+            data->shared = mt_fs_tests_shared_calloc(1,
+                                                     sizeof *(data->shared) + nb_threads * sizeof *(data->shared->threads));
+            data->nodes = mt_fs_tests_shared_calloc((size_t) data->nb_directories,
+                                                    sizeof *(data->nodes));
+            data->deques = mt_fs_tests_shared_calloc(nb_threads,
+                                                     sizeof *(data->deques));
+            data->deques_items = mt_fs_tests_shared_calloc(nb_threads * (size_t) data->deque_capacity,
+                                                           sizeof *(data->deques_items));
+
+            if (data->shared != NULL &&
+                data->nodes != NULL &&
+                data->deques != NULL &&
+                data->deques_items != NULL)
+            {
+                /* The root, to be read by the first thread. */
+                data->nodes[0].parent = NO_PARENT;
+                snprintf(data->nodes[0].name, sizeof data->nodes[0].name, ".");
+                data->shared->next_node = 1;
+                data->shared->pending = 1;
+                data->deques_items[0] = 0;
+                data->deques[0].bottom = 1;
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            data->directory = strdup(DIRECTORY_TEMPLATE);
+
+            if (data->directory != NULL)
+            {
+                if (mkdtemp(data->directory) != NULL)
+                {
+                    uint64_t const start_ns = mt_fs_tests_now_ns();
+
+                    result = tree_walk_mt_build_tree(data);
+
+                    if (result == 0)
+                    {
+                        LOG_DEBUG("Built a tree of %llu directories and %llu entries in %.3f s",
+                                  (unsigned long long) data->nb_directories,
+                                  (unsigned long long) data->nb_entries,
+                                  (double) (mt_fs_tests_now_ns() - start_ns) / (double) MT_FS_TESTS_NS_PER_SEC);
+                    }
+                }
+                else
+                {
+                    result = errno;
+                    LOG_ERROR("Error in mkdtemp: %d",
+                              result);
+                    free(data->directory), data->directory = NULL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0 &&
+            data->baseline == true)
+        {
+            result = tree_walk_mt_run_baseline(data);
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            tree_walk_mt_remove_tree(data);
+            tree_walk_mt_free(data);
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static void tree_walk_mt_lock(uint32_t * const lock)
+{
+    while (__atomic_exchange_n(lock, 1, __ATOMIC_ACQUIRE) != 0)
+    {
+        sched_yield();
+    }
+}
+
+static void tree_walk_mt_unlock(uint32_t * const lock)
+{
+    __atomic_store_n(lock, 0, __ATOMIC_RELEASE);
+}
+
+static int tree_walk_mt_push(tree_walk_mt_data const * const data,
+                             size_t const id,
+                             uint32_t const node)
+{
+    int result = 0;
+    tree_walk_mt_deque * const deque = &(data->deques[id]);
+
+    tree_walk_mt_lock(&(deque->lock));
+
+    if (deque->bottom - deque->top < data->deque_capacity)
+    {
+        data->deques_items[id * data->deque_capacity + deque->bottom % data->deque_capacity] = node;
+        deque->bottom++;
+    }
+    else
+    {
+        result = EOVERFLOW;
+    }
+
+    tree_walk_mt_unlock(&(deque->lock));
+
+    return result;
+}
+
+/* Takes the newest directory of a deque for its owner, the oldest one for
+   a thief. */
+static bool tree_walk_mt_take(tree_walk_mt_data const * const data,
+                              size_t const id,
+                              bool const steal,
+                              uint32_t * const node)
+{
+    bool result = false;
+    tree_walk_mt_deque * const deque = &(data->deques[id]);
+
+    /* Not worth taking the lock of an empty deque. */
+    if (__atomic_load_n(&(deque->bottom), __ATOMIC_RELAXED) != __atomic_load_n(&(deque->top), __ATOMIC_RELAXED))
+    {
+        tree_walk_mt_lock(&(deque->lock));
+
+        if (deque->bottom != deque->top)
+        {
+            if (steal == true)
+            {
+                *node = data->deques_items[id * data->deque_capacity + deque->top % data->deque_capacity];
+                deque->top++;
+            }
+            else
+            {
+                deque->bottom--;
+                *node = data->deques_items[id * data->deque_capacity + deque->bottom % data->deque_capacity];
+            }
+
+            result = true;
+        }
+
+        tree_walk_mt_unlock(&(deque->lock));
+    }
+
+    return result;
+}
+
+/* Path of a directory relative to the root of the tree. */
+static int tree_walk_mt_node_path(tree_walk_mt_data const * const data,
+                                  uint32_t const node,
+                                  char * const path,
+                                  size_t const size)
+{
+    int result = 0;
+    uint32_t chain[MAX_DEPTH + 1];
+    size_t nb_chain = 0;
+    size_t used = 0;
+
+    for (uint32_t current = node;
+         result == 0 &&
+             data->nodes[current].parent != NO_PARENT;
+         current = data->nodes[current].parent)
+    {
+        if (nb_chain < sizeof chain / sizeof *chain)
+        {
+            chain[nb_chain] = current;
+            nb_chain++;
+        }
+        else
+        {
+            result = ENAMETOOLONG;
+        }
+    }
+
+    snprintf(path, size, ".");
+
+    for (size_t idx = nb_chain;
+         result == 0 &&
+             idx > 0;
+         idx--)
+    {
+        int const written = snprintf(path + used,
+                                     size - used,
+                                     "%s%s",
+                                     used > 0 ? "/" : "",
+                                     data->nodes[chain[idx - 1]].name);
+
+        if (written > 0 &&
+            (size_t) written < size - used)
+        {
+            used += (size_t) written;
+        }
+        else
+        {
+            result = ENAMETOOLONG;
+        }
+    }
+
+    return result;
+}
+
+static int tree_walk_mt_stat_entry(tree_walk_mt_data const * const data,
+                                   int const dir_fd,
+                                   char const * const name,
+                                   unsigned char * const type)
+{
+    int result = 0;
+    mt_fs_tests_op op;
+
+#ifdef STATX_TYPE
+    if (data->stat == tree_walk_mt_stat_statx)
+    {
+        struct statx stx;
+
+        mt_fs_tests_op_begin(&op,
+                             "statx");
+
+        if (statx(dir_fd,
+                  name,
+                  AT_SYMLINK_NOFOLLOW,
+                  STATX_TYPE | STATX_MODE | STATX_SIZE | STATX_MTIME,
+                  &stx) == 0)
+        {
+            *type = S_ISDIR(stx.stx_mode) ? DT_DIR : DT_REG;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+    else
+#endif
+    {
+        struct stat st;
+
+        mt_fs_tests_op_begin(&op,
+                             "fstatat");
+
+        if (fstatat(dir_fd,
+                    name,
+                    &st,
+                    AT_SYMLINK_NOFOLLOW) == 0)
+        {
+            *type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+        }
+        else
+        {
+            result = errno;
+        }
+    }
+
+    mt_fs_tests_op_end(&op,
+                       result);
+
+    if (result != 0)
+    {
+        LOG_ERROR("Error stating %s: %d",
+                  name,
+                  result);
+    }
+
+    return result;
+}
+
+/* Reads a directory, stating its entries and pushing its subdirectories. */
+static int tree_walk_mt_read_directory(tree_walk_mt_data const * const data,
+                                       size_t const id,
+                                       int const root_fd,
+                                       uint32_t const node,
+                                       uint8_t * const buffer)
+{
+    int result = 0;
+    tree_walk_mt_thread * const thread = &(data->shared->threads[id]);
+    char path[MAX_DEPTH * NODE_NAME_SIZE];
+    int fd = -1;
+    mt_fs_tests_op op;
+
+    result = tree_walk_mt_node_path(data,
+                                    node,
+                                    path,
+                                    sizeof path);
+
+    if (result == 0)
+    {
+        mt_fs_tests_op_begin(&op,
+                             "openat");
+
+        fd = openat(root_fd,
+                    path,
+                    O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+        result = fd != -1 ? 0 : errno;
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error opening %s: %d",
+                      path,
+                      result);
+        }
+    }
+
+    while (result == 0)
+    {
+        long got = 0;
+
+        mt_fs_tests_op_begin(&op,
+                             "getdents64");
+
+        got = syscall(SYS_getdents64,
+                      fd,
+                      buffer,
+                      DIRENTS_BUFFER_SIZE);
+
+        result = got >= 0 ? 0 : errno;
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error reading directory %s: %d",
+                      path,
+                      result);
+        }
+        else if (got == 0)
+        {
+            break;
+        }
+
+        for (long pos = 0;
+             result == 0 &&
+                 pos < got;)
+        {
+            tree_walk_mt_dirent dirent;
+            char const * const name = (char const *) buffer + pos + DIRENT_NAME_OFFSET;
+
+            memcpy(&dirent, buffer + pos, DIRENT_NAME_OFFSET);
+            pos += dirent.d_reclen;
+
+            if (strcmp(name, ".") == 0 ||
+                strcmp(name, "..") == 0)
+            {
+                continue;
+            }
+
+            unsigned char type = dirent.d_type;
+
+            if (data->stat != tree_walk_mt_stat_none ||
+                type == DT_UNKNOWN)
+            {
+                result = tree_walk_mt_stat_entry(data,
+                                                 fd,
+                                                 name,
+                                                 &type);
+            }
+
+            if (result == 0)
+            {
+                thread->walk.count++;
+            }
+
+            if (result == 0 &&
+                type == DT_DIR)
+            {
+                uint32_t const child = __atomic_fetch_add(&(data->shared->next_node), 1, __ATOMIC_RELAXED);
+
+                if (child < data->nb_directories &&
+                    strlen(name) < sizeof data->nodes[child].name)
+                {
+                    data->nodes[child].parent = node;
+                    snprintf(data->nodes[child].name, sizeof data->nodes[child].name, "%s", name);
+
+                    __atomic_fetch_add(&(data->shared->pending), 1, __ATOMIC_RELAXED);
+                    result = tree_walk_mt_push(data,
+                                               id,
+                                               child);
+                }
+                else
+                {
+                    result = EOVERFLOW;
+                }
+
+                if (result != 0)
+                {
+                    LOG_ERROR("Error, unexpected directory %s in %s: %d",
+                              name,
+                              path,
+                              result);
+                }
+            }
+        }
+    }
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+    }
+
+    thread->directories++;
+
+    return result;
+}
+
+static int tree_walk_mt_run(void * const test_suite_data,
+                            size_t const id)
+{
+    int result = 0;
+    tree_walk_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    tree_walk_mt_thread * const thread = &(data->shared->threads[id]);
+    uint8_t * const buffer = malloc(DIRENTS_BUFFER_SIZE);
+    int root_fd = open(data->directory,
+                       O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    mt_fs_tests_phase_begin(&(thread->walk));
+
+    if (buffer == NULL)
+    {
+        result = ENOMEM;
+    }
+    else if (root_fd == -1)
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  data->directory,
+                  result);
+    }
+
+    while (result == 0 &&
+           __atomic_load_n(&(data->shared->error), __ATOMIC_RELAXED) == 0)
+    {
+        uint32_t node = 0;
+        bool found = tree_walk_mt_take(data,
+                                       id,
+                                       false,
+                                       &node);
+
+        for (size_t idx = 1;
+             found == false &&
+                 idx < data->nb_threads;
+             idx++)
+        {
+            found = tree_walk_mt_take(data,
+                                      (id + idx) % data->nb_threads,
+                                      true,
+                                      &node);
+        }
+
+        if (found == true)
+        {
+            result = tree_walk_mt_read_directory(data,
+                                                 id,
+                                                 root_fd,
+                                                 node,
+                                                 buffer);
+
+            __atomic_fetch_sub(&(data->shared->pending), 1, __ATOMIC_RELEASE);
+        }
+        else if (__atomic_load_n(&(data->shared->pending), __ATOMIC_ACQUIRE) == 0)
+        {
+            break;
+        }
+        else
+        {
+            /* Others are still reading directories which may hold more. */
+            sched_yield();
+        }
+    }
+
+    if (result != 0)
+    {
+        /* Others would otherwise wait forever for the directories this
+           thread did not read. */
+        __atomic_store_n(&(data->shared->error), result, __ATOMIC_RELAXED);
+    }
+
+    mt_fs_tests_outcomes_add(&(thread->outcomes),
+                             result);
+
+    mt_fs_tests_phase_end(&(thread->walk));
+
+    if (root_fd != -1)
+    {
+        close(root_fd), root_fd = -1;
+    }
+
+    free(buffer);
+
+    return 0;
+}
+
+static int tree_walk_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    tree_walk_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    mt_fs_tests_phase walk;
+    uint64_t directories = 0;
+    double elapsed;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+    mt_fs_tests_phase_reset(&walk);
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        tree_walk_mt_thread const * const thread = &(data->shared->threads[id]);
+
+        mt_fs_tests_phase_merge(&walk,
+                                &(thread->walk));
+        directories += thread->directories;
+
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(thread->outcomes));
+    }
+
+    elapsed = mt_fs_tests_phase_elapsed(&walk);
+
+    if (elapsed > 0.0)
+    {
+        double const rate = (double) walk.count / elapsed;
+
+        LOG_OK("walk: %llu entries in %llu directories in %.3f s, %.1f entries/s (%s)",
+               (unsigned long long) walk.count,
+               (unsigned long long) directories,
+               elapsed,
+               rate,
+               tree_walk_mt_stats_names[data->stat]);
+
+        if (data->baseline == true &&
+            data->baseline_ns > 0)
+        {
+            double const baseline_elapsed = (double) data->baseline_ns / (double) MT_FS_TESTS_NS_PER_SEC;
+            double const baseline_rate = (double) data->baseline_entries / baseline_elapsed;
+
+            LOG_OK("nftw baseline: %llu entries in %.3f s, %.1f entries/s, the parallel walk being %.2f times as fast",
+                   (unsigned long long) data->baseline_entries,
+                   baseline_elapsed,
+                   baseline_rate,
+                   rate / baseline_rate);
+        }
+    }
+
+    if (walk.count != data->nb_entries)
+    {
+        LOG_ERROR("Error, expected %llu entries, found %llu",
+                  (unsigned long long) data->nb_entries,
+                  (unsigned long long) walk.count);
+        /* Not expected, so that the check below fails. */
+        mt_fs_tests_outcomes_add(&outcomes,
+                                 EIO);
+    }
+
+    /* Every thread walks until the whole tree has been read. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_exactly, data->nb_threads }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int tree_walk_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    tree_walk_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        tree_walk_mt_remove_tree(data);
+        tree_walk_mt_free(data);
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_tree_walk_mt =
+{
+    "tree_walk_mt",
+    &tree_walk_mt_init,
+    &tree_walk_mt_run,
+    &tree_walk_mt_post_run,
+    &tree_walk_mt_deinit,
+    test_suite_type_mt
+};
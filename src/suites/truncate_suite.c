@@ -0,0 +1,811 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Size changes racing with reads: the first truncate_mt.truncators threads
+   repeatedly cut the end of a file with ftruncate() and extend it back, or
+   punch a hole in it with fallocate(FALLOC_FL_PUNCH_HOLE), then write the
+   lost data back, while the other threads read random ranges of the file
+   with pread(). A reader may see the data, zeros where data is missing, or
+   a short read past the current end of the file, but no byte of any other
+   value. Truncators keep going until all readers are done. Once the run is
+   over, the file must have its original size and content.
+
+   Options:
+   - truncate_mt.mode: truncate (default) or punch_hole;
+   - truncate_mt.truncators: threads changing the file (default 1);
+   - truncate_mt.size: size of the file (default 1m);
+   - truncate_mt.range: largest range cut or punched at once (default 64k);
+   - truncate_mt.io_size: size of reads (default 4k);
+   - truncate_mt.iterations: reads per reader, or cycles per truncator
+     when there is no reader (default 10000). */
+
+#define FILENAME_TEMPLATE "truncate_suite_XXXXXX"
+#define DEFAULT_TRUNCATORS (1)
+#define DEFAULT_SIZE (1024 * 1024)
+#define DEFAULT_RANGE (64 * 1024)
+#define DEFAULT_IO_SIZE (4096)
+#define DEFAULT_ITERATIONS (10000)
+
+typedef enum
+{
+    truncate_mt_mode_truncate = 0,
+    truncate_mt_mode_punch_hole,
+    truncate_mt_mode_count
+} truncate_mt_mode;
+
+static char const * const truncate_mt_modes_names[] =
+{
+    "truncate",
+    "punch_hole",
+};
+
+typedef struct
+{
+    /* Counts cycles for truncators, reads for readers. */
+    mt_fs_tests_phase run;
+    uint64_t inconsistencies;
+    mt_fs_tests_outcomes outcomes;
+} truncate_mt_thread;
+
+typedef struct
+{
+    uint64_t readers_done;
+    truncate_mt_thread threads[];
+} truncate_mt_shared;
+
+typedef struct {
+    char * filename;
+    truncate_mt_shared * shared;
+    size_t nb_threads;
+    uint64_t nb_truncators;
+    uint64_t size;
+    uint64_t range;
+    uint64_t io_size;
+    uint64_t iterations;
+    truncate_mt_mode mode;
+} truncate_mt_data;
+
+/* Byte expected at each offset of the file, never 0 so that zeros, from a
+   cut or a hole, are told apart from data. */
+static void truncate_mt_fill(uint8_t * const buffer,
+                             uint64_t const offset,
+                             size_t const size)
+{
+    for (size_t idx = 0;
+         idx < size;
+         idx++)
+    {
+        uint64_t const pos = offset + idx;
+        uint64_t block = pos / sizeof (uint64_t);
+        uint8_t const value = (uint8_t) (mt_fs_tests_prng_splitmix64(&block) >> (pos % sizeof (uint64_t) * 8));
+
+        buffer[idx] = value != 0 ? value : 1;
+    }
+}
+
+static int truncate_mt_get_options(truncate_mt_data * const data)
+{
+    char const * const mode = mt_fs_tests_option_get_string("truncate_mt.mode",
+                                                            "truncate");
+    int result = mt_fs_tests_option_get_uint64("truncate_mt.truncators",
+                                               DEFAULT_TRUNCATORS,
+                                               &(data->nb_truncators));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("truncate_mt.size",
+                                             DEFAULT_SIZE,
+                                             &(data->size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("truncate_mt.range",
+                                             DEFAULT_RANGE,
+                                             &(data->range));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("truncate_mt.io_size",
+                                             DEFAULT_IO_SIZE,
+                                             &(data->io_size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("truncate_mt.iterations",
+                                               DEFAULT_ITERATIONS,
+                                               &(data->iterations));
+    }
+
+    if (result == 0 &&
+        (data->range == 0 ||
+         data->io_size == 0 ||
+         data->range > data->size ||
+         data->io_size > data->size ||
+         data->size > INT64_MAX))
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid sizes, expected 0 < range <= size and 0 < io_size <= size");
+    }
+
+    if (result == 0 &&
+        data->nb_truncators > data->nb_threads)
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid truncate_mt.truncators, %llu for %zu threads",
+                  (unsigned long long) data->nb_truncators,
+                  data->nb_threads);
+    }
+
+    if (result == 0)
+    {
+        result = ENOENT;
+
+        for (size_t idx = 0;
+             result == ENOENT &&
+                 idx < truncate_mt_mode_count;
+             idx++)
+        {
+            if (strcasecmp(mode, truncate_mt_modes_names[idx]) == 0)
+            {
+                data->mode = (truncate_mt_mode) idx;
+                result = 0;
+            }
+        }
+
+        if (result != 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid mode %s", mode);
+        }
+    }
+
+    return result;
+}
+
+static int truncate_mt_write(int const fd,
+                             uint8_t * const buffer,
+                             uint64_t const offset,
+                             size_t const size)
+{
+    int result = 0;
+    size_t written = 0;
+
+    truncate_mt_fill(buffer,
+                     offset,
+                     size);
+
+    while (result == 0 &&
+           written < size)
+    {
+        ssize_t const res = pwrite(fd,
+                                   buffer + written,
+                                   size - written,
+                                   (off_t) (offset + written));
+
+        if (res > 0)
+        {
+            written += (size_t) res;
+        }
+        else
+        {
+            result = res == 0 ? EIO : errno;
+            LOG_ERROR("Error writing %zu bytes at %llu: %d",
+                      size - written,
+                      (unsigned long long) (offset + written),
+                      result);
+        }
+    }
+
+    return result;
+}
+
+static int truncate_mt_create_file(truncate_mt_data * const data)
+{
+    int result = 0;
+    uint8_t * const buffer = malloc((size_t) data->range);
+
+    data->filename = strdup(FILENAME_TEMPLATE);
+
+    if (buffer != NULL &&
+        data->filename != NULL)
+    {
+        int fd = mkstemp(data->filename);
+
+        if (fd != -1)
+        {
+            for (uint64_t pos = 0;
+                 result == 0 &&
+                     pos < data->size;
+                 pos += data->range)
+            {
+                result = truncate_mt_write(fd,
+                                           buffer,
+                                           pos,
+                                           (size_t) (data->size - pos < data->range ? data->size - pos : data->range));
+            }
+
+            /* Checks that the filesystem supports punching holes before
+               starting, the hole being filled right away. */
+            if (result == 0 &&
+                data->mode == truncate_mt_mode_punch_hole)
+            {
+                if (fallocate(fd,
+                              FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                              0,
+                              (off_t) data->range) == 0)
+                {
+                    result = truncate_mt_write(fd,
+                                               buffer,
+                                               0,
+                                               (size_t) data->range);
+                }
+                else
+                {
+                    result = errno;
+                    LOG_ERROR("Error punching a hole in %s: %d",
+                              data->filename,
+                              result);
+                }
+            }
+
+            close(fd), fd = -1;
+
+            if (result != 0)
+            {
+                unlink(data->filename);
+                free(data->filename), data->filename = NULL;
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error in mkstemp: %d",
+                      result);
+            free(data->filename), data->filename = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+        free(data->filename), data->filename = NULL;
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+static int truncate_mt_init(void ** test_suite_data,
+                            size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    truncate_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = truncate_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->shared = mt_fs_tests_shared_calloc(1,
+                                                     sizeof *(data->shared) + nb_threads * sizeof *(data->shared->threads));
+
+            if (data->shared == NULL)
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            result = truncate_mt_create_file(data);
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            if (data->shared != NULL)
+            {
+                mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+/* Cuts or punches a random range of the file, then writes it back. */
+static int truncate_mt_cycle(truncate_mt_data const * const data,
+                             int const fd,
+                             mt_fs_tests_prng * const prng,
+                             uint8_t * const buffer)
+{
+    int result = 0;
+    uint64_t const length = 1 + mt_fs_tests_prng_bounded(prng, data->range);
+    uint64_t offset = 0;
+    mt_fs_tests_op op;
+
+    if (data->mode == truncate_mt_mode_truncate)
+    {
+        offset = data->size - length;
+
+        mt_fs_tests_op_begin(&op,
+                             "ftruncate");
+
+        result = ftruncate(fd, (off_t) offset) == 0 ? 0 : errno;
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        if (result == 0)
+        {
+            mt_fs_tests_op_begin(&op,
+                                 "ftruncate");
+
+            result = ftruncate(fd, (off_t) data->size) == 0 ? 0 : errno;
+
+            mt_fs_tests_op_end(&op,
+                               result);
+        }
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error truncating %s: %d",
+                      data->filename,
+                      result);
+        }
+    }
+    else
+    {
+        offset = mt_fs_tests_prng_bounded(prng, data->size - length + 1);
+
+        mt_fs_tests_op_begin(&op,
+                             "punch_hole");
+
+        result = fallocate(fd,
+                           FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                           (off_t) offset,
+                           (off_t) length) == 0 ? 0 : errno;
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        if (result != 0)
+        {
+            LOG_ERROR("Error punching a hole in %s: %d",
+                      data->filename,
+                      result);
+        }
+    }
+
+    if (result == 0)
+    {
+        mt_fs_tests_op_begin(&op,
+                             "pwrite");
+
+        result = truncate_mt_write(fd,
+                                   buffer,
+                                   offset,
+                                   (size_t) length);
+
+        mt_fs_tests_op_end(&op,
+                           result);
+
+        if (result == 0)
+        {
+            mt_fs_tests_op_add_bytes(length);
+        }
+    }
+
+    return result;
+}
+
+/* Each byte read is either the expected one or 0. */
+static int truncate_mt_read(truncate_mt_data const * const data,
+                            int const fd,
+                            mt_fs_tests_prng * const prng,
+                            uint8_t * const buffer,
+                            uint8_t * const expected,
+                            truncate_mt_thread * const thread)
+{
+    int result = 0;
+    uint64_t const offset = mt_fs_tests_prng_bounded(prng, data->size - data->io_size + 1);
+    ssize_t got = 0;
+    mt_fs_tests_op op;
+
+    mt_fs_tests_op_begin(&op,
+                         "pread");
+
+    got = pread(fd,
+                buffer,
+                (size_t) data->io_size,
+                (off_t) offset);
+
+    if (got >= 0)
+    {
+        size_t mismatch = (size_t) got;
+
+        truncate_mt_fill(expected,
+                         offset,
+                         (size_t) got);
+
+        for (size_t idx = 0;
+             mismatch == (size_t) got &&
+                 idx < (size_t) got;
+             idx++)
+        {
+            if (buffer[idx] != expected[idx] &&
+                buffer[idx] != 0)
+            {
+                mismatch = idx;
+            }
+        }
+
+        if (mismatch != (size_t) got)
+        {
+            result = EIO;
+
+            /* Only the first one, the thread goes on counting others. */
+            if (thread->inconsistencies == 0)
+            {
+                LOG_ERROR("Error, expected %d or 0 at offset %llu of %s, got %d",
+                          expected[mismatch],
+                          (unsigned long long) (offset + mismatch),
+                          data->filename,
+                          buffer[mismatch]);
+            }
+
+            thread->inconsistencies++;
+        }
+        else
+        {
+            mt_fs_tests_op_add_bytes((uint64_t) got);
+        }
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error reading from %s at %llu: %d",
+                  data->filename,
+                  (unsigned long long) offset,
+                  result);
+    }
+
+    mt_fs_tests_op_end(&op,
+                       result);
+
+    return result;
+}
+
+static int truncate_mt_run(void * const test_suite_data,
+                           size_t const id)
+{
+    int result = 0;
+    truncate_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    truncate_mt_thread * const thread = &(data->shared->threads[id]);
+    uint64_t const nb_readers = data->nb_threads - data->nb_truncators;
+    bool const truncator = id < data->nb_truncators;
+    uint8_t * const buffer = malloc((size_t) (data->range > data->io_size ? data->range : data->io_size));
+    uint8_t * const expected = malloc((size_t) data->io_size);
+    int fd = open(data->filename,
+                  O_RDWR);
+
+    mt_fs_tests_phase_begin(&(thread->run));
+
+    if (fd != -1 &&
+        buffer != NULL &&
+        expected != NULL)
+    {
+        mt_fs_tests_prng prng;
+
+        mt_fs_tests_prng_thread_init(&prng, id);
+
+        if (truncator == true)
+        {
+            /* Without readers, there is no end to wait for. */
+            while (result == 0 &&
+                   (nb_readers > 0 ?
+                    __atomic_load_n(&(data->shared->readers_done), __ATOMIC_RELAXED) < nb_readers :
+                    thread->run.count < data->iterations))
+            {
+                result = truncate_mt_cycle(data,
+                                           fd,
+                                           &prng,
+                                           buffer);
+                mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                         result);
+                thread->run.count++;
+            }
+        }
+        else
+        {
+            for (uint64_t idx = 0;
+                 (result == 0 ||
+                  result == EIO) &&
+                     idx < data->iterations;
+                 idx++)
+            {
+                result = truncate_mt_read(data,
+                                          fd,
+                                          &prng,
+                                          buffer,
+                                          expected,
+                                          thread);
+                mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                         result);
+                thread->run.count++;
+            }
+        }
+    }
+    else if (fd == -1)
+    {
+        result = errno;
+        LOG_ERROR("Error opening %s: %d",
+                  data->filename,
+                  result);
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+    else
+    {
+        result = ENOMEM;
+        mt_fs_tests_outcomes_add(&(thread->outcomes),
+                                 result);
+    }
+
+    mt_fs_tests_phase_end(&(thread->run));
+
+    if (truncator == false)
+    {
+        /* Whatever happened, or truncators would never stop. */
+        __atomic_fetch_add(&(data->shared->readers_done), 1, __ATOMIC_RELAXED);
+    }
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+    }
+
+    free(expected);
+    free(buffer);
+
+    return 0;
+}
+
+/* Once truncators are done, every range they cut has been written back. */
+static int truncate_mt_verify_file(truncate_mt_data const * const data)
+{
+    int result = 0;
+    size_t const size = (size_t) data->range;
+    uint8_t * const buffer = malloc(size);
+    uint8_t * const expected = malloc(size);
+    int fd = open(data->filename,
+                  O_RDONLY);
+
+    if (fd != -1 &&
+        buffer != NULL &&
+        expected != NULL)
+    {
+        struct stat st;
+
+        if (fstat(fd, &st) == 0 &&
+            (uint64_t) st.st_size != data->size)
+        {
+            result = EIO;
+            LOG_ERROR("Error, expected a size of %llu, got %lld",
+                      (unsigned long long) data->size,
+                      (long long int) st.st_size);
+        }
+
+        for (uint64_t pos = 0;
+             result == 0 &&
+                 pos < data->size;
+             pos += size)
+        {
+            size_t const to_read = (size_t) (data->size - pos < size ? data->size - pos : size);
+            ssize_t const got = pread(fd,
+                                      buffer,
+                                      to_read,
+                                      (off_t) pos);
+
+            if (got == (ssize_t) to_read)
+            {
+                truncate_mt_fill(expected,
+                                 pos,
+                                 to_read);
+
+                if (memcmp(buffer, expected, to_read) != 0)
+                {
+                    result = EIO;
+                    LOG_ERROR("Error, unexpected content between %llu and %llu",
+                              (unsigned long long) pos,
+                              (unsigned long long) (pos + to_read));
+                }
+            }
+            else
+            {
+                result = got < 0 ? errno : EIO;
+                LOG_ERROR("Error reading from %llu: %d",
+                          (unsigned long long) pos,
+                          result);
+            }
+        }
+    }
+    else
+    {
+        result = fd == -1 ? errno : ENOMEM;
+    }
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+    }
+
+    free(expected);
+    free(buffer);
+
+    return result;
+}
+
+static int truncate_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    truncate_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t role = 0;
+         role < 2;
+         role++)
+    {
+        bool const truncators = role == 0;
+        mt_fs_tests_phase run;
+        uint64_t inconsistencies = 0;
+        double elapsed;
+
+        mt_fs_tests_phase_reset(&run);
+
+        for (size_t id = truncators == true ? 0 : (size_t) data->nb_truncators;
+             id < (truncators == true ? (size_t) data->nb_truncators : data->nb_threads);
+             id++)
+        {
+            truncate_mt_thread const * const thread = &(data->shared->threads[id]);
+
+            mt_fs_tests_phase_merge(&run,
+                                    &(thread->run));
+            inconsistencies += thread->inconsistencies;
+
+            mt_fs_tests_outcomes_merge(&outcomes,
+                                       &(thread->outcomes));
+        }
+
+        elapsed = mt_fs_tests_phase_elapsed(&run);
+
+        if (elapsed > 0.0)
+        {
+            if (truncators == true)
+            {
+                /* A cycle cuts and extends back, or punches once. */
+                bool const truncate_mode = data->mode == truncate_mt_mode_truncate;
+                char const * const op_name = truncate_mode == true ? "ftruncate" : "punch_hole";
+                uint64_t const ops_per_cycle = truncate_mode == true ? 2 : 1;
+
+                LOG_OK("%s: %llu cycles of %llu %s and a write back in %.3f s, %.1f %s/s",
+                       truncate_mt_modes_names[data->mode],
+                       (unsigned long long) run.count,
+                       (unsigned long long) ops_per_cycle,
+                       op_name,
+                       elapsed,
+                       (double) (run.count * ops_per_cycle) / elapsed,
+                       op_name);
+            }
+            else
+            {
+                LOG_OK("pread: %llu reads in %.3f s, %.1f reads/s, %llu inconsistent",
+                       (unsigned long long) run.count,
+                       elapsed,
+                       (double) run.count / elapsed,
+                       (unsigned long long) inconsistencies);
+            }
+        }
+    }
+
+    int const res = truncate_mt_verify_file(data);
+
+    if (res == 0)
+    {
+        LOG_OK("File content verified after the run.");
+    }
+    else
+    {
+        LOG_ERROR("Error verifying file content after the run: %d",
+                  res);
+        mt_fs_tests_outcomes_add(&outcomes,
+                                 res);
+    }
+
+    /* Inconsistent reads, and the file content after the run, are counted
+       as EIO. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_at_least, 1 }
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int truncate_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    truncate_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        if (data->filename != NULL)
+        {
+            unlink(data->filename);
+            free(data->filename), data->filename = NULL;
+        }
+
+        if (data->shared != NULL)
+        {
+            mt_fs_tests_shared_free(data->shared), data->shared = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_truncate_mt =
+{
+    "truncate_mt",
+    &truncate_mt_init,
+    &truncate_mt_run,
+    &truncate_mt_post_run,
+    &truncate_mt_deinit,
+    test_suite_type_mt
+};
@@ -0,0 +1,994 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#include "cold_cache.h"
+#include "distributions.h"
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+
+/* Executes a mix of operations described by a job file, given with
+   -o workload_mt.job=<path>, over a set of files created beforehand:
+
+     # Global settings
+     files = 1000
+     file_size = 1M
+     # Defaults of the groups below
+     io_size = 4k
+     ops = 10000
+
+     [readers]
+     share = 3
+     mix = read:80 stat:15 open:5
+
+     [writers]
+     share = 1
+     rate = 500
+     mix = write:60 fsync:10 create:10 rename:10 unlink:10
+
+   Threads are split between groups in proportion of their share. Each
+   thread does ops operations, drawn according to the weights of the mix of
+   its group, on files chosen according to the workload_mt.distribution
+   options (see distributions.h). A group rate, in operations per second for
+   all threads of the group, switches these threads to open-loop mode.
+   Without job file, a single group mixing all operations is used.
+
+   The mix of each group is compiled to a shuffled table of operations,
+   which threads go through from different offsets, so that picking the next
+   operation costs a memory read. */
+
+#define DIRECTORY_TEMPLATE "workload_suite_XXXXXX"
+#define FILE_NAME_FORMAT "%s/f%llu"
+#define LINE_MAX_SIZE (1024)
+#define GROUP_NAME_MAX_SIZE (64)
+#define MAX_GROUPS (16)
+#define OP_TABLE_SIZE (1024)
+#define DEFAULT_FILES (128)
+#define DEFAULT_FILE_SIZE (65536)
+#define DEFAULT_IO_SIZE (4096)
+#define DEFAULT_OPS (1000)
+#define DEFAULT_MIX "create:5 open:15 read:30 write:20 stat:15 rename:5 unlink:5 fsync:5"
+
+typedef enum
+{
+    workload_mt_op_create = 0,
+    workload_mt_op_open,
+    workload_mt_op_read,
+    workload_mt_op_write,
+    workload_mt_op_stat,
+    workload_mt_op_rename,
+    workload_mt_op_unlink,
+    workload_mt_op_fsync,
+    workload_mt_op_count
+} workload_mt_op_type;
+
+static char const * const workload_mt_op_names[] =
+{
+    "create",
+    "open",
+    "read",
+    "write",
+    "stat",
+    "rename",
+    "unlink",
+    "fsync",
+};
+
+typedef struct
+{
+    char name[GROUP_NAME_MAX_SIZE];
+    uint64_t weights[workload_mt_op_count];
+    uint64_t share;
+    uint64_t ops;
+    uint64_t io_size;
+    double rate;
+    size_t first_thread;
+    size_t nb_threads;
+    uint8_t table[OP_TABLE_SIZE];
+} workload_mt_group;
+
+typedef struct
+{
+    workload_mt_group groups[MAX_GROUPS];
+    mt_fs_tests_distribution distribution;
+    char * directory;
+    char ** paths;
+    /* One per thread. */
+    mt_fs_tests_outcomes * threads_outcomes;
+    size_t nb_groups;
+    size_t nb_threads;
+    uint64_t nb_files;
+    uint64_t file_size;
+} workload_mt_data;
+
+/* Files come and go with create, rename and unlink operations, any other
+   error stops the thread. */
+static mt_fs_tests_expectation const workload_mt_expectations[] =
+{
+    { 0, mt_fs_tests_expect_at_least, 1 },
+    { ENOENT, mt_fs_tests_expect_any, 0 },
+};
+
+static char * workload_mt_trim(char * str)
+{
+    char * end = NULL;
+
+    while (isspace((unsigned char) *str))
+    {
+        str++;
+    }
+
+    end = str + strlen(str);
+
+    while (end > str &&
+           isspace((unsigned char) end[-1]))
+    {
+        end--;
+    }
+
+    *end = '\0';
+
+    return str;
+}
+
+static int workload_mt_parse_mix(char * const str,
+                                 workload_mt_group * const group)
+{
+    int result = 0;
+    char * saveptr = NULL;
+    uint64_t total = 0;
+
+    memset(group->weights, 0, sizeof group->weights);
+
+    for (char * token = strtok_r(str, " \t,", &saveptr);
+         result == 0 &&
+             token != NULL;
+         token = strtok_r(NULL, " \t,", &saveptr))
+    {
+        char * const colon = strchr(token, ':');
+        uint64_t weight = 1;
+
+        if (colon != NULL)
+        {
+            *colon = '\0';
+            result = mt_fs_tests_parse_size(colon + 1,
+                                            &weight);
+        }
+
+        if (result == 0)
+        {
+            result = ENOENT;
+
+            for (size_t idx = 0;
+                 result == ENOENT &&
+                     idx < workload_mt_op_count;
+                 idx++)
+            {
+                if (strcasecmp(token, workload_mt_op_names[idx]) == 0)
+                {
+                    group->weights[idx] += weight;
+                    total += weight;
+                    result = 0;
+                }
+            }
+        }
+    }
+
+    if (result == 0 &&
+        total == 0)
+    {
+        result = EINVAL;
+    }
+
+    return result;
+}
+
+static int workload_mt_set(workload_mt_data * const data,
+                           workload_mt_group * const group,
+                           bool const global,
+                           char const * const key,
+                           char * const value)
+{
+    int result = 0;
+
+    if (global == true &&
+        strcasecmp(key, "files") == 0)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        &(data->nb_files));
+
+        if (result == 0 &&
+            data->nb_files == 0)
+        {
+            result = EINVAL;
+        }
+    }
+    else if (global == true &&
+             strcasecmp(key, "file_size") == 0)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        &(data->file_size));
+    }
+    else if (strcasecmp(key, "io_size") == 0)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        &(group->io_size));
+
+        if (result == 0 &&
+            group->io_size == 0)
+        {
+            result = EINVAL;
+        }
+    }
+    else if (strcasecmp(key, "ops") == 0)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        &(group->ops));
+    }
+    else if (strcasecmp(key, "share") == 0)
+    {
+        result = mt_fs_tests_parse_size(value,
+                                        &(group->share));
+    }
+    else if (strcasecmp(key, "rate") == 0)
+    {
+        char * end = NULL;
+        errno = 0;
+        group->rate = strtod(value, &end);
+
+        if (errno != 0 ||
+            end == value ||
+            *end != '\0' ||
+            group->rate < 0.0)
+        {
+            result = EINVAL;
+        }
+    }
+    else if (strcasecmp(key, "mix") == 0)
+    {
+        result = workload_mt_parse_mix(value,
+                                       group);
+    }
+    else
+    {
+        result = ENOENT;
+    }
+
+    return result;
+}
+
+static int workload_mt_parse_job(workload_mt_data * const data,
+                                 workload_mt_group * const defaults,
+                                 char const * const path)
+{
+    int result = 0;
+    FILE * fp = fopen(path, "r");
+
+    if (fp != NULL)
+    {
+        char line[LINE_MAX_SIZE];
+        size_t line_number = 0;
+        workload_mt_group * group = defaults;
+
+        while (result == 0 &&
+               fgets(line, sizeof line, fp) != NULL)
+        {
+            char * const comment = strchr(line, '#');
+            char * content = NULL;
+
+            line_number++;
+
+            if (comment != NULL)
+            {
+                *comment = '\0';
+            }
+
+            content = workload_mt_trim(line);
+
+            if (*content == '[')
+            {
+                char * const end = strchr(content, ']');
+
+                if (end != NULL &&
+                    end[1] == '\0' &&
+                    data->nb_groups < MAX_GROUPS)
+                {
+                    *end = '\0';
+                    group = &(data->groups[data->nb_groups]);
+                    data->nb_groups++;
+
+                    *group = *defaults;
+                    snprintf(group->name,
+                             sizeof group->name,
+                             "%s",
+                             workload_mt_trim(content + 1));
+                }
+                else
+                {
+                    result = EINVAL;
+                }
+            }
+            else if (*content != '\0')
+            {
+                char * const equal = strchr(content, '=');
+
+                if (equal != NULL)
+                {
+                    *equal = '\0';
+
+                    result = workload_mt_set(data,
+                                             group,
+                                             group == defaults,
+                                             workload_mt_trim(content),
+                                             workload_mt_trim(equal + 1));
+                }
+                else
+                {
+                    result = EINVAL;
+                }
+            }
+
+            if (result != 0)
+            {
+                LOG_ERROR("Error parsing %s at line %zu: %d",
+                          path,
+                          line_number,
+                          result);
+            }
+        }
+
+        fclose(fp), fp = NULL;
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error opening job file %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+/* Turns the weights of the mix into OP_TABLE_SIZE operations, each one
+   represented in proportion of its weight, then shuffles them. */
+static void workload_mt_compile_group(workload_mt_group * const group,
+                                      size_t const group_idx)
+{
+    uint64_t total = 0;
+    uint64_t counts[workload_mt_op_count];
+    uint64_t remainders[workload_mt_op_count];
+    uint64_t assigned = 0;
+    size_t pos = 0;
+    mt_fs_tests_prng prng;
+
+    for (size_t idx = 0;
+         idx < workload_mt_op_count;
+         idx++)
+    {
+        total += group->weights[idx];
+    }
+
+    assert(total > 0);
+
+    for (size_t idx = 0;
+         idx < workload_mt_op_count;
+         idx++)
+    {
+        counts[idx] = group->weights[idx] * OP_TABLE_SIZE / total;
+        remainders[idx] = group->weights[idx] * OP_TABLE_SIZE % total;
+        assigned += counts[idx];
+    }
+
+    /* Largest remainders get the entries left. */
+    while (assigned < OP_TABLE_SIZE)
+    {
+        size_t best = 0;
+
+        for (size_t idx = 1;
+             idx < workload_mt_op_count;
+             idx++)
+        {
+            if (remainders[idx] > remainders[best])
+            {
+                best = idx;
+            }
+        }
+
+        counts[best]++;
+        remainders[best] = 0;
+        assigned++;
+    }
+
+    for (size_t idx = 0;
+         idx < workload_mt_op_count;
+         idx++)
+    {
+        for (uint64_t count = 0;
+             count < counts[idx];
+             count++)
+        {
+            group->table[pos] = (uint8_t) idx;
+            pos++;
+        }
+    }
+
+    mt_fs_tests_prng_thread_init(&prng,
+                                 group_idx);
+
+    for (size_t idx = OP_TABLE_SIZE - 1;
+         idx > 0;
+         idx--)
+    {
+        size_t const other = (size_t) mt_fs_tests_prng_bounded(&prng,
+                                                               (uint64_t) idx + 1);
+        uint8_t const temp = group->table[idx];
+        group->table[idx] = group->table[other];
+        group->table[other] = temp;
+    }
+}
+
+static int workload_mt_load_job(workload_mt_data * const data)
+{
+    int result = 0;
+    workload_mt_group defaults =
+        {
+            .name = "default",
+            .share = 1,
+            .ops = DEFAULT_OPS,
+            .io_size = DEFAULT_IO_SIZE,
+        };
+    char const * const path = mt_fs_tests_option_get_string("workload_mt.job",
+                                                            NULL);
+    uint64_t total_share = 0;
+    uint64_t cumulated_share = 0;
+
+    data->nb_files = DEFAULT_FILES;
+    data->file_size = DEFAULT_FILE_SIZE;
+
+    {
+        char mix[] = DEFAULT_MIX;
+        result = workload_mt_parse_mix(mix,
+                                       &defaults);
+        assert(result == 0);
+    }
+
+    if (path != NULL)
+    {
+        result = workload_mt_parse_job(data,
+                                       &defaults,
+                                       path);
+    }
+
+    if (result == 0 &&
+        data->nb_groups == 0)
+    {
+        data->groups[0] = defaults;
+        data->nb_groups = 1;
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_groups;
+         idx++)
+    {
+        total_share += data->groups[idx].share;
+    }
+
+    if (result == 0 &&
+        total_share == 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("Error, no group has a share of threads");
+    }
+
+    for (size_t idx = 0;
+         result == 0 &&
+             idx < data->nb_groups;
+         idx++)
+    {
+        workload_mt_group * const group = &(data->groups[idx]);
+        size_t const first = (size_t) (cumulated_share * data->nb_threads / total_share);
+
+        cumulated_share += group->share;
+        group->first_thread = first;
+        group->nb_threads = (size_t) (cumulated_share * data->nb_threads / total_share) - first;
+
+        workload_mt_compile_group(group,
+                                  idx);
+
+        LOG_DEBUG("Group %s: %zu threads, %llu ops each of %llu bytes, %.1f ops/s",
+                  group->name,
+                  group->nb_threads,
+                  (unsigned long long) group->ops,
+                  (unsigned long long) group->io_size,
+                  group->rate);
+    }
+
+    return result;
+}
+
+static int workload_mt_create_files(workload_mt_data * const data)
+{
+    int result = 0;
+    size_t const buffer_size = data->file_size < DEFAULT_FILE_SIZE ? (size_t) data->file_size : DEFAULT_FILE_SIZE;
+    char * const buffer = malloc(buffer_size > 0 ? buffer_size : 1);
+
+    data->paths = calloc((size_t) data->nb_files, sizeof *(data->paths));
+
+    if (buffer != NULL &&
+        data->paths != NULL)
+    {
+        memset(buffer, 'W', buffer_size);
+
+        for (uint64_t idx = 0;
+             result == 0 &&
+                 idx < data->nb_files;
+             idx++)
+        {
+            int written = asprintf(&(data->paths[idx]),
+                                   FILE_NAME_FORMAT,
+                                   data->directory,
+                                   (unsigned long long) idx);
+
+            if (written > 0)
+            {
+                int fd = open(data->paths[idx],
+                              O_CREAT | O_EXCL | O_WRONLY,
+                              S_IRUSR | S_IWUSR);
+
+                if (fd != -1)
+                {
+                    for (uint64_t pos = 0;
+                         result == 0 &&
+                             pos < data->file_size;
+                         pos += buffer_size)
+                    {
+                        size_t const to_write = data->file_size - pos < buffer_size ? (size_t) (data->file_size - pos) : buffer_size;
+
+                        if (write(fd, buffer, to_write) != (ssize_t) to_write)
+                        {
+                            result = errno != 0 ? errno : EIO;
+                        }
+                    }
+
+                    close(fd), fd = -1;
+
+                    if (result == 0)
+                    {
+                        result = mt_fs_tests_cold_cache_track(data->paths[idx]);
+                    }
+                }
+                else
+                {
+                    result = errno;
+                }
+
+                if (result != 0)
+                {
+                    LOG_ERROR("Error creating %s: %d",
+                              data->paths[idx],
+                              result);
+                }
+            }
+            else
+            {
+                data->paths[idx] = NULL;
+                result = ENOMEM;
+            }
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+static void workload_mt_remove_files(workload_mt_data * const data)
+{
+    if (data->paths != NULL)
+    {
+        for (uint64_t idx = 0;
+             idx < data->nb_files;
+             idx++)
+        {
+            if (data->paths[idx] != NULL)
+            {
+                mt_fs_tests_cold_cache_untrack(data->paths[idx]);
+                /* Might have been renamed or removed during the run. */
+                unlink(data->paths[idx]);
+                free(data->paths[idx]), data->paths[idx] = NULL;
+            }
+        }
+
+        free(data->paths), data->paths = NULL;
+    }
+
+    if (data->directory != NULL)
+    {
+        rmdir(data->directory);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+static int workload_mt_init(void ** test_suite_data,
+                            size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    workload_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = workload_mt_load_job(data);
+
+        if (result == 0)
+        {
+            result = mt_fs_tests_distribution_from_options("workload_mt",
+                                                           data->nb_files,
+                                                           &(data->distribution));
+        }
+
+        if (result == 0)
+        {
+            data->threads_outcomes = mt_fs_tests_shared_calloc(nb_threads,
+                                                               sizeof *(data->threads_outcomes));
+
+            if (data->threads_outcomes == NULL)
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            data->directory = strdup(DIRECTORY_TEMPLATE);
+
+            if (data->directory != NULL)
+            {
+                if (mkdtemp(data->directory) != NULL)
+                {
+                    result = workload_mt_create_files(data);
+                }
+                else
+                {
+                    result = errno;
+                    LOG_ERROR("Error in mkdtemp: %d",
+                              result);
+                    free(data->directory), data->directory = NULL;
+                }
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            workload_mt_remove_files(data);
+
+            if (data->threads_outcomes != NULL)
+            {
+                mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int workload_mt_io(char const * const path,
+                          workload_mt_op_type const type,
+                          char * const buffer,
+                          size_t const io_size,
+                          off_t const offset)
+{
+    int result = 0;
+    int fd = open(path,
+                  type == workload_mt_op_read ? O_RDONLY : O_WRONLY);
+
+    if (fd != -1)
+    {
+        ssize_t res = 0;
+
+        switch(type)
+        {
+        case workload_mt_op_read:
+            res = pread(fd, buffer, io_size, offset);
+            break;
+        case workload_mt_op_write:
+            res = pwrite(fd, buffer, io_size, offset);
+            break;
+        case workload_mt_op_fsync:
+            res = fsync(fd);
+            break;
+        default:
+            assert(false);
+            break;
+        }
+
+        if (res == -1)
+        {
+            result = errno;
+        }
+        else
+        {
+            /* Nothing for fsync, which returns 0. */
+            mt_fs_tests_op_add_bytes((uint64_t) res);
+        }
+
+        close(fd), fd = -1;
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static int workload_mt_run_op(workload_mt_data const * const data,
+                              workload_mt_group const * const group,
+                              workload_mt_op_type const type,
+                              mt_fs_tests_sampler * const sampler,
+                              char * const buffer)
+{
+    int result = 0;
+    char const * const path = data->paths[mt_fs_tests_sampler_next(sampler)];
+
+    switch(type)
+    {
+    case workload_mt_op_create:
+    {
+        int const fd = open(path,
+                            O_CREAT | O_WRONLY,
+                            S_IRUSR | S_IWUSR);
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        else
+        {
+            result = errno;
+        }
+        break;
+    }
+    case workload_mt_op_open:
+    {
+        int const fd = open(path,
+                            O_RDONLY);
+
+        if (fd != -1)
+        {
+            close(fd);
+        }
+        else
+        {
+            result = errno;
+        }
+        break;
+    }
+    case workload_mt_op_read:
+    case workload_mt_op_write:
+    case workload_mt_op_fsync:
+    {
+        uint64_t const nb_blocks = data->file_size > group->io_size ? data->file_size / group->io_size : 1;
+        off_t const offset = (off_t) (mt_fs_tests_prng_bounded(&(sampler->prng), nb_blocks) * group->io_size);
+
+        result = workload_mt_io(path,
+                                type,
+                                buffer,
+                                (size_t) group->io_size,
+                                offset);
+        break;
+    }
+    case workload_mt_op_stat:
+    {
+        struct stat st;
+
+        if (stat(path, &st) != 0)
+        {
+            result = errno;
+        }
+        break;
+    }
+    case workload_mt_op_rename:
+        if (rename(path,
+                   data->paths[mt_fs_tests_sampler_next(sampler)]) != 0)
+        {
+            result = errno;
+        }
+        break;
+    case workload_mt_op_unlink:
+        if (unlink(path) != 0)
+        {
+            result = errno;
+        }
+        break;
+    default:
+        assert(false);
+        result = EINVAL;
+        break;
+    }
+
+    return result;
+}
+
+static int workload_mt_run(void * test_suite_data,
+                           size_t id)
+{
+    int result = 0;
+    workload_mt_data * data = test_suite_data;
+    workload_mt_group const * group = NULL;
+    char * buffer = NULL;
+
+    assert(data != NULL);
+
+    for (size_t idx = 0;
+         group == NULL &&
+             idx < data->nb_groups;
+         idx++)
+    {
+        if (id >= data->groups[idx].first_thread &&
+            id < data->groups[idx].first_thread + data->groups[idx].nb_threads)
+        {
+            group = &(data->groups[idx]);
+        }
+    }
+
+    assert(group != NULL);
+
+    buffer = malloc((size_t) group->io_size);
+
+    if (buffer != NULL)
+    {
+        mt_fs_tests_sampler sampler;
+        /* Threads of a group go through its table from different offsets. */
+        size_t const start = (id - group->first_thread) * OP_TABLE_SIZE / group->nb_threads;
+
+        memset(buffer, 'w', (size_t) group->io_size);
+
+        mt_fs_tests_sampler_init(&sampler,
+                                 &(data->distribution),
+                                 id,
+                                 data->nb_threads);
+
+        if (group->rate > 0.0)
+        {
+            mt_fs_tests_op_set_thread_rate(group->rate / (double) group->nb_threads);
+        }
+
+        for (uint64_t idx = 0;
+             result == 0 &&
+                 idx < group->ops;
+             idx++)
+        {
+            workload_mt_op_type const type = (workload_mt_op_type) group->table[(start + idx) % OP_TABLE_SIZE];
+            mt_fs_tests_op op;
+            int res = 0;
+
+            mt_fs_tests_op_begin(&op,
+                                 workload_mt_op_names[type]);
+
+            res = workload_mt_run_op(data,
+                                     group,
+                                     type,
+                                     &sampler,
+                                     buffer);
+
+            mt_fs_tests_op_end(&op,
+                               res);
+            mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                     res);
+
+            /* Files come and go with create, rename and unlink operations. */
+            if (res != 0 &&
+                res != ENOENT)
+            {
+                result = res;
+                LOG_ERROR("Error in %s operation of thread %zu: %d",
+                          workload_mt_op_names[type],
+                          id,
+                          result);
+            }
+        }
+
+        free(buffer), buffer = NULL;
+    }
+    else
+    {
+        result = ENOMEM;
+        mt_fs_tests_outcomes_add(&(data->threads_outcomes[id]),
+                                 result);
+    }
+
+    return 0;
+}
+
+static int workload_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    workload_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t idx = 0;
+         idx < data->nb_threads;
+         idx++)
+    {
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->threads_outcomes[idx]));
+    }
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               workload_mt_expectations,
+                               sizeof workload_mt_expectations / sizeof *workload_mt_expectations);
+
+    return result;
+}
+
+static int workload_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    workload_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        workload_mt_remove_files(data);
+
+        if (data->threads_outcomes != NULL)
+        {
+            mt_fs_tests_shared_free(data->threads_outcomes), data->threads_outcomes = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_workload_mt =
+{
+    "workload_mt",
+    &workload_mt_init,
+    &workload_mt_run,
+    &workload_mt_post_run,
+    &workload_mt_deinit,
+    test_suite_type_mt
+};
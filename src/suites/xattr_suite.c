@@ -0,0 +1,837 @@
+#define _GNU_SOURCE
+
+#include <assert.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/xattr.h>
+#include <unistd.h>
+
+#include "ops.h"
+#include "options.h"
+#include "outcomes.h"
+#include "prng.h"
+#include "shared_memory.h"
+#include "test_suites.h"
+#include "utils.h"
+#include "verify.h"
+
+/* Extended attributes under concurrency: threads run a mix of getxattr
+   (40%), setxattr (30%), listxattr (20%) and removexattr (10%) on user.*
+   attributes of a file shared by all threads, or of a file of their own.
+   Values carry a header with their writer, sequence number and CRC32C, so
+   that torn or misdirected values are noticed when read. After the run, the
+   attributes of the files of the threads must hold the last value their
+   owner set, and those of the shared file a valid value, if any.
+
+   Options:
+   - xattr_mt.iterations: operations per thread (default 10000);
+   - xattr_mt.attributes: attributes per file (default 4);
+   - xattr_mt.shared: percentage of operations on the shared file (default
+     50);
+   - xattr_mt.min_value_size and xattr_mt.max_value_size: bounds of the size
+     of values, with an optional k, m or g suffix (default 32 and 512).
+     Values larger than the space left in the inode, about 100 bytes with
+     ext4 256-byte inodes, are stored in a separate block. */
+
+#define DIRECTORY_TEMPLATE "xattr_suite_XXXXXX"
+#define SHARED_FILE_FORMAT "%s/shared"
+#define THREAD_FILE_FORMAT "%s/t%zu"
+#define ATTRIBUTE_NAME_FORMAT "user.xattr_mt.%zu"
+#define PATH_SIZE (256)
+#define NAME_SIZE (64)
+#define DEFAULT_ITERATIONS (10000)
+#define DEFAULT_ATTRIBUTES (4)
+#define DEFAULT_SHARED_PERCENT (50)
+#define DEFAULT_MIN_VALUE_SIZE (32)
+#define DEFAULT_MAX_VALUE_SIZE (512)
+/* XATTR_SIZE_MAX and XATTR_LIST_MAX of Linux. */
+#define VALUE_SIZE_MAX (65536)
+#define LIST_SIZE_MAX (65536)
+/* Last sequence number of an attribute removed by its owner. */
+#define REMOVED (UINT64_MAX)
+
+typedef struct
+{
+    uint32_t crc;
+    uint32_t size;
+    uint64_t writer;
+    uint64_t seq;
+    uint64_t attribute;
+} xattr_mt_header;
+
+typedef struct {
+    char * directory;
+    char * shared_path;
+    /* Results of the threads, one per thread. */
+    mt_fs_tests_outcomes * outcomes;
+    /* Sequence number of the last value each thread set on each attribute
+       of its own file, nb_threads * nb_attributes. */
+    uint64_t * last_seqs;
+    size_t nb_threads;
+    uint64_t iterations;
+    uint64_t nb_attributes;
+    uint64_t shared_percent;
+    uint64_t min_value_size;
+    uint64_t max_value_size;
+} xattr_mt_data;
+
+static int xattr_mt_get_options(xattr_mt_data * const data)
+{
+    int result = mt_fs_tests_option_get_uint64("xattr_mt.iterations",
+                                               DEFAULT_ITERATIONS,
+                                               &(data->iterations));
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("xattr_mt.attributes",
+                                               DEFAULT_ATTRIBUTES,
+                                               &(data->nb_attributes));
+
+        if (result == 0 &&
+            (data->nb_attributes == 0 ||
+             data->nb_attributes > 1000))
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid xattr_mt.attributes, expected 1 to 1000, got %llu",
+                      (unsigned long long) data->nb_attributes);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_uint64("xattr_mt.shared",
+                                               DEFAULT_SHARED_PERCENT,
+                                               &(data->shared_percent));
+
+        if (result == 0 &&
+            data->shared_percent > 100)
+        {
+            result = EINVAL;
+            LOG_ERROR("Invalid xattr_mt.shared, expected a percentage, got %llu",
+                      (unsigned long long) data->shared_percent);
+        }
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("xattr_mt.min_value_size",
+                                             DEFAULT_MIN_VALUE_SIZE,
+                                             &(data->min_value_size));
+    }
+
+    if (result == 0)
+    {
+        result = mt_fs_tests_option_get_size("xattr_mt.max_value_size",
+                                             DEFAULT_MAX_VALUE_SIZE,
+                                             &(data->max_value_size));
+    }
+
+    if (result == 0 &&
+        (data->min_value_size < sizeof (xattr_mt_header) ||
+         data->min_value_size > data->max_value_size ||
+         data->max_value_size > VALUE_SIZE_MAX))
+    {
+        result = EINVAL;
+        LOG_ERROR("Invalid value sizes, expected %zu <= min_value_size <= max_value_size <= %d, got %llu and %llu",
+                  sizeof (xattr_mt_header),
+                  VALUE_SIZE_MAX,
+                  (unsigned long long) data->min_value_size,
+                  (unsigned long long) data->max_value_size);
+    }
+
+    return result;
+}
+
+static void xattr_mt_fill_value(uint8_t * const value,
+                                size_t const size,
+                                uint64_t const writer,
+                                uint64_t const seq,
+                                uint64_t const attribute)
+{
+    xattr_mt_header header =
+        {
+            .size = (uint32_t) size,
+            .writer = writer,
+            .seq = seq,
+            .attribute = attribute
+        };
+    assert(size >= sizeof header);
+
+    memset(value + sizeof header, (uint8_t) seq, size - sizeof header);
+    memcpy(value, &header, sizeof header);
+    header.crc = mt_fs_tests_crc32c(0,
+                                    value + sizeof header.crc,
+                                    size - sizeof header.crc);
+    memcpy(value, &header.crc, sizeof header.crc);
+}
+
+/* Whether the value is intact and belongs to the attribute, the header of
+   the value being returned in that case. */
+static bool xattr_mt_check_value(uint8_t const * const value,
+                                 size_t const size,
+                                 uint64_t const attribute,
+                                 xattr_mt_header * const header)
+{
+    bool result = false;
+
+    if (size >= sizeof *header)
+    {
+        memcpy(header, value, sizeof *header);
+
+        result = header->size == size &&
+            header->attribute == attribute &&
+            header->crc == mt_fs_tests_crc32c(0,
+                                              value + sizeof header->crc,
+                                              size - sizeof header->crc);
+    }
+
+    return result;
+}
+
+static int xattr_mt_get(char const * const path,
+                        char const * const name,
+                        uint64_t const attribute,
+                        uint8_t * const buffer,
+                        size_t const buffer_size,
+                        xattr_mt_header * const header)
+{
+    int result = 0;
+    ssize_t const got = getxattr(path,
+                                 name,
+                                 buffer,
+                                 buffer_size);
+
+    if (got >= 0)
+    {
+        if (xattr_mt_check_value(buffer,
+                                 (size_t) got,
+                                 attribute,
+                                 header) == false)
+        {
+            result = EIO;
+            LOG_ERROR("Error, corrupted value of %zd bytes for %s of %s",
+                      got,
+                      name,
+                      path);
+        }
+    }
+    else
+    {
+        result = errno;
+
+        if (result != ENODATA)
+        {
+            LOG_ERROR("Error getting %s of %s: %d",
+                      name,
+                      path,
+                      result);
+        }
+    }
+
+    return result;
+}
+
+static int xattr_mt_set(char const * const path,
+                        char const * const name,
+                        uint8_t const * const value,
+                        size_t const size)
+{
+    int result = 0;
+
+    if (setxattr(path,
+                 name,
+                 value,
+                 size,
+                 0) != 0)
+    {
+        result = errno;
+        LOG_ERROR("Error setting %s of %s to %zu bytes: %d",
+                  name,
+                  path,
+                  size,
+                  result);
+    }
+
+    return result;
+}
+
+static void xattr_mt_remove_files(xattr_mt_data * const data)
+{
+    if (data->directory != NULL)
+    {
+        char path[PATH_SIZE];
+
+        for (size_t id = 0;
+             id < data->nb_threads;
+             id++)
+        {
+            snprintf(path,
+                     sizeof path,
+                     THREAD_FILE_FORMAT,
+                     data->directory,
+                     id);
+            unlink(path);
+        }
+
+        if (data->shared_path != NULL)
+        {
+            unlink(data->shared_path);
+            free(data->shared_path), data->shared_path = NULL;
+        }
+
+        rmdir(data->directory);
+        free(data->directory), data->directory = NULL;
+    }
+}
+
+/* Files start with all their attributes set, by thread 0 for the shared
+   one. */
+static int xattr_mt_create_file(xattr_mt_data const * const data,
+                                char const * const path,
+                                uint64_t const writer,
+                                uint8_t * const buffer)
+{
+    int result = 0;
+    int fd = open(path,
+                  O_CREAT | O_EXCL | O_WRONLY,
+                  S_IRUSR | S_IWUSR);
+
+    if (fd != -1)
+    {
+        close(fd), fd = -1;
+
+        for (uint64_t attribute = 0;
+             result == 0 &&
+                 attribute < data->nb_attributes;
+             attribute++)
+        {
+            char name[NAME_SIZE];
+
+            snprintf(name,
+                     sizeof name,
+                     ATTRIBUTE_NAME_FORMAT,
+                     (size_t) attribute);
+
+            xattr_mt_fill_value(buffer,
+                                (size_t) data->min_value_size,
+                                writer,
+                                0,
+                                attribute);
+
+            result = xattr_mt_set(path,
+                                  name,
+                                  buffer,
+                                  (size_t) data->min_value_size);
+
+            if (result == ENOTSUP)
+            {
+                LOG_ERROR("User extended attributes are not supported here");
+            }
+        }
+    }
+    else
+    {
+        result = errno;
+        LOG_ERROR("Error creating %s: %d",
+                  path,
+                  result);
+    }
+
+    return result;
+}
+
+static int xattr_mt_create_files(xattr_mt_data * const data)
+{
+    int result = 0;
+    uint8_t * const buffer = malloc((size_t) data->min_value_size);
+
+    data->directory = strdup(DIRECTORY_TEMPLATE);
+
+    if (buffer != NULL &&
+        data->directory != NULL)
+    {
+        if (mkdtemp(data->directory) != NULL)
+        {
+            char path[PATH_SIZE];
+
+            snprintf(path,
+                     sizeof path,
+                     SHARED_FILE_FORMAT,
+                     data->directory);
+
+            data->shared_path = strdup(path);
+
+            if (data->shared_path != NULL)
+            {
+                result = xattr_mt_create_file(data,
+                                              data->shared_path,
+                                              0,
+                                              buffer);
+            }
+            else
+            {
+                result = ENOMEM;
+            }
+
+            for (size_t id = 0;
+                 result == 0 &&
+                     id < data->nb_threads;
+                 id++)
+            {
+                snprintf(path,
+                         sizeof path,
+                         THREAD_FILE_FORMAT,
+                         data->directory,
+                         id);
+
+                result = xattr_mt_create_file(data,
+                                              path,
+                                              id,
+                                              buffer);
+            }
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error in mkdtemp: %d",
+                      result);
+            free(data->directory), data->directory = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    free(buffer);
+
+    return result;
+}
+
+static int xattr_mt_init(void ** test_suite_data,
+                         size_t const nb_threads)
+{
+    int result = 0;
+    assert(test_suite_data != NULL);
+    xattr_mt_data * data = calloc(1, sizeof *data);
+
+    if (data != NULL)
+    {
+        data->nb_threads = nb_threads;
+
+        result = xattr_mt_get_options(data);
+
+        if (result == 0)
+        {
+            data->outcomes = mt_fs_tests_shared_calloc(nb_threads,
+                                                       sizeof *(data->outcomes));
+            data->last_seqs = mt_fs_tests_shared_calloc(nb_threads * data->nb_attributes,
+                                                        sizeof *(data->last_seqs));
+
+            if (data->outcomes == NULL ||
+                data->last_seqs == NULL)
+            {
+                result = ENOMEM;
+            }
+        }
+
+        if (result == 0)
+        {
+            result = xattr_mt_create_files(data);
+        }
+
+        if (result == 0)
+        {
+            *test_suite_data = data;
+        }
+        else
+        {
+            xattr_mt_remove_files(data);
+
+            if (data->outcomes != NULL)
+            {
+                mt_fs_tests_shared_free(data->outcomes), data->outcomes = NULL;
+            }
+
+            if (data->last_seqs != NULL)
+            {
+                mt_fs_tests_shared_free(data->last_seqs), data->last_seqs = NULL;
+            }
+
+            free(data), data = NULL;
+        }
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    return result;
+}
+
+static int xattr_mt_run(void * const test_suite_data,
+                        size_t const id)
+{
+    int result = 0;
+    xattr_mt_data * data = test_suite_data;
+    assert(data != NULL);
+    assert(id < data->nb_threads);
+    mt_fs_tests_outcomes * const outcomes = &(data->outcomes[id]);
+    uint64_t * const last_seqs = &(data->last_seqs[id * data->nb_attributes]);
+    uint8_t * const buffer = malloc((size_t) data->max_value_size);
+    char * const list = malloc(LIST_SIZE_MAX);
+    char own_path[PATH_SIZE];
+
+    snprintf(own_path,
+             sizeof own_path,
+             THREAD_FILE_FORMAT,
+             data->directory,
+             id);
+
+    if (buffer != NULL &&
+        list != NULL)
+    {
+        mt_fs_tests_prng prng;
+
+        mt_fs_tests_prng_thread_init(&prng, id);
+
+        /* Sequence number 0 is the one of the values set by init. */
+        for (uint64_t seq = 1;
+             result == 0 &&
+                 seq <= data->iterations;
+             seq++)
+        {
+            uint64_t const kind = mt_fs_tests_prng_bounded(&prng, 100);
+            bool const shared = mt_fs_tests_prng_bounded(&prng, 100) < data->shared_percent;
+            uint64_t const attribute = mt_fs_tests_prng_bounded(&prng, data->nb_attributes);
+            char const * const path = shared == true ? data->shared_path : own_path;
+            int outcome = 0;
+            char name[NAME_SIZE];
+            mt_fs_tests_op op;
+
+            snprintf(name,
+                     sizeof name,
+                     ATTRIBUTE_NAME_FORMAT,
+                     (size_t) attribute);
+
+            if (kind < 40)
+            {
+                xattr_mt_header header = { 0 };
+
+                mt_fs_tests_op_begin(&op,
+                                     "getxattr");
+
+                outcome = xattr_mt_get(path,
+                                       name,
+                                       attribute,
+                                       buffer,
+                                       (size_t) data->max_value_size,
+                                       &header);
+
+                if (outcome == 0)
+                {
+                    mt_fs_tests_op_add_bytes(header.size);
+                }
+            }
+            else if (kind < 70)
+            {
+                size_t const size = (size_t) (data->min_value_size +
+                                              mt_fs_tests_prng_bounded(&prng,
+                                                                       data->max_value_size - data->min_value_size + 1));
+
+                xattr_mt_fill_value(buffer,
+                                    size,
+                                    id,
+                                    seq,
+                                    attribute);
+
+                mt_fs_tests_op_begin(&op,
+                                     "setxattr");
+
+                outcome = xattr_mt_set(path,
+                                       name,
+                                       buffer,
+                                       size);
+
+                if (outcome == 0)
+                {
+                    mt_fs_tests_op_add_bytes(size);
+
+                    if (shared == false)
+                    {
+                        last_seqs[attribute] = seq;
+                    }
+                }
+            }
+            else if (kind < 90)
+            {
+                mt_fs_tests_op_begin(&op,
+                                     "listxattr");
+
+                ssize_t const got = listxattr(path,
+                                              list,
+                                              LIST_SIZE_MAX);
+
+                if (got < 0)
+                {
+                    outcome = errno;
+                    LOG_ERROR("Error listing attributes of %s: %d",
+                              path,
+                              outcome);
+                }
+            }
+            else
+            {
+                mt_fs_tests_op_begin(&op,
+                                     "removexattr");
+
+                if (removexattr(path,
+                                name) != 0)
+                {
+                    outcome = errno;
+
+                    if (outcome != ENODATA)
+                    {
+                        LOG_ERROR("Error removing %s of %s: %d",
+                                  name,
+                                  path,
+                                  outcome);
+                    }
+                }
+
+                if (shared == false &&
+                    (outcome == 0 ||
+                     outcome == ENODATA))
+                {
+                    last_seqs[attribute] = REMOVED;
+                }
+            }
+
+            mt_fs_tests_op_end(&op,
+                               outcome);
+
+            mt_fs_tests_outcomes_add(outcomes,
+                                     outcome);
+
+            /* Attributes come and go, ENODATA does not stop the thread. */
+            if (outcome != ENODATA)
+            {
+                result = outcome;
+            }
+        }
+    }
+    else
+    {
+        mt_fs_tests_outcomes_add(outcomes,
+                                 ENOMEM);
+    }
+
+    free(list);
+    free(buffer);
+
+    return 0;
+}
+
+/* Attributes of the files of the threads hold the last value set by their
+   owner, or none if it removed them last, and those of the shared file
+   hold a valid value, if any. */
+static int xattr_mt_verify_file(xattr_mt_data const * const data,
+                                char const * const path,
+                                uint64_t const * const last_seqs,
+                                size_t const owner,
+                                uint8_t * const buffer)
+{
+    int result = 0;
+
+    for (uint64_t attribute = 0;
+         result == 0 &&
+             attribute < data->nb_attributes;
+         attribute++)
+    {
+        xattr_mt_header header = { 0 };
+        char name[NAME_SIZE];
+        int res = 0;
+
+        snprintf(name,
+                 sizeof name,
+                 ATTRIBUTE_NAME_FORMAT,
+                 (size_t) attribute);
+
+        res = xattr_mt_get(path,
+                           name,
+                           attribute,
+                           buffer,
+                           (size_t) data->max_value_size,
+                           &header);
+
+        if (last_seqs == NULL)
+        {
+            if (res == 0 &&
+                header.writer >= data->nb_threads)
+            {
+                result = EIO;
+                LOG_ERROR("Error, %s of %s written by unknown thread %llu",
+                          name,
+                          path,
+                          (unsigned long long) header.writer);
+            }
+            else if (res != 0 &&
+                     res != ENODATA)
+            {
+                result = res;
+            }
+        }
+        else if (last_seqs[attribute] == REMOVED)
+        {
+            if (res != ENODATA)
+            {
+                result = res != 0 ? res : EIO;
+                LOG_ERROR("Error, %s of %s was removed, got %d",
+                          name,
+                          path,
+                          res);
+            }
+        }
+        else if (res != 0)
+        {
+            result = res;
+            LOG_ERROR("Error, %s of %s was set to value %llu, got %d",
+                      name,
+                      path,
+                      (unsigned long long) last_seqs[attribute],
+                      res);
+        }
+        else if (header.writer != owner ||
+                 header.seq != last_seqs[attribute])
+        {
+            result = EIO;
+            LOG_ERROR("Error, %s of %s was set to value %llu by thread %zu, got value %llu by thread %llu",
+                      name,
+                      path,
+                      (unsigned long long) last_seqs[attribute],
+                      owner,
+                      (unsigned long long) header.seq,
+                      (unsigned long long) header.writer);
+        }
+    }
+
+    return result;
+}
+
+static int xattr_mt_post_run(void * test_suite_data)
+{
+    int result = 0;
+    xattr_mt_data * data = test_suite_data;
+    mt_fs_tests_outcomes outcomes;
+    assert(data != NULL);
+    uint8_t * const buffer = malloc((size_t) data->max_value_size);
+
+    if (buffer != NULL)
+    {
+        char path[PATH_SIZE];
+        int res = xattr_mt_verify_file(data,
+                                       data->shared_path,
+                                       NULL,
+                                       0,
+                                       buffer);
+
+        for (size_t id = 0;
+             res == 0 &&
+                 id < data->nb_threads;
+             id++)
+        {
+            snprintf(path,
+                     sizeof path,
+                     THREAD_FILE_FORMAT,
+                     data->directory,
+                     id);
+
+            res = xattr_mt_verify_file(data,
+                                       path,
+                                       &(data->last_seqs[id * data->nb_attributes]),
+                                       id,
+                                       buffer);
+        }
+
+        if (res == 0)
+        {
+            LOG_OK("Attribute values verified after the run.");
+        }
+        else
+        {
+            LOG_ERROR("Error verifying attribute values after the run: %d",
+                      res);
+        }
+
+        free(buffer);
+    }
+    else
+    {
+        LOG_ERROR("Error allocating memory to verify attribute values");
+    }
+
+    mt_fs_tests_outcomes_reset(&outcomes);
+
+    for (size_t id = 0;
+         id < data->nb_threads;
+         id++)
+    {
+        mt_fs_tests_outcomes_merge(&outcomes,
+                                   &(data->outcomes[id]));
+    }
+
+    /* Getting or removing an attribute another thread just removed fails
+       with ENODATA, nothing else should. */
+    mt_fs_tests_expectation const expectations[] =
+        {
+            { 0, mt_fs_tests_expect_at_least, 1 },
+            { ENODATA, mt_fs_tests_expect_any, 0 },
+        };
+
+    mt_fs_tests_outcomes_check(&outcomes,
+                               expectations,
+                               sizeof expectations / sizeof *expectations);
+
+    return result;
+}
+
+static int xattr_mt_deinit(void * test_suite_data)
+{
+    int result = 0;
+    xattr_mt_data * data = test_suite_data;
+
+    if (data != NULL)
+    {
+        xattr_mt_remove_files(data);
+
+        if (data->outcomes != NULL)
+        {
+            mt_fs_tests_shared_free(data->outcomes), data->outcomes = NULL;
+        }
+
+        if (data->last_seqs != NULL)
+        {
+            mt_fs_tests_shared_free(data->last_seqs), data->last_seqs = NULL;
+        }
+
+        free(data);
+    }
+
+    return result;
+}
+
+test_suite const test_suite_xattr_mt =
+{
+    "xattr_mt",
+    &xattr_mt_init,
+    &xattr_mt_run,
+    &xattr_mt_post_run,
+    &xattr_mt_deinit,
+    test_suite_type_mt
+};
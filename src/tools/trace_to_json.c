@@ -0,0 +1,372 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+#include "utils.h"
+
+/* Converts a binary trace written by mt-fs-tests --trace to the Chrome
+   trace event JSON format, which can be loaded in chrome://tracing or
+   https://ui.perfetto.dev. Each suite run is shown as a process, each
+   thread of the run as a thread of this process. */
+
+static int read_exact(FILE * const fp,
+                      void * const buffer,
+                      size_t const size)
+{
+    int result = 0;
+
+    if (size > 0 &&
+        fread(buffer, size, 1, fp) != 1)
+    {
+        result = feof(fp) ? ENODATA : EIO;
+    }
+
+    return result;
+}
+
+static int read_string(FILE * const fp,
+                       char ** const out)
+{
+    uint32_t len = 0;
+    int result = read_exact(fp, &len, sizeof len);
+
+    if (result == 0)
+    {
+        char * str = malloc((size_t) len + 1);
+
+        if (str != NULL)
+        {
+            result = read_exact(fp, str, len);
+
+            if (result == 0)
+            {
+                str[len] = '\0';
+                *out = str;
+            }
+            else
+            {
+                free(str), str = NULL;
+            }
+        }
+        else
+        {
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+static void print_json_string(FILE * const out,
+                              char const * const str)
+{
+    fputc('"', out);
+
+    for (char const * ptr = str;
+         *ptr != '\0';
+         ptr++)
+    {
+        if (*ptr == '"' ||
+            *ptr == '\\')
+        {
+            fputc('\\', out);
+            fputc(*ptr, out);
+        }
+        else if ((unsigned char) *ptr < 0x20)
+        {
+            fprintf(out, "\\u%04x", (unsigned int) (unsigned char) *ptr);
+        }
+        else
+        {
+            fputc(*ptr, out);
+        }
+    }
+
+    fputc('"', out);
+}
+
+/* Without out, only lowers base_ns to the earliest event of the section,
+   threads being written one after the other rather than in time order. */
+static int convert_section(FILE * const fp,
+                           FILE * const out,
+                           uint32_t const pid,
+                           bool * const first_output,
+                           uint64_t * const base_ns)
+{
+    char * suite_name = NULL;
+    char ** names = NULL;
+    uint32_t run_idx = 0;
+    uint32_t nb_threads = 0;
+    uint32_t nb_names = 0;
+    uint64_t nb_events = 0;
+    int result = read_string(fp, &suite_name);
+
+    if (result == 0)
+    {
+        result = read_exact(fp, &run_idx, sizeof run_idx);
+
+        if (result == 0)
+        {
+            result = read_exact(fp, &nb_threads, sizeof nb_threads);
+        }
+
+        if (result == 0)
+        {
+            result = read_exact(fp, &nb_names, sizeof nb_names);
+        }
+
+        if (result == 0)
+        {
+            names = calloc(nb_names > 0 ? nb_names : 1, sizeof *names);
+
+            if (names == NULL)
+            {
+                result = ENOMEM;
+            }
+        }
+
+        for (uint32_t idx = 0;
+             result == 0 &&
+                 idx < nb_names;
+             idx++)
+        {
+            result = read_string(fp, &(names[idx]));
+        }
+
+        if (result == 0)
+        {
+            result = read_exact(fp, &nb_events, sizeof nb_events);
+        }
+
+        if (result == 0 &&
+            out != NULL)
+        {
+            fprintf(out,
+                    "%s\n{\"ph\":\"M\",\"name\":\"process_name\",\"pid\":%" PRIu32 ",\"args\":{\"name\":",
+                    *first_output ? "" : ",",
+                    pid);
+            print_json_string(out, suite_name);
+            fprintf(out, "}}");
+            fprintf(out,
+                    ",\n{\"ph\":\"M\",\"name\":\"process_labels\",\"pid\":%" PRIu32 ",\"args\":{\"labels\":\"run %" PRIu32 ", %" PRIu32 " threads\"}}",
+                    pid,
+                    run_idx,
+                    nb_threads);
+            *first_output = false;
+        }
+
+        for (uint64_t idx = 0;
+             result == 0 &&
+                 idx < nb_events;
+             idx++)
+        {
+            mt_fs_tests_trace_file_event event;
+
+            result = read_exact(fp, &event, sizeof event);
+
+            if (result == 0)
+            {
+                if (event.name_idx >= nb_names)
+                {
+                    result = EINVAL;
+                    break;
+                }
+
+                if (out == NULL)
+                {
+                    *base_ns = event.timestamp_ns < *base_ns ? event.timestamp_ns : *base_ns;
+                    continue;
+                }
+
+                fprintf(out,
+                        ",\n{\"ph\":\"%s\",\"pid\":%" PRIu32 ",\"tid\":%" PRIu32 ",\"ts\":%.3f,\"name\":",
+                        event.phase == mt_fs_tests_trace_phase_begin ? "B" : "E",
+                        pid,
+                        event.thread,
+                        ((double) event.timestamp_ns - (double) *base_ns) / 1000.0);
+                print_json_string(out, names[event.name_idx]);
+
+                if (event.phase == mt_fs_tests_trace_phase_end)
+                {
+                    fprintf(out,
+                            ",\"args\":{\"result\":%" PRId32 "}",
+                            event.result);
+                }
+
+                fputc('}', out);
+            }
+        }
+
+        if (names != NULL)
+        {
+            for (uint32_t idx = 0;
+                 idx < nb_names;
+                 idx++)
+            {
+                free(names[idx]), names[idx] = NULL;
+            }
+
+            free(names), names = NULL;
+        }
+
+        free(suite_name), suite_name = NULL;
+    }
+
+    return result;
+}
+
+static int convert_sections(FILE * const fp,
+                            FILE * const out,
+                            bool * const first_output,
+                            uint64_t * const base_ns)
+{
+    int result = 0;
+
+    for (uint32_t pid = 1;
+         result == 0;
+         pid++)
+    {
+        int const next = fgetc(fp);
+
+        if (next == EOF)
+        {
+            break;
+        }
+
+        ungetc(next, fp);
+
+        result = convert_section(fp,
+                                 out,
+                                 pid,
+                                 first_output,
+                                 base_ns);
+    }
+
+    return result;
+}
+
+static int convert(FILE * const fp,
+                   FILE * const out)
+{
+    char magic[sizeof MT_FS_TESTS_TRACE_MAGIC];
+    uint32_t version = 0;
+    int result = read_exact(fp, magic, sizeof magic);
+
+    if (result == 0 &&
+        memcmp(magic, MT_FS_TESTS_TRACE_MAGIC, sizeof magic) == 0)
+    {
+        result = read_exact(fp, &version, sizeof version);
+
+        if (result == 0 &&
+            version == MT_FS_TESTS_TRACE_VERSION)
+        {
+            bool first_output = true;
+            uint64_t base_ns = UINT64_MAX;
+            long const start = ftell(fp);
+
+            /* Time zero is the earliest event of all sections, so that no
+               event gets a negative timestamp. */
+            result = convert_sections(fp,
+                                      NULL,
+                                      &first_output,
+                                      &base_ns);
+
+            if (result == 0 &&
+                (start == -1 ||
+                 fseek(fp, start, SEEK_SET) != 0))
+            {
+                result = errno;
+            }
+
+            if (result == 0)
+            {
+                fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+                result = convert_sections(fp,
+                                          out,
+                                          &first_output,
+                                          &base_ns);
+
+                fprintf(out, "\n]}\n");
+            }
+        }
+        else if (result == 0)
+        {
+            result = EINVAL;
+            LOG_ERROR("Unsupported trace version %" PRIu32,
+                      version);
+        }
+    }
+    else if (result == 0)
+    {
+        result = EINVAL;
+        LOG_ERROR("Not a mt-fs-tests trace file");
+    }
+
+    return result;
+}
+
+int main(int const argc,
+         char const * const * const argv)
+{
+    int result = 0;
+
+    if (argc == 2 ||
+        argc == 3)
+    {
+        FILE * fp = fopen(argv[1], "rb");
+
+        if (fp != NULL)
+        {
+            FILE * out = argc == 3 ? fopen(argv[2], "w") : stdout;
+
+            if (out != NULL)
+            {
+                result = convert(fp, out);
+
+                if (result != 0)
+                {
+                    LOG_ERROR("Error converting %s: %d",
+                              argv[1],
+                              result);
+                }
+
+                if (out != stdout)
+                {
+                    fclose(out), out = NULL;
+                }
+            }
+            else
+            {
+                result = errno;
+                LOG_ERROR("Error opening %s: %d",
+                          argv[2],
+                          result);
+            }
+
+            fclose(fp), fp = NULL;
+        }
+        else
+        {
+            result = errno;
+            LOG_ERROR("Error opening %s: %d",
+                      argv[1],
+                      result);
+        }
+    }
+    else
+    {
+        result = EINVAL;
+        LOG_ERROR("Usage: %s <trace file> [<json output file>]",
+                  argv[0]);
+    }
+
+    return result;
+}
@@ -0,0 +1,236 @@
+
+#include <assert.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "shared_memory.h"
+#include "trace.h"
+#include "utils.h"
+
+int mt_fs_tests_trace_buffer_init(mt_fs_tests_trace_buffer * const buffer,
+                                  size_t const capacity)
+{
+    int result = 0;
+    assert(buffer != NULL);
+
+    buffer->count = 0;
+    buffer->dropped = 0;
+    buffer->capacity = capacity;
+    buffer->events = NULL;
+
+    if (capacity > 0)
+    {
+        buffer->events = mt_fs_tests_shared_calloc(capacity,
+                                                   sizeof *(buffer->events));
+
+        if (buffer->events != NULL)
+        {
+            /* Fault the pages in now rather than during the run. */
+            memset(buffer->events, 0, sizeof *(buffer->events) * capacity);
+        }
+        else
+        {
+            buffer->capacity = 0;
+            result = ENOMEM;
+        }
+    }
+
+    return result;
+}
+
+void mt_fs_tests_trace_buffer_free(mt_fs_tests_trace_buffer * const buffer)
+{
+    if (buffer != NULL)
+    {
+        mt_fs_tests_shared_free(buffer->events), buffer->events = NULL;
+        buffer->capacity = 0;
+        buffer->count = 0;
+    }
+}
+
+int mt_fs_tests_trace_open(char const * const path,
+                           FILE ** const fp)
+{
+    int result = 0;
+    assert(path != NULL);
+    assert(fp != NULL);
+
+    *fp = fopen(path, "wb");
+
+    if (*fp != NULL)
+    {
+        uint32_t const version = MT_FS_TESTS_TRACE_VERSION;
+
+        if (fwrite(MT_FS_TESTS_TRACE_MAGIC, sizeof MT_FS_TESTS_TRACE_MAGIC, 1, *fp) != 1 ||
+            fwrite(&version, sizeof version, 1, *fp) != 1)
+        {
+            result = EIO;
+            fclose(*fp), *fp = NULL;
+        }
+    }
+    else
+    {
+        result = errno;
+    }
+
+    return result;
+}
+
+static int mt_fs_tests_trace_write_string(FILE * const fp,
+                                          char const * const str)
+{
+    int result = 0;
+    size_t const len = strlen(str);
+    uint32_t const len32 = (uint32_t) len;
+
+    if (fwrite(&len32, sizeof len32, 1, fp) != 1 ||
+        fwrite(str, 1, len, fp) != len)
+    {
+        result = EIO;
+    }
+
+    return result;
+}
+
+static uint32_t mt_fs_tests_trace_name_index(char const ** const names,
+                                             size_t * const nb_names,
+                                             char const * const name)
+{
+    size_t idx = 0;
+
+    while (idx < *nb_names &&
+           names[idx] != name &&
+           strcmp(names[idx], name) != 0)
+    {
+        idx++;
+    }
+
+    if (idx == *nb_names)
+    {
+        names[idx] = name;
+        (*nb_names)++;
+    }
+
+    return (uint32_t) idx;
+}
+
+int mt_fs_tests_trace_write_section(FILE * const fp,
+                                    char const * const suite_name,
+                                    size_t const run_idx,
+                                    mt_fs_tests_trace_buffer const * const * const buffers,
+                                    size_t const nb_threads)
+{
+    int result = 0;
+    uint64_t nb_events = 0;
+    uint64_t dropped = 0;
+    char const ** names = NULL;
+    size_t nb_names = 0;
+    assert(fp != NULL);
+    assert(suite_name != NULL);
+    assert(buffers != NULL);
+
+    for (size_t th_idx = 0;
+         th_idx < nb_threads;
+         th_idx++)
+    {
+        nb_events += buffers[th_idx]->count;
+        dropped += buffers[th_idx]->dropped;
+    }
+
+    /* There can not be more distinct names than events. */
+    names = malloc(sizeof *names * (nb_events > 0 ? nb_events : 1));
+
+    if (names != NULL)
+    {
+        uint32_t const run_idx32 = (uint32_t) run_idx;
+        uint32_t const nb_threads32 = (uint32_t) nb_threads;
+        uint32_t nb_names32 = 0;
+
+        for (size_t th_idx = 0;
+             th_idx < nb_threads;
+             th_idx++)
+        {
+            for (size_t idx = 0;
+                 idx < buffers[th_idx]->count;
+                 idx++)
+            {
+                mt_fs_tests_trace_name_index(names,
+                                             &nb_names,
+                                             buffers[th_idx]->events[idx].name);
+            }
+        }
+
+        nb_names32 = (uint32_t) nb_names;
+
+        result = mt_fs_tests_trace_write_string(fp,
+                                                suite_name);
+
+        if (result == 0 &&
+            (fwrite(&run_idx32, sizeof run_idx32, 1, fp) != 1 ||
+             fwrite(&nb_threads32, sizeof nb_threads32, 1, fp) != 1 ||
+             fwrite(&nb_names32, sizeof nb_names32, 1, fp) != 1))
+        {
+            result = EIO;
+        }
+
+        for (size_t idx = 0;
+             result == 0 &&
+                 idx < nb_names;
+             idx++)
+        {
+            result = mt_fs_tests_trace_write_string(fp,
+                                                    names[idx]);
+        }
+
+        if (result == 0 &&
+            fwrite(&nb_events, sizeof nb_events, 1, fp) != 1)
+        {
+            result = EIO;
+        }
+
+        for (size_t th_idx = 0;
+             result == 0 &&
+                 th_idx < nb_threads;
+             th_idx++)
+        {
+            for (size_t idx = 0;
+                 result == 0 &&
+                     idx < buffers[th_idx]->count;
+                 idx++)
+            {
+                mt_fs_tests_trace_event const * const event = &(buffers[th_idx]->events[idx]);
+                mt_fs_tests_trace_file_event const file_event =
+                    {
+                        .timestamp_ns = event->timestamp_ns,
+                        .thread = (uint32_t) th_idx,
+                        .name_idx = mt_fs_tests_trace_name_index(names,
+                                                                 &nb_names,
+                                                                 event->name),
+                        .result = event->result,
+                        .phase = event->phase
+                    };
+
+                if (fwrite(&file_event, sizeof file_event, 1, fp) != 1)
+                {
+                    result = EIO;
+                }
+            }
+        }
+
+        free(names), names = NULL;
+    }
+    else
+    {
+        result = ENOMEM;
+    }
+
+    if (dropped > 0)
+    {
+        LOG_ERROR("%s: %llu trace events dropped, trace buffers are full",
+                  suite_name,
+                  (unsigned long long) dropped);
+    }
+
+    return result;
+}
@@ -0,0 +1,287 @@
+
+#include <assert.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MT_FS_TESTS_VERIFY_X86
+#include <immintrin.h>
+#endif
+
+#include "verify.h"
+
+#define CRC32C_POLYNOMIAL (UINT32_C(0x82F63B78)) /* reversed */
+
+typedef size_t (*mt_fs_tests_verify_pattern_fn)(uint8_t const * buffer,
+                                                size_t size,
+                                                uint8_t pattern);
+
+typedef uint32_t (*mt_fs_tests_crc32c_fn)(uint32_t crc,
+                                          uint8_t const * buffer,
+                                          size_t size);
+
+static pthread_once_t verify_once = PTHREAD_ONCE_INIT;
+static uint32_t crc32c_table[8][256];
+static mt_fs_tests_verify_pattern_fn verify_pattern_impl = NULL;
+static mt_fs_tests_crc32c_fn crc32c_impl = NULL;
+static char const * implementation_name = NULL;
+
+static size_t mt_fs_tests_verify_pattern_scalar(uint8_t const * const buffer,
+                                                size_t const size,
+                                                uint8_t const pattern)
+{
+    uint64_t const expected = UINT64_C(0x0101010101010101) * pattern;
+    size_t idx = 0;
+
+    for (;
+         idx + sizeof expected <= size;
+         idx += sizeof expected)
+    {
+        uint64_t word;
+        memcpy(&word, buffer + idx, sizeof word);
+
+        if (word != expected)
+        {
+            break;
+        }
+    }
+
+    while (idx < size &&
+           buffer[idx] == pattern)
+    {
+        idx++;
+    }
+
+    return idx;
+}
+
+static uint32_t mt_fs_tests_crc32c_scalar(uint32_t crc,
+                                          uint8_t const * buffer,
+                                          size_t size)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    while (size >= sizeof (uint64_t))
+    {
+        uint64_t word;
+        uint32_t high = 0;
+        memcpy(&word, buffer, sizeof word);
+
+        crc ^= (uint32_t) word;
+        high = (uint32_t) (word >> 32);
+
+        crc = crc32c_table[7][crc & 0xFF] ^
+            crc32c_table[6][(crc >> 8) & 0xFF] ^
+            crc32c_table[5][(crc >> 16) & 0xFF] ^
+            crc32c_table[4][crc >> 24] ^
+            crc32c_table[3][high & 0xFF] ^
+            crc32c_table[2][(high >> 8) & 0xFF] ^
+            crc32c_table[1][(high >> 16) & 0xFF] ^
+            crc32c_table[0][high >> 24];
+
+        buffer += sizeof word;
+        size -= sizeof word;
+    }
+#endif
+
+    while (size > 0)
+    {
+        crc = crc32c_table[0][(crc ^ *buffer) & 0xFF] ^ (crc >> 8);
+        buffer++;
+        size--;
+    }
+
+    return crc;
+}
+
+#if defined(MT_FS_TESTS_VERIFY_X86)
+
+__attribute__ ((__target__("avx2")))
+static size_t mt_fs_tests_verify_pattern_avx2(uint8_t const * const buffer,
+                                              size_t const size,
+                                              uint8_t const pattern)
+{
+    __m256i const expected = _mm256_set1_epi8((char) pattern);
+    size_t idx = 0;
+
+    /* Four vectors per iteration, the mismatching one being found by the
+       next loop. */
+    for (;
+         idx + 4 * sizeof expected <= size;
+         idx += 4 * sizeof expected)
+    {
+        __m256i const v0 = _mm256_loadu_si256((__m256i const *) (void const *) (buffer + idx));
+        __m256i const v1 = _mm256_loadu_si256((__m256i const *) (void const *) (buffer + idx + sizeof expected));
+        __m256i const v2 = _mm256_loadu_si256((__m256i const *) (void const *) (buffer + idx + 2 * sizeof expected));
+        __m256i const v3 = _mm256_loadu_si256((__m256i const *) (void const *) (buffer + idx + 3 * sizeof expected));
+        __m256i const eq = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(v0, expected),
+                                                             _mm256_cmpeq_epi8(v1, expected)),
+                                            _mm256_and_si256(_mm256_cmpeq_epi8(v2, expected),
+                                                             _mm256_cmpeq_epi8(v3, expected)));
+
+        if (_mm256_movemask_epi8(eq) != -1)
+        {
+            break;
+        }
+    }
+
+    for (;
+         idx + sizeof expected <= size;
+         idx += sizeof expected)
+    {
+        __m256i const v = _mm256_loadu_si256((__m256i const *) (void const *) (buffer + idx));
+
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, expected)) != -1)
+        {
+            break;
+        }
+    }
+
+    return idx + mt_fs_tests_verify_pattern_scalar(buffer + idx,
+                                                   size - idx,
+                                                   pattern);
+}
+
+__attribute__ ((__target__("sse4.2")))
+static uint32_t mt_fs_tests_crc32c_sse42(uint32_t crc,
+                                         uint8_t const * buffer,
+                                         size_t size)
+{
+#if defined(__x86_64__)
+    uint64_t crc64 = crc;
+
+    while (size >= sizeof (uint64_t))
+    {
+        uint64_t word;
+        memcpy(&word, buffer, sizeof word);
+
+        crc64 = _mm_crc32_u64(crc64, word);
+
+        buffer += sizeof word;
+        size -= sizeof word;
+    }
+
+    crc = (uint32_t) crc64;
+#endif
+
+    while (size >= sizeof (uint32_t))
+    {
+        uint32_t word;
+        memcpy(&word, buffer, sizeof word);
+
+        crc = _mm_crc32_u32(crc, word);
+
+        buffer += sizeof word;
+        size -= sizeof word;
+    }
+
+    while (size > 0)
+    {
+        crc = _mm_crc32_u8(crc, *buffer);
+        buffer++;
+        size--;
+    }
+
+    return crc;
+}
+
+#endif /* MT_FS_TESTS_VERIFY_X86 */
+
+static void mt_fs_tests_verify_init(void)
+{
+    for (uint32_t idx = 0;
+         idx < 256;
+         idx++)
+    {
+        uint32_t crc = idx;
+
+        for (size_t bit = 0;
+             bit < 8;
+             bit++)
+        {
+            crc = (crc & 1) != 0 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+
+        crc32c_table[0][idx] = crc;
+    }
+
+    for (size_t idx = 0;
+         idx < 256;
+         idx++)
+    {
+        for (size_t slice = 1;
+             slice < 8;
+             slice++)
+        {
+            uint32_t const previous = crc32c_table[slice - 1][idx];
+            crc32c_table[slice][idx] = crc32c_table[0][previous & 0xFF] ^ (previous >> 8);
+        }
+    }
+
+    verify_pattern_impl = &mt_fs_tests_verify_pattern_scalar;
+    crc32c_impl = &mt_fs_tests_crc32c_scalar;
+    implementation_name = "scalar compare, table CRC32C";
+
+#if defined(MT_FS_TESTS_VERIFY_X86)
+    __builtin_cpu_init();
+
+    {
+        bool const avx2 = __builtin_cpu_supports("avx2") != 0;
+        bool const sse42 = __builtin_cpu_supports("sse4.2") != 0;
+
+        if (avx2 == true)
+        {
+            verify_pattern_impl = &mt_fs_tests_verify_pattern_avx2;
+        }
+
+        if (sse42 == true)
+        {
+            crc32c_impl = &mt_fs_tests_crc32c_sse42;
+        }
+
+        if (avx2 == true && sse42 == true)
+        {
+            implementation_name = "AVX2 compare, SSE4.2 CRC32C";
+        }
+        else if (avx2 == true)
+        {
+            implementation_name = "AVX2 compare, table CRC32C";
+        }
+        else if (sse42 == true)
+        {
+            implementation_name = "scalar compare, SSE4.2 CRC32C";
+        }
+    }
+#endif
+}
+
+size_t mt_fs_tests_verify_pattern(void const * const buffer,
+                                  size_t const size,
+                                  uint8_t const pattern)
+{
+    assert(buffer != NULL || size == 0);
+    pthread_once(&verify_once, &mt_fs_tests_verify_init);
+
+    return (*verify_pattern_impl)(buffer,
+                                  size,
+                                  pattern);
+}
+
+uint32_t mt_fs_tests_crc32c(uint32_t const crc,
+                            void const * const buffer,
+                            size_t const size)
+{
+    assert(buffer != NULL || size == 0);
+    pthread_once(&verify_once, &mt_fs_tests_verify_init);
+
+    return ~(*crc32c_impl)(~crc,
+                           buffer,
+                           size);
+}
+
+char const * mt_fs_tests_verify_implementation(void)
+{
+    pthread_once(&verify_once, &mt_fs_tests_verify_init);
+
+    return implementation_name;
+}